@@ -0,0 +1,48 @@
+#include "active_object_list.h"
+#include "object.h"
+
+namespace kglt {
+
+void ActiveObjectList::add(Object* object) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if(object->active_slot_ >= 0) {
+        return;
+    }
+
+    object->active_slot_ = objects_.size();
+    objects_.push_back(object);
+}
+
+void ActiveObjectList::remove(Object* object) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if(object->active_slot_ < 0) {
+        return;
+    }
+
+    objects_[object->active_slot_] = nullptr;
+    object->active_slot_ = -1;
+    has_gaps_ = true;
+}
+
+void ActiveObjectList::compact() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if(!has_gaps_) {
+        return;
+    }
+
+    uint32_t count = 0;
+    for(Object* object: objects_) {
+        if(object) {
+            object->active_slot_ = count;
+            objects_[count++] = object;
+        }
+    }
+
+    objects_.resize(count);
+    has_gaps_ = false;
+}
+
+}
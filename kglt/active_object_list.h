@@ -0,0 +1,42 @@
+#ifndef ACTIVE_OBJECT_LIST_H
+#define ACTIVE_OBJECT_LIST_H
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "generic/managed.h"
+
+namespace kglt {
+
+class Object;
+
+/*
+ *  The objects in a Stage which need updating every step. Objects add themselves when they
+ *  gain some behaviour (a constraint, a playing sound, an animation...) and are dropped after
+ *  an update in which they no longer have any (see Object::wants_update), so the cost of
+ *  updating a stage depends on how much is going on in it rather than how big it is.
+ *
+ *  Removing an object only clears its entry so that the list can be modified while it's being
+ *  iterated, compact() closes the gaps afterwards.
+ */
+class ActiveObjectList:
+    public Managed<ActiveObjectList> {
+
+public:
+    void add(Object* object);
+    void remove(Object* object);
+    void compact();
+
+    uint32_t size() const { return objects_.size(); }
+    Object* at(uint32_t i) const { return objects_[i]; } ///< Null if the object was removed
+
+private:
+    std::mutex mutex_;
+    std::vector<Object*> objects_;
+    bool has_gaps_ = false;
+};
+
+}
+
+#endif // ACTIVE_OBJECT_LIST_H
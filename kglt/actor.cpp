@@ -1,4 +1,5 @@
 #include "stage.h"
+#include "partitioner.h"
 #include "actor.h"
 
 namespace kglt {
@@ -77,7 +78,11 @@ const AABB Actor::transformed_aabb() const {
 }
 
 void Actor::ask_owner_for_destruction() {
-    stage()->delete_actor(id());
+    stage()->defer(std::bind(&Stage::delete_actor, stage(), id()));
+}
+
+void Actor::transformation_changed() {
+    stage()->partitioner().actor_moved(id());
 }
 
 const MaterialID SubActor::material_id() const {
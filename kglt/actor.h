@@ -58,6 +58,10 @@ public:
 
     void ask_owner_for_destruction();
 
+    //Streaming sounds and constraints reach outside the actor, so those have to stay on the main thread
+    bool is_parallel_update_safe() const override { return !is_constrained() && !has_sound_instances(); }
+    bool wants_update() const override { return Object::wants_update() || has_sound_instances(); }
+
     RenderPriority render_priority() const { return render_priority_; }
     void set_render_priority(RenderPriority value) { render_priority_ = value;}
 
@@ -83,6 +87,9 @@ private:
         update_source(dt);
     }
 
+    void on_sound_played() override { activate_updates(); }
+    void transformation_changed() override;
+
     std::shared_ptr<ResponsiveBody> body_;
 
     void rebuild_subactors();
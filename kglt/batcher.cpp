@@ -14,6 +14,45 @@
 
 namespace kglt {
 
+void FrameResources::begin(StageID stage) {
+    end(); //In case the last pipeline was interrupted by an exception
+    if(stage) {
+        stage_ = window_.BaseStageManager::manager_get(stage).lock();
+    }
+}
+
+void FrameResources::end() {
+    cameras_.clear();
+    materials_.clear();
+    textures_.clear();
+    lights_.clear();
+    stage_.reset();
+}
+
+Camera* FrameResources::camera(CameraID id) {
+    return cameras_.get(id, [this](CameraID cid) {
+        return window_.CameraManager::manager_get(cid).lock();
+    });
+}
+
+Material* FrameResources::material(MaterialID id) {
+    return materials_.get(id, [this](MaterialID mid) {
+        return window_.MaterialManager::manager_get(mid).lock();
+    });
+}
+
+Texture* FrameResources::texture(TextureID id) {
+    return textures_.get(id, [this](TextureID tid) {
+        return window_.TextureManager::manager_get(tid).lock();
+    });
+}
+
+Light* FrameResources::light(LightID id) {
+    return lights_.get(id, [this](LightID lid) {
+        return stage_->LightManager::manager_get(lid).lock();
+    });
+}
+
 void RootGroup::bind(GPUProgram *program) {
 }
 
@@ -25,7 +64,7 @@ StagePtr RootGroup::stage() {
     return window_.stage(stage_id_);
 }
 
-void RootGroup::generate_mesh_groups(RenderGroup* parent, Renderable &ent, MaterialPass& pass, const std::vector<LightID>& lights) {
+void RootGroup::generate_mesh_groups(RenderGroup* parent, Renderable &ent, MaterialPass& pass, const LightList& lights) {
     /*
      *  Here we add the entities to the leaves of the tree. If the Renderable can return an instanced_mesh_id we create an
      *  InstancedMeshGroup, otherwise a simple basic RenderableGroup. At the moment THERE IS NO DIFFERENCE BETWEEN THESE TWO THINGS,
@@ -70,11 +109,11 @@ void RootGroup::generate_mesh_groups(RenderGroup* parent, Renderable &ent, Mater
     }
 }
 
-void RootGroup::insert(Renderable &ent, uint8_t pass_number, const std::vector<LightID>& lights) {
+void RootGroup::insert(Renderable &ent, uint8_t pass_number, const LightList& lights) {
     if(!ent.is_visible()) return;
 
     //Get the material for the actor, this is used to build the tree
-    auto mat = stage()->material(ent.material_id());
+    auto mat = resources_.material(ent.material_id());
 
     MaterialPass& pass = mat->pass(pass_number);
 
@@ -124,7 +163,7 @@ void LightGroup::bind(GPUProgram* program) {
     }
 
     RootGroup& root = static_cast<RootGroup&>(get_root());
-    auto light = root.stage()->light(data_.light_id);
+    Light* light = root.resources().light(data_.light_id);
 
     if(program->uniforms().uses_auto(SP_AUTO_LIGHT_POSITION)) {
         Vec4 light_pos = Vec4(light->absolute_position(), (light->type() == LIGHT_TYPE_DIRECTIONAL) ? 0.0 : 1.0);
@@ -200,7 +239,7 @@ void ShaderGroup::bind(GPUProgram* program) {
     if(params.uses_auto(SP_AUTO_LIGHT_GLOBAL_AMBIENT)) {
         params.set_colour(
             params.auto_variable_name(SP_AUTO_LIGHT_GLOBAL_AMBIENT),
-            root.stage()->ambient_light()
+            root.resources().stage().ambient_light()
         );
     }
 }
@@ -239,7 +278,7 @@ void DepthGroup::unbind(GPUProgram *program) {
 void TextureGroup::bind(GPUProgram* program) {
     GLCheck(glActiveTexture, GL_TEXTURE0 + data_.unit);
     RootGroup& root = static_cast<RootGroup&>(get_root());
-    GLCheck(glBindTexture, GL_TEXTURE_2D, root.stage()->texture(data_.texture_id)->gl_tex());
+    GLCheck(glBindTexture, GL_TEXTURE_2D, root.resources().texture(data_.texture_id)->gl_tex());
 }
 
 void TextureGroup::unbind(GPUProgram *program) {
@@ -297,9 +336,9 @@ void MaterialGroup::bind(GPUProgram* program) {
     }
 
     if(program->uniforms().uses_auto(SP_AUTO_MATERIAL_ACTIVE_TEXTURE_UNITS)) {
-        auto uniform_name = program->uniforms().auto_variable_name(SP_AUTO_MATERIAL_ACTIVE_TEXTURE_UNITS);
+        const unicode& uniform_name = program->uniforms().auto_variable_name(SP_AUTO_MATERIAL_ACTIVE_TEXTURE_UNITS);
 
-        auto info = program->uniforms().info(uniform_name);
+        const UniformInfo& info = program->uniforms().info(uniform_name);
         if(info.type == GL_FLOAT) {
             static bool logged = false;
 
@@ -1,12 +1,13 @@
 #ifndef BATCHER_H_INCLUDED
 #define BATCHER_H_INCLUDED
 
-#include <list>
 #include <unordered_map>
 #include <memory>
 #include <kazbase/exceptions.h>
 #include "kglt/types.h"
 #include "generic/auto_weakptr.h"
+#include "generic/frame_cache.h"
+#include "generic/linear_arena.h"
 
 namespace kglt {
 
@@ -21,6 +22,43 @@ class Stage;
 class SubActor;
 class Camera;
 class MaterialPass;
+class Material;
+class Texture;
+class Light;
+
+/*
+ *  Read-only access to the camera, materials, textures and lights used while rendering a
+ *  pipeline. Each ID is looked up in its manager once per pipeline rather than per draw, and no
+ *  ProtectedPtr (with its heap-allocated lock) is created, see generic::FrameCache. Lights can
+ *  only be looked up between begin() and end() with a stage, UI pipelines have none.
+ *
+ *  Gameplay code still goes through the locked accessors, but isn't serialised against these
+ *  reads. That's no different to the renderables themselves, which were never locked.
+ */
+class FrameResources {
+public:
+    FrameResources(WindowBase& window):
+        window_(window) {}
+
+    void begin(StageID stage);
+    void end();
+
+    Stage& stage() { return *stage_; }
+
+    Camera* camera(CameraID id);
+    Material* material(MaterialID id);
+    Texture* texture(TextureID id);
+    Light* light(LightID id);
+
+private:
+    WindowBase& window_;
+    std::shared_ptr<Stage> stage_;
+
+    generic::FrameCache<CameraID, Camera> cameras_;
+    generic::FrameCache<MaterialID, Material> materials_;
+    generic::FrameCache<TextureID, Texture> textures_;
+    generic::FrameCache<LightID, Light> lights_;
+};
 
 struct GroupData {
     typedef std::shared_ptr<GroupData> ptr;
@@ -45,12 +83,18 @@ public:
     typedef std::shared_ptr<RenderGroup> ptr;
 
     RenderGroup(RenderGroup* parent):
-        parent_(parent) {
+        parent_(parent),
+        arena_(parent->arena_),
+        children_(0, ChildKeyHash(), std::equal_to<ChildKey>(), ChildAllocator(arena_)),
+        renderables_(RenderableAllocator(arena_)) {
 
     }
 
+    virtual ~RenderGroup() {}
+
     ///Traverses the tree and calls the callback on each subactor we encounter
-    void traverse(std::function<void (Renderable&, MaterialPass&)> callback) {
+    template<typename Callback>
+    void traverse(const Callback& callback) {
         bind(get_root().current_program());
 
         for(auto& p: renderables_) {
@@ -60,10 +104,8 @@ public:
             callback(*p.first, *p.second);
         }
 
-        for(std::pair<std::size_t, RenderGroups> groups: this->children_) {
-            for(std::pair<std::size_t, std::shared_ptr<RenderGroup>> group: groups.second) {
-                group.second->traverse(callback);
-            }
+        for(auto& child: children_) {
+            child.second->traverse(callback);
         }
 
         unbind(get_root().current_program());
@@ -73,19 +115,17 @@ public:
     RenderGroup& get_or_create(const GroupData& data) {
         static_assert(std::is_base_of<RenderGroup, RenderGroupType>::value, "RenderGroupType must derive RenderGroup");
 
-        size_t identifier = typeid(RenderGroupType).hash_code();
-
-        auto& container = children_[identifier];
+        ChildKey key(typeid(RenderGroupType).hash_code(), data.hash());
 
         const typename RenderGroupType::data_type& cast_data = static_cast<const typename RenderGroupType::data_type&>(data);
 
-        RenderGroups::const_iterator it = container.find(data.hash());
+        auto it = children_.find(key);
 
-        if(it != container.end()) {
+        if(it != children_.end()) {
             return *(*it).second;
         } else {
-            std::shared_ptr<RenderGroupType> new_child(new RenderGroupType(this, cast_data));
-            container.insert(std::make_pair(cast_data.hash(), new_child));
+            RenderGroupType* new_child = arena_.create<RenderGroupType>(this, cast_data);
+            children_.insert(std::make_pair(key, generic::ArenaPtr<RenderGroup>(new_child)));
             return *new_child;
         }
     }
@@ -94,38 +134,22 @@ public:
     bool exists(const GroupData& data) const {
         static_assert(std::is_base_of<RenderGroup, RenderGroupType>::value, "RenderGroupType must derive RenderGroup");
 
-        std::size_t hash = typeid(RenderGroupType).hash_code();
-
-        typename RenderGroupChildren::const_iterator it = children_.find(hash);
-        if(it == children_.end()) {
-            return false;
-        }
-
-        const RenderGroups& container = (*it).second;
-
-        return container.find(data.hash()) != container.end();
+        ChildKey key(typeid(RenderGroupType).hash_code(), data.hash());
+        return children_.find(key) != children_.end();
     }
 
     template<typename RenderGroupType>
     RenderGroup& get(const GroupData& data) {
         static_assert(std::is_base_of<RenderGroup, RenderGroupType>::value, "RenderGroupType must derive RenderGroup");
 
-        std::size_t hash = typeid(RenderGroupType).hash_code();
+        ChildKey key(typeid(RenderGroupType).hash_code(), data.hash());
 
-        typename RenderGroupChildren::const_iterator child_it = children_.find(hash);
-        if(child_it == children_.end()) {
+        auto it = children_.find(key);
+        if(it == children_.end()) {
             throw DoesNotExist<RenderGroupType>();
         }
 
-        const RenderGroups& container = (*child_it).second;
-
-        RenderGroups::const_iterator it = container.find(data.hash());
-
-        if(it != container.end()) {
-            return *(*it).second;
-        } else {
-            throw DoesNotExist<RenderGroupType>();
-        }
+        return *(*it).second;
     }
 
     void add(Renderable* renderable, MaterialPass* pass) {
@@ -141,11 +165,6 @@ public:
 
     void clear() {
         renderables_.clear();
-        for(auto groups: children_) {
-            for(auto group: groups.second) {
-                group.second->clear();
-            }
-        }
         children_.clear();
     }
 
@@ -155,13 +174,39 @@ public:
 protected:
     RenderGroup* parent_;
 
+    /* For the root, which has no parent to take the arena from */
+    RenderGroup(generic::LinearArena& arena):
+        parent_(nullptr),
+        arena_(arena),
+        children_(0, ChildKeyHash(), std::equal_to<ChildKey>(), ChildAllocator(arena_)),
+        renderables_(RenderableAllocator(arena_)) {
+
+    }
+
 private:
-    typedef std::unordered_map<std::size_t, std::shared_ptr<RenderGroup> > RenderGroups;
-    typedef std::unordered_map<std::size_t, RenderGroups> RenderGroupChildren;
+    /*
+     * Groups are rebuilt every frame, so the nodes and the containers linking them all come
+     * from the frame arena. Children are keyed on their group type and data.
+     */
+    typedef std::pair<std::size_t, std::size_t> ChildKey;
+
+    struct ChildKeyHash {
+        std::size_t operator()(const ChildKey& key) const {
+            std::size_t seed = key.first;
+            hash_combine(seed, key.second);
+            return seed;
+        }
+    };
+
+    typedef std::pair<const ChildKey, generic::ArenaPtr<RenderGroup>> Child;
+    typedef generic::ArenaAllocator<Child> ChildAllocator;
+    typedef std::pair<Renderable*, MaterialPass*> RenderableEntry;
+    typedef generic::ArenaAllocator<RenderableEntry> RenderableAllocator;
 
-    RenderGroupChildren children_;
+    generic::LinearArena& arena_;
 
-    std::list<std::pair<Renderable*, MaterialPass*> > renderables_;
+    std::unordered_map<ChildKey, generic::ArenaPtr<RenderGroup>, ChildKeyHash, std::equal_to<ChildKey>, ChildAllocator> children_;
+    std::vector<RenderableEntry, RenderableAllocator> renderables_;
 
     GPUProgram* current_program_ = nullptr;
 };
@@ -171,9 +216,10 @@ public:
     typedef std::shared_ptr<RootGroup> ptr;
     typedef int data_type;
 
-    RootGroup(WindowBase& window, StageID stage, CameraID camera):
-        RenderGroup(nullptr),
+    RootGroup(WindowBase& window, FrameResources& resources, generic::LinearArena& arena, StageID stage, CameraID camera):
+        RenderGroup(arena),
         window_(window),
+        resources_(resources),
         stage_id_(stage),
         camera_id_(camera){}
 
@@ -187,14 +233,17 @@ public:
     StagePtr stage();
     ProtectedPtr<CameraProxy> camera();
 
-    void insert(Renderable& ent, uint8_t pass_number, const std::vector<kglt::LightID> &lights);
+    FrameResources& resources() { return resources_; }
+
+    void insert(Renderable& ent, uint8_t pass_number, const LightList& lights);
 
 private:
     WindowBase& window_;
+    FrameResources& resources_;
     StageID stage_id_;
     CameraID camera_id_;
 
-    void generate_mesh_groups(RenderGroup* parent, Renderable& ent, MaterialPass& pass, const std::vector<kglt::LightID> &lights);
+    void generate_mesh_groups(RenderGroup* parent, Renderable& ent, MaterialPass& pass, const LightList& lights);
 };
 
 
@@ -1,4 +1,5 @@
 #include <cassert>
+#include <algorithm>
 
 #include "utils/glcompat.h"
 
@@ -9,6 +10,67 @@
 
 namespace kglt {
 
+const uint32_t DirtyRanges::MAX_RANGES;
+
+void DirtyRanges::mark(uint32_t first, uint32_t count) {
+    if(all_ || !count) {
+        return;
+    }
+
+    //Fast path, sequential writes just extend the last range
+    if(!ranges_.empty()) {
+        Range& last = ranges_.back();
+        if(first >= last.first && first <= last.end()) {
+            last.count = std::max(last.end(), first + count) - last.first;
+            return;
+        }
+    }
+
+    Range range = { first, count };
+    auto it = std::lower_bound(ranges_.begin(), ranges_.end(), range, [](const Range& lhs, const Range& rhs) {
+        return lhs.first < rhs.first;
+    });
+
+    //Merge with the previous range if it touches this one
+    if(it != ranges_.begin() && (it - 1)->end() >= first) {
+        --it;
+        it->count = std::max(it->end(), first + count) - it->first;
+    } else {
+        it = ranges_.insert(it, range);
+    }
+
+    //Swallow any following ranges that now touch
+    auto next = it + 1;
+    while(next != ranges_.end() && next->first <= it->end()) {
+        it->count = std::max(it->end(), next->end()) - it->first;
+        ++next;
+    }
+    ranges_.erase(it + 1, next);
+
+    if(ranges_.size() > MAX_RANGES) {
+        //Merge the two ranges with the smallest gap between them
+        uint32_t closest = 0;
+        for(uint32_t i = 1; i < ranges_.size() - 1; ++i) {
+            if(ranges_[i + 1].first - ranges_[i].end() < ranges_[closest + 1].first - ranges_[closest].end()) {
+                closest = i;
+            }
+        }
+
+        ranges_[closest].count = ranges_[closest + 1].end() - ranges_[closest].first;
+        ranges_.erase(ranges_.begin() + closest + 1);
+    }
+}
+
+void DirtyRanges::mark_all() {
+    all_ = true;
+    ranges_.clear();
+}
+
+void DirtyRanges::clear() {
+    all_ = false;
+    ranges_.clear();
+}
+
 BufferObject::BufferObject(BufferObjectType type, BufferObjectUsage usage):
     usage_(usage),
     gl_target_(0),
@@ -119,6 +181,7 @@ void BufferObject::build(uint32_t byte_size, const void* data) {
 
     GLCheck(glBindBuffer, gl_target_, buffer_id_);
     GLCheck(glBufferData, gl_target_, byte_size, data, usage());
+    size_ = byte_size;
 }
 
 void BufferObject::modify(uint32_t offset, uint32_t byte_size, const void* data) {
@@ -128,6 +191,24 @@ void BufferObject::modify(uint32_t offset, uint32_t byte_size, const void* data)
     GLCheck(glBufferSubData, gl_target_, offset, byte_size, data);
 }
 
+void BufferObject::update(uint32_t byte_size, const void* data, const DirtyRanges& dirty, uint32_t element_size) {
+    if(dirty.all() || !buffer_id_ || byte_size != size_) {
+        build(byte_size, data);
+        return;
+    }
+
+    const uint8_t* bytes = (const uint8_t*) data;
+    for(const DirtyRanges::Range& range: dirty.ranges()) {
+        uint32_t offset = range.first * element_size;
+        if(offset >= byte_size) {
+            continue;
+        }
+
+        uint32_t length = std::min(range.count * element_size, byte_size - offset);
+        modify(offset, length, bytes + offset);
+    }
+}
+
 VertexArrayObject::VertexArrayObject(BufferObjectUsage vertex_usage, BufferObjectUsage index_usage){
     vertex_buffer_ = BufferObject::create(BUFFER_OBJECT_VERTEX_DATA, vertex_usage);
     index_buffer_ = BufferObject::create(BUFFER_OBJECT_INDEX_DATA, index_usage);
@@ -167,4 +248,12 @@ void VertexArrayObject::index_buffer_update_partial(uint32_t offset, uint32_t by
     index_buffer_->modify(offset, byte_size, data);
 }
 
+void VertexArrayObject::vertex_buffer_update(uint32_t byte_size, const void* data, const DirtyRanges& dirty, uint32_t element_size) {
+    vertex_buffer_->update(byte_size, data, dirty, element_size);
+}
+
+void VertexArrayObject::index_buffer_update(uint32_t byte_size, const void* data, const DirtyRanges& dirty, uint32_t element_size) {
+    index_buffer_->update(byte_size, data, dirty, element_size);
+}
+
 }
@@ -26,6 +26,37 @@ enum BufferObjectUsage {
     MODIFY_REPEATEDLY_USED_FOR_QUERYING_AND_RENDERING
 };
 
+/*
+ *  Tracks which elements (e.g. vertices or indices) of a buffer have been modified since it was
+ *  last uploaded. Overlapping and adjacent ranges are coalesced and if too many separate ranges
+ *  build up the closest ones are merged, so uploads never turn into lots of tiny transfers.
+ */
+class DirtyRanges {
+public:
+    struct Range {
+        uint32_t first;
+        uint32_t count;
+
+        uint32_t end() const { return first + count; }
+    };
+
+    static const uint32_t MAX_RANGES = 16;
+
+    void mark(uint32_t first, uint32_t count=1);
+    void mark_all();
+    void clear();
+
+    bool all() const { return all_; }
+    bool empty() const { return !all_ && ranges_.empty(); }
+
+    const std::vector<Range>& ranges() const { return ranges_; }
+
+private:
+    //Nothing has been uploaded to begin with
+    bool all_ = true;
+    std::vector<Range> ranges_;
+};
+
 class BufferObject : public Managed<BufferObject> {
 public:
     BufferObject(BufferObjectType type, BufferObjectUsage usage=MODIFY_ONCE_USED_FOR_RENDERING);
@@ -36,6 +67,14 @@ public:
     void modify(uint32_t offset, uint32_t byte_size, const void* data);
     void release();
 
+    /*
+     * Uploads only the dirty elements of data. The whole buffer is rebuilt if everything is
+     * dirty or byte_size differs from the size of the buffer on the GPU.
+     */
+    void update(uint32_t byte_size, const void* data, const DirtyRanges& dirty, uint32_t element_size);
+
+    uint32_t size() const { return size_; }
+
     const std::vector<uint8_t>& offline_data() { return offline_data_; }
 
     GLenum usage() const;
@@ -46,6 +85,7 @@ private:
 
     uint32_t gl_target_;
     uint32_t buffer_id_;
+    uint32_t size_ = 0;
 
     std::vector<uint8_t> offline_data_;
 };
@@ -65,6 +105,9 @@ public:
     void index_buffer_update(uint32_t byte_size, const void* data);
     void index_buffer_update_partial(uint32_t offset, uint32_t byte_size, const void* data);
 
+    void vertex_buffer_update(uint32_t byte_size, const void* data, const DirtyRanges& dirty, uint32_t element_size);
+    void index_buffer_update(uint32_t byte_size, const void* data, const DirtyRanges& dirty, uint32_t element_size);
+
 private:
     void vertex_buffer_bind() { vertex_buffer_->bind(); }
     void index_buffer_bind() { index_buffer_->bind(); }
@@ -44,6 +44,7 @@ void CameraProxy::follow(ActorID actor, const kglt::Vec3& offset, float lag_in_s
     following_offset_ = offset;
     following_lag_ = lag_in_seconds;
 
+    activate_updates();
     _update_following(1.0);
 }
 
@@ -68,8 +69,6 @@ void CameraProxy::_update_following(double dt) {
         Vec3 new_absolute = rotated_offset + actor_position;
         set_absolute_position(new_absolute);
         assert(new_absolute == absolute_position());
-
-        update_from_parent();
     } else {
         //The actor was destroyed, so reset
         following_actor_ = ActorID();
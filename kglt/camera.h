@@ -32,6 +32,8 @@ public:
 
     void _update_following(double dt);
 
+    bool wants_update() const override { return Object::wants_update() || bool(following_actor_); }
+
     Frustum& frustum();
     kmVec3 project_point(const RenderTarget &target, const Viewport& viewport, const kmVec3& point);
 
@@ -1,5 +1,9 @@
+#include <algorithm>
+
 #include "../../window.h"
+#include "../../stage.h"
 #include "../../actor.h"
+#include "../../partitioner.h"
 
 #include "boid.h"
 
@@ -99,6 +103,43 @@ kglt::Vec3 Boid::separate(const std::vector<Boid::ptr> others) {
         }
     }
 
+    return steer_away(sum, count);
+}
+
+kglt::Vec3 Boid::separate() {
+    float desired_sep = actor_->radius() * 2;
+    kglt::Vec3 position = actor_->position();
+
+    nearby_.clear();
+    actor_->stage()->partitioner().geometry_within(position, desired_sep, nearby_);
+
+    auto& own = actor_->actor()->_subactors();
+
+    kglt::Vec3 sum;
+    int32_t count = 0;
+    for(Renderable* other: nearby_) {
+        bool is_self = std::any_of(own.begin(), own.end(), [other](const std::shared_ptr<SubActor>& subactor) {
+            return subactor.get() == other;
+        });
+
+        if(is_self) {
+            continue;
+        }
+
+        float d = kglt::Vec3::distance(position, other->centre());
+        if((d > 0) && (d < desired_sep)) {
+            kglt::Vec3 diff = position - other->centre();
+            diff.normalize();
+            diff /= d;
+            sum += diff;
+            count++;
+        }
+    }
+
+    return steer_away(sum, count);
+}
+
+kglt::Vec3 Boid::steer_away(kglt::Vec3 sum, int32_t count) const {
     if(count > 0) {
         sum /= count;
         sum.normalize();
@@ -29,6 +29,12 @@ public:
 
     kglt::Vec3 separate(const std::vector<Boid::ptr> others);
 
+    /*
+     * Steers away from whatever geometry is too close, rather than from a list of other boids.
+     * The stage's partitioner finds what's nearby, so this doesn't look at everything.
+     */
+    kglt::Vec3 separate();
+
 private:
     MoveableActorHolder* actor_;
 
@@ -41,6 +47,9 @@ private:
 
     mutable std::vector<kglt::Vec3> normal_points_;
     void update_debug_mesh() const;
+
+    RenderableList nearby_;
+    kglt::Vec3 steer_away(kglt::Vec3 sum, int32_t count) const;
 };
 
 float map(float value, float min, float max, float new_min, float new_max);
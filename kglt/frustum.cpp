@@ -1,4 +1,12 @@
+#include <algorithm>
 #include <cassert>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
 #include "frustum.h"
 #include "types.h"
 
@@ -38,6 +46,185 @@ bool Frustum::intersects_aabb(const kmAABB3 &aabb) const {
     return true;
 }
 
+FrustumClassification Frustum::classify_aabb(const kmAABB3& aabb) const {
+    uint8_t plane_mask = FRUSTUM_ALL_PLANES;
+    uint8_t first_plane = 0;
+    return classify_aabb(aabb, plane_mask, first_plane);
+}
+
+FrustumClassification Frustum::classify_aabb(const kmAABB3& aabb, uint8_t& plane_mask, uint8_t& first_plane) const {
+    /*
+     * Only two corners matter for each plane: the one furthest along the plane's normal (if
+     * that's behind, they all are) and the one furthest against it (if that's in front, they
+     * all are).
+     */
+    if(planes_.empty()) {
+        //Never built, so there's nothing to be outside of
+        plane_mask = 0;
+        return FRUSTUM_CONTAINS_ALL;
+    }
+
+    if(first_plane >= FRUSTUM_PLANE_MAX) {
+        first_plane = 0;
+    }
+
+    uint8_t straddled = 0;
+
+    for(uint8_t i = 0; i < FRUSTUM_PLANE_MAX; ++i) {
+        uint8_t which = (first_plane + i) % FRUSTUM_PLANE_MAX;
+        if(!(plane_mask & (1 << which))) {
+            continue;
+        }
+
+        const kmPlane& plane = planes_[which];
+
+        kmVec3 furthest, nearest;
+        furthest.x = (plane.a >= 0) ? aabb.max.x : aabb.min.x;
+        furthest.y = (plane.b >= 0) ? aabb.max.y : aabb.min.y;
+        furthest.z = (plane.c >= 0) ? aabb.max.z : aabb.min.z;
+        nearest.x = (plane.a >= 0) ? aabb.min.x : aabb.max.x;
+        nearest.y = (plane.b >= 0) ? aabb.min.y : aabb.max.y;
+        nearest.z = (plane.c >= 0) ? aabb.min.z : aabb.max.z;
+
+        if(kmPlaneClassifyPoint(&plane, &furthest) == POINT_BEHIND_PLANE) {
+            first_plane = which;
+            return FRUSTUM_CONTAINS_NONE;
+        }
+
+        if(kmPlaneClassifyPoint(&plane, &nearest) == POINT_BEHIND_PLANE) {
+            straddled |= (1 << which);
+        }
+    }
+
+    plane_mask = straddled;
+    return (straddled) ? FRUSTUM_CONTAINS_PARTIAL : FRUSTUM_CONTAINS_ALL;
+}
+
+namespace {
+
+#if defined(__AVX__) || defined(__SSE__)
+
+//Anything further behind a plane than this is behind it, as kmPlaneClassifyPoint has it
+const float BEHIND = -0.001f;
+
+#if defined(__AVX__)
+
+typedef __m256 Lanes;
+const uint32_t LANE_COUNT = 8;
+
+inline Lanes splat(float value) { return _mm256_set1_ps(value); }
+inline Lanes load(const float* values) { return _mm256_loadu_ps(values); }
+inline Lanes add(Lanes lhs, Lanes rhs) { return _mm256_add_ps(lhs, rhs); }
+inline Lanes sub(Lanes lhs, Lanes rhs) { return _mm256_sub_ps(lhs, rhs); }
+inline Lanes mul(Lanes lhs, Lanes rhs) { return _mm256_mul_ps(lhs, rhs); }
+inline Lanes either(Lanes lhs, Lanes rhs) { return _mm256_or_ps(lhs, rhs); }
+inline Lanes less_than(Lanes lhs, Lanes rhs) { return _mm256_cmp_ps(lhs, rhs, _CMP_LT_OQ); }
+inline Lanes without_sign(Lanes value) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), value); }
+inline uint32_t lanes_set(Lanes value) { return _mm256_movemask_ps(value); }
+
+#else
+
+typedef __m128 Lanes;
+const uint32_t LANE_COUNT = 4;
+
+inline Lanes splat(float value) { return _mm_set1_ps(value); }
+inline Lanes load(const float* values) { return _mm_loadu_ps(values); }
+inline Lanes add(Lanes lhs, Lanes rhs) { return _mm_add_ps(lhs, rhs); }
+inline Lanes sub(Lanes lhs, Lanes rhs) { return _mm_sub_ps(lhs, rhs); }
+inline Lanes mul(Lanes lhs, Lanes rhs) { return _mm_mul_ps(lhs, rhs); }
+inline Lanes either(Lanes lhs, Lanes rhs) { return _mm_or_ps(lhs, rhs); }
+inline Lanes less_than(Lanes lhs, Lanes rhs) { return _mm_cmplt_ps(lhs, rhs); }
+inline Lanes without_sign(Lanes value) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), value); }
+inline uint32_t lanes_set(Lanes value) { return _mm_movemask_ps(value); }
+
+#endif
+
+const uint32_t ALL_LANES = (1 << LANE_COUNT) - 1;
+
+/*
+ * Classifies up to LANE_COUNT boxes, one per lane. The boxes are turned into their centres and
+ * half extents, then for each plane the distance of the centre plus the extents projected onto
+ * the normal (the extents with their signs masked off to pick the corner furthest along it)
+ * gives how far in front the furthest corner is, and minus them the nearest.
+ */
+void classify_lanes(const std::vector<kmPlane>& planes, const kmAABB3* boxes, uint32_t count, uint8_t plane_mask, FrustumClassification* out) {
+    float min[3][LANE_COUNT], max[3][LANE_COUNT];
+    for(uint32_t i = 0; i < LANE_COUNT; ++i) {
+        //Spare lanes repeat the first box, their results are thrown away
+        const kmAABB3& box = boxes[(i < count) ? i : 0];
+        min[0][i] = box.min.x; min[1][i] = box.min.y; min[2][i] = box.min.z;
+        max[0][i] = box.max.x; max[1][i] = box.max.y; max[2][i] = box.max.z;
+    }
+
+    Lanes half = splat(0.5f);
+    Lanes centre[3], extent[3];
+    for(uint32_t axis = 0; axis < 3; ++axis) {
+        Lanes lower = load(min[axis]);
+        Lanes upper = load(max[axis]);
+        centre[axis] = mul(add(lower, upper), half);
+        extent[axis] = mul(sub(upper, lower), half);
+    }
+
+    Lanes behind = splat(BEHIND);
+    Lanes outside = splat(0.0f);
+    Lanes straddling = splat(0.0f);
+
+    for(uint32_t which = 0; which < FRUSTUM_PLANE_MAX; ++which) {
+        if(!(plane_mask & (1 << which))) {
+            continue;
+        }
+
+        const kmPlane& plane = planes[which];
+        Lanes a = splat(plane.a), b = splat(plane.b), c = splat(plane.c);
+
+        Lanes distance = add(add(add(mul(a, centre[0]), mul(b, centre[1])), mul(c, centre[2])), splat(plane.d));
+        Lanes reach = add(add(mul(without_sign(a), extent[0]), mul(without_sign(b), extent[1])), mul(without_sign(c), extent[2]));
+
+        outside = either(outside, less_than(add(distance, reach), behind));
+        straddling = either(straddling, less_than(sub(distance, reach), behind));
+
+        if((lanes_set(outside) & ALL_LANES) == ALL_LANES) {
+            break;
+        }
+    }
+
+    uint32_t outside_bits = lanes_set(outside);
+    uint32_t straddling_bits = lanes_set(straddling);
+
+    for(uint32_t i = 0; i < count; ++i) {
+        if(outside_bits & (1 << i)) {
+            out[i] = FRUSTUM_CONTAINS_NONE;
+        } else if(straddling_bits & (1 << i)) {
+            out[i] = FRUSTUM_CONTAINS_PARTIAL;
+        } else {
+            out[i] = FRUSTUM_CONTAINS_ALL;
+        }
+    }
+}
+
+#endif
+
+}
+
+void Frustum::classify_aabbs(const kmAABB3* boxes, uint32_t count, FrustumClassification* out, uint8_t plane_mask) const {
+#if defined(__AVX__) || defined(__SSE__)
+    if(planes_.empty()) {
+        std::fill(out, out + count, FRUSTUM_CONTAINS_ALL);
+        return;
+    }
+
+    for(uint32_t i = 0; i < count; i += LANE_COUNT) {
+        classify_lanes(planes_, boxes + i, std::min(count - i, LANE_COUNT), plane_mask, out + i);
+    }
+#else
+    for(uint32_t i = 0; i < count; ++i) {
+        uint8_t mask = plane_mask;
+        uint8_t first_plane = 0;
+        out[i] = classify_aabb(boxes[i], mask, first_plane);
+    }
+#endif
+}
+
 void Frustum::build(const kmMat4* modelview_projection) {
     planes_.resize(FRUSTUM_PLANE_MAX);
 
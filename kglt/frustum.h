@@ -28,6 +28,9 @@ enum FrustumPlane {
     FRUSTUM_PLANE_MAX
 };
 
+//A bit for each FrustumPlane, for saying which planes to test
+const uint8_t FRUSTUM_ALL_PLANES = (1 << FRUSTUM_PLANE_MAX) - 1;
+
 enum FrustumClassification {
     FRUSTUM_CONTAINS_NONE = 0,
     FRUSTUM_CONTAINS_PARTIAL,
@@ -46,8 +49,30 @@ public:
 
     bool intersects_aabb(const kmAABB3& box) const;
 
+    /* Like intersects_aabb, but also tells whether the box is entirely inside */
+    FrustumClassification classify_aabb(const kmAABB3& box) const;
+
+    /*
+     * classify_aabb for walking down a hierarchy. Only the planes in plane_mask are tested, and on
+     * return it only has those the box straddles, so the box's children can skip the ones it's
+     * entirely in front of. first_plane is tested first and, if the box is outside, set to the
+     * plane which showed it - the same plane usually rejects the same box the next frame too.
+     */
+    FrustumClassification classify_aabb(const kmAABB3& box, uint8_t& plane_mask, uint8_t& first_plane) const;
+
+    /*
+     * classify_aabb for count boxes at once, testing only the planes in plane_mask. The boxes are
+     * tested eight at a time with AVX or four at a time with SSE, if the compiler has them.
+     */
+    void classify_aabbs(const kmAABB3* boxes, uint32_t count, FrustumClassification* out, uint8_t plane_mask=FRUSTUM_ALL_PLANES) const;
+
     bool initialized() const { return initialized_; }
 
+    const kmPlane& plane(FrustumPlane which) const {
+        assert(initialized_);
+        return planes_[which];
+    }
+
     double near_height() const {
         assert(initialized_);
         kmVec3 diff;
@@ -0,0 +1,112 @@
+#ifndef FRAME_CACHE_H
+#define FRAME_CACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace kglt {
+namespace generic {
+
+/*
+ *  Resolves IDs to objects at most once between calls to clear(), for read-only access from
+ *  the renderer. The first lookup of an ID goes through the given function (and so the
+ *  manager's lock), after that it's a probe of an open-addressed table. No allocation happens
+ *  once the table has grown to fit a frame's worth of objects, and no ProtectedPtr is built so
+ *  the objects' own mutexes aren't touched.
+ *
+ *  A reference to each object is held until clear(), so nothing looked up can be freed from
+ *  under the caller even if it's deleted from the manager in the meantime.
+ */
+template<typename IDType, typename T>
+class FrameCache {
+public:
+    FrameCache() {
+        entries_.resize(INITIAL_CAPACITY);
+    }
+
+    template<typename Lookup>
+    T* get(IDType id, Lookup lookup) {
+        uint32_t key = id.value();
+        uint32_t mask = entries_.size() - 1;
+
+        uint32_t i = hash(key) & mask;
+        while(entries_[i].key) {
+            if(entries_[i].key == key) {
+                return entries_[i].object.get();
+            }
+            i = (i + 1) & mask;
+        }
+
+        std::shared_ptr<T> object = lookup(id);
+
+        //Keep the table at most half full so that probes stay short
+        if((used_.size() + 1) * 2 > entries_.size()) {
+            grow();
+            return insert(key, object);
+        }
+
+        entries_[i].key = key;
+        entries_[i].object = object;
+        used_.push_back(i);
+        return object.get();
+    }
+
+    void clear() {
+        for(uint32_t i: used_) {
+            entries_[i].key = 0;
+            entries_[i].object.reset();
+        }
+        used_.clear();
+    }
+
+    uint32_t size() const { return used_.size(); }
+
+private:
+    static const uint32_t INITIAL_CAPACITY = 64;
+
+    struct Entry {
+        uint32_t key = 0;
+        std::shared_ptr<T> object;
+    };
+
+    std::vector<Entry> entries_;
+    std::vector<uint32_t> used_;
+
+    static uint32_t hash(uint32_t key) {
+        //Sequential IDs would otherwise cluster
+        return key * 2654435761u;
+    }
+
+    T* insert(uint32_t key, const std::shared_ptr<T>& object) {
+        uint32_t mask = entries_.size() - 1;
+        uint32_t i = hash(key) & mask;
+        while(entries_[i].key) {
+            i = (i + 1) & mask;
+        }
+
+        entries_[i].key = key;
+        entries_[i].object = object;
+        used_.push_back(i);
+        return object.get();
+    }
+
+    void grow() {
+        std::vector<Entry> old;
+        std::swap(old, entries_);
+        entries_.resize(old.size() * 2);
+
+        std::vector<uint32_t> old_used;
+        std::swap(old_used, used_);
+        used_.reserve(old_used.size() * 2);
+
+        for(uint32_t i: old_used) {
+            insert(old[i].key, old[i].object);
+        }
+    }
+};
+
+}
+}
+
+#endif // FRAME_CACHE_H
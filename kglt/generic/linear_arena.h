@@ -0,0 +1,177 @@
+#ifndef LINEAR_ARENA_H
+#define LINEAR_ARENA_H
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace kglt {
+namespace generic {
+
+/*
+ *  Bump allocator for data which only lives for a frame. Allocation moves a pointer along a
+ *  block, deallocation does nothing and reset() makes everything available again in one go.
+ *
+ *  If a frame needs more than one block, the blocks are merged into one large enough for the
+ *  whole frame on the next reset(), so once the frames settle down the arena stops touching the
+ *  heap at all.
+ *
+ *  Nothing allocated from the arena may be used after reset(), including containers using an
+ *  ArenaAllocator; they must have been destroyed by then.
+ */
+class LinearArena {
+public:
+    static const std::size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+    LinearArena(std::size_t block_size=DEFAULT_BLOCK_SIZE):
+        block_size_(block_size) {}
+
+    LinearArena(const LinearArena&) = delete;
+    LinearArena& operator=(const LinearArena&) = delete;
+
+    void* allocate(std::size_t size, std::size_t alignment=alignof(std::max_align_t)) {
+        if(!blocks_.empty()) {
+            Block& block = blocks_.back();
+            std::size_t offset = align(block.used, alignment);
+            if(offset + size <= block.size) {
+                block.used = offset + size;
+                return block.data.get() + offset;
+            }
+        }
+
+        std::size_t needed = size + alignment;
+        add_block((needed > block_size_) ? needed : block_size_);
+
+        Block& block = blocks_.back();
+        std::size_t offset = align(0, alignment);
+        block.used = offset + size;
+        return block.data.get() + offset;
+    }
+
+    template<typename T, typename... Args>
+    T* create(Args&&... args) {
+        void* mem = allocate(sizeof(T), alignof(T));
+        return new (mem) T(std::forward<Args>(args)...);
+    }
+
+    void reset() {
+        if(blocks_.size() > 1) {
+            std::size_t total = capacity();
+            blocks_.clear();
+            add_block(total);
+        }
+
+        if(!blocks_.empty()) {
+            blocks_.back().used = 0;
+        }
+    }
+
+    std::size_t capacity() const {
+        std::size_t total = 0;
+        for(const Block& block: blocks_) {
+            total += block.size;
+        }
+        return total;
+    }
+
+    /* The number of times the arena has had to go to the heap for a block */
+    uint32_t block_allocations() const { return block_allocations_; }
+
+private:
+    struct Block {
+        std::unique_ptr<uint8_t[]> data;
+        std::size_t size = 0;
+        std::size_t used = 0;
+    };
+
+    std::size_t block_size_;
+    std::vector<Block> blocks_;
+    uint32_t block_allocations_ = 0;
+
+    void add_block(std::size_t size) {
+        if(blocks_.capacity() == blocks_.size()) {
+            blocks_.reserve(blocks_.size() * 2 + 1);
+        }
+
+        Block block;
+        block.data.reset(new uint8_t[size]);
+        block.size = size;
+        blocks_.push_back(std::move(block));
+
+        ++block_allocations_;
+    }
+
+    std::size_t align(std::size_t offset, std::size_t alignment) const {
+        //Blocks come from new[], which is aligned for anything, so aligning the offset is enough
+        return (offset + alignment - 1) & ~(alignment - 1);
+    }
+};
+
+/*
+ *  STL allocator drawing from a LinearArena. A default constructed one uses the heap, so that
+ *  containers of these types can still be used where no arena is to hand.
+ */
+template<typename T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+
+    ArenaAllocator() = default;
+
+    ArenaAllocator(LinearArena& arena):
+        arena_(&arena) {}
+
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other):
+        arena_(other.arena()) {}
+
+    T* allocate(std::size_t n) {
+        if(!arena_) {
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+        return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, std::size_t) {
+        if(!arena_) {
+            ::operator delete(p);
+        }
+    }
+
+    LinearArena* arena() const { return arena_; }
+
+private:
+    LinearArena* arena_ = nullptr;
+};
+
+template<typename T, typename U>
+bool operator==(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) {
+    return lhs.arena() == rhs.arena();
+}
+
+template<typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) {
+    return lhs.arena() != rhs.arena();
+}
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+/* Runs the destructor of something made with LinearArena::create(), the memory stays put */
+struct ArenaDeleter {
+    template<typename T>
+    void operator()(T* p) const {
+        p->~T();
+    }
+};
+
+template<typename T>
+using ArenaPtr = std::unique_ptr<T, ArenaDeleter>;
+
+}
+}
+
+#endif // LINEAR_ARENA_H
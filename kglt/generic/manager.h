@@ -2,6 +2,7 @@
 #define MANAGER_H
 
 #include "manager_base.h"
+#include "slot_map.h"
 
 #include <kazbase/list_utils.h>
 #include <kazbase/signals.h>
@@ -9,7 +10,13 @@
 namespace kglt {
 namespace generic {
 
-template<typename Derived, typename ObjectType, typename ObjectIDType, typename NewIDGenerator=IncrementalGetNextID<ObjectIDType> >
+template<
+    typename Derived,
+    typename ObjectType,
+    typename ObjectIDType,
+    typename NewIDGenerator=IncrementalGetNextID<ObjectIDType>,
+    typename ObjectStorage=std::unordered_map<ObjectIDType, std::shared_ptr<ObjectType> >
+>
 class TemplatedManager {
 protected:
     mutable std::recursive_mutex manager_lock_;
@@ -17,6 +24,7 @@ protected:
 public:
     typedef NewIDGenerator GeneratorType;
     typedef ObjectType Type;
+    typedef ObjectStorage ObjectMap;
 
     ObjectIDType manager_new() {
         return manager_new(ObjectIDType());
@@ -26,10 +34,19 @@ public:
     ObjectIDType manager_new(ObjectIDType id, Args&&... args) {
         {
             std::lock_guard<std::recursive_mutex> lock(manager_lock_);
-            if(!id) {
-                id = generator_();
+            bool new_id = !id;
+            if(new_id) {
+                id = storage_new_id(objects_, generator_);
+            }
+
+            try {
+                objects_.insert(std::make_pair(id, ObjectType::create((Derived*)this, id, std::forward<Args>(args)...)));
+            } catch(...) {
+                if(new_id) {
+                    storage_release_id(objects_, id);
+                }
+                throw;
             }
-            objects_.insert(std::make_pair(id, ObjectType::create((Derived*)this, id, std::forward<Args>(args)...)));
         }
 
         signal_post_create_(*objects_[id], id);
@@ -98,7 +115,7 @@ public:
     }
 
     //Internal!
-    std::unordered_map<ObjectIDType, std::shared_ptr<ObjectType> >& __objects() {
+    ObjectMap& __objects() {
         return objects_;
     }
 private:
@@ -108,21 +125,39 @@ private:
     static NewIDGenerator generator_;
 
 protected:
-    std::unordered_map<ObjectIDType, std::shared_ptr<ObjectType> > objects_;
+    ObjectMap objects_;
 
+    /*
+     * Every managed object is Identifiable and was created with its ID, so there's nothing to
+     * search for. The storage lookup only checks that the object really is one of ours.
+     */
     ObjectIDType _get_object_id_from_ptr(ObjectType* ptr) {
-        for(std::pair<ObjectIDType, std::shared_ptr<ObjectType> > pair: objects_) {
-            if(pair.second.get() == ptr) {
-                return pair.first;
-            }
+        if(!ptr) {
+            return ObjectIDType();
         }
 
-        return ObjectIDType();
+        ObjectIDType id = ptr->id();
+        auto it = objects_.find(id);
+        if(it == objects_.end() || it->second.get() != ptr) {
+            return ObjectIDType();
+        }
+
+        return id;
     }
 };
 
-template <typename Derived, typename ObjectType, typename ObjectIDType, typename NewIDGenerator>
-NewIDGenerator TemplatedManager<Derived, ObjectType, ObjectIDType, NewIDGenerator>::generator_;
+template <typename Derived, typename ObjectType, typename ObjectIDType, typename NewIDGenerator, typename ObjectStorage>
+NewIDGenerator TemplatedManager<Derived, ObjectType, ObjectIDType, NewIDGenerator, ObjectStorage>::generator_;
+
+/*
+ * A TemplatedManager which keeps its objects in a SlotMap. IDs are only unique within
+ * the manager rather than across every manager of the same type.
+ */
+template<typename Derived, typename ObjectType, typename ObjectIDType>
+using SlotMapManager = TemplatedManager<
+    Derived, ObjectType, ObjectIDType,
+    IncrementalGetNextID<ObjectIDType>, SlotMap<ObjectIDType, ObjectType>
+>;
 
 
 }
@@ -2,6 +2,10 @@
 #define REFCOUNT_MANAGER_H
 
 #include "manager_base.h"
+#include "slot_map.h"
+#include <algorithm>
+#include <deque>
+#include <unordered_set>
 #include <kazbase/list_utils.h>
 #include <kazbase/signals.h>
 
@@ -12,13 +16,16 @@ template<
     typename Derived,
     typename ObjectType,
     typename ObjectIDType,
-    typename NewIDGenerator=IncrementalGetNextID<ObjectIDType>
+    typename NewIDGenerator=IncrementalGetNextID<ObjectIDType>,
+    typename ObjectStorage=std::unordered_map<ObjectIDType, std::shared_ptr<ObjectType> >
 >
 class RefCountedTemplatedManager {
 protected:
     mutable std::mutex manager_lock_;
 
 public:
+    typedef ObjectStorage ObjectMap;
+
     void mark_as_uncollected(ObjectIDType id) {
         uncollected_.insert(id);
     }
@@ -30,16 +37,27 @@ public:
     template<typename ...Args>
     ObjectIDType manager_new(ObjectIDType id, bool garbage_collect, Args&&... args) {
         std::lock_guard<std::mutex> lock(manager_lock_);
-        if(!id) {
-            id = NewIDGenerator()();
+        bool new_id = !id;
+        if(new_id) {
+            NewIDGenerator generator;
+            id = storage_new_id(objects_, generator);
         }
 
-        auto obj = ObjectType::create((Derived*)this, id, std::forward<Args>(args)...);
+        std::shared_ptr<ObjectType> obj;
+        try {
+            obj = ObjectType::create((Derived*)this, id, std::forward<Args>(args)...);
+        } catch(...) {
+            if(new_id) {
+                storage_release_id(objects_, id);
+            }
+            throw;
+        }
         obj->enable_gc(garbage_collect);
 
         objects_.insert(std::make_pair(id, obj));
         creation_times_[id] = std::chrono::system_clock::now();
         uncollected_.insert(id);
+        gc_enqueue(id);
 
         signal_post_create_(*objects_[id], id);
 
@@ -62,6 +80,9 @@ public:
 
         uncollected_.erase(id);
 
+        //Whoever asked may let go of it (or enable GC on it) at any point from now
+        gc_enqueue(id);
+
         return std::weak_ptr<ObjectType>(it->second);
     }
 
@@ -89,27 +110,56 @@ public:
     sig::signal<void (ObjectType&, ObjectIDType)>& signal_pre_delete() { return signal_pre_delete_; }
 
     //Internal!
-    std::unordered_map<ObjectIDType, std::shared_ptr<ObjectType> > __objects() {
+    ObjectMap __objects() {
         return objects_;
     }
 
-    void garbage_collect() {
-        std::lock_guard<std::mutex> lock(manager_lock_);
+    /*
+     * Examines up to max_items collection candidates, deleting those which are no longer
+     * referenced and picking up where the last call left off. Only objects which have been
+     * created or handed out since they were last found unreferenced are candidates, so
+     * resources that nobody is touching cost nothing. Returns the number of objects deleted.
+     */
+    uint32_t garbage_collect(uint32_t max_items) {
+        std::vector<std::shared_ptr<ObjectType>> doomed;
+
+        {
+            std::lock_guard<std::mutex> lock(manager_lock_);
+
+            date_time now = std::chrono::system_clock::now();
+
+            max_items = std::min<uint32_t>(max_items, gc_queue_.size());
+            for(uint32_t i = 0; i < max_items; ++i) {
+                ObjectIDType key = gc_queue_.front();
+                gc_queue_.pop_front();
+
+                auto it = objects_.find(key);
+                if(it == objects_.end()) {
+                    gc_queued_.erase(key);
+                    continue;
+                }
 
-        for(ObjectIDType key: container::keys(objects_)) {
-            if(objects_[key].unique() && objects_[key]->uses_gc()) {
-                auto it = uncollected_.find(key);
-                bool ok_to_delete = false;
+                if(!it->second.unique()) {
+                    //Still in use, check again when the cursor comes back round
+                    gc_queue_.push_back(key);
+                    continue;
+                }
+
+                if(!it->second->uses_gc()) {
+                    //Nobody holds it, so nobody can enable GC on it without going through
+                    //the manager, which makes it a candidate again
+                    gc_queued_.erase(key);
+                    continue;
+                }
 
-                if(it == uncollected_.end()) {
+                bool ok_to_delete = false;
+                if(uncollected_.find(key) == uncollected_.end()) {
                     //If the object has been accessed, then we can assume
                     //that it's been used and no longer needed
                     ok_to_delete = true;
                 } else {
                     //Otherwise, if the object hasn't been accessed after 10 seconds
                     //of being alive then delete it.
-                    date_time now = std::chrono::system_clock::now();
-
                     int lifetime_in_seconds = std::chrono::duration_cast<std::chrono::seconds>(
                         now-creation_times_[key]
                     ).count();
@@ -121,17 +171,39 @@ public:
                     }
                 }
 
-                if(ok_to_delete) {
-                    objects_.erase(key);
-                    creation_times_.erase(key);
-
-                    L_DEBUG(_u("Garbage collected: {0}").format(key.value()));
+                if(!ok_to_delete) {
+                    gc_queue_.push_back(key);
+                    continue;
                 }
+
+                //Destroyed after the lock is released, their destructors may call back in
+                doomed.push_back(it->second);
+                objects_.erase(key);
+                creation_times_.erase(key);
+                uncollected_.erase(key);
+                gc_queued_.erase(key);
+
+                L_DEBUG(_u("Garbage collected: {0}").format(key.value()));
             }
         }
+
+        return doomed.size();
     }
 
-    typedef std::unordered_map<ObjectIDType, std::shared_ptr<ObjectType>> ObjectMap;
+    /* Examines every candidate at once */
+    uint32_t garbage_collect() {
+        uint32_t pending = 0;
+        {
+            std::lock_guard<std::mutex> lock(manager_lock_);
+            pending = gc_queue_.size();
+        }
+        return garbage_collect(pending);
+    }
+
+    uint32_t gc_candidate_count() const {
+        std::lock_guard<std::mutex> lock(manager_lock_);
+        return gc_queue_.size();
+    }
 
 protected:
     void manager_store_alias(const unicode& alias, ObjectIDType id) {
@@ -160,6 +232,19 @@ protected:
         object_names_.erase(alias);
     }
 
+    /*
+     * Must be called with the lock held. Every lookup calls this, and almost always for something
+     * which is already queued, so that's checked first and costs nothing but the probe.
+     */
+    void gc_enqueue(ObjectIDType id) const {
+        if(gc_queued_.find(id) != gc_queued_.end()) {
+            return;
+        }
+
+        gc_queued_.insert(id);
+        gc_queue_.push_back(id);
+    }
+
 private:
     typedef std::chrono::time_point<std::chrono::system_clock> date_time;
 
@@ -167,6 +252,9 @@ private:
     std::unordered_map<ObjectIDType, date_time> creation_times_;
     mutable std::set<ObjectIDType> uncollected_;
 
+    mutable std::deque<ObjectIDType> gc_queue_;
+    mutable std::unordered_set<ObjectIDType> gc_queued_;
+
     sig::signal<void (ObjectType&, ObjectIDType)> signal_post_create_;
     sig::signal<void (ObjectType&, ObjectIDType)> signal_pre_delete_;
 
@@ -174,6 +262,12 @@ private:
 
 };
 
+template<typename Derived, typename ObjectType, typename ObjectIDType>
+using RefCountedSlotMapManager = RefCountedTemplatedManager<
+    Derived, ObjectType, ObjectIDType,
+    IncrementalGetNextID<ObjectIDType>, SlotMap<ObjectIDType, ObjectType>
+>;
+
 }
 }
 
@@ -0,0 +1,208 @@
+#ifndef SLOT_MAP_H
+#define SLOT_MAP_H
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace kglt {
+namespace generic {
+
+/*
+ *  Generational slot map, usable as the object storage of the managers in place of an
+ *  unordered_map (see SlotMapManager and RefCountedSlotMapManager).
+ *
+ *  The objects are kept in a dense array so iteration is a linear walk, deletion swaps the
+ *  last object into the hole. IDs are handed out by the map itself: the low bits are the index
+ *  of a slot pointing into the dense array and the high bits are that slot's generation, which
+ *  is bumped every time the slot is freed. Lookup is an index and a comparison, and an ID to
+ *  something which has been deleted won't find whatever has since reused its slot.
+ *
+ *  The interface is the subset of unordered_map which the managers use, so they don't need
+ *  to care which they have. The one difference is that only IDs from new_id() can be inserted.
+ */
+template<typename IDType, typename T>
+class SlotMap {
+public:
+    typedef IDType key_type;
+    typedef std::shared_ptr<T> mapped_type;
+    typedef std::pair<IDType, std::shared_ptr<T>> value_type;
+    typedef typename std::vector<value_type>::iterator iterator;
+    typedef typename std::vector<value_type>::const_iterator const_iterator;
+
+    static const uint32_t INDEX_BITS = 20;
+    static const uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+    static const uint32_t GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+
+    /* Reserves a slot and returns its ID, the slot stays empty until the ID is inserted */
+    IDType new_id() {
+        uint32_t index;
+        if(!free_slots_.empty()) {
+            index = free_slots_.back();
+            free_slots_.pop_back();
+        } else {
+            //Index + 1 has to fit in the index bits, so that no ID is ever zero
+            if(slots_.size() >= INDEX_MASK) {
+                throw std::length_error("SlotMap is full");
+            }
+
+            index = slots_.size();
+            slots_.push_back(Slot());
+        }
+
+        slots_[index].dense = RESERVED;
+        return make_id(index, slots_[index].generation);
+    }
+
+    /* Gives back a reserved slot which was never filled */
+    void release_id(IDType id) {
+        uint32_t index = index_of(id);
+        if(index < slots_.size() && slots_[index].dense == RESERVED && slots_[index].generation == generation_of(id)) {
+            free_slot(index);
+        }
+    }
+
+    std::pair<iterator, bool> insert(const value_type& value) {
+        uint32_t index = index_of(value.first);
+        if(index >= slots_.size() || slots_[index].generation != generation_of(value.first)) {
+            throw std::logic_error("Tried to insert an ID which wasn't allocated by this SlotMap");
+        }
+
+        Slot& slot = slots_[index];
+        if(slot.dense != RESERVED) {
+            if(slot.dense == FREE) {
+                throw std::logic_error("Tried to insert an ID which wasn't allocated by this SlotMap");
+            }
+            return std::make_pair(dense_.begin() + slot.dense, false);
+        }
+
+        slot.dense = dense_.size();
+        dense_.push_back(value);
+        return std::make_pair(dense_.begin() + slot.dense, true);
+    }
+
+    iterator find(IDType id) {
+        uint32_t dense = dense_index(id);
+        return (dense == FREE) ? dense_.end() : dense_.begin() + dense;
+    }
+
+    const_iterator find(IDType id) const {
+        uint32_t dense = dense_index(id);
+        return (dense == FREE) ? dense_.end() : dense_.begin() + dense;
+    }
+
+    /* Unlike unordered_map this doesn't insert, the ID must be in the map */
+    mapped_type& operator[](IDType id) {
+        uint32_t dense = dense_index(id);
+        if(dense == FREE) {
+            throw std::out_of_range("ID is not in the SlotMap");
+        }
+        return dense_[dense].second;
+    }
+
+    std::size_t erase(IDType id) {
+        uint32_t dense = dense_index(id);
+        if(dense == FREE) {
+            return 0;
+        }
+
+        //Keep the object alive until the map is consistent again, its destructor might look
+        value_type removed = std::move(dense_[dense]);
+
+        if(dense != dense_.size() - 1) {
+            dense_[dense] = std::move(dense_.back());
+            slots_[index_of(dense_[dense].first)].dense = dense;
+        }
+        dense_.pop_back();
+
+        free_slot(index_of(id));
+        return 1;
+    }
+
+    void clear() {
+        std::vector<value_type> removed;
+        std::swap(removed, dense_);
+
+        for(auto& value: removed) {
+            free_slot(index_of(value.first));
+        }
+    }
+
+    iterator begin() { return dense_.begin(); }
+    iterator end() { return dense_.end(); }
+    const_iterator begin() const { return dense_.begin(); }
+    const_iterator end() const { return dense_.end(); }
+
+    std::size_t size() const { return dense_.size(); }
+    bool empty() const { return dense_.empty(); }
+
+private:
+    static const uint32_t FREE = ~0u;
+    static const uint32_t RESERVED = ~0u - 1;
+
+    struct Slot {
+        uint32_t generation = 0;
+        uint32_t dense = FREE;
+    };
+
+    std::vector<Slot> slots_;
+    std::vector<uint32_t> free_slots_;
+    std::vector<value_type> dense_;
+
+    static IDType make_id(uint32_t index, uint32_t generation) {
+        return IDType((generation << INDEX_BITS) | (index + 1));
+    }
+
+    static uint32_t index_of(IDType id) { return (id.value() & INDEX_MASK) - 1; }
+    static uint32_t generation_of(IDType id) { return id.value() >> INDEX_BITS; }
+
+    /* Returns FREE unless the ID refers to a live object */
+    uint32_t dense_index(IDType id) const {
+        uint32_t index = index_of(id);
+        if(index >= slots_.size()) {
+            return FREE;
+        }
+
+        const Slot& slot = slots_[index];
+        if(slot.generation != generation_of(id) || slot.dense == RESERVED) {
+            return FREE;
+        }
+
+        return slot.dense;
+    }
+
+    void free_slot(uint32_t index) {
+        slots_[index].dense = FREE;
+        slots_[index].generation = (slots_[index].generation + 1) & GENERATION_MASK;
+        free_slots_.push_back(index);
+    }
+};
+
+/*
+ * Called by the managers to create and abandon IDs, unordered_maps use the manager's
+ * generator and SlotMaps create their own
+ */
+template<typename Storage, typename Generator>
+typename Storage::key_type storage_new_id(Storage&, Generator& generator) {
+    return generator();
+}
+
+template<typename IDType, typename T, typename Generator>
+IDType storage_new_id(SlotMap<IDType, T>& storage, Generator&) {
+    return storage.new_id();
+}
+
+template<typename Storage>
+void storage_release_id(Storage&, typename Storage::key_type) {}
+
+template<typename IDType, typename T>
+void storage_release_id(SlotMap<IDType, T>& storage, IDType id) {
+    storage.release_id(id);
+}
+
+}
+}
+
+#endif // SLOT_MAP_H
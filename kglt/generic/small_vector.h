@@ -0,0 +1,124 @@
+#ifndef SMALL_VECTOR_H
+#define SMALL_VECTOR_H
+
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace kglt {
+namespace generic {
+
+/*
+ *  A vector which keeps up to N elements inside itself and only goes to the heap when it
+ *  outgrows them. Meant for the many small lists which usually hold a handful of things (e.g.
+ *  the objects in an octree node), where a std::vector would mean an allocation and a pointer
+ *  chase for each one.
+ *
+ *  Elements are moved around with memcpy, so only trivially copyable types are allowed.
+ */
+template<typename T, uint32_t N>
+class SmallVector {
+    static_assert(std::is_trivially_copyable<T>::value, "SmallVector only holds trivially copyable types");
+
+public:
+    typedef T value_type;
+    typedef T* iterator;
+    typedef const T* const_iterator;
+
+    SmallVector() = default;
+
+    SmallVector(const SmallVector& other) {
+        *this = other;
+    }
+
+    SmallVector& operator=(const SmallVector& other) {
+        if(this != &other) {
+            clear();
+            reserve(other.size_);
+            std::memcpy(data(), other.data(), other.size_ * sizeof(T));
+            size_ = other.size_;
+        }
+        return *this;
+    }
+
+    ~SmallVector() {
+        if(heap_) {
+            std::free(heap_);
+        }
+    }
+
+    void push_back(const T& value) {
+        if(size_ == capacity_) {
+            //Copy first, value might be one of ours
+            T copy = value;
+            reserve(capacity_ * 2);
+            data()[size_++] = copy;
+        } else {
+            data()[size_++] = value;
+        }
+    }
+
+    void pop_back() { --size_; }
+
+    /* Removes the element at i by moving the last one into its place, returns the new size */
+    uint32_t swap_remove(uint32_t i) {
+        T* d = data();
+        d[i] = d[size_ - 1];
+        return --size_;
+    }
+
+    /* Empties the vector, but keeps any heap storage for reuse */
+    void clear() { size_ = 0; }
+
+    void reserve(uint32_t capacity) {
+        if(capacity <= capacity_) {
+            return;
+        }
+
+        T* storage = static_cast<T*>(std::malloc(capacity * sizeof(T)));
+        if(!storage) {
+            throw std::bad_alloc();
+        }
+
+        std::memcpy(storage, data(), size_ * sizeof(T));
+
+        if(heap_) {
+            std::free(heap_);
+        }
+
+        heap_ = storage;
+        capacity_ = capacity;
+    }
+
+    T& operator[](uint32_t i) { return data()[i]; }
+    const T& operator[](uint32_t i) const { return data()[i]; }
+
+    T& back() { return data()[size_ - 1]; }
+    const T& back() const { return data()[size_ - 1]; }
+
+    iterator begin() { return data(); }
+    iterator end() { return data() + size_; }
+    const_iterator begin() const { return data(); }
+    const_iterator end() const { return data() + size_; }
+
+    uint32_t size() const { return size_; }
+    uint32_t capacity() const { return capacity_; }
+    bool empty() const { return size_ == 0; }
+
+    T* data() { return heap_ ? heap_ : reinterpret_cast<T*>(&inline_); }
+    const T* data() const { return heap_ ? heap_ : reinterpret_cast<const T*>(&inline_); }
+
+private:
+    typename std::aligned_storage<sizeof(T) * N, alignof(T)>::type inline_;
+    T* heap_ = nullptr;
+    uint32_t size_ = 0;
+    uint32_t capacity_ = N;
+};
+
+}
+}
+
+#endif // SMALL_VECTOR_H
@@ -13,7 +13,7 @@ UniformManager::UniformManager(GPUProgram &program):
     program.signal_linked().connect(std::bind(&UniformManager::clear_uniform_cache, this));
 }
 
-UniformInfo UniformManager::info(const unicode& uniform_name) {
+const UniformInfo& UniformManager::info(const unicode& uniform_name) {
     /*
      *  Returns information about the named uniform
      */
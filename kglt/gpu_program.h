@@ -169,7 +169,7 @@ public:
         return auto_uniforms_.find(uniform) != auto_uniforms_.end();
     }
 
-    unicode auto_variable_name(ShaderAvailableAuto auto_name) const {
+    const unicode& auto_variable_name(ShaderAvailableAuto auto_name) const {
         auto it = auto_uniforms_.find(auto_name);
         if(it == auto_uniforms_.end()) {
             throw std::logic_error("Specified auto is not registered");
@@ -183,7 +183,7 @@ public:
         uniform_cache_.clear();
     }
 
-    UniformInfo info(const unicode& uniform_name);
+    const UniformInfo& info(const unicode& uniform_name);
 
 private:
     friend class GPUProgram;
@@ -258,7 +258,7 @@ public:
     ProgramLinkedSignal& signal_linked() { return signal_linked_; }
     ShaderCompiledSignal& signal_shader_compiled() { return signal_shader_compiled_; }
 
-    unicode md5() { return md5_shader_hash_; }
+    const unicode& md5() const { return md5_shader_hash_; }
 private:
     friend class UniformManager;
     friend class AttributeManager;
@@ -172,6 +172,17 @@ public:
             box.min.z + half_depth()
         );
     }
+
+    /*
+     * Where the spatial structure holding this entity has put it, so that it can be found again
+     * without a lookup. Only the structure the entity was added to should touch this, and it must
+     * check the slot really is this entity's before trusting it.
+     */
+    uint32_t _spatial_slot() const { return spatial_slot_; }
+    void _set_spatial_slot(uint32_t slot) const { spatial_slot_ = slot; }
+
+private:
+    mutable uint32_t spatial_slot_ = ~0u;
 };
 
 class VertexData;
@@ -200,6 +211,12 @@ public:
 
 typedef std::shared_ptr<Renderable> RenderablePtr;
 
+/*
+ * Filled in by the partitioners each frame. The pointers aren't owning, whatever is listed must be
+ * kept alive by its owner (or the partitioner) until the list is done with
+ */
+typedef generic::ArenaVector<Renderable*> RenderableList;
+
 
 class RenderableStage {
     /*
@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <cassert>
+
+#include "kazbase/logging.h"
+#include "job_system.h"
+
+namespace kglt {
+
+namespace {
+
+thread_local JobSystem* current_system = nullptr;
+thread_local int32_t current_index = -1;
+
+}
+
+JobSystem::JobSystem(int32_t worker_count):
+    running_(true),
+    queued_(0) {
+
+    if(worker_count < 0) {
+        worker_count = std::max<int32_t>(int32_t(std::thread::hardware_concurrency()) - 1, 0);
+    }
+
+    for(int32_t i = 0; i < worker_count + 1; ++i) {
+        queues_.push_back(std::unique_ptr<Queue>(new Queue()));
+    }
+
+    for(int32_t i = 0; i < worker_count; ++i) {
+        workers_.push_back(std::thread(&JobSystem::worker_main, this, i));
+    }
+
+    L_DEBUG(_u("Started job system with {0} workers").format(worker_count));
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        running_ = false;
+    }
+    sleep_cv_.notify_all();
+
+    //The workers only stop once the queues are empty, so nothing scheduled is dropped
+    for(auto& worker: workers_) {
+        worker.join();
+    }
+
+    //Without workers it falls to us
+    while(JobHandle job = find_job()) {
+        execute(job);
+    }
+
+    assert(queued_ == 0);
+}
+
+int32_t JobSystem::current_worker() const {
+    return (current_system == this) ? current_index : -1;
+}
+
+JobHandle JobSystem::schedule(std::function<void ()> func) {
+    return schedule(func, std::vector<JobHandle>());
+}
+
+JobHandle JobSystem::schedule(std::function<void ()> func, const std::vector<JobHandle>& dependencies) {
+    JobHandle job = std::make_shared<Job>();
+    job->func_ = func;
+
+    for(JobHandle dependency: dependencies) {
+        std::lock_guard<std::mutex> lock(dependency->dependents_mutex_);
+        if(!dependency->finished_) {
+            ++job->pending_;
+            dependency->dependents_.push_back(job);
+        }
+    }
+
+    //Drop the reference we started with, if nothing else is outstanding the job can go
+    release(job);
+    return job;
+}
+
+void JobSystem::release(JobHandle job) {
+    if(--job->pending_ == 0) {
+        enqueue(job);
+    }
+}
+
+void JobSystem::enqueue(JobHandle job) {
+    int32_t worker = current_worker();
+    Queue& queue = *queues_[(worker < 0) ? queues_.size() - 1 : worker];
+
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(job);
+    }
+
+    ++queued_;
+
+    {
+        //Taking the lock means a worker can't miss this between checking and sleeping
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+    }
+    sleep_cv_.notify_one();
+}
+
+JobHandle JobSystem::pop(int32_t queue_index) {
+    Queue& queue = *queues_[queue_index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if(queue.jobs.empty()) {
+        return JobHandle();
+    }
+
+    JobHandle job;
+    if(queue_index == current_worker()) {
+        //Our own queue, newest first while it's still warm in the cache
+        job = queue.jobs.back();
+        queue.jobs.pop_back();
+    } else {
+        //Stealing, take the oldest
+        job = queue.jobs.front();
+        queue.jobs.pop_front();
+    }
+
+    --queued_;
+    return job;
+}
+
+JobHandle JobSystem::find_job() {
+    int32_t worker = current_worker();
+    int32_t count = queues_.size();
+
+    if(worker >= 0) {
+        if(JobHandle job = pop(worker)) {
+            return job;
+        }
+    }
+
+    //Start stealing from our neighbour so that the workers don't all pile on to the same queue
+    int32_t start = (worker < 0) ? count - 1 : worker + 1;
+    for(int32_t i = 0; i < count; ++i) {
+        int32_t victim = (start + i) % count;
+        if(victim == worker) {
+            continue;
+        }
+
+        if(JobHandle job = pop(victim)) {
+            return job;
+        }
+    }
+
+    return JobHandle();
+}
+
+void JobSystem::execute(JobHandle job) {
+    try {
+        job->func_();
+    } catch(...) {
+        job->error_ = std::current_exception();
+    }
+
+    std::vector<JobHandle> dependents;
+    {
+        std::lock_guard<std::mutex> lock(job->dependents_mutex_);
+        job->finished_ = true;
+        std::swap(dependents, job->dependents_);
+    }
+
+    for(JobHandle dependent: dependents) {
+        release(dependent);
+    }
+}
+
+void JobSystem::worker_main(uint32_t index) {
+    current_system = this;
+    current_index = index;
+
+    while(true) {
+        if(JobHandle job = find_job()) {
+            execute(job);
+            continue;
+        }
+
+        /*
+         * Anything a job still running elsewhere goes on to release is picked up by that thread,
+         * so once shutting down it's safe to leave as soon as the queues are empty.
+         */
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        if(!running_ && queued_ == 0) {
+            break;
+        }
+
+        sleep_cv_.wait(lock, [this]() -> bool { return !running_ || queued_ > 0; });
+    }
+}
+
+void JobSystem::wait(JobHandle job) {
+    while(!job->finished_) {
+        if(JobHandle other = find_job()) {
+            execute(other);
+        } else {
+            //Whatever we're waiting for is running on another thread
+            std::this_thread::yield();
+        }
+    }
+
+    if(job->error_) {
+        std::rethrow_exception(job->error_);
+    }
+}
+
+void JobSystem::wait(const std::vector<JobHandle>& jobs) {
+    //Wait for everything before rethrowing, jobs may reference the caller's stack
+    std::exception_ptr error;
+    for(JobHandle job: jobs) {
+        try {
+            wait(job);
+        } catch(...) {
+            if(!error) {
+                error = std::current_exception();
+            }
+        }
+    }
+
+    if(error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void JobSystem::parallel_for(uint32_t first, uint32_t last, std::function<void (uint32_t, uint32_t)> func, uint32_t grain_size) {
+    if(last <= first) {
+        return;
+    }
+
+    uint32_t total = last - first;
+    if(!grain_size) {
+        uint32_t chunks = (worker_count() + 1) * 4;
+        grain_size = std::max<uint32_t>((total + chunks - 1) / chunks, 1);
+    }
+
+    if(total <= grain_size) {
+        func(first, last);
+        return;
+    }
+
+    std::vector<JobHandle> jobs;
+    jobs.reserve(total / grain_size + 1);
+
+    //The last chunk runs on this thread rather than sitting idle
+    uint32_t begin = first;
+    for(; begin + grain_size < last; begin += grain_size) {
+        uint32_t end = begin + grain_size;
+        jobs.push_back(schedule([=]() { func(begin, end); }));
+    }
+
+    std::exception_ptr error;
+    try {
+        func(begin, last);
+    } catch(...) {
+        error = std::current_exception();
+    }
+
+    wait(jobs);
+
+    if(error) {
+        std::rethrow_exception(error);
+    }
+}
+
+}
@@ -0,0 +1,100 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <cstdint>
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+namespace kglt {
+
+class JobSystem;
+
+class Job {
+public:
+    bool is_finished() const { return finished_; }
+
+private:
+    friend class JobSystem;
+
+    std::function<void ()> func_;
+
+    //Starts at one so the job can't become runnable while its dependencies are being linked
+    std::atomic<int32_t> pending_ = {1};
+    std::atomic<bool> finished_ = {false};
+
+    std::mutex dependents_mutex_;
+    std::vector<std::shared_ptr<Job>> dependents_;
+
+    std::exception_ptr error_;
+};
+
+typedef std::shared_ptr<Job> JobHandle;
+
+/*
+ *  A work-stealing task scheduler. Each worker thread has its own queue, it runs the newest
+ *  job from the back of that and when it runs dry it steals the oldest from the front of
+ *  someone else's. Jobs scheduled from outside the pool (e.g. the main thread) go into a
+ *  shared queue which the workers steal from too.
+ *
+ *  Threads waiting on a job help out by running other jobs in the meantime, so waiting from
+ *  inside a job is fine and the system still works with no worker threads at all.
+ *
+ *  Exceptions thrown by a job are rethrown from wait(). Dependents of a failed job still run.
+ *
+ *  Destroying the system runs every job which is still queued before the workers are joined.
+ */
+class JobSystem {
+public:
+    /* By default there is one worker per core, less one for the thread which is scheduling */
+    JobSystem(int32_t worker_count=-1);
+    ~JobSystem();
+
+    JobHandle schedule(std::function<void ()> func);
+    JobHandle schedule(std::function<void ()> func, const std::vector<JobHandle>& dependencies);
+
+    void wait(JobHandle job);
+    void wait(const std::vector<JobHandle>& jobs);
+
+    /*
+     * Calls func(begin, end) on sub-ranges of [first, last) across the workers and waits for them
+     * all to finish. A grain_size of zero splits the range into a few chunks per thread.
+     */
+    void parallel_for(uint32_t first, uint32_t last, std::function<void (uint32_t, uint32_t)> func, uint32_t grain_size=0);
+
+    uint32_t worker_count() const { return workers_.size(); }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<JobHandle> jobs;
+    };
+
+    std::vector<std::thread> workers_;
+    std::vector<std::unique_ptr<Queue>> queues_; //One per worker, then the shared one at the end
+
+    std::atomic<bool> running_;
+    std::atomic<uint32_t> queued_;
+
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
+
+    void enqueue(JobHandle job);
+    JobHandle pop(int32_t queue_index);
+    JobHandle find_job();
+    void execute(JobHandle job);
+    void release(JobHandle job);
+
+    void worker_main(uint32_t index);
+    int32_t current_worker() const;
+};
+
+}
+
+#endif // JOB_SYSTEM_H
@@ -1,4 +1,5 @@
 #include "stage.h"
+#include "partitioner.h"
 #include "light.h"
 
 namespace kglt {
@@ -49,4 +50,8 @@ void Light::ask_owner_for_destruction() {
     stage()->delete_light(id());
 }
 
+void Light::transformation_changed() {
+    stage()->partitioner().light_moved(id());
+}
+
 }
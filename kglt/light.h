@@ -94,6 +94,8 @@ public:
         }
     }
 private:
+    void transformation_changed() override;
+
     LightType type_;
 
     kglt::Colour ambient_;
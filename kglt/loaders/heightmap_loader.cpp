@@ -73,80 +73,101 @@ void HeightmapLoader::into(Loadable &resource, const LoaderOptions &options) {
         submeshes.push_back(mesh->new_submesh(mat));
     }
 
-    // Generate the vertices from the heightmap
-    for(uint32_t z = 0; z < tex->height(); ++z) {
-        for(uint32_t x = 0; x < tex->width(); ++x) {
-            uint32_t idx = (z * tex->width()) + x;
+    uint32_t width = tex->width();
+    uint32_t height = tex->height();
+    uint32_t vertex_count = width * height;
+
+    // Generate the positions and indices from the heightmap
+    std::vector<kglt::Vec3> positions(vertex_count);
+    std::vector<std::vector<uint32_t>> patch_indices(total_patches);
+
+    for(uint32_t z = 0; z < height; ++z) {
+        for(uint32_t x = 0; x < width; ++x) {
+            uint32_t idx = (z * width) + x;
 
             float height_val = tex->data()[idx * (tex->bpp() / 8)];
 
             float normalized_height = float(height_val) / float(256.0);
-            float height = range * normalized_height;
-            float final_pos = min_height + height;
+            float final_pos = min_height + (range * normalized_height);
 
-            mesh->shared_data().position(
+            positions[idx] = kglt::Vec3(
                 (x * spacing) - x_offset,
                 final_pos,
                 (z * spacing) - z_offset
             );
-            mesh->shared_data().diffuse(kglt::Colour::WHITE);
-            mesh->shared_data().normal(kglt::Vec3(0, 1, 0));
 
-            mesh->shared_data().move_next();
-
-            if(z < tex->height() - 1 && x < tex->width() - 1) {
+            if(z < height - 1 && x < width - 1) {
                 int patch_x = (x / patch_size);
                 int patch_z = (z / patch_size);
                 int patch_idx = (patch_z * patches_across) + patch_x;
 
-                auto& sm = mesh->submesh(submeshes.at(patch_idx));
-                sm.index_data().index(idx);
-                sm.index_data().index(idx + tex->width());
-                sm.index_data().index(idx + 1);
-
+                auto& indices = patch_indices.at(patch_idx);
+                indices.push_back(idx);
+                indices.push_back(idx + width);
+                indices.push_back(idx + 1);
 
-                sm.index_data().index(idx + 1);
-                sm.index_data().index(idx + tex->width());
-                sm.index_data().index(idx + tex->width() + 1);
+                indices.push_back(idx + 1);
+                indices.push_back(idx + width);
+                indices.push_back(idx + width + 1);
             }
         }
     }
 
-    // The mesh don't have any normals, let's generate some!
-    std::unordered_map<int, kglt::Vec3> index_to_normal;
+    // The heightmap doesn't have any normals, let's generate some by adding the face
+    // normal of each triangle to its vertices
+    std::vector<kglt::Vec3> normals(vertex_count, kglt::Vec3(0, 0, 0));
 
-    for(auto smi: submeshes) {
-        auto& sm = mesh->submesh(smi);
-        // Go through all the triangles, add the face normal to all the vertices
-        for(uint16_t i = 0; i < sm.index_data().count(); i+=3) {
-            uint16_t idx1 = sm.index_data().at(i);
-            uint16_t idx2 = sm.index_data().at(i+1);
-            uint16_t idx3 = sm.index_data().at(i+2);
+    for(auto& indices: patch_indices) {
+        for(uint32_t i = 0; i < indices.size(); i += 3) {
+            uint32_t idx1 = indices[i];
+            uint32_t idx2 = indices[i + 1];
+            uint32_t idx3 = indices[i + 2];
 
-            kglt::Vec3 v1, v2, v3;
-            v1 = sm.vertex_data().position_at(idx1);
-            v2 = sm.vertex_data().position_at(idx2);
-            v3 = sm.vertex_data().position_at(idx3);
+            kglt::Vec3& v1 = positions[idx1];
+            kglt::Vec3& v2 = positions[idx2];
+            kglt::Vec3& v3 = positions[idx3];
 
             kglt::Vec3 normal = (v2 - v1).normalized().cross((v3 - v1).normalized()).normalized();
 
-            index_to_normal[idx1] += normal;
-            index_to_normal[idx2] += normal;
-            index_to_normal[idx3] += normal;
+            normals[idx1] += normal;
+            normals[idx2] += normal;
+            normals[idx3] += normal;
         }
     }
 
-    // Now set the normal on the vertex data
-    for(auto p: index_to_normal) {
-        mesh->shared_data().move_to(p.first);
-        mesh->shared_data().normal(p.second.normalized());
-        mesh->shared_data().diffuse(diffuse_func(mesh->shared_data().position(), mesh->shared_data().normal()));
+    std::vector<kglt::Colour> colours(vertex_count, kglt::Colour::WHITE);
+    for(uint32_t i = 0; i < vertex_count; ++i) {
+        if(normals[i].length() == 0) {
+            // Not part of any triangle
+            normals[i] = kglt::Vec3(0, 1, 0);
+            continue;
+        }
+
+        normals[i] = normals[i].normalized();
+        colours[i] = diffuse_func(positions[i], normals[i]);
     }
 
-    for(auto smi: submeshes) {
-        mesh->submesh(smi).index_data().done();
+    // Declare the format up front so the bulk writes don't have to convert anything
+    VertexSpecification spec;
+    spec.position_attribute = VERTEX_ATTRIBUTE_TYPE_3F;
+    spec.normal_attribute = VERTEX_ATTRIBUTE_TYPE_3F;
+    spec.diffuse_attribute = VERTEX_ATTRIBUTE_TYPE_4F;
+
+    VertexData& data = mesh->shared_data();
+    data.set_specification(spec);
+    data.reserve(vertex_count);
+    data.write_positions(0, &positions[0], vertex_count, sizeof(kglt::Vec3));
+    data.write_normals(0, &normals[0], vertex_count, sizeof(kglt::Vec3));
+    data.write_diffuse(0, &colours[0], vertex_count);
+    data.move_to_end();
+    data.done();
+
+    for(int i = 0; i < total_patches; ++i) {
+        auto& sm = mesh->submesh(submeshes[i]);
+        sm.index_data().reserve(patch_indices[i].size());
+        sm.index_data().index(patch_indices[i].data(), patch_indices[i].size());
+        sm.index_data().done();
     }
-    mesh->shared_data().done();
 
     mesh->resource_manager().delete_texture(tid); //Finally delete the texture
 }
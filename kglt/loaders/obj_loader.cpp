@@ -192,10 +192,10 @@ void OBJLoader::into(Loadable &resource, const LoaderOptions &options) {
         std::unordered_map<int, kglt::Vec3> index_to_normal;
 
         // Go through all the triangles, add the face normal to all the vertices
-        for(uint16_t i = 0; i < sm.index_data().count(); i+=3) {
-            uint16_t idx1 = sm.index_data().at(i);
-            uint16_t idx2 = sm.index_data().at(i+1);
-            uint16_t idx3 = sm.index_data().at(i+2);
+        for(uint32_t i = 0; i < sm.index_data().count(); i+=3) {
+            uint32_t idx1 = sm.index_data().at(i);
+            uint32_t idx2 = sm.index_data().at(i+1);
+            uint32_t idx3 = sm.index_data().at(i+2);
 
             kglt::Vec3 v1, v2, v3;
             v1 = sm.vertex_data().position_at(idx1);
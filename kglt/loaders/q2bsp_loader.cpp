@@ -0,0 +1,613 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <kazbase/logging.h>
+#include <kazbase/unicode.h>
+
+#include "../stage.h"
+#include "../mesh.h"
+#include "../types.h"
+#include "../light.h"
+#include "../resource_manager.h"
+#include "../partitioners/bsp_tree.h"
+#include "q2bsp_loader.h"
+
+#include "kglt/shortcuts.h"
+
+namespace kglt  {
+namespace loaders {
+
+namespace Q2 {
+
+enum LumpType {
+    ENTITIES = 0,
+    PLANES,
+    VERTICES,
+    VISIBILITY,
+    NODES,
+    TEXTURE_INFO,
+    FACES,
+    LIGHTMAPS,
+    LEAVES,
+    LEAF_FACE_TABLE,
+    LEAF_BRUSH_TABLE,
+    EDGES,
+    FACE_EDGE_TABLE,
+    MODELS,
+    BRUSHES,
+    BRUSH_SIDES,
+    POP,
+    AREAS,
+    AREA_PORTALS,
+    MAX_LUMPS
+};
+
+enum SurfaceFlags {
+    SURFACE_NODRAW = 0x80
+};
+
+struct Point3f {
+    float x;
+    float y;
+    float z;
+};
+
+struct Point3s {
+    int16_t x;
+    int16_t y;
+    int16_t z;
+};
+
+struct Edge {
+    uint16_t a;
+    uint16_t b;
+};
+
+struct Plane {
+    Point3f normal;
+    float distance;
+    uint32_t type;
+};
+
+struct Node {
+    uint32_t plane;
+    int32_t front_child;        // Negative numbers are -(leaf index + 1)
+    int32_t back_child;
+    Point3s bbox_min;
+    Point3s bbox_max;
+    uint16_t first_face;
+    uint16_t num_faces;
+};
+
+struct Leaf {
+    uint32_t contents;
+    int16_t cluster;            // -1 for leaves in solid space
+    uint16_t area;
+    Point3s bbox_min;
+    Point3s bbox_max;
+    uint16_t first_leaf_face;
+    uint16_t num_leaf_faces;
+    uint16_t first_leaf_brush;
+    uint16_t num_leaf_brushes;
+};
+
+struct TextureInfo {
+    Point3f u_axis;
+    float u_offset;
+    Point3f v_axis;
+    float v_offset;
+
+    uint32_t flags;
+    uint32_t value;
+
+    char texture_name[32];
+
+    uint32_t next_tex_info;
+};
+
+struct Face {
+    uint16_t plane;             // index of the plane the face is parallel to
+    uint16_t plane_side;        // set if the normal is parallel to the plane normal
+    uint32_t first_edge;        // index of the first edge (in the face edge array)
+    uint16_t num_edges;         // number of consecutive edges (in the face edge array)
+    uint16_t texture_info;      // index of the texture info structure
+    uint8_t lightmap_syles[4]; // styles (bit flags) for the lightmaps
+    uint32_t lightmap_offset;   // offset of the lightmap (in bytes) in the lightmap lump
+};
+
+struct Model {
+    Point3f bbox_min;
+    Point3f bbox_max;
+    Point3f origin;
+    int32_t head_node;
+    uint32_t first_face;        // the world is model 0, the rest are doors, lifts and the like
+    uint32_t num_faces;
+};
+
+struct Lump {
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct Header {
+    uint8_t magic[4];
+    uint32_t version;
+
+    Lump lumps[MAX_LUMPS];
+};
+
+}
+
+namespace {
+
+template<typename T>
+void read_lump(std::istream& file, const Q2::Header& header, Q2::LumpType type, std::vector<T>& out) {
+    const Q2::Lump& lump = header.lumps[type];
+
+    out.resize(lump.length / sizeof(T));
+    if(out.empty()) {
+        return;
+    }
+
+    file.seekg(lump.offset);
+    file.read((char*) &out[0], sizeof(T) * out.size());
+
+    if(!file.good()) {
+        throw IOError("The BSP file is truncated");
+    }
+}
+
+void parse_actors(const std::string& actor_string, std::vector<ActorProperties>& actors) {
+    bool inside_actor = false;
+    ActorProperties current;
+    std::string key, value;
+    bool inside_key = false, inside_value = false, key_done_for_this_line = false;
+    for(char c: actor_string) {
+        if(c == '{' && !inside_actor) {
+            inside_actor = true;
+            current.clear();
+        }
+        else if(c == '}' && inside_actor) {
+            inside_actor = false;
+            actors.push_back(current);
+        }
+        else if(c == '\n' || c == '\r') {
+            key_done_for_this_line = false;
+            if(!key.empty() && !value.empty()) {
+                current[unicode(key).strip().encode()] = unicode(value).strip().encode();
+            }
+            key = "";
+            value = "";
+        }
+        else if (c == '"') {
+            if(!inside_key && !inside_value) {
+                if(!key_done_for_this_line) {
+                    inside_key = true;
+                } else {
+                    inside_value = true;
+                }
+
+            }
+            else if(inside_key) {
+                inside_key = false;
+                key_done_for_this_line = true;
+            } else {
+                inside_value = false;
+            }
+        }
+        else {
+            if(inside_key) {
+                key.push_back(c);
+            } else if(inside_value) {
+                value.push_back(c);
+            }
+
+        }
+    }
+
+}
+
+//Needed because the Quake 2 coord system is weird, this is a -90 degree rotation around X
+Vec3 to_y_up(float x, float y, float z) {
+    return Vec3(x, z, -y);
+}
+
+Vec3 to_y_up(const Q2::Point3f& p) {
+    return to_y_up(p.x, p.y, p.z);
+}
+
+Vec3 read_origin(const std::string& origin) {
+    float x = 0, y = 0, z = 0;
+    std::istringstream stream(origin);
+    stream >> x >> y >> z;
+
+    return to_y_up(x, y, z);
+}
+
+Vec3 find_player_spawn_point(const std::vector<ActorProperties>& actors) {
+    for(const ActorProperties& p: actors) {
+        auto classname = p.find("classname");
+        auto origin = p.find("origin");
+
+        if(classname != p.end() && classname->second == "info_player_start" && origin != p.end()) {
+            return read_origin(origin->second);
+        }
+    }
+
+    return Vec3();
+}
+
+BSPTree::ptr build_tree(const std::vector<Q2::Plane>& planes, const std::vector<Q2::Node>& nodes,
+                        const std::vector<Q2::Leaf>& leaves, const std::vector<uint8_t>& visibility) {
+
+    BSPTree::ptr tree = BSPTree::create();
+
+    for(const Q2::Plane& plane: planes) {
+        //A rotation about the origin leaves the planes' distances from it alone
+        tree->add_plane(to_y_up(plane.normal), plane.distance);
+    }
+
+    for(const Q2::Node& node: nodes) {
+        if(node.plane >= planes.size()) {
+            throw IOError("A BSP node refers to a plane which doesn't exist");
+        }
+        tree->add_node(node.plane, node.front_child, node.back_child);
+    }
+
+    for(const Q2::Leaf& leaf: leaves) {
+        tree->add_leaf(leaf.cluster);
+    }
+
+    /*
+     *  The visibility lump starts with the number of clusters, then the offsets of each cluster's
+     *  potentially visible and potentially hearable rows from the start of the lump
+     */
+    if(visibility.size() >= sizeof(int32_t)) {
+        const int32_t* header = (const int32_t*) &visibility[0];
+        int32_t cluster_count = header[0];
+
+        if(cluster_count < 0 || visibility.size() < sizeof(int32_t) * (1 + cluster_count * 2)) {
+            throw IOError("The BSP file's visibility data is corrupt");
+        }
+
+        std::vector<uint32_t> offsets(cluster_count);
+        for(int32_t i = 0; i < cluster_count; ++i) {
+            offsets[i] = header[1 + i * 2];
+        }
+
+        tree->set_visibility(cluster_count, offsets, visibility);
+    } else {
+        L_WARN("BSP file has no visibility data, everything will be drawn");
+    }
+
+    return tree;
+}
+
+}
+
+void add_lights_to_stage(StagePtr stage, const std::vector<ActorProperties>& actors) {
+    for(ActorProperties props: actors) {
+        if(props["classname"] == "light") {
+            auto new_light = stage->light(stage->new_light());
+            new_light->set_absolute_position(read_origin(props["origin"]));
+
+            float range = 300; //Default in Q2
+            if(container::contains(props, std::string("light"))) {
+                std::istringstream value(props["light"]);
+                value >> range;
+            }
+
+            if(container::contains(props, std::string("_color"))) {
+                kglt::Colour diffuse;
+                std::istringstream value(props["_color"]);
+                value >> diffuse.r >> diffuse.g >> diffuse.b;
+                diffuse.a = 1.0;
+                new_light->set_diffuse(diffuse);
+            }
+
+            new_light->set_attenuation_from_range(range);
+        }
+    }
+}
+
+void Q2BSPLoader::into(Loadable& resource, const LoaderOptions &options) {
+    Mesh* mesh = loadable_to<Mesh>(resource);
+    std::istream& file = *data_;
+
+    Q2::Header header;
+    file.read((char*)&header, sizeof(Q2::Header));
+
+    if(!file.good() || std::string(header.magic, header.magic + 4) != "IBSP") {
+        throw IOError("Not a valid Q2 map: " + filename_.encode());
+    }
+
+    std::vector<char> actor_buffer;
+    read_lump(file, header, Q2::LumpType::ENTITIES, actor_buffer);
+    std::string actor_string(actor_buffer.begin(), actor_buffer.end());
+
+    std::vector<ActorProperties> actors;
+    parse_actors(actor_string, actors);
+
+    std::vector<Q2::Point3f> vertices;
+    std::vector<Q2::Edge> edges;
+    std::vector<Q2::TextureInfo> textures;
+    std::vector<Q2::Face> faces;
+    std::vector<int32_t> face_edges;
+    std::vector<Q2::Plane> planes;
+    std::vector<Q2::Node> nodes;
+    std::vector<Q2::Leaf> leaves;
+    std::vector<Q2::Model> models;
+    std::vector<uint16_t> leaf_faces;
+    std::vector<uint8_t> visibility;
+
+    read_lump(file, header, Q2::LumpType::VERTICES, vertices);
+    read_lump(file, header, Q2::LumpType::EDGES, edges);
+    read_lump(file, header, Q2::LumpType::TEXTURE_INFO, textures);
+    read_lump(file, header, Q2::LumpType::FACES, faces);
+    read_lump(file, header, Q2::LumpType::FACE_EDGE_TABLE, face_edges);
+    read_lump(file, header, Q2::LumpType::PLANES, planes);
+    read_lump(file, header, Q2::LumpType::NODES, nodes);
+    read_lump(file, header, Q2::LumpType::LEAVES, leaves);
+    read_lump(file, header, Q2::LumpType::MODELS, models);
+    read_lump(file, header, Q2::LumpType::LEAF_FACE_TABLE, leaf_faces);
+    read_lump(file, header, Q2::LumpType::VISIBILITY, visibility);
+
+    BSPTree::ptr tree = build_tree(planes, nodes, leaves, visibility);
+
+    /*
+     *  Faces are listed by every leaf they're in, which can be more than one cluster. Each face
+     *  goes in a submesh with the first of its clusters, the submesh is then in all of them.
+     *
+     *  Only the world's faces are in the tree. Other models have their own small trees, whose
+     *  leaves claim to be in cluster 0.
+     */
+    uint32_t world_faces_begin = 0;
+    uint32_t world_faces_end = faces.size();
+    if(!models.empty()) {
+        world_faces_begin = models[0].first_face;
+        world_faces_end = models[0].first_face + models[0].num_faces;
+    }
+
+    std::vector<std::vector<int32_t> > face_clusters(faces.size());
+    for(const Q2::Leaf& leaf: leaves) {
+        if(leaf.cluster < 0) {
+            continue;
+        }
+
+        for(uint32_t i = leaf.first_leaf_face; i < uint32_t(leaf.first_leaf_face + leaf.num_leaf_faces); ++i) {
+            if(i >= leaf_faces.size() || leaf_faces[i] >= faces.size()) {
+                throw IOError("A BSP leaf refers to a face which doesn't exist");
+            }
+
+            uint16_t face = leaf_faces[i];
+            if(face < world_faces_begin || face >= world_faces_end) {
+                continue;
+            }
+
+            std::vector<int32_t>& clusters = face_clusters[face];
+            if(std::find(clusters.begin(), clusters.end(), leaf.cluster) == clusters.end()) {
+                clusters.push_back(leaf.cluster);
+            }
+        }
+    }
+
+    std::vector<Vec3> positions;
+    //Copy the vertices to the mesh
+    for(Q2::Point3f& p: vertices) {
+        positions.push_back(to_y_up(p));
+    }
+
+    for(Q2::TextureInfo& tex: textures) {
+        Vec3 u_axis = to_y_up(tex.u_axis);
+        Vec3 v_axis = to_y_up(tex.v_axis);
+        tex.u_axis.x = u_axis.x;
+        tex.u_axis.y = u_axis.y;
+        tex.u_axis.z = u_axis.z;
+
+        tex.v_axis.x = v_axis.x;
+        tex.v_axis.y = v_axis.y;
+        tex.v_axis.z = v_axis.z;
+    }
+
+    /**
+     *  Load the textures and generate materials, one for each texture name
+     */
+
+    ResourceManager& resources = mesh->resource_manager();
+
+    std::map<std::string, MaterialID> texture_materials;
+    std::map<std::string, std::pair<uint32_t, uint32_t> > texture_dimensions;
+
+    for(Q2::TextureInfo& tex: textures) {
+        std::string texture_name(tex.texture_name, strnlen(tex.texture_name, sizeof(tex.texture_name)));
+        if(texture_materials.count(texture_name)) {
+            continue;
+        }
+
+        std::string texture_filename = "textures/" + texture_name + ".tga";
+
+        try {
+            TextureID tid = resources.new_texture_from_file(texture_filename);
+            auto texture = resources.texture(tid);
+
+            //We need to store this to divide the texture coordinates later
+            texture_dimensions[texture_name] = std::make_pair(texture->width(), texture->height());
+            texture_materials[texture_name] = resources.new_material_from_texture(tid);
+        } catch(IOError& e) {
+            //Fallback texture, Quake 2's are mostly this size
+            L_ERROR("Unable to find texture required by BSP file: " + texture_filename);
+            texture_dimensions[texture_name] = std::make_pair(64, 64);
+            texture_materials[texture_name] = resources.clone_default_material();
+        }
+    }
+
+    /*
+     *  Faces belonging to no cluster (e.g. those of doors and other brush models) are put
+     *  together under cluster -1, and their submeshes are left for the frustum to cull.
+     */
+    std::map<std::pair<int32_t, MaterialID>, SubMeshIndex> submesh_lookup;
+    SubMeshClusters submesh_clusters;
+
+    //The vertices and each submesh's indices are gathered up and written in one go at the end
+    std::vector<Vec3> level_positions;
+    std::vector<Vec3> level_normals;
+    std::vector<float> level_tex_coords;
+    std::map<SubMeshIndex, std::vector<uint32_t> > submesh_indices;
+
+    for(uint32_t face_index = 0; face_index < faces.size(); ++face_index) {
+        Q2::Face& f = faces[face_index];
+
+        if(f.texture_info >= textures.size() || f.plane >= planes.size()) {
+            throw IOError("A BSP face refers to data which doesn't exist");
+        }
+
+        Q2::TextureInfo& tex = textures[f.texture_info];
+        if(tex.flags & Q2::SURFACE_NODRAW) {
+            continue;
+        }
+
+        std::vector<uint32_t> indexes;
+        for(uint32_t i = f.first_edge; i < f.first_edge + f.num_edges; ++i) {
+            int32_t edge_idx = face_edges.at(i);
+            if(edge_idx > 0) {
+                Q2::Edge& e = edges.at(edge_idx);
+                indexes.push_back(e.a);
+            } else {
+                edge_idx = -edge_idx;
+                Q2::Edge& e = edges.at(edge_idx);
+                indexes.push_back(e.b);
+            }
+        }
+
+        std::string texture_name(tex.texture_name, strnlen(tex.texture_name, sizeof(tex.texture_name)));
+        MaterialID material = texture_materials[texture_name];
+
+        const std::vector<int32_t>& clusters = face_clusters[face_index];
+        auto key = std::make_pair(clusters.empty() ? -1 : clusters[0], material);
+
+        auto it = submesh_lookup.find(key);
+        if(it == submesh_lookup.end()) {
+            it = submesh_lookup.insert(std::make_pair(key, mesh->new_submesh(material, MESH_ARRANGEMENT_TRIANGLES, true))).first;
+        }
+
+        std::vector<int32_t>& in_clusters = submesh_clusters[it->second];
+        for(int32_t cluster: clusters) {
+            if(std::find(in_clusters.begin(), in_clusters.end(), cluster) == in_clusters.end()) {
+                in_clusters.push_back(cluster);
+            }
+        }
+
+        std::vector<uint32_t>& sm_indices = submesh_indices[it->second];
+
+        //All of the face is on its plane, facing away from it if it's on the back side
+        Vec3 normal = to_y_up(planes[f.plane].normal);
+        if(f.plane_side) {
+            normal = normal * -1.0f;
+        }
+
+        float w = float(texture_dimensions[texture_name].first);
+        float h = float(texture_dimensions[texture_name].second);
+
+        /*
+         *  A unique vertex is defined by a combination of the position ID and the
+         *  texture_info index (because texture coordinates depend on both and some
+         *  some vertices must be duplicated.
+         *
+         *  Here we store a mapping so that we don't create duplicate vertices if we don't need to!
+         */
+        std::map<uint32_t, uint32_t> index_lookup;
+
+        /*
+         * Build the triangles for this "face"
+         */
+        for(int16_t i = 1; i < (int16_t) indexes.size() - 1; ++i) {
+            uint32_t tri_idx[] = {
+                indexes[0],
+                indexes[i+1],
+                indexes[i]
+            };
+
+            for(uint8_t j = 0; j < 3; ++j) {
+                if(container::contains(index_lookup, tri_idx[j])) {
+                    //We've already processed this vertex
+                    sm_indices.push_back(index_lookup[tri_idx[j]]);
+                    continue;
+                }
+
+                Vec3& pos = positions.at(tri_idx[j]);
+
+                //We haven't done this before so calculate the vertex
+                float u = pos.x * tex.u_axis.x
+                        + pos.y * tex.u_axis.y
+                        + pos.z * tex.u_axis.z + tex.u_offset;
+
+                float v = pos.x * tex.v_axis.x
+                        + pos.y * tex.v_axis.y
+                        + pos.z * tex.v_axis.z + tex.v_offset;
+
+                uint32_t new_index = level_positions.size();
+
+                level_positions.push_back(pos);
+                level_normals.push_back(normal);
+                level_tex_coords.push_back(u / w);
+                level_tex_coords.push_back(v / h);
+
+                sm_indices.push_back(new_index);
+
+                //Cache this new vertex in the lookup
+                index_lookup[tri_idx[j]] = new_index;
+            }
+        }
+    }
+
+    //Declare the format up front so the bulk writes don't have to convert anything
+    VertexSpecification spec;
+    spec.position_attribute = VERTEX_ATTRIBUTE_TYPE_3F;
+    spec.normal_attribute = VERTEX_ATTRIBUTE_TYPE_3F;
+    spec.texcoord_attributes[0] = VERTEX_ATTRIBUTE_TYPE_2F;
+    spec.texcoord_attributes[1] = VERTEX_ATTRIBUTE_TYPE_2F;
+    spec.diffuse_attribute = VERTEX_ATTRIBUTE_TYPE_4F;
+
+    uint32_t vertex_count = level_positions.size();
+    std::vector<Colour> colours(vertex_count, kglt::Colour::WHITE);
+
+    VertexData& data = mesh->shared_data();
+    data.set_specification(spec);
+    if(vertex_count) {
+        data.reserve(vertex_count);
+        data.write_positions(0, &level_positions[0], vertex_count, sizeof(Vec3));
+        data.write_normals(0, &level_normals[0], vertex_count, sizeof(Vec3));
+        data.write_diffuse(0, &colours[0], vertex_count);
+        data.write_tex_coords(0, 0, &level_tex_coords[0], vertex_count);
+        data.write_tex_coords(1, 0, &level_tex_coords[0], vertex_count);
+        data.move_to_end();
+    }
+
+    for(auto& pair: submesh_indices) {
+        IndexData& index_data = mesh->submesh(pair.first).index_data();
+        index_data.reserve(pair.second.size());
+        index_data.index(pair.second.data(), pair.second.size());
+    }
+
+    mesh->shared_data().done();
+    for(SubMeshIndex i: mesh->submesh_ids()) {
+        //Delete empty submeshes
+        if(!mesh->submesh(i).index_data().count()) {
+            mesh->delete_submesh(i);
+            submesh_clusters.erase(i);
+            continue;
+        }
+        mesh->submesh(i).index_data().done();
+    }
+
+    L_DEBUG(_u("Loaded BSP level with {0} submeshes and {1} clusters").format(submesh_clusters.size(), tree->cluster_count()));
+
+    mesh->stash(tree, "BSP_TREE");
+    mesh->stash(submesh_clusters, "BSP_SUBMESH_CLUSTERS");
+    mesh->stash(actors, "BSP_ACTORS");
+    mesh->stash(find_player_spawn_point(actors), "BSP_PLAYER_START");
+}
+
+}
+}
@@ -0,0 +1,55 @@
+#ifndef Q2BSP_LOADER_H_INCLUDED
+#define Q2BSP_LOADER_H_INCLUDED
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../loader.h"
+
+namespace kglt {
+namespace loaders {
+
+typedef std::map<std::string, std::string> ActorProperties;
+
+/*
+ *  Loads a Quake 2 BSP level into a mesh. The level's faces are split into a submesh for each
+ *  cluster and texture, and the following are stashed on the mesh:
+ *
+ *  - "BSP_TREE": the level's BSPTree::ptr, with its potentially visible sets
+ *  - "BSP_SUBMESH_CLUSTERS": the SubMeshClusters each submesh's faces are in
+ *  - "BSP_ACTORS": the level's entities, a std::vector<ActorProperties>
+ *  - "BSP_PLAYER_START": where info_player_start is, as a Vec3
+ *
+ *  An actor made from the mesh on a stage using PARTITIONER_BSP is culled cluster by cluster.
+ *  Quake 2 is Z-up, everything is rotated to be Y-up.
+ */
+class Q2BSPLoader : public Loader {
+public:
+    Q2BSPLoader(const unicode& filename, std::shared_ptr<std::stringstream> data):
+        Loader(filename, data) {}
+
+    void into(Loadable& resource, const LoaderOptions& options=LoaderOptions());
+
+};
+
+class Q2BSPLoaderType : public LoaderType {
+public:
+    unicode name() { return "bsp_loader"; }
+    bool supports(const unicode& filename) const {
+        return filename.lower().ends_with(".bsp");
+    }
+
+    Loader::ptr loader_for(const unicode& filename, std::shared_ptr<std::stringstream> data) const {
+        return Loader::ptr(new Q2BSPLoader(filename, data));
+    }
+};
+
+/* Creates a point light on the stage for each light in a level's actors */
+void add_lights_to_stage(StagePtr stage, const std::vector<ActorProperties>& actors);
+
+}
+}
+
+
+#endif // Q2BSP_LOADER_H_INCLUDED
@@ -1,13 +1,17 @@
 
+#include <algorithm>
+
 #include "managers.h"
 #include "background.h"
 #include "window_base.h"
 #include "stage.h"
+#include "partitioner.h"
 #include "ui_stage.h"
 #include "camera.h"
 #include "utils/ownable.h"
 #include "render_sequence.h"
 #include "loader.h"
+#include "job_system.h"
 
 namespace kglt {
 
@@ -181,10 +185,69 @@ void StageManager::delete_stage(StageID s) {
 void StageManager::update(double dt) {
     //Update the stages
     for(auto stage_pair: StageManager::__objects()) {
-        GenericTreeNode* root = stage_pair.second.get();
-        root->apply_recursively([=](GenericTreeNode* node) -> void {
-            node->as<SceneNode>()->update(dt);
-        });
+        Stage* stage = stage_pair.second.get();
+
+        double step = dt;
+        if(!stage->_consume_update_step(dt, step)) {
+            continue;
+        }
+
+        ActiveObjectList& active = *stage->active_objects();
+
+        //Only objects with something to do are visited, see Object::wants_update
+        std::vector<Object*> parallel_objects;
+        for(uint32_t i = 0; i < active.size(); ++i) {
+            Object* object = active.at(i);
+            if(object && object->is_parallel_update_safe()) {
+                parallel_objects.push_back(object);
+            }
+        }
+
+        if(!parallel_objects.empty()) {
+            //Resolve the transformations up front, so that nodes reading them don't race to do it lazily
+            stage->update_transforms();
+
+            stage->_begin_parallel_update();
+            try {
+                window_->jobs->parallel_for(0, parallel_objects.size(), [&](uint32_t begin, uint32_t end) {
+                    for(uint32_t i = begin; i < end; ++i) {
+                        parallel_objects[i]->update(step);
+                    }
+                });
+            } catch(...) {
+                stage->_end_parallel_update();
+                throw;
+            }
+            stage->_end_parallel_update();
+
+            std::sort(parallel_objects.begin(), parallel_objects.end());
+        }
+
+        stage->update(step);
+
+        //Everything else runs here on the main thread, free to change the scene as it goes. Objects
+        //destroyed along the way leave a gap, ones activated along the way are picked up at the end
+        for(uint32_t i = 0; i < active.size(); ++i) {
+            Object* object = active.at(i);
+            if(object && !std::binary_search(parallel_objects.begin(), parallel_objects.end(), object)) {
+                object->update(step);
+            }
+        }
+
+        //Drop anything which has gone quiet, it'll add itself back when it has something to do
+        for(uint32_t i = 0; i < active.size(); ++i) {
+            Object* object = active.at(i);
+            if(object && !object->wants_update()) {
+                active.remove(object);
+            }
+        }
+        active.compact();
+
+        //Now everything has moved, resolve the absolute transformations in one top-down pass
+        stage_pair.second->update_transforms();
+
+        //...and let the partitioner catch up with anything that moved
+        stage_pair.second->partitioner().update();
     }
 }
 
@@ -68,7 +68,7 @@ void Mesh::enable_debug(bool value) {
 
         //Go through the submeshes, and for each index draw a normal line
         for(SubMeshIndex smi: submesh_ids()) {
-            for(uint16_t idx: submesh(smi).index_data().all()) {
+            for(uint32_t idx: submesh(smi).index_data().all()) {
                 kmVec3 pos1 = submesh(smi).vertex_data().position_at(idx);
                 kmVec3 n = submesh(smi).vertex_data().normal_at(idx);
                 kmVec3Scale(&n, &n, 10.0);
@@ -78,7 +78,7 @@ void Mesh::enable_debug(bool value) {
 
                 submesh(normal_debug_mesh_).vertex_data().position(pos1);
                 submesh(normal_debug_mesh_).vertex_data().diffuse(kglt::Colour::RED);
-                int16_t next_index = submesh(normal_debug_mesh_).vertex_data().move_next();
+                uint32_t next_index = submesh(normal_debug_mesh_).vertex_data().move_next();
                 submesh(normal_debug_mesh_).index_data().index(next_index - 1);
 
                 submesh(normal_debug_mesh_).vertex_data().position(pos2);
@@ -121,51 +121,41 @@ SubMeshIndex Mesh::new_submesh_as_rectangle(MaterialID material, float width, fl
     float y_offset = offset.y;
     float z_offset = offset.z;
 
-    //Build some shared vertex data
-    sm.vertex_data().position(x_offset + (-width / 2.0), y_offset + (-height / 2.0), z_offset);
-    sm.vertex_data().diffuse(kglt::Colour::WHITE);
-    sm.vertex_data().tex_coord0(0.0, 0.0);
-    sm.vertex_data().tex_coord1(0.0, 0.0);
-    sm.vertex_data().tex_coord2(0.0, 0.0);
-    sm.vertex_data().tex_coord3(0.0, 0.0);
-    sm.vertex_data().normal(0, 0, 1);
-    sm.vertex_data().move_next();
-
-    sm.vertex_data().position(x_offset + (width / 2.0), y_offset + (-height / 2.0), z_offset);
-    sm.vertex_data().diffuse(kglt::Colour::WHITE);
-    sm.vertex_data().tex_coord0(1.0, 0.0);
-    sm.vertex_data().tex_coord1(1.0, 0.0);
-    sm.vertex_data().tex_coord2(1.0, 0.0);
-    sm.vertex_data().tex_coord3(1.0, 0.0);
-    sm.vertex_data().normal(0, 0, 1);
-    sm.vertex_data().move_next();
-
-    sm.vertex_data().position(x_offset + (width / 2.0),  y_offset + (height / 2.0), z_offset);
-    sm.vertex_data().diffuse(kglt::Colour::WHITE);
-    sm.vertex_data().tex_coord0(1.0, 1.0);
-    sm.vertex_data().tex_coord1(1.0, 1.0);
-    sm.vertex_data().tex_coord2(1.0, 1.0);
-    sm.vertex_data().tex_coord3(1.0, 1.0);
-    sm.vertex_data().normal(0, 0, 1);
-    sm.vertex_data().move_next();
-
-    sm.vertex_data().position(x_offset + (-width / 2.0),  y_offset + (height / 2.0), z_offset);
-    sm.vertex_data().diffuse(kglt::Colour::WHITE);
-    sm.vertex_data().tex_coord0(0.0, 1.0);
-    sm.vertex_data().tex_coord1(0.0, 1.0);
-    sm.vertex_data().tex_coord2(0.0, 1.0);
-    sm.vertex_data().tex_coord3(0.0, 1.0);
-    sm.vertex_data().normal(0, 0, 1);
-    sm.vertex_data().move_next();
-    sm.vertex_data().done();
-
-    sm.index_data().index(0);
-    sm.index_data().index(1);
-    sm.index_data().index(2);
-
-    sm.index_data().index(0);
-    sm.index_data().index(2);
-    sm.index_data().index(3);
+    float half_width = width / 2.0;
+    float half_height = height / 2.0;
+
+    const kmVec3 positions[] = {
+        { x_offset - half_width, y_offset - half_height, z_offset },
+        { x_offset + half_width, y_offset - half_height, z_offset },
+        { x_offset + half_width, y_offset + half_height, z_offset },
+        { x_offset - half_width, y_offset + half_height, z_offset }
+    };
+
+    const kmVec3 normals[] = { {0, 0, 1}, {0, 0, 1}, {0, 0, 1}, {0, 0, 1} };
+    const float tex_coords[] = { 0, 0, 1, 0, 1, 1, 0, 1 };
+    const kglt::Colour colours[] = { kglt::Colour::WHITE, kglt::Colour::WHITE, kglt::Colour::WHITE, kglt::Colour::WHITE };
+
+    VertexSpecification spec;
+    spec.position_attribute = VERTEX_ATTRIBUTE_TYPE_3F;
+    spec.normal_attribute = VERTEX_ATTRIBUTE_TYPE_3F;
+    for(uint8_t i = 0; i < 4; ++i) {
+        spec.texcoord_attributes[i] = VERTEX_ATTRIBUTE_TYPE_2F;
+    }
+    spec.diffuse_attribute = VERTEX_ATTRIBUTE_TYPE_4F;
+
+    VertexData& data = sm.vertex_data();
+    data.set_specification(spec);
+    data.write_positions(0, positions, 4);
+    data.write_normals(0, normals, 4);
+    data.write_diffuse(0, colours, 4);
+    for(uint8_t i = 0; i < 4; ++i) {
+        data.write_tex_coords(i, 0, tex_coords, 4);
+    }
+    data.move_to_end();
+    data.done();
+
+    const uint32_t indices[] = { 0, 1, 2, 0, 2, 3 };
+    sm.index_data().index(indices, 6);
     sm.index_data().done();
 
     return ret;
@@ -191,7 +181,7 @@ void Mesh::set_material_id(MaterialID material) {
 void Mesh::transform_vertices(const kglt::Mat4& transform, bool include_submeshes) {
     shared_data().move_to_start();
 
-    for(int i = 0; i < shared_data().count(); ++i) {
+    for(uint32_t i = 0; i < shared_data().count(); ++i) {
         kglt::Vec3 v = shared_data().position_at(i);
         kmVec3MultiplyMat4(&v, &v, &transform);
         shared_data().position(v);
@@ -215,7 +205,7 @@ void Mesh::transform_vertices(const kglt::Mat4& transform, bool include_submeshe
 
 void Mesh::set_diffuse(const kglt::Colour& colour, bool include_submeshes) {
     shared_data().move_to_start();
-    for(int i = 0; i < shared_data().count(); ++i) {
+    for(uint32_t i = 0; i < shared_data().count(); ++i) {
         shared_data().diffuse(colour);
         shared_data().move_next();
     }
@@ -254,7 +244,9 @@ void Mesh::set_texture_on_material(uint8_t unit, TextureID tex, uint8_t pass) {
 
 void Mesh::_update_buffer_object() {
     if(shared_data_dirty_) {
-        shared_data_buffer_object_->build(shared_data().count() * sizeof(Vertex), shared_data()._raw_data());
+        VertexData& data = shared_data();
+        shared_data_buffer_object_->update(data.count() * data.stride(), data._raw_data(), data.dirty_ranges(), data.stride());
+        data.mark_clean();
         shared_data_dirty_ = false;
     }
 }
@@ -291,6 +283,15 @@ SubMesh::SubMesh(
     vrecalc_ = vertex_data().signal_update_complete().connect(std::bind(&SubMesh::_recalc_bounds, this));
     irecalc_ = index_data().signal_update_complete().connect(std::bind(&SubMesh::_recalc_bounds, this));
 
+    //The triangle BVH is rebuilt the next time it's asked for
+    auto invalidate_bvh = [this]() {
+        std::lock_guard<std::mutex> lock(triangle_bvh_lock_);
+        triangle_bvh_.reset();
+    };
+
+    vbvh_ = vertex_data().signal_update_complete().connect(invalidate_bvh);
+    ibvh_ = index_data().signal_update_complete().connect(invalidate_bvh);
+
     if(!uses_shared_data_) {
         vertex_data().signal_update_complete().connect([&]{
             this->vertex_data_dirty_ = true;
@@ -310,12 +311,16 @@ void SubMesh::_update_vertex_array_object() {
     if(uses_shared_vertices()) {
         parent_._update_buffer_object();
     } else if(vertex_data_dirty_) {
-        vertex_array_object_->vertex_buffer_update(vertex_data().count() * sizeof(Vertex), vertex_data()._raw_data());
+        VertexData& data = vertex_data();
+        vertex_array_object_->vertex_buffer_update(data.count() * data.stride(), data._raw_data(), data.dirty_ranges(), data.stride());
+        data.mark_clean();
         vertex_data_dirty_ = false;
     }
 
     if(index_data_dirty_) {
-        vertex_array_object_->index_buffer_update(index_data().count() * sizeof(uint16_t), index_data()._raw_data());
+        IndexData& indexes = index_data();
+        vertex_array_object_->index_buffer_update(indexes.count() * indexes.index_size(), indexes._raw_data(), indexes.dirty_ranges(), indexes.index_size());
+        indexes.mark_clean();
         index_data_dirty_ = false;
 
         if(vertex_data().empty()) {
@@ -339,7 +344,7 @@ void SubMesh::transform_vertices(const kglt::Mat4& transformation) {
     }
 
     vertex_data().move_to_start();
-    for(uint16_t i = 0; i < vertex_data().count(); ++i) {
+    for(uint32_t i = 0; i < vertex_data().count(); ++i) {
         kglt::Vec3 v = vertex_data().position_at(i);
 
         kmVec3MultiplyMat4(&v, &v, &transformation);
@@ -363,7 +368,7 @@ void SubMesh::set_diffuse(const kglt::Colour& colour) {
     }
 
     vertex_data().move_to_start();
-    for(uint16_t i = 0; i < vertex_data().count(); ++i) {
+    for(uint32_t i = 0; i < vertex_data().count(); ++i) {
         vertex_data().diffuse(colour);
         vertex_data().move_next();
     }
@@ -375,7 +380,7 @@ void SubMesh::reverse_winding() {
         throw NotImplementedError(__FILE__, __LINE__);
     }
 
-    std::vector<uint16_t> original = index_data().all();
+    std::vector<uint32_t> original = index_data().all();
 
     index_data().clear();
     for(uint32_t i = 0; i < original.size() / 3; ++i) {
@@ -404,8 +409,8 @@ void SubMesh::_recalc_bounds() {
         return;
     }
 
-    for(uint16_t idx: index_data().all()) {
-        kmVec3 pos = vertex_data().position_at(idx);
+    for(uint32_t i = 0; i < index_data().count(); ++i) {
+        kmVec3 pos = vertex_data().position_at(index_data().at(i));
         if(pos.x < bounds_.min.x) bounds_.min.x = pos.x;
         if(pos.y < bounds_.min.y) bounds_.min.y = pos.y;
         if(pos.z < bounds_.min.z) bounds_.min.z = pos.z;
@@ -441,6 +446,55 @@ void SubMesh::set_texture_on_material(uint8_t unit, TextureID tex, uint8_t pass)
 SubMesh::~SubMesh() {
     vrecalc_.disconnect();
     irecalc_.disconnect();
+    vbvh_.disconnect();
+    ibvh_.disconnect();
+}
+
+std::shared_ptr<const TriangleBVH> SubMesh::triangle_bvh() const {
+    std::lock_guard<std::mutex> lock(triangle_bvh_lock_);
+
+    if(triangle_bvh_) {
+        return triangle_bvh_;
+    }
+
+    const VertexData& vertices = vertex_data();
+    const IndexData& indexes = index_data();
+    uint32_t count = indexes.count();
+
+    std::vector<kmVec3> corners;
+    auto add_triangle = [&](uint32_t a, uint32_t b, uint32_t c) {
+        corners.push_back(vertices.position_at(indexes.at(a)));
+        corners.push_back(vertices.position_at(indexes.at(b)));
+        corners.push_back(vertices.position_at(indexes.at(c)));
+    };
+
+    switch(arrangement_) {
+        case MESH_ARRANGEMENT_TRIANGLES:
+            corners.reserve(count - (count % 3));
+            for(uint32_t i = 0; i + 2 < count; i += 3) {
+                add_triangle(i, i + 1, i + 2);
+            }
+        break;
+        case MESH_ARRANGEMENT_TRIANGLE_STRIP:
+            //Winding doesn't matter, the triangles are two sided
+            for(uint32_t i = 2; i < count; ++i) {
+                add_triangle(i - 2, i - 1, i);
+            }
+        break;
+        case MESH_ARRANGEMENT_TRIANGLE_FAN:
+            for(uint32_t i = 2; i < count; ++i) {
+                add_triangle(0, i - 1, i);
+            }
+        break;
+        default:
+            break;
+    }
+
+    std::shared_ptr<TriangleBVH> bvh = std::make_shared<TriangleBVH>();
+    bvh->build(corners);
+
+    triangle_bvh_ = bvh;
+    return triangle_bvh_;
 }
 
 }
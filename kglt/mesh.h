@@ -2,6 +2,8 @@
 #define NEWMESH_H
 
 #include <cstdint>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <unordered_map>
 #include <set>
@@ -17,6 +19,7 @@
 #include "vertex_data.h"
 #include "types.h"
 #include "interfaces.h"
+#include "utils/triangle_bvh.h"
 
 namespace kglt {
 
@@ -79,6 +82,15 @@ public:
     void _update_vertex_array_object();
     void _bind_vertex_array_object();
 
+    /*
+     * A BVH over the submesh's triangles for exact ray tests, in the submesh's own space. It's
+     * built the first time it's asked for and dropped whenever the vertex or index data changes.
+     * What's returned is a snapshot: it stays valid for as long as it's held, but shows the
+     * triangles as they were when it was built. Points and lines have no triangles, so give an
+     * empty one.
+     */
+    std::shared_ptr<const TriangleBVH> triangle_bvh() const;
+
     SubMeshIndex id() const { return id_; }
 private:
     Mesh& parent_;
@@ -99,6 +111,12 @@ private:
 
     sig::connection vrecalc_;
     sig::connection irecalc_;
+
+    mutable std::mutex triangle_bvh_lock_;
+    mutable std::shared_ptr<const TriangleBVH> triangle_bvh_;
+
+    sig::connection vbvh_;
+    sig::connection ibvh_;
 };
 
 class Mesh :
@@ -15,11 +15,14 @@ uint64_t Object::object_counter = 0;
 Object::Object(Stage *stage):
     uuid_(++object_counter),
     stage_(stage),
-    is_visible_(true),
-    rotation_locked_(false),
-    position_locked_(false) {
+    transforms_(stage->transform_store()),
+    is_visible_(true) {
 
-    update_from_parent();
+    transform_ = transforms_->new_transform(this);
+
+    //Everything gets at least one update, after that it's up to wants_update()
+    active_objects_ = stage->active_objects();
+    activate_updates();
 
     //When the parent changes, update the position/orientation
     parent_changed_connection_ = signal_parent_changed().connect(std::bind(&Object::parent_changed_callback, this, std::placeholders::_1, std::placeholders::_2));
@@ -27,6 +30,15 @@ Object::Object(Stage *stage):
 
 Object::~Object() {
     parent_changed_connection_.disconnect();
+
+    //Our children are about to be detached, don't leave them pointing at a dead transformation
+    for(GenericTreeNode* child = first_child(); child; child = child->right_sibling()) {
+        transforms_->set_parent(child->as<Object>()->transform_, INVALID_TRANSFORM);
+        child->as<Object>()->mark_transform_dirty();
+    }
+
+    transforms_->delete_transform(transform_);
+    active_objects_->remove(this);
 }
 
 void Object::_update_constraint() {
@@ -51,6 +63,7 @@ void Object::_update_constraint() {
 
 void Object::constrain_to(const Vec3 &min, const Vec3 &max) {
     constraint_.reset(new std::pair<Vec3, Vec3>(min, max));
+    activate_updates();
 }
 
 void Object::constrain_to(const AABB& box) {
@@ -77,6 +90,9 @@ void Object::disable_constraint() {
 void Object::parent_changed_callback(GenericTreeNode *old_parent, GenericTreeNode *new_parent) {
     Object* new_p = dynamic_cast<Object*>(new_parent);
 
+    transforms_->set_parent(transform_, new_p ? new_p->transform_ : INVALID_TRANSFORM);
+    mark_transform_dirty();
+
     if(!new_p) {
         return;
     }
@@ -96,8 +112,6 @@ void Object::parent_changed_callback(GenericTreeNode *old_parent, GenericTreeNod
 
         responsive_parental_constraint_ = body().create_fixed_constraint(new_p->body());
     }
-
-    update_from_parent();
 }
 
 void Object::make_responsive() {
@@ -125,21 +139,21 @@ void Object::make_collidable() {
 }
 
 void Object::lock_rotation() {
-    rotation_locked_ = true;
+    transforms_->set_rotation_locked(transform_, true);
 }
 
 void Object::unlock_rotation() {
-    rotation_locked_ = false;
-    update_from_parent();
+    transforms_->set_rotation_locked(transform_, false);
+    mark_transform_dirty();
 }
 
 void Object::lock_position() {
-    position_locked_ = true;
+    transforms_->set_position_locked(transform_, true);
 }
 
 void Object::unlock_position() {
-    position_locked_ = false;
-    update_from_parent();
+    transforms_->set_position_locked(transform_, false);
+    mark_transform_dirty();
 }
 
 /**
@@ -153,7 +167,7 @@ void Object::unlock_position() {
  * @param z
  */
 void Object::set_absolute_position(float x, float y, float z) {
-    if(position_locked_) {
+    if(transforms_->position_locked(transform_)) {
         return;
     }
 
@@ -181,9 +195,9 @@ void Object::set_absolute_position(float x, float y, float z) {
 }
 
 void Object::set_relative_position(float x, float y, float z) {
-    //Always store the relative_position_ even for responsive bodies
+    //Always store the relative position even for responsive bodies
     //as they only deal with absolute
-    relative_position_ = Vec3(x, y, z);
+    transforms_->set_relative_position(transform_, Vec3(x, y, z));
 
     if(is_responsive()) {
         if(responsive_parental_constraint_) {
@@ -199,7 +213,7 @@ void Object::set_relative_position(float x, float y, float z) {
             responsive_parental_constraint_ = body().create_fixed_constraint(parent()->as<Object>()->body());
         }
     } else {
-        update_from_parent();
+        mark_transform_dirty();
     }
 }
 
@@ -208,7 +222,7 @@ kglt::Vec3 Object::absolute_position() const {
         return body().position();
     }
 
-    return absolute_position_;
+    return transforms_->absolute_position(transform_);
 }
 
 kglt::Vec3 Object::relative_position() const {
@@ -216,15 +230,15 @@ kglt::Vec3 Object::relative_position() const {
         return absolute_position() - parent()->as<SceneNode>()->position();
     }
 
-    return relative_position_;
+    return transforms_->relative_position(transform_);
 }
 
 kglt::Quaternion Object::absolute_rotation() const {
     if(is_responsive()) {
         return body().rotation();
-    } else {
-        return absolute_rotation_;
     }
+
+    return transforms_->absolute_rotation(transform_);
 }
 
 kglt::Quaternion Object::relative_rotation() const {
@@ -234,12 +248,12 @@ kglt::Quaternion Object::relative_rotation() const {
         return parent_rot * body().rotation();
     }
 
-    return relative_rotation_;
+    return transforms_->relative_rotation(transform_);
 }
 
 
 void Object::set_absolute_rotation(const Quaternion& quat) {
-    if(rotation_locked_) {
+    if(transforms_->rotation_locked(transform_)) {
         return;
     }
 
@@ -275,8 +289,9 @@ void Object::set_absolute_rotation(const Quaternion& quat) {
 void Object::set_relative_rotation(const Quaternion &quaternion) {
     //Always store the relative rotation, even for responsive bodies
     //as they only deal with absolute
-    relative_rotation_ = quaternion;
-    relative_rotation_.normalize();
+    Quaternion normalized = quaternion;
+    normalized.normalize();
+    transforms_->set_relative_rotation(transform_, normalized);
 
     if(is_responsive()) {
         if(responsive_parental_constraint_) {
@@ -292,12 +307,12 @@ void Object::set_relative_rotation(const Quaternion &quaternion) {
             responsive_parental_constraint_ = body().create_fixed_constraint(parent()->as<Object>()->body());
         }
     } else {
-        update_from_parent();
+        mark_transform_dirty();
     }
 }
 
 void Object::set_absolute_rotation(const Degrees &angle, float x, float y, float z) {
-    if(rotation_locked_) {
+    if(transforms_->rotation_locked(transform_)) {
         return;
     }
 
@@ -316,7 +331,7 @@ void Object::move_forward(float amount) {
 }
 
 void Object::rotate_absolute_x(float amount) {
-    if(rotation_locked_) {
+    if(transforms_->rotation_locked(transform_)) {
         return;
     }
 
@@ -330,12 +345,10 @@ void Object::rotate_absolute_x(float amount) {
     kmQuaternionRotationAxisAngle(&rot, &axis, kmDegreesToRadians(amount));
 
     set_absolute_rotation(absolute_rotation() * rot);
-
-    update_from_parent();
 }
 
 void Object::rotate_absolute_z(float amount) {
-    if(rotation_locked_) {
+    if(transforms_->rotation_locked(transform_)) {
         return;
     }
 
@@ -349,13 +362,10 @@ void Object::rotate_absolute_z(float amount) {
     kmQuaternionRotationAxisAngle(&rot, &axis, kmDegreesToRadians(amount));
 
     set_absolute_rotation(absolute_rotation() * rot);
-    absolute_rotation_.normalize();
-
-    update_from_parent();
 }
 
 void Object::rotate_absolute_y(float amount) {
-    if(rotation_locked_) {
+    if(transforms_->rotation_locked(transform_)) {
         return;
     }
 
@@ -369,9 +379,6 @@ void Object::rotate_absolute_y(float amount) {
     kmQuaternionRotationAxisAngle(&rot, &axis, kmDegreesToRadians(amount));
 
     set_absolute_rotation(absolute_rotation() * rot);
-    absolute_rotation_.normalize();
-
-    update_from_parent();
 }
 
 void Object::look_at(const Vec3& position) {
@@ -400,42 +407,43 @@ void Object::look_at(const Vec3& position) {
 
 
 Mat4 Object::absolute_transformation() const {
-    Mat4 rot_matrix, trans_matrix, final;
-
-    Quaternion abs_rot = absolute_rotation();
+    if(is_responsive()) {
+        //The physics engine owns the transformation, so it can't be cached
+        Mat4 rot_matrix, final;
+
+        Quaternion abs_rot = absolute_rotation();
+        Vec3 abs_pos = absolute_position();
+
+        kmMat4RotationQuaternion(&rot_matrix, &abs_rot);
+        final = rot_matrix;
+        final.mat[12] = abs_pos.x;
+        final.mat[13] = abs_pos.y;
+        final.mat[14] = abs_pos.z;
+        return final;
+    }
 
-    kmMat4RotationQuaternion(&rot_matrix, &abs_rot);
-    kmMat4Translation(&trans_matrix, absolute_position().x, absolute_position().y, absolute_position().z);
+    return transforms_->absolute_transformation(transform_);
+}
 
-    kmMat4Multiply(&final, &trans_matrix, &rot_matrix);
-    return final;
+uint64_t Object::transform_version() const {
+    return transforms_->version(transform_);
 }
 
-void Object::update_from_parent() {
-    Vec3 orig_pos = absolute_position();
-    Quaternion orig_rot = absolute_rotation();
+void Object::activate_updates() {
+    active_objects_->add(this);
+}
 
-    if(!has_parent()) {
-        absolute_position_ = relative_position();
-        absolute_rotation_ = relative_rotation();
-    } else {
-        if(!position_locked_) {
-            absolute_position_ = parent()->as<SceneNode>()->position() + relative_position();
-        }
-        if(!rotation_locked_) {
-            absolute_rotation_ = relative_rotation() * parent()->as<SceneNode>()->rotation();
-            absolute_rotation_.normalize();
-        }
+void Object::mark_transform_dirty() {
+    if(transforms_->is_dirty(transform_)) {
+        //Already dirty, so the children must be too
+        return;
     }
 
-    //Only signal that the transformation changed if it did
-    if(orig_pos != absolute_position() || orig_rot != absolute_rotation()) {
-        transformation_changed();
-    }
+    transforms_->mark_dirty(transform_);
 
-    apply_recursively([](GenericTreeNode* x) {
-        x->as<Object>()->update_from_parent();
-    }, false);
+    for(GenericTreeNode* child = first_child(); child; child = child->right_sibling()) {
+        child->as<Object>()->mark_transform_dirty();
+    }
 }
 
 void Object::destroy_children() {
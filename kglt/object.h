@@ -22,6 +22,8 @@
 
 #include "scene_node.h"
 #include "interfaces.h"
+#include "transform_store.h"
+#include "active_object_list.h"
 
 namespace kglt {
 
@@ -143,6 +145,12 @@ public:
 
     kglt::Mat4 absolute_transformation() const;
 
+    /*
+     * Incremented whenever the absolute transformation of this object changes, so
+     * anything caching data derived from it can cheaply tell if it's stale.
+     */
+    uint64_t transform_version() const;
+
     //Make this object ignore parent rotations or rotate commands until unlocked
     void lock_rotation();
     void unlock_rotation();
@@ -156,6 +164,14 @@ public:
     virtual void _initialize() {}
     virtual void do_update(double dt) {}
 
+    /*
+     * Objects are only updated while they're in their stage's active list. They're added when
+     * created, and whenever they call activate_updates(), and dropped after any update where
+     * this returns false. Subclasses with their own behaviour should override it.
+     */
+    virtual bool wants_update() const { return is_constrained(); }
+    bool is_update_active() const { return active_slot_ >= 0; }
+
     Stage* stage() {
         assert(stage_);
         return stage_;
@@ -215,8 +231,11 @@ public:
     sig::signal<void ()>& signal_made_shape() { return signal_made_collidable_; }
 
     void _update_constraint();
+
+    TransformHandle _transform_handle() const { return transform_; }
 protected:
-    void update_from_parent();
+    void mark_transform_dirty();
+    void activate_updates();
 
 private:
     static uint64_t object_counter;
@@ -224,19 +243,26 @@ private:
 
     Stage* stage_; //Each object is owned by a scene
 
-    kglt::Vec3 relative_position_;
-    kglt::Quaternion relative_rotation_;
+    /*
+     * The transformation lives in the stage's TransformStore, the absolute part is derived
+     * from the relative one and the parent's when it's next read or at the end of the frame.
+     * If an object is dirty then so are all of its descendants.
+     */
+    TransformStore::ptr transforms_;
+    TransformHandle transform_;
+
+    friend class TransformStore;
+
+    ActiveObjectList::ptr active_objects_;
+    int32_t active_slot_ = -1;
 
-    kglt::Vec3 absolute_position_;
-    kglt::Quaternion absolute_rotation_;
+    friend class ActiveObjectList;
 
     sig::connection parent_changed_connection_;
 
     void parent_changed_callback(GenericTreeNode* old_parent, GenericTreeNode* new_parent);
 
     bool is_visible_;
-    bool rotation_locked_;
-    bool position_locked_;
 
     std::shared_ptr<ResponsiveBody> responsive_body_;
     std::shared_ptr<Collidable> collidable_;
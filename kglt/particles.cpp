@@ -1,5 +1,7 @@
-#include <kazbase/random.h>
+#include <algorithm>
+#include <numeric>
 #include "stage.h"
+#include "partitioner.h"
 #include "particles.h"
 
 namespace kglt {
@@ -8,8 +10,15 @@ ParticleSystem::ParticleSystem(Stage* stage, ParticleSystemID id):
     generic::Identifiable<ParticleSystemID>(id),
     ParentSetterMixin<Object>(stage),
     Source(stage),
+    random_(std::random_device()()),
     vao_(MODIFY_REPEATEDLY_USED_FOR_RENDERING, MODIFY_REPEATEDLY_USED_FOR_RENDERING){
 
+    //Particles are rebuilt every frame, so keep the vertices as small as possible
+    VertexSpecification spec;
+    spec.position_attribute = VERTEX_ATTRIBUTE_TYPE_3F;
+    spec.diffuse_attribute = VERTEX_ATTRIBUTE_TYPE_4UB_NORMALIZED;
+    vertex_data_.set_specification(spec);
+
     set_material_id(stage->clone_default_material());       
 }
 
@@ -88,8 +97,11 @@ void ParticleSystem::_update_vertex_array_object() {
         return;
     }
 
-    vao_.vertex_buffer_update(vertex_data().count() * sizeof(Vertex), vertex_data_._raw_data());
-    vao_.index_buffer_update(index_data().count() * sizeof(uint16_t), index_data_._raw_data());
+    vao_.vertex_buffer_update(vertex_data_.count() * vertex_data_.stride(), vertex_data_._raw_data(), vertex_data_.dirty_ranges(), vertex_data_.stride());
+    vertex_data_.mark_clean();
+
+    vao_.index_buffer_update(index_data_.count() * index_data_.index_size(), index_data_._raw_data(), index_data_.dirty_ranges(), index_data_.index_size());
+    index_data_.mark_clean();
 }
 
 void ParticleSystem::_bind_vertex_array_object() {
@@ -126,7 +138,11 @@ bool ParticleSystem::has_active_emitters() const {
 }
 
 void ParticleSystem::ask_owner_for_destruction() {
-    stage()->delete_particle_system(id());
+    stage()->defer(std::bind(&Stage::delete_particle_system, stage(), id()));
+}
+
+void ParticleSystem::transformation_changed() {
+    stage()->partitioner().particle_system_moved(id());
 }
 
 void ParticleEmitter::activate() {
@@ -144,7 +160,7 @@ void ParticleEmitter::update(double dt) {
     if(current_duration_ && time_active_ >= current_duration_) {
         deactivate();
 
-        float repeat_delay = random_gen::random_float(repeat_delay_range_.first, repeat_delay_range_.second);
+        float repeat_delay = system().random_float(repeat_delay_range_.first, repeat_delay_range_.second);
         if(repeat_delay > 0) {
             system().window().idle->add_timeout(repeat_delay, std::bind(&ParticleEmitter::activate, this));
         }
@@ -156,6 +172,11 @@ WindowBase& ParticleSystem::window() {
     return stage()->window();
 }
 
+float ParticleSystem::random_float(float min, float max) {
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    return min + (max - min) * unit(random_);
+}
+
 void ParticleSystem::do_update(double dt) {
     update_source(dt); //Update any sounds attached to this particle system
 
@@ -169,24 +190,19 @@ void ParticleSystem::do_update(double dt) {
         }
 
         auto max_can_emit = quota_ - current_particle_count;
-        auto new_particles = emitter->do_emit(dt, max_can_emit);
-        particles_.insert(particles_.end(), new_particles.begin(), new_particles.end());
-        current_particle_count += new_particles.size();
+        current_particle_count += emitter->do_emit(dt, max_can_emit, particles_);
     }
 
-    for(auto it = particles_.begin(); it != particles_.end(); ) {
-        Particle& particle = (*it);
-
+    for(Particle& particle: particles_) {
         particle.position += particle.velocity * dt;
         particle.ttl -= dt;
-
-        if(particle.ttl <= 0.0) {
-            it = particles_.erase(it);
-        } else {
-            ++it;
-        }
     }
 
+    particles_.erase(
+        std::remove_if(particles_.begin(), particles_.end(), [](const Particle& p) { return p.ttl <= 0.0; }),
+        particles_.end()
+    );
+
     if(particles_.empty() && !has_repeating_emitters() && !has_active_emitters()) {
         // If the particles are gone, and we don't have repeating emitters and all the emitters are inactive
         // Then destroy the particle system if that's what we've been told to do
@@ -197,29 +213,31 @@ void ParticleSystem::do_update(double dt) {
         }
     }
 
+    //Write straight out of the particle array, the spec was declared in the constructor
+    uint32_t count = particles_.size();
     vertex_data_.move_to_start();
-    vertex_data_.clear();
-    for(auto particle: particles_) {
-        vertex_data_.position(particle.position);
-        vertex_data_.diffuse(particle.colour);
-        vertex_data_.move_next();
+    vertex_data_.resize(count);
+    if(count) {
+        vertex_data_.write_positions(0, &particles_[0].position, count, sizeof(Particle));
+        vertex_data_.write_diffuse(0, &particles_[0].colour, count, sizeof(Particle));
     }
     vertex_data_.done();
 
+    //One point per particle, so the indices only change when the count does
+    if(index_data_.count() != count) {
+        index_scratch_.resize(count);
+        std::iota(index_scratch_.begin(), index_scratch_.end(), 0);
 
-    index_data_.clear();
-    for(uint16_t i = 0; i < vertex_data().count(); ++i) {
-        index_data_.index(i);
+        index_data_.clear();
+        index_data_.index(index_scratch_.data(), count);
     }
     index_data_.done();
 
 }
 
-std::vector<Particle> ParticleEmitter::do_emit(double dt, uint32_t max) {
-    std::vector<Particle> new_particles;
-
+uint32_t ParticleEmitter::do_emit(double dt, uint32_t max, std::vector<Particle>& out) {
     if(!max) {
-        return new_particles; //Do nothing
+        return 0; //Do nothing
     }
 
     emission_accumulator_ += dt; //Buffer time
@@ -239,30 +257,30 @@ std::vector<Particle> ParticleEmitter::do_emit(double dt, uint32_t max) {
             float hh = dimensions_.y * 0.5;
             float hd = dimensions_.z * 0.5;
 
-            p.position.x += random_gen::random_float(-hw, hw);
-            p.position.y += random_gen::random_float(-hh, hh);
-            p.position.z += random_gen::random_float(-hd, hd);
+            p.position.x += system().random_float(-hw, hw);
+            p.position.y += system().random_float(-hh, hh);
+            p.position.z += system().random_float(-hd, hd);
         }
 
         Vec3 dir = direction();
         if(angle().value_ != 0) {
             Radians ang(angle()); //Convert from degress to radians
-            ang.value_ *= random_gen::random_float(0, 1); //Multiply by a random unit float
-            dir = dir.random_deviant(ang);
+            ang.value_ *= system().random_float(0, 1); //Multiply by a random unit float
+            dir = dir.deviant(ang, system().random_float(0, 1));
         }
 
-        p.velocity = dir.normalized() * random_gen::random_float(velocity_range().first, velocity_range().second);
+        p.velocity = dir.normalized() * system().random_float(velocity_range().first, velocity_range().second);
 
         //We have to rotate the velocity by the system, because if the particle system is attached to something (e.g. the back of a spaceship)
         //when that entity rotates we want the velocity to stay pointing relative to the entity
         auto rot = system().absolute_rotation();
         kmQuaternionMultiplyVec3(&p.velocity, &rot, &p.velocity);
 
-        p.ttl = random_gen::random_float(ttl_range().first, ttl_range().second);
+        p.ttl = system().random_float(ttl_range().first, ttl_range().second);
         p.colour = colour();
 
         //FIXME: Initialize other properties
-        new_particles.push_back(p);
+        out.push_back(p);
 
         emission_accumulator_ -= decrement; //Decrement the accumulator while we can
         to_emit--;
@@ -271,7 +289,7 @@ std::vector<Particle> ParticleEmitter::do_emit(double dt, uint32_t max) {
         }
     }
 
-    return new_particles;
+    return max - to_emit;
 }
 
 
@@ -321,7 +339,7 @@ void ParticleEmitter::set_duration(float seconds) {
 
 void ParticleEmitter::set_duration_range(float min_seconds, float max_seconds) {
     duration_range_ = std::make_pair(min_seconds, max_seconds);
-    current_duration_ = random_gen::random_float(duration_range_.first, duration_range_.second);
+    current_duration_ = system().random_float(duration_range_.first, duration_range_.second);
 }
 
 std::pair<float, float> ParticleEmitter::duration_range() const {
@@ -2,6 +2,8 @@
 #define PARTICLES_H
 
 #include <memory>
+#include <random>
+#include <vector>
 #include <unordered_map>
 
 #include "generic/identifiable.h"
@@ -94,7 +96,8 @@ public:
     void set_duration_range(float min_seconds, float max_seconds);
     std::pair<float, float> duration_range() const;
 
-    std::vector<Particle> do_emit(double dt, uint32_t max_to_emit);
+    /* Appends up to max_to_emit new particles to out, returns how many were added */
+    uint32_t do_emit(double dt, uint32_t max_to_emit, std::vector<Particle>& out);
 
     ParticleSystem& system() { return system_; }
 
@@ -173,6 +176,10 @@ public:
 
     void ask_owner_for_destruction();
 
+    //Emission only draws on the system's own generator, so systems can be updated side by side
+    bool is_parallel_update_safe() const override { return !is_constrained() && !has_sound_instances(); }
+    bool wants_update() const override { return true; } //Emitting or not, it has to notice when to finish
+
     //Renderable stuff
 
     const MeshArrangement arrangement() const { return MESH_ARRANGEMENT_POINTS; }
@@ -206,6 +213,9 @@ public:
 
     bool has_repeating_emitters() const;
     bool has_active_emitters() const;
+
+    /* A random number between min and max from this system's own generator, for its emitters */
+    float random_float(float min, float max);
 private:
     unicode name_;
     int quota_ = 10;
@@ -217,9 +227,13 @@ private:
     MaterialPtr material_ref_;
 
     std::vector<EmitterPtr> emitters_;
-    std::list<Particle> particles_;
+    std::vector<Particle> particles_;
+    std::vector<uint32_t> index_scratch_;
+
+    std::mt19937 random_;
 
     void do_update(double dt);
+    void transformation_changed() override;
 
     VertexData vertex_data_;
     IndexData index_data_;
@@ -0,0 +1,117 @@
+#include <algorithm>
+
+#include "partitioner.h"
+#include "batcher.h"
+#include "stage.h"
+
+namespace kglt {
+
+void Partitioner::lights_visible_from(CameraID camera_id, LightList& out) {
+    FrameResources resources(stage_.window());
+    resources.begin(stage_.id());
+    lights_visible_from(resources, camera_id, out);
+    resources.end();
+}
+
+void Partitioner::geometry_visible_from(CameraID camera_id, RenderableList& out) {
+    FrameResources resources(stage_.window());
+    resources.begin(stage_.id());
+    geometry_visible_from(resources, camera_id, out);
+    resources.end();
+}
+
+bool Partitioner::raycast(const Ray& ray, RaycastHit& nearest) {
+    float max_distance = ray.length;
+    Renderable* found = nullptr;
+
+    visit_geometry_along_ray(ray, max_distance, [&](Renderable* renderable) {
+        float distance;
+        if(!ray.intersects(renderable->transformed_aabb(), distance) || distance > max_distance) {
+            return;
+        }
+
+        if(!found || distance < max_distance) {
+            found = renderable;
+            max_distance = distance; //Nothing further away can be nearer
+        }
+    });
+
+    if(!found) {
+        return false;
+    }
+
+    nearest.renderable = found;
+    nearest.distance = max_distance;
+    return true;
+}
+
+void Partitioner::raycast_all(const Ray& ray, RaycastHitList& out) {
+    const float max_distance = ray.length;
+    uint32_t first = out.size();
+
+    visit_geometry_along_ray(ray, max_distance, [&](Renderable* renderable) {
+        float distance;
+        if(ray.intersects(renderable->transformed_aabb(), distance)) {
+            out.push_back(RaycastHit{renderable, distance});
+        }
+    });
+
+    std::sort(out.begin() + first, out.end(), [](const RaycastHit& lhs, const RaycastHit& rhs) {
+        return lhs.distance < rhs.distance;
+    });
+}
+
+void Partitioner::geometry_overlapping(const AABB& box, RenderableList& out) {
+    visit_geometry_overlapping(box, [&](Renderable* renderable) {
+        AABB bounds = renderable->transformed_aabb();
+        if(kmAABB3IntersectsAABB(&bounds, &box)) {
+            out.push_back(renderable);
+        }
+    });
+}
+
+void Partitioner::geometry_within(const Vec3& centre, float radius, RenderableList& out) {
+    const float max_distance_sq = radius * radius;
+
+    visit_geometry_near(centre, max_distance_sq, [&](Renderable* renderable) {
+        if(renderable->transformed_aabb().distance_squared(centre) <= max_distance_sq) {
+            out.push_back(renderable);
+        }
+    });
+}
+
+void Partitioner::nearest_geometry(const Vec3& point, uint32_t count, RenderableList& out, float max_distance) {
+    if(!count) {
+        return;
+    }
+
+    //A max-heap of the nearest found so far, once it's full only nearer things are of interest
+    nearest_.clear();
+    float max_distance_sq = max_distance * max_distance;
+
+    visit_geometry_near(point, max_distance_sq, [&](Renderable* renderable) {
+        float distance_sq = renderable->transformed_aabb().distance_squared(point);
+        if(distance_sq > max_distance_sq) {
+            return;
+        }
+
+        nearest_.push_back(std::make_pair(distance_sq, renderable));
+        std::push_heap(nearest_.begin(), nearest_.end());
+
+        if(nearest_.size() > count) {
+            std::pop_heap(nearest_.begin(), nearest_.end());
+            nearest_.pop_back();
+        }
+
+        if(nearest_.size() == count) {
+            max_distance_sq = nearest_.front().first;
+        }
+    });
+
+    std::sort_heap(nearest_.begin(), nearest_.end());
+    for(auto& pair: nearest_) {
+        out.push_back(pair.second);
+    }
+}
+
+}
@@ -1,8 +1,11 @@
 #ifndef PARTITIONER_H
 #define PARTITIONER_H
 
+#include <functional>
+#include <limits>
 #include <memory>
 #include <set>
+#include <utility>
 #include <vector>
 
 #include "generic/managed.h"
@@ -13,6 +16,14 @@
 namespace kglt {
 
 class SubActor;
+class FrameResources;
+
+struct RaycastHit {
+    Renderable* renderable;
+    float distance; //How far along the ray it enters the renderable's bounds
+};
+
+typedef std::vector<RaycastHit> RaycastHitList;
 
 class Partitioner:
     public Managed<Partitioner> {
@@ -30,14 +41,70 @@ public:
     virtual void add_light(LightID obj) = 0;
     virtual void remove_light(LightID obj) = 0;
 
-    virtual std::vector<LightID> lights_visible_from(CameraID camera_id) = 0;
-    virtual std::vector<std::shared_ptr<Renderable>> geometry_visible_from(CameraID camera_id) = 0;
+    /*
+     * Called as objects' absolute transformations change. Partitioners which care should
+     * queue these up and deal with them in update(), which the stage calls once per frame
+     * after its transformations have been resolved.
+     */
+    virtual void actor_moved(ActorID obj) {}
+    virtual void light_moved(LightID obj) {}
+    virtual void particle_system_moved(ParticleSystemID ps) {}
+
+    virtual void update() {}
+
+    /*
+     * These append to the caller's list rather than returning a new one, so that the renderer can
+     * hand over lists allocated from the window's frame arena. The camera and any lights are
+     * looked up through resources, the renderer passes the ones it renders the pipeline with so
+     * that they're resolved (and kept alive) once per pipeline rather than locked on every query.
+     */
+    virtual void lights_visible_from(FrameResources& resources, CameraID camera_id, LightList& out) = 0;
+    virtual void geometry_visible_from(FrameResources& resources, CameraID camera_id, RenderableList& out) = 0;
+
+    /* As above, with the camera and lights looked up for just this call */
+    void lights_visible_from(CameraID camera_id, LightList& out);
+    void geometry_visible_from(CameraID camera_id, RenderableList& out);
+
+    /*
+     * Spatial queries against the geometry (subactors and particle systems) by its world space
+     * bounds, as of the last update(). Each partitioner narrows them down with its own structure,
+     * so they're cheap enough to run every frame. Like the visibility queries they append to the
+     * caller's list, so the same list can be cleared and reused.
+     */
+
+    /* Finds the nearest thing the ray hits, returns false if it hits nothing */
+    bool raycast(const Ray& ray, RaycastHit& nearest);
+
+    /* Appends everything the ray hits, nearest first */
+    void raycast_all(const Ray& ray, RaycastHitList& out);
+
+    void geometry_overlapping(const AABB& box, RenderableList& out);
+    void geometry_within(const Vec3& centre, float radius, RenderableList& out);
+
+    /* Appends the count nearest things to point, nearest first, ignoring anything beyond max_distance */
+    void nearest_geometry(const Vec3& point, uint32_t count, RenderableList& out,
+        float max_distance=std::numeric_limits<float>::infinity()
+    );
 
 protected:
     Stage* stage() { return &stage_; }
 
+    typedef std::function<void (Renderable*)> GeometryCallback;
+
+    /*
+     * Partitioners call callback with every piece of geometry which might satisfy a query, the
+     * queries then test each one's bounds exactly. The limits are read as the walk goes, the
+     * queries lower them as they find things so that the walk can give up on what's further away.
+     */
+    virtual void visit_geometry_along_ray(const Ray& ray, const float& max_distance, const GeometryCallback& callback) = 0;
+    virtual void visit_geometry_near(const Vec3& point, const float& max_distance_sq, const GeometryCallback& callback) = 0;
+    virtual void visit_geometry_overlapping(const AABB& box, const GeometryCallback& callback) = 0;
+
 private:
     Stage& stage_;
+
+    //Kept between calls to nearest_geometry() so it doesn't allocate each time
+    std::vector<std::pair<float, Renderable*>> nearest_;
 };
 
 }
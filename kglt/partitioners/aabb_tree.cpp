@@ -0,0 +1,348 @@
+#include <algorithm>
+#include <cassert>
+
+#include "aabb_tree.h"
+
+namespace kglt {
+
+AABB AABBTree::combine(const AABB& lhs, const AABB& rhs) {
+    AABB result;
+    result.min.x = std::min(lhs.min.x, rhs.min.x);
+    result.min.y = std::min(lhs.min.y, rhs.min.y);
+    result.min.z = std::min(lhs.min.z, rhs.min.z);
+    result.max.x = std::max(lhs.max.x, rhs.max.x);
+    result.max.y = std::max(lhs.max.y, rhs.max.y);
+    result.max.z = std::max(lhs.max.z, rhs.max.z);
+    return result;
+}
+
+float AABBTree::surface_area(const AABB& box) {
+    float x = box.max.x - box.min.x;
+    float y = box.max.y - box.min.y;
+    float z = box.max.z - box.min.z;
+    return 2.0f * (x * y + y * z + z * x);
+}
+
+AABB AABBTree::fatten(const AABB& bounds) const {
+    float diameter = std::max(
+        bounds.max.x - bounds.min.x,
+        std::max(bounds.max.y - bounds.min.y, bounds.max.z - bounds.min.z)
+    );
+
+    float margin = diameter * margin_;
+
+    AABB result = bounds;
+    result.min.x -= margin;
+    result.min.y -= margin;
+    result.min.z -= margin;
+    result.max.x += margin;
+    result.max.y += margin;
+    result.max.z += margin;
+    return result;
+}
+
+uint32_t AABBTree::leaf_of(const BoundableEntity* object) const {
+    uint32_t slot = object->_spatial_slot();
+    if(slot < nodes_.size() && nodes_[slot].height == 0 && nodes_[slot].object == object) {
+        return slot;
+    }
+    return NO_NODE;
+}
+
+uint32_t AABBTree::new_node() {
+    if(free_nodes_.empty()) {
+        nodes_.push_back(Node());
+        return nodes_.size() - 1;
+    }
+
+    uint32_t index = free_nodes_.back();
+    free_nodes_.pop_back();
+    nodes_[index] = Node();
+    return index;
+}
+
+void AABBTree::delete_node(uint32_t index) {
+    nodes_[index] = Node();
+    free_nodes_.push_back(index);
+}
+
+const AABB& AABBTree::fat_bounds(const BoundableEntity* object) const {
+    uint32_t leaf = leaf_of(object);
+    if(leaf == NO_NODE) {
+        throw std::logic_error("Object does not exist in the tree");
+    }
+    return nodes_[leaf].bounds;
+}
+
+void AABBTree::insert(const BoundableEntity* object, Renderable* renderable) {
+    assert(object);
+
+    if(leaf_of(object) != NO_NODE) {
+        throw std::logic_error("Tried to add an object which is already in the tree");
+    }
+
+    uint32_t leaf = new_node();
+
+    Node& node = nodes_[leaf];
+    node.bounds = fatten(object->transformed_aabb());
+    node.height = 0;
+    node.object = object;
+    node.renderable = renderable;
+
+    object->_set_spatial_slot(leaf);
+
+    insert_leaf(leaf);
+    ++object_count_;
+}
+
+void AABBTree::remove(const BoundableEntity* object) {
+    assert(object);
+
+    uint32_t leaf = leaf_of(object);
+    if(leaf == NO_NODE) {
+        throw std::logic_error("Tried to remove an object that doesn't exist in the tree");
+    }
+
+    remove_leaf(leaf);
+    delete_node(leaf);
+
+    object->_set_spatial_slot(~0u);
+    --object_count_;
+}
+
+bool AABBTree::update(const BoundableEntity* object) {
+    assert(object);
+
+    uint32_t leaf = leaf_of(object);
+    if(leaf == NO_NODE) {
+        throw std::logic_error("Tried to update an object that doesn't exist in the tree");
+    }
+
+    AABB bounds = object->transformed_aabb();
+
+    //Still inside the margin, so nothing needs to change. This is the common case
+    if(encloses(nodes_[leaf].bounds, bounds)) {
+        return false;
+    }
+
+    remove_leaf(leaf);
+    nodes_[leaf].bounds = fatten(bounds);
+    insert_leaf(leaf);
+
+    return true;
+}
+
+void AABBTree::insert_leaf(uint32_t leaf) {
+    if(root_ == NO_NODE) {
+        root_ = leaf;
+        nodes_[leaf].parent = NO_NODE;
+        return;
+    }
+
+    /*
+     * Find the best sibling for the leaf. At each level the choice is between pairing the
+     * leaf with the current node (which costs the area of a new parent around both), or going
+     * down into one of the children (which grows every node on the way). Go whichever way is
+     * cheapest, stopping once neither child is cheaper than stopping here.
+     */
+    AABB leaf_bounds = nodes_[leaf].bounds;
+
+    uint32_t index = root_;
+    while(!nodes_[index].is_leaf()) {
+        const Node& node = nodes_[index];
+
+        float area = surface_area(node.bounds);
+        float combined_area = surface_area(combine(node.bounds, leaf_bounds));
+
+        float cost = 2.0f * combined_area;
+        float inheritance_cost = 2.0f * (combined_area - area);
+
+        auto descent_cost = [&](uint32_t child_index) -> float {
+            const Node& child = nodes_[child_index];
+            float child_cost = surface_area(combine(child.bounds, leaf_bounds));
+            if(!child.is_leaf()) {
+                child_cost -= surface_area(child.bounds);
+            }
+            return child_cost + inheritance_cost;
+        };
+
+        float left_cost = descent_cost(node.left);
+        float right_cost = descent_cost(node.right);
+
+        if(cost < left_cost && cost < right_cost) {
+            break;
+        }
+
+        index = (left_cost < right_cost) ? node.left : node.right;
+    }
+
+    uint32_t sibling = index;
+    uint32_t old_parent = nodes_[sibling].parent;
+    uint32_t new_parent = new_node();
+
+    Node& parent = nodes_[new_parent];
+    parent.parent = old_parent;
+    parent.bounds = combine(leaf_bounds, nodes_[sibling].bounds);
+    parent.height = nodes_[sibling].height + 1;
+    parent.left = sibling;
+    parent.right = leaf;
+
+    nodes_[sibling].parent = new_parent;
+    nodes_[leaf].parent = new_parent;
+
+    if(old_parent == NO_NODE) {
+        root_ = new_parent;
+    } else if(nodes_[old_parent].left == sibling) {
+        nodes_[old_parent].left = new_parent;
+    } else {
+        nodes_[old_parent].right = new_parent;
+    }
+
+    refit_from(new_parent);
+}
+
+void AABBTree::remove_leaf(uint32_t leaf) {
+    if(leaf == root_) {
+        root_ = NO_NODE;
+        return;
+    }
+
+    uint32_t parent = nodes_[leaf].parent;
+    uint32_t grandparent = nodes_[parent].parent;
+    uint32_t sibling = (nodes_[parent].left == leaf) ? nodes_[parent].right : nodes_[parent].left;
+
+    //The sibling takes the parent's place
+    nodes_[sibling].parent = grandparent;
+    if(grandparent == NO_NODE) {
+        root_ = sibling;
+    } else if(nodes_[grandparent].left == parent) {
+        nodes_[grandparent].left = sibling;
+    } else {
+        nodes_[grandparent].right = sibling;
+    }
+
+    delete_node(parent);
+    nodes_[leaf].parent = NO_NODE;
+
+    refit_from(grandparent);
+}
+
+void AABBTree::refit_from(uint32_t index) {
+    while(index != NO_NODE) {
+        index = balance(index);
+
+        Node& node = nodes_[index];
+        const Node& left = nodes_[node.left];
+        const Node& right = nodes_[node.right];
+
+        node.height = 1 + std::max(left.height, right.height);
+        node.bounds = combine(left.bounds, right.bounds);
+
+        index = node.parent;
+    }
+}
+
+/*
+ * If one child of the node is more than one level taller than the other, rotate the taller
+ * child up into the node's place. The node takes the place of the taller child's shorter
+ * child, which moves across to the node. Returns whichever node is now in this position.
+ */
+uint32_t AABBTree::balance(uint32_t index_a) {
+    Node& a = nodes_[index_a];
+    if(a.is_leaf() || a.height < 2) {
+        return index_a;
+    }
+
+    uint32_t index_b = a.left;
+    uint32_t index_c = a.right;
+    Node& b = nodes_[index_b];
+    Node& c = nodes_[index_c];
+
+    int32_t difference = c.height - b.height;
+
+    if(difference > 1) {
+        //Rotate C up
+        uint32_t index_f = c.left;
+        uint32_t index_g = c.right;
+        Node& f = nodes_[index_f];
+        Node& g = nodes_[index_g];
+
+        c.left = index_a;
+        c.parent = a.parent;
+        a.parent = index_c;
+
+        if(c.parent == NO_NODE) {
+            root_ = index_c;
+        } else if(nodes_[c.parent].left == index_a) {
+            nodes_[c.parent].left = index_c;
+        } else {
+            nodes_[c.parent].right = index_c;
+        }
+
+        //The taller of C's children stays with C
+        if(f.height > g.height) {
+            c.right = index_f;
+            a.right = index_g;
+            g.parent = index_a;
+            a.bounds = combine(b.bounds, g.bounds);
+            c.bounds = combine(a.bounds, f.bounds);
+            a.height = 1 + std::max(b.height, g.height);
+            c.height = 1 + std::max(a.height, f.height);
+        } else {
+            c.right = index_g;
+            a.right = index_f;
+            f.parent = index_a;
+            a.bounds = combine(b.bounds, f.bounds);
+            c.bounds = combine(a.bounds, g.bounds);
+            a.height = 1 + std::max(b.height, f.height);
+            c.height = 1 + std::max(a.height, g.height);
+        }
+
+        return index_c;
+    }
+
+    if(difference < -1) {
+        //Rotate B up
+        uint32_t index_d = b.left;
+        uint32_t index_e = b.right;
+        Node& d = nodes_[index_d];
+        Node& e = nodes_[index_e];
+
+        b.left = index_a;
+        b.parent = a.parent;
+        a.parent = index_b;
+
+        if(b.parent == NO_NODE) {
+            root_ = index_b;
+        } else if(nodes_[b.parent].left == index_a) {
+            nodes_[b.parent].left = index_b;
+        } else {
+            nodes_[b.parent].right = index_b;
+        }
+
+        //The taller of B's children stays with B
+        if(d.height > e.height) {
+            b.right = index_d;
+            a.left = index_e;
+            e.parent = index_a;
+            a.bounds = combine(c.bounds, e.bounds);
+            b.bounds = combine(a.bounds, d.bounds);
+            a.height = 1 + std::max(c.height, e.height);
+            b.height = 1 + std::max(a.height, d.height);
+        } else {
+            b.right = index_e;
+            a.left = index_d;
+            d.parent = index_a;
+            a.bounds = combine(c.bounds, d.bounds);
+            b.bounds = combine(a.bounds, e.bounds);
+            a.height = 1 + std::max(c.height, d.height);
+            b.height = 1 + std::max(a.height, e.height);
+        }
+
+        return index_b;
+    }
+
+    return index_a;
+}
+
+}
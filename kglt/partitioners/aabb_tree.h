@@ -0,0 +1,287 @@
+#ifndef AABB_TREE_H
+#define AABB_TREE_H
+
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <kazmath/kazmath.h>
+
+#include "../generic/small_vector.h"
+#include "../interfaces.h"
+#include "../types.h"
+#include "../frustum.h"
+
+namespace kglt {
+
+/*
+ * A dynamic bounding volume hierarchy. Each object is a leaf, and every other node is the union
+ * of its two children. Unlike the Octree the shape of the tree follows the objects rather than
+ * space, so it doesn't care how large the world is or how unevenly things are spread out.
+ *
+ * * Leaves are given bounds larger than their object, by a margin which is a fraction of the
+ *   object's size on each side. An object moving around inside them costs nothing, when it
+ *   leaves them the leaf is taken out and put back in. The default margin makes leaves about as
+ *   loose as the Octree's nodes, smaller margins mean tighter culling but more reinsertion.
+ * * Insertion walks down from the root towards whichever side would grow the least in surface
+ *   area (the surface area heuristic), so the tree stays cheap to search as it changes.
+ * * On the way back up after an insertion or removal, unbalanced nodes are rotated so the tree
+ *   can't degrade into a list when objects are added in order.
+ *
+ * Nodes are kept in an array and refer to each other by index. Objects are found through
+ * BoundableEntity::_spatial_slot(), so an object can only be in one tree at a time.
+ */
+class AABBTree {
+public:
+    static const uint32_t NO_NODE = ~0u;
+
+    AABBTree(float margin=1.0f):
+        margin_(margin) {}
+
+    AABBTree(const AABBTree&) = delete;
+    AABBTree& operator=(const AABBTree&) = delete;
+
+    void insert(const BoundableEntity* object, Renderable* renderable=nullptr);
+    void remove(const BoundableEntity* object);
+
+    /* Returns true if the object had left its leaf's bounds and was moved in the tree */
+    bool update(const BoundableEntity* object);
+
+    bool contains(const BoundableEntity* object) const { return leaf_of(object) != NO_NODE; }
+
+    uint32_t object_count() const { return object_count_; }
+    uint32_t node_count() const { return nodes_.size() - free_nodes_.size(); }
+
+    /* The longest path from the root to a leaf, zero for a single leaf or an empty tree */
+    uint32_t height() const { return (root_ == NO_NODE) ? 0 : nodes_[root_].height; }
+
+    /* The bounds the tree holds for the object, i.e. with the margin added */
+    const AABB& fat_bounds(const BoundableEntity* object) const;
+
+    /*
+     * Appends the renderables of the objects in view to out. Whole subtrees within the frustum
+     * are taken without testing anything below them, in subtrees which straddle the edge each
+     * object's own bounds are tested if cull_objects is set.
+     */
+    void objects_visible_from(const Frustum& frustum, RenderableList& out, bool cull_objects=true) const {
+        visit_visible(frustum, [&out](const BoundableEntity*, Renderable* renderable) {
+            if(renderable) {
+                out.push_back(renderable);
+            }
+        }, cull_objects);
+    }
+
+    /* As objects_visible_from, but calls callback(object, renderable) for each one */
+    template<typename Callback>
+    void visit_visible(const Frustum& frustum, const Callback& callback, bool cull_objects=true) const {
+        if(root_ == NO_NODE) {
+            return;
+        }
+
+        generic::SmallVector<uint32_t, 64> stack;
+        stack.push_back(root_);
+
+        while(!stack.empty()) {
+            const Node& node = nodes_[stack.back()];
+            stack.pop_back();
+
+            if(node.is_leaf()) {
+                //The leaf's bounds are close enough if we aren't culling objects
+                AABB bounds = (cull_objects) ? node.object->transformed_aabb() : node.bounds;
+                if(frustum.intersects_aabb(bounds)) {
+                    callback(node.object, node.renderable);
+                }
+                continue;
+            }
+
+            switch(frustum.classify_aabb(node.bounds)) {
+                case FRUSTUM_CONTAINS_NONE:
+                    break;
+                case FRUSTUM_CONTAINS_ALL:
+                    visit_subtree(node.left, callback);
+                    visit_subtree(node.right, callback);
+                    break;
+                default:
+                    stack.push_back(node.left);
+                    stack.push_back(node.right);
+            }
+        }
+    }
+
+    /* Calls callback(object, renderable) for every object whose leaf bounds overlap box */
+    template<typename Callback>
+    void visit_overlapping(const AABB& box, const Callback& callback) const {
+        if(root_ == NO_NODE) {
+            return;
+        }
+
+        generic::SmallVector<uint32_t, 64> stack;
+        stack.push_back(root_);
+
+        while(!stack.empty()) {
+            const Node& node = nodes_[stack.back()];
+            stack.pop_back();
+
+            if(!overlaps(node.bounds, box)) {
+                continue;
+            }
+
+            if(node.is_leaf()) {
+                callback(node.object, node.renderable);
+            } else {
+                stack.push_back(node.left);
+                stack.push_back(node.right);
+            }
+        }
+    }
+
+    /*
+     * Calls callback(object, renderable) for every object whose leaf the ray passes through
+     * within max_distance. max_distance is read as the walk goes, so the callback can shorten it
+     * (e.g. to the nearest hit so far) to skip everything further away. Nearer subtrees go first.
+     */
+    template<typename Callback>
+    void visit_along_ray(const Ray& ray, const float& max_distance, const Callback& callback) const {
+        walk_nearest_first(
+            [&ray](const AABB& bounds, float& distance) { return ray.intersects(bounds, distance); },
+            max_distance, callback
+        );
+    }
+
+    /*
+     * Calls callback(object, renderable) for every object whose leaf is within
+     * sqrt(max_distance_sq) of point. As with visit_along_ray, the callback can shrink the limit
+     * as it goes, so a nearest neighbour search can stop early.
+     */
+    template<typename Callback>
+    void visit_near(const kmVec3& point, const float& max_distance_sq, const Callback& callback) const {
+        walk_nearest_first(
+            [&point](const AABB& bounds, float& distance) {
+                distance = bounds.distance_squared(point);
+                return true;
+            },
+            max_distance_sq, callback
+        );
+    }
+
+private:
+    //A node waiting to be looked at, and how far away it was when it was found
+    struct Pending {
+        uint32_t node;
+        float distance;
+    };
+
+    template<typename Measure, typename Callback>
+    void walk_nearest_first(const Measure& measure, const float& limit, const Callback& callback) const {
+        if(root_ == NO_NODE) {
+            return;
+        }
+
+        generic::SmallVector<Pending, 64> stack;
+
+        Pending root = {root_, 0.0f};
+        if(!measure(nodes_[root_].bounds, root.distance)) {
+            return;
+        }
+        stack.push_back(root);
+
+        while(!stack.empty()) {
+            Pending next = stack.back();
+            stack.pop_back();
+
+            //The limit may have come down since this was pushed
+            if(next.distance > limit) {
+                continue;
+            }
+
+            const Node& node = nodes_[next.node];
+            if(node.is_leaf()) {
+                callback(node.object, node.renderable);
+                continue;
+            }
+
+            Pending left = {node.left, 0.0f};
+            Pending right = {node.right, 0.0f};
+            bool keep_left = measure(nodes_[node.left].bounds, left.distance) && left.distance <= limit;
+            bool keep_right = measure(nodes_[node.right].bounds, right.distance) && right.distance <= limit;
+
+            //Push the further one first, so the nearer is looked at next
+            if(keep_left && keep_right && left.distance < right.distance) {
+                std::swap(left, right);
+            }
+
+            if(keep_left) stack.push_back(left);
+            if(keep_right) stack.push_back(right);
+        }
+    }
+
+    struct Node {
+        AABB bounds;
+        uint32_t parent = NO_NODE; //Or the next free node, if this one isn't in use
+        uint32_t left = NO_NODE;
+        uint32_t right = NO_NODE;
+        int32_t height = -1; //Zero for leaves, -1 for free nodes
+
+        const BoundableEntity* object = nullptr;
+        Renderable* renderable = nullptr;
+
+        bool is_leaf() const { return left == NO_NODE; }
+    };
+
+    float margin_;
+
+    std::vector<Node> nodes_;
+    std::vector<uint32_t> free_nodes_;
+    uint32_t root_ = NO_NODE;
+    uint32_t object_count_ = 0;
+
+    uint32_t leaf_of(const BoundableEntity* object) const;
+
+    uint32_t new_node();
+    void delete_node(uint32_t index);
+
+    AABB fatten(const AABB& bounds) const;
+
+    void insert_leaf(uint32_t leaf);
+    void remove_leaf(uint32_t leaf);
+
+    //Refits and rebalances the nodes from index up to the root
+    void refit_from(uint32_t index);
+    uint32_t balance(uint32_t index);
+
+    template<typename Callback>
+    void visit_subtree(uint32_t index, const Callback& callback) const {
+        generic::SmallVector<uint32_t, 64> stack;
+        stack.push_back(index);
+
+        while(!stack.empty()) {
+            const Node& node = nodes_[stack.back()];
+            stack.pop_back();
+
+            if(node.is_leaf()) {
+                callback(node.object, node.renderable);
+            } else {
+                stack.push_back(node.left);
+                stack.push_back(node.right);
+            }
+        }
+    }
+
+    static bool overlaps(const AABB& lhs, const AABB& rhs) {
+        return lhs.min.x <= rhs.max.x && lhs.max.x >= rhs.min.x &&
+               lhs.min.y <= rhs.max.y && lhs.max.y >= rhs.min.y &&
+               lhs.min.z <= rhs.max.z && lhs.max.z >= rhs.min.z;
+    }
+
+    static bool encloses(const AABB& outer, const AABB& inner) {
+        return outer.min.x <= inner.min.x && outer.max.x >= inner.max.x &&
+               outer.min.y <= inner.min.y && outer.max.y >= inner.max.y &&
+               outer.min.z <= inner.min.z && outer.max.z >= inner.max.z;
+    }
+
+    static AABB combine(const AABB& lhs, const AABB& rhs);
+    static float surface_area(const AABB& box);
+};
+
+}
+
+#endif // AABB_TREE_H
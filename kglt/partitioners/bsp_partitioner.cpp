@@ -0,0 +1,205 @@
+#include "bsp_partitioner.h"
+
+#include "../stage.h"
+#include "../light.h"
+#include "../actor.h"
+#include "../camera.h"
+#include "../batcher.h"
+#include "../mesh.h"
+#include "../particles.h"
+
+namespace kglt {
+
+void BSPPartitioner::add_actor(ActorID obj) {
+    auto ent = stage()->actor(obj);
+
+    //Level meshes are recognised by what the loader stashed on them
+    BSPTree::ptr level_tree;
+    SubMeshClusters level_clusters;
+
+    MeshID mesh_id = ent->mesh_id();
+    if(mesh_id) {
+        auto mesh = stage()->mesh(mesh_id);
+        if(mesh->exists("BSP_TREE")) {
+            level_tree = mesh->get<BSPTree::ptr>("BSP_TREE");
+            if(mesh->exists("BSP_SUBMESH_CLUSTERS")) {
+                level_clusters = mesh->get<SubMeshClusters>("BSP_SUBMESH_CLUSTERS");
+            }
+        }
+    }
+
+    if(!level_tree) {
+        SpatialPartitioner::add_actor(obj);
+        return;
+    }
+
+    if(tree_) {
+        L_WARN("A second BSP level was added to the partitioner, it replaces the first");
+        level_parts_.clear();
+    }
+
+    tree_ = level_tree;
+    level_actor_ = obj;
+
+    visible_.clear();
+    place_everything();
+
+    //The level's submeshes are given their clusters below rather than placed as they're inserted
+    adding_level_ = true;
+    SpatialPartitioner::add_actor(obj);
+    adding_level_ = false;
+
+    for(uint16_t i = 0; i < ent->subactor_count(); ++i) {
+        const BoundableEntity* boundable = &ent->subactor(i);
+
+        auto it = level_clusters.find(ent->subactor(i).submesh_id());
+        if(it != level_clusters.end() && !it->second.empty()) {
+            clusters_[boundable] = it->second;
+            level_parts_.insert(boundable);
+        } else {
+            //Parts of the level in no cluster go by where their bounds are
+            place(boundable);
+        }
+    }
+}
+
+void BSPPartitioner::remove_actor(ActorID obj) {
+    SpatialPartitioner::remove_actor(obj);
+
+    if(tree_ && obj == level_actor_) {
+        //Without the level there's nothing to cull by, so everything is visible again
+        tree_.reset();
+        level_actor_ = ActorID();
+
+        visible_.clear();
+        visible_from_ = -1;
+        clusters_.clear();
+        level_parts_.clear();
+    }
+}
+
+void BSPPartitioner::insert_geometry(const BoundableEntity* boundable, Renderable* renderable) {
+    geometry_.insert(boundable, renderable);
+
+    if(!adding_level_) {
+        place(boundable);
+    }
+}
+
+void BSPPartitioner::update_geometry(const BoundableEntity* boundable) {
+    geometry_.update(boundable);
+
+    if(!level_parts_.count(boundable)) {
+        place(boundable);
+    }
+}
+
+void BSPPartitioner::remove_geometry(const BoundableEntity* boundable) {
+    geometry_.remove(boundable);
+    clusters_.erase(boundable);
+    level_parts_.erase(boundable);
+}
+
+void BSPPartitioner::insert_light_bounds(const BoundableEntity* boundable) {
+    lights_.insert(boundable);
+    place(boundable);
+}
+
+void BSPPartitioner::update_light_bounds(const BoundableEntity* boundable) {
+    lights_.update(boundable);
+    place(boundable);
+}
+
+void BSPPartitioner::remove_light_bounds(const BoundableEntity* boundable) {
+    lights_.remove(boundable);
+    clusters_.erase(boundable);
+}
+
+void BSPPartitioner::place(const BoundableEntity* boundable) {
+    if(!tree_) {
+        return;
+    }
+
+    std::vector<int32_t>& clusters = clusters_[boundable];
+    clusters.clear();
+    tree_->clusters_overlapping(boundable->transformed_aabb(), clusters);
+}
+
+void BSPPartitioner::place_everything() {
+    each_registered([this](const BoundableEntity* boundable) {
+        if(!level_parts_.count(boundable)) {
+            place(boundable);
+        }
+    });
+}
+
+void BSPPartitioner::find_visible_clusters(const Camera& camera) {
+    if(!tree_) {
+        return;
+    }
+
+    const Mat4& transform = camera.transform();
+    Vec3 eye(transform.mat[12], transform.mat[13], transform.mat[14]);
+
+    //Decompressing a row is cheap, but the camera usually stays in the same cluster for a while
+    int32_t cluster = tree_->cluster_at(eye);
+    if(cluster != visible_from_ || visible_.empty()) {
+        tree_->visible_clusters(cluster, visible_);
+        visible_from_ = cluster;
+    }
+}
+
+bool BSPPartitioner::potentially_visible(const BoundableEntity* boundable) const {
+    if(!tree_) {
+        return true;
+    }
+
+    auto it = clusters_.find(boundable);
+    if(it == clusters_.end() || it->second.empty()) {
+        return true;
+    }
+
+    for(int32_t cluster: it->second) {
+        if(BSPTree::is_visible(visible_, cluster)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void BSPPartitioner::geometry_visible_from(FrameResources& resources, CameraID camera_id, RenderableList& out) {
+    Camera* camera = resources.camera(camera_id);
+    find_visible_clusters(*camera);
+
+    geometry_.visit_visible(camera->frustum(), [this, &out](const BoundableEntity* boundable, Renderable* renderable) {
+        if(renderable && potentially_visible(boundable)) {
+            out.push_back(renderable);
+        }
+    });
+}
+
+void BSPPartitioner::lights_visible_from(FrameResources& resources, CameraID camera_id, LightList& out) {
+    Camera* camera = resources.camera(camera_id);
+    find_visible_clusters(*camera);
+
+    lights_.visit_visible(camera->frustum(), [this, &out](const BoundableEntity* boundable, Renderable*) {
+        if(potentially_visible(boundable)) {
+            out.push_back(light_for(boundable));
+        }
+    });
+}
+
+void BSPPartitioner::visit_geometry_along_ray(const Ray& ray, const float& max_distance, const GeometryCallback& callback) {
+    geometry_.visit_along_ray(ray, max_distance, forward_renderables(callback));
+}
+
+void BSPPartitioner::visit_geometry_near(const Vec3& point, const float& max_distance_sq, const GeometryCallback& callback) {
+    geometry_.visit_near(point, max_distance_sq, forward_renderables(callback));
+}
+
+void BSPPartitioner::visit_geometry_overlapping(const AABB& box, const GeometryCallback& callback) {
+    geometry_.visit_overlapping(box, forward_renderables(callback));
+}
+
+}
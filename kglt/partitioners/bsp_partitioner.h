@@ -0,0 +1,83 @@
+#ifndef BSP_PARTITIONER_H
+#define BSP_PARTITIONER_H
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "spatial_partitioner.h"
+#include "aabb_tree.h"
+#include "bsp_tree.h"
+
+namespace kglt {
+
+/*
+ * For indoor levels loaded from BSP files (see Q2BSPLoader). When an actor is added whose mesh
+ * carries a BSPTree, that actor becomes the level: the cluster the camera is in decides which
+ * clusters can be seen, and only level submeshes, actors, particle systems and lights in those
+ * clusters are returned, after frustum culling. Until there's a level it behaves as the
+ * BVHPartitioner does, which it's built the same way as.
+ *
+ * The level should stay where it was loaded, the tree is in the mesh's own space.
+ */
+class BSPPartitioner :
+    public SpatialPartitioner {
+
+public:
+    BSPPartitioner(Stage& ss):
+        SpatialPartitioner(ss) {}
+
+    void add_actor(ActorID obj);
+    void remove_actor(ActorID obj);
+
+    void lights_visible_from(FrameResources& resources, CameraID camera_id, LightList& out);
+    void geometry_visible_from(FrameResources& resources, CameraID camera_id, RenderableList& out);
+
+    bool has_level() const { return bool(tree_); }
+
+    /* The cluster the camera was last seen in, -1 if it's outside the level or there isn't one */
+    int32_t camera_cluster() const { return visible_from_; }
+
+protected:
+    void insert_geometry(const BoundableEntity* boundable, Renderable* renderable);
+    void update_geometry(const BoundableEntity* boundable);
+    void remove_geometry(const BoundableEntity* boundable);
+
+    void insert_light_bounds(const BoundableEntity* boundable);
+    void update_light_bounds(const BoundableEntity* boundable);
+    void remove_light_bounds(const BoundableEntity* boundable);
+
+    void visit_geometry_along_ray(const Ray& ray, const float& max_distance, const GeometryCallback& callback);
+    void visit_geometry_near(const Vec3& point, const float& max_distance_sq, const GeometryCallback& callback);
+    void visit_geometry_overlapping(const AABB& box, const GeometryCallback& callback);
+
+private:
+    AABBTree geometry_;
+    AABBTree lights_;
+
+    BSPTree::ptr tree_;
+    ActorID level_actor_;
+
+    /*
+     * The clusters each object is in. Objects which aren't in any (or all of them, before a level
+     * is loaded) are never hidden by the visible sets, only by the frustum.
+     */
+    std::unordered_map<const BoundableEntity*, std::vector<int32_t> > clusters_;
+
+    //The level's submeshes, whose clusters came with the level and don't depend on where they are
+    std::unordered_set<const BoundableEntity*> level_parts_;
+    bool adding_level_ = false;
+
+    //The clusters visible from visible_from_, kept while the camera stays in the same cluster
+    std::vector<uint8_t> visible_;
+    int32_t visible_from_ = -1;
+
+    void place(const BoundableEntity* boundable);
+    void place_everything();
+    void find_visible_clusters(const Camera& camera);
+    bool potentially_visible(const BoundableEntity* boundable) const;
+};
+
+}
+
+#endif // BSP_PARTITIONER_H
@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "bsp_tree.h"
+#include "../generic/small_vector.h"
+
+namespace kglt {
+
+void BSPTree::add_plane(const Vec3& normal, float distance) {
+    planes_.push_back(Plane{normal, distance});
+}
+
+void BSPTree::add_node(uint32_t plane, int32_t front, int32_t back) {
+    nodes_.push_back(Node{plane, front, back});
+}
+
+void BSPTree::add_leaf(int32_t cluster) {
+    leaf_clusters_.push_back(cluster);
+
+    if(cluster >= 0) {
+        cluster_count_ = std::max(cluster_count_, uint32_t(cluster) + 1);
+    }
+}
+
+void BSPTree::set_visibility(uint32_t cluster_count, const std::vector<uint32_t>& offsets, const std::vector<uint8_t>& data) {
+    if(offsets.size() != cluster_count) {
+        throw std::logic_error("Every cluster needs a row of visibility data");
+    }
+
+    for(uint32_t offset: offsets) {
+        if(offset >= data.size()) {
+            throw std::logic_error("Visibility row starts outside of the visibility data");
+        }
+    }
+
+    cluster_count_ = std::max(cluster_count_, cluster_count);
+    offsets_ = offsets;
+    rows_ = data;
+}
+
+int32_t BSPTree::leaf_at(const Vec3& point) const {
+    if(leaf_clusters_.empty()) {
+        return -1;
+    }
+
+    if(nodes_.empty()) {
+        return 0;
+    }
+
+    int32_t child = 0;
+    while(child >= 0) {
+        const Node& node = nodes_[child];
+        const Plane& plane = planes_[node.plane];
+
+        child = (kmVec3Dot(&plane.normal, &point) - plane.distance >= 0.0f) ? node.front : node.back;
+    }
+
+    return child_to_leaf(child);
+}
+
+int32_t BSPTree::cluster_at(const Vec3& point) const {
+    int32_t leaf = leaf_at(point);
+    return (leaf < 0) ? -1 : leaf_clusters_[leaf];
+}
+
+void BSPTree::clusters_overlapping(const AABB& box, std::vector<int32_t>& out) const {
+    if(leaf_clusters_.empty()) {
+        return;
+    }
+
+    uint32_t first = out.size();
+
+    if(nodes_.empty()) {
+        out.push_back(leaf_clusters_[0]);
+    } else {
+        Vec3 centre;
+        kmAABB3Centre(&box, &centre);
+        Vec3 half_extents = (Vec3(box.max) - Vec3(box.min)) * 0.5f;
+
+        generic::SmallVector<int32_t, 64> stack;
+        stack.push_back(0);
+
+        while(!stack.empty()) {
+            int32_t child = stack.back();
+            stack.pop_back();
+
+            if(child < 0) {
+                out.push_back(leaf_clusters_[child_to_leaf(child)]);
+                continue;
+            }
+
+            const Node& node = nodes_[child];
+            const Plane& plane = planes_[node.plane];
+
+            //How far the box reaches along the normal either side of its centre
+            float reach = std::fabs(plane.normal.x) * half_extents.x
+                        + std::fabs(plane.normal.y) * half_extents.y
+                        + std::fabs(plane.normal.z) * half_extents.z;
+
+            float distance = kmVec3Dot(&plane.normal, &centre) - plane.distance;
+
+            if(distance >= -reach) {
+                stack.push_back(node.front);
+            }
+
+            if(distance < reach) {
+                stack.push_back(node.back);
+            }
+        }
+    }
+
+    //Solid leaves don't belong to anything and most clusters are made of many leaves
+    auto begin = out.begin() + first;
+    std::sort(begin, out.end());
+    out.erase(std::unique(begin, out.end()), out.end());
+    out.erase(std::remove(begin, out.end(), -1), out.end());
+}
+
+void BSPTree::visible_clusters(int32_t cluster, std::vector<uint8_t>& out) const {
+    uint32_t row_length = (cluster_count_ + 7) / 8;
+
+    if(cluster < 0 || uint32_t(cluster) >= offsets_.size()) {
+        out.assign(row_length, 0xFF);
+        return;
+    }
+
+    out.assign(row_length, 0);
+
+    uint32_t in = offsets_[cluster];
+    uint32_t written = 0;
+
+    while(written < row_length && in < rows_.size()) {
+        uint8_t value = rows_[in++];
+        if(value) {
+            out[written++] = value;
+            continue;
+        }
+
+        //A run of zero bytes, which out already has
+        if(in == rows_.size()) {
+            break;
+        }
+        written += rows_[in++];
+    }
+}
+
+}
@@ -0,0 +1,91 @@
+#ifndef BSP_TREE_H
+#define BSP_TREE_H
+
+#include <cstdint>
+#include <map>
+#include <vector>
+#include <kazmath/kazmath.h>
+
+#include "../generic/managed.h"
+#include "../types.h"
+
+namespace kglt {
+
+/*
+ * The binary space partition and potentially visible sets (PVS) a level compiler bakes into a
+ * BSP level. Space is split by planes down to convex leaves, leaves are grouped into clusters,
+ * and for every cluster the compiler recorded which others can be seen from anywhere inside it.
+ *
+ * Node children follow the Quake convention: zero or more is another node, anything negative is
+ * the leaf -(child + 1). Node 0 is the root. Cluster -1 is solid space, or outside the level.
+ */
+class BSPTree:
+    public Managed<BSPTree> {
+
+public:
+    struct Plane {
+        Vec3 normal;
+        float distance;
+    };
+
+    struct Node {
+        uint32_t plane;
+        int32_t front; //The side the plane's normal points to
+        int32_t back;
+    };
+
+    void add_plane(const Vec3& normal, float distance);
+    void add_node(uint32_t plane, int32_t front, int32_t back);
+    void add_leaf(int32_t cluster);
+
+    /*
+     * Sets the visibility rows in the form Quake 2 stores them: a bit per cluster, set if it can be
+     * seen, with each run of zero bytes replaced by a zero and the length of the run. offsets[i]
+     * is where cluster i's row starts in data. Until this is called every cluster sees every other.
+     */
+    void set_visibility(uint32_t cluster_count, const std::vector<uint32_t>& offsets, const std::vector<uint8_t>& data);
+
+    bool has_visibility() const { return !offsets_.empty(); }
+
+    uint32_t plane_count() const { return planes_.size(); }
+    uint32_t node_count() const { return nodes_.size(); }
+    uint32_t leaf_count() const { return leaf_clusters_.size(); }
+    uint32_t cluster_count() const { return cluster_count_; }
+
+    int32_t leaf_at(const Vec3& point) const;
+    int32_t cluster_at(const Vec3& point) const;
+
+    /* Appends the clusters of the leaves the box reaches into, each once and in order */
+    void clusters_overlapping(const AABB& box, std::vector<int32_t>& out) const;
+
+    /*
+     * Fills out with a bit per cluster, set for those visible from cluster. From cluster -1 (e.g. a
+     * camera which has left the level), or without visibility data, everything is visible.
+     */
+    void visible_clusters(int32_t cluster, std::vector<uint8_t>& out) const;
+
+    static bool is_visible(const std::vector<uint8_t>& visible, int32_t cluster) {
+        return cluster >= 0 && uint32_t(cluster >> 3) < visible.size() && (visible[cluster >> 3] & (1 << (cluster & 7)));
+    }
+
+private:
+    std::vector<Plane> planes_;
+    std::vector<Node> nodes_;
+    std::vector<int32_t> leaf_clusters_;
+
+    uint32_t cluster_count_ = 0;
+    std::vector<uint32_t> offsets_;
+    std::vector<uint8_t> rows_;
+
+    int32_t child_to_leaf(int32_t child) const { return -(child + 1); }
+};
+
+/*
+ * The clusters that the faces in each submesh of a level mesh belong to, keyed by submesh. Level
+ * loaders stash this on the mesh as "BSP_SUBMESH_CLUSTERS", beside the tree as "BSP_TREE".
+ */
+typedef std::map<SubMeshIndex, std::vector<int32_t> > SubMeshClusters;
+
+}
+
+#endif // BSP_TREE_H
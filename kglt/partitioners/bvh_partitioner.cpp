@@ -0,0 +1,31 @@
+#include "bvh_partitioner.h"
+
+#include "../stage.h"
+#include "../camera.h"
+#include "../batcher.h"
+
+namespace kglt {
+
+void BVHPartitioner::geometry_visible_from(FrameResources& resources, CameraID camera_id, RenderableList& out) {
+    geometry_.objects_visible_from(resources.camera(camera_id)->frustum(), out);
+}
+
+void BVHPartitioner::lights_visible_from(FrameResources& resources, CameraID camera_id, LightList& out) {
+    lights_.visit_visible(resources.camera(camera_id)->frustum(), [this, &out](const BoundableEntity* boundable, Renderable*) {
+        out.push_back(light_for(boundable));
+    });
+}
+
+void BVHPartitioner::visit_geometry_along_ray(const Ray& ray, const float& max_distance, const GeometryCallback& callback) {
+    geometry_.visit_along_ray(ray, max_distance, forward_renderables(callback));
+}
+
+void BVHPartitioner::visit_geometry_near(const Vec3& point, const float& max_distance_sq, const GeometryCallback& callback) {
+    geometry_.visit_near(point, max_distance_sq, forward_renderables(callback));
+}
+
+void BVHPartitioner::visit_geometry_overlapping(const AABB& box, const GeometryCallback& callback) {
+    geometry_.visit_overlapping(box, forward_renderables(callback));
+}
+
+}
@@ -0,0 +1,45 @@
+#ifndef BVH_PARTITIONER_H
+#define BVH_PARTITIONER_H
+
+#include "spatial_partitioner.h"
+#include "aabb_tree.h"
+
+namespace kglt {
+
+/*
+ * Keeps the stage in a pair of dynamic AABB trees, one for geometry and one for lights. Better
+ * suited than the octree to scenes full of mid-sized moving things, as most movement stays
+ * within the leaves' margins and costs nothing.
+ */
+class BVHPartitioner :
+    public SpatialPartitioner {
+
+public:
+    BVHPartitioner(Stage& ss):
+        SpatialPartitioner(ss) {}
+
+    void lights_visible_from(FrameResources& resources, CameraID camera_id, LightList& out);
+    void geometry_visible_from(FrameResources& resources, CameraID camera_id, RenderableList& out);
+
+protected:
+    //Most moves stay within the margin around each leaf and return straight away
+    void insert_geometry(const BoundableEntity* boundable, Renderable* renderable) { geometry_.insert(boundable, renderable); }
+    void update_geometry(const BoundableEntity* boundable) { geometry_.update(boundable); }
+    void remove_geometry(const BoundableEntity* boundable) { geometry_.remove(boundable); }
+
+    void insert_light_bounds(const BoundableEntity* boundable) { lights_.insert(boundable); }
+    void update_light_bounds(const BoundableEntity* boundable) { lights_.update(boundable); }
+    void remove_light_bounds(const BoundableEntity* boundable) { lights_.remove(boundable); }
+
+    void visit_geometry_along_ray(const Ray& ray, const float& max_distance, const GeometryCallback& callback);
+    void visit_geometry_near(const Vec3& point, const float& max_distance_sq, const GeometryCallback& callback);
+    void visit_geometry_overlapping(const AABB& box, const GeometryCallback& callback);
+
+private:
+    AABBTree geometry_;
+    AABBTree lights_;
+};
+
+}
+
+#endif // BVH_PARTITIONER_H
@@ -3,51 +3,55 @@
 #include "../actor.h"
 #include "../light.h"
 #include "../particles.h"
+#include "../batcher.h"
 
 #include "null_partitioner.h"
 
 namespace kglt {
 
-std::vector<LightID> NullPartitioner::lights_visible_from(CameraID camera_id) {
-    auto frustum = stage()->window().camera(camera_id)->frustum();
+void NullPartitioner::lights_visible_from(FrameResources& resources, CameraID camera_id, LightList& out) {
+    const Frustum& frustum = resources.camera(camera_id)->frustum();
 
-    std::vector<LightID> result;
     for(LightID lid: all_lights_) {
-        auto light = stage()->light(lid);
-        AABB aabb = light->transformed_aabb();
-        if(frustum.intersects_aabb(aabb)) {
-            result.push_back(lid);
+        if(frustum.intersects_aabb(resources.light(lid)->transformed_aabb())) {
+            out.push_back(lid);
         }
     }
-
-    return result;
 }
 
-std::vector<RenderablePtr> NullPartitioner::geometry_visible_from(CameraID camera_id) {
-    std::vector<RenderablePtr> result;
-
-    auto frustum = stage()->window().camera(camera_id)->frustum();
+void NullPartitioner::geometry_visible_from(FrameResources& resources, CameraID camera_id, RenderableList& out) {
+    const Frustum& frustum = resources.camera(camera_id)->frustum();
+    Stage& stage = resources.stage();
 
     //Just return all of the meshes in the stage
     for(ActorID eid: all_actors_) {
-        auto subactors = stage()->actor(eid)->_subactors();
+        auto actor = stage.ActorManager::manager_get(eid).lock();
 
-        for(auto ent: subactors) {
+        for(auto& ent: actor->_subactors()) {
             if(frustum.intersects_aabb(ent->transformed_aabb())) {
-                result.push_back(ent);
+                out.push_back(ent.get());
             }
         }
     }
 
     for(ParticleSystemID ps: all_particle_systems_) {
-        auto system = stage()->particle_system(ps);
-        AABB aabb = system->transformed_aabb();
-        if(frustum.intersects_aabb(aabb)) {
-            result.push_back(system.__object);
+        auto system = stage.ParticleSystemManager::manager_get(ps).lock();
+        if(frustum.intersects_aabb(system->transformed_aabb())) {
+            out.push_back(system.get());
         }
     }
+}
 
-    return result;
+void NullPartitioner::visit_all_geometry(const GeometryCallback& callback) {
+    for(ActorID eid: all_actors_) {
+        for(auto ent: stage()->actor(eid)->_subactors()) {
+            callback(ent.get());
+        }
+    }
+
+    for(ParticleSystemID ps: all_particle_systems_) {
+        callback(stage()->particle_system(ps).__object.get());
+    }
 }
 
 }
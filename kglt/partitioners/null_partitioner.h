@@ -36,13 +36,29 @@ public:
         all_particle_systems_.erase(ps);
     }
 
-    std::vector<LightID> lights_visible_from(CameraID camera_id);
-    std::vector<std::shared_ptr<Renderable>> geometry_visible_from(CameraID camera_id);
+    void lights_visible_from(FrameResources& resources, CameraID camera_id, LightList& out);
+    void geometry_visible_from(FrameResources& resources, CameraID camera_id, RenderableList& out);
+
+protected:
+    //There's nothing to narrow the search down with, so these hand over everything
+    void visit_geometry_along_ray(const Ray&, const float&, const GeometryCallback& callback) {
+        visit_all_geometry(callback);
+    }
+
+    void visit_geometry_near(const Vec3&, const float&, const GeometryCallback& callback) {
+        visit_all_geometry(callback);
+    }
+
+    void visit_geometry_overlapping(const AABB&, const GeometryCallback& callback) {
+        visit_all_geometry(callback);
+    }
 
 private:
     std::set<ParticleSystemID> all_particle_systems_;
     std::set<ActorID> all_actors_;
     std::set<LightID> all_lights_;
+
+    void visit_all_geometry(const GeometryCallback& callback);
 };
 
 }
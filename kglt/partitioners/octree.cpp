@@ -8,16 +8,97 @@
 
 namespace kglt {
 
+uint8_t OctreeNode::child_count() const {
+    uint8_t count = 0;
+    for(uint8_t mask = child_mask_; mask; mask &= mask - 1) {
+        ++count;
+    }
+    return count;
+}
+
+OctreeNode& OctreeNode::child(OctreePosition pos) {
+    if(!has_child(pos)) {
+        throw ChildNodeDoesNotExist();
+    }
+
+    return tree_->node(children_[pos]);
+}
+
 Octree::Octree() {
 
 }
 
+Octree::ObjectLocation* Octree::locate(const BoundableEntity* object) {
+    uint32_t slot = object->_spatial_slot();
+    if(slot < objects_.size() && objects_[slot].object == object) {
+        return &objects_[slot];
+    }
+    return nullptr;
+}
+
 OctreeNode& Octree::find(const BoundableEntity* object) {
-    if(!container::contains(object_node_lookup_, object)) {
+    ObjectLocation* location = locate(object);
+    if(!location) {
         throw std::logic_error("Object does not exist in the tree");
     }
 
-    return *container::const_get(object_node_lookup_, object);
+    return node(location->node);
+}
+
+uint32_t Octree::new_node(uint32_t parent, uint8_t position, float strict_diameter, const kmVec3& centre) {
+    if(free_nodes_.empty()) {
+        uint32_t first = node_blocks_.size() * NODES_PER_BLOCK;
+        node_blocks_.push_back(std::unique_ptr<OctreeNode[]>(new OctreeNode[NODES_PER_BLOCK]));
+
+        //Hand out the lowest indices first, so nodes created together sit together
+        free_nodes_.reserve(free_nodes_.size() + NODES_PER_BLOCK);
+        for(uint32_t i = NODES_PER_BLOCK; i > 0; --i) {
+            free_nodes_.push_back(first + i - 1);
+        }
+    }
+
+    uint32_t index = free_nodes_.back();
+    free_nodes_.pop_back();
+
+    OctreeNode& result = node(index);
+    result.tree_ = this;
+    result.parent_ = parent;
+    result.position_ = position;
+    result.rejected_by_ = 0;
+    result.child_mask_ = 0;
+    result.objects_.clear();
+    result.centre_ = centre;
+
+    kmAABB3Initialize(&result.strict_bounds_, &result.centre_, strict_diameter, strict_diameter, strict_diameter);
+    kmAABB3Initialize(&result.loose_bounds_, &result.centre_, strict_diameter * 2, strict_diameter * 2, strict_diameter * 2);
+
+    ++node_count_;
+    return index;
+}
+
+void Octree::delete_node(uint32_t index) {
+    node(index).objects_.clear();
+    free_nodes_.push_back(index);
+    --node_count_;
+}
+
+uint32_t Octree::create_child(uint32_t parent, OctreePosition pos) {
+    OctreeNode& parent_node = node(parent);
+    if(parent_node.has_child(pos)) {
+        return parent_node.children_[pos];
+    }
+
+    kmAABB3 bounds = parent_node.calculate_child_strict_bounds(pos);
+    kmVec3 centre;
+    kmAABB3Centre(&bounds, &centre);
+
+    //Nodes don't move when the pool grows, so parent_node is still good after this
+    uint32_t child = new_node(parent, pos, kmAABB3DiameterX(&bounds), centre);
+
+    parent_node.children_[pos] = child;
+    parent_node.child_mask_ |= (1 << pos);
+
+    return child;
 }
 
 void visible_node_finder(OctreeNode* self, std::vector<OctreeNode*>& result, const Frustum& frustum) {
@@ -44,27 +125,237 @@ std::vector<OctreeNode*> Octree::nodes_visible_from(const Frustum& frustum) {
     return result;
 }
 
+void Octree::objects_visible_from(const Frustum& frustum, RenderableList& out, bool cull_objects) {
+    if(!has_root()) {
+        return;
+    }
+
+    _add_visible_objects(node(root_), frustum, FRUSTUM_ALL_PLANES, out, cull_objects);
+}
+
+void Octree::_add_all_objects(const OctreeNode& current, RenderableList& out) {
+    for(const OctreeNode::Entry& entry: current.objects_) {
+        if(entry.renderable) {
+            out.push_back(entry.renderable);
+        }
+    }
+
+    for(uint8_t i = 0; i < 8; ++i) {
+        if(current.child_mask_ & (1 << i)) {
+            _add_all_objects(node(current.children_[i]), out);
+        }
+    }
+}
+
+void Octree::_add_visible_objects(OctreeNode& current, const Frustum& frustum, uint8_t plane_mask, RenderableList& out, bool cull_objects) {
+    switch(frustum.classify_aabb(current.absolute_loose_bounds(), plane_mask, current.rejected_by_)) {
+        case FRUSTUM_CONTAINS_NONE:
+            return;
+        case FRUSTUM_CONTAINS_ALL:
+            //Everything below is inside too
+            _add_all_objects(current, out);
+            return;
+        default:
+            break;
+    }
+
+    if(cull_objects) {
+        //Objects are within the node's loose bounds, so only the planes it straddles can cut them
+        const uint32_t BATCH_SIZE = 8;
+        kmAABB3 bounds[BATCH_SIZE];
+        FrustumClassification results[BATCH_SIZE];
+        Renderable* renderables[BATCH_SIZE];
+
+        uint32_t batched = 0;
+        for(uint32_t i = 0; i < current.objects_.size(); ++i) {
+            const OctreeNode::Entry& entry = current.objects_[i];
+            if(entry.renderable) {
+                bounds[batched] = entry.object->transformed_aabb();
+                renderables[batched] = entry.renderable;
+                ++batched;
+            }
+
+            if(batched == BATCH_SIZE || (batched && i == current.objects_.size() - 1)) {
+                frustum.classify_aabbs(bounds, batched, results, plane_mask);
+                for(uint32_t j = 0; j < batched; ++j) {
+                    if(results[j] != FRUSTUM_CONTAINS_NONE) {
+                        out.push_back(renderables[j]);
+                    }
+                }
+                batched = 0;
+            }
+        }
+    } else {
+        for(const OctreeNode::Entry& entry: current.objects_) {
+            if(entry.renderable) {
+                out.push_back(entry.renderable);
+            }
+        }
+    }
+
+    for(uint8_t i = 0; i < 8; ++i) {
+        if(current.child_mask_ & (1 << i)) {
+            _add_visible_objects(node(current.children_[i]), frustum, plane_mask, out, cull_objects);
+        }
+    }
+}
+
+void Octree::_place_object(uint32_t node_index, const OctreeNode::Entry& entry) {
+    OctreeNode& target = node(node_index);
+
+    ObjectLocation* location = locate(entry.object);
+    if(!location) {
+        entry.object->_set_spatial_slot(objects_.size());
+        objects_.push_back(ObjectLocation{entry.object, node_index, 0});
+        location = &objects_.back();
+    }
+
+    location->node = node_index;
+    location->position = target.objects_.size();
+    target.objects_.push_back(entry);
+}
+
+OctreeNode::Entry Octree::_take_object(const ObjectLocation& location) {
+    OctreeNode& owner = node(location.node);
+    OctreeNode::Entry entry = owner.objects_[location.position];
+
+    if(location.position < owner.objects_.swap_remove(location.position)) {
+        //Another object was moved into the gap
+        locate(owner.objects_[location.position].object)->position = location.position;
+    }
+
+    return entry;
+}
+
+void Octree::_unregister_object(const BoundableEntity* obj) {
+    uint32_t slot = obj->_spatial_slot();
+
+    if(slot != objects_.size() - 1) {
+        objects_[slot] = objects_.back();
+        objects_[slot].object->_set_spatial_slot(slot);
+    }
+    objects_.pop_back();
+
+    obj->_set_spatial_slot(~0u);
+}
+
+void Octree::collapse(uint32_t index) {
+    //Remove empty leaves, working up towards the root
+    while(index != root_) {
+        OctreeNode& current = node(index);
+        if(current.has_objects() || current.child_mask_) {
+            return;
+        }
+
+        uint32_t parent = current.parent_;
+        node(parent).child_mask_ &= ~(1 << current.position_);
+        delete_node(index);
+        index = parent;
+    }
+
+    //A root with nothing in it but a single child only makes the tree deeper
+    while(has_root()) {
+        OctreeNode& current = node(root_);
+        if(current.has_objects() || current.child_count() > 1) {
+            return;
+        }
+
+        uint32_t old_root = root_;
+        if(current.child_mask_) {
+            uint8_t pos = 0;
+            while(!(current.child_mask_ & (1 << pos))) {
+                ++pos;
+            }
+
+            root_ = current.children_[pos];
+            node(root_).parent_ = OctreeNode::NO_NODE;
+        } else {
+            root_ = OctreeNode::NO_NODE;
+        }
+
+        delete_node(old_root);
+    }
+}
+
 void Octree::shrink(const BoundableEntity* object) {
     assert(object);
 
-    if(!container::contains(this->object_node_lookup_, object)) {
+    ObjectLocation* location = locate(object);
+    if(!location) {
         throw std::logic_error("Tried to remove an object that doesn't exist in the tree");
     }
 
-    OctreeNode& node = *container::const_get(this->object_node_lookup_, object);
-    node.remove_object(object);
+    uint32_t index = location->node;
+    _take_object(*location);
+    _unregister_object(object);
+
+    collapse(index);
+}
 
-    if(!node.has_objects() && !node.child_count()) {
-        L_WARN("FIXME: Node should be deleted but this is not yet implemented");
+void Octree::relocate(const BoundableEntity* object) {
+    assert(object);
+
+    ObjectLocation* location = locate(object);
+    if(!location) {
+        //Objects with no volume aren't added to the tree, but it might have one now
+        grow(object);
+        return;
     }
 
-    _unregister_object(object);
+    OctreeNode& current = node(location->node);
+    AABB obj_bounds = object->transformed_aabb();
+
+    //Still within the loose bounds, so nothing needs to change. This is the common case
+    if(kmAABB3ContainsAABB(&current.absolute_loose_bounds(), &obj_bounds) == KM_CONTAINS_ALL) {
+        return;
+    }
+
+    uint32_t old_index = location->node;
+    OctreeNode::Entry entry = _take_object(*location);
+
+    float obj_diameter = object->diameter();
+    if(obj_diameter < kmEpsilon) {
+        _unregister_object(object);
+        collapse(old_index);
+        return;
+    }
+
+    /*
+     * Walk up to the nearest node which could hold the object (its centre is within the strict
+     * bounds and it's smaller than them, so it must be within the loose bounds) and then back
+     * down as far as it will go. If no node will do, the tree needs to grow.
+     */
+    kmVec3 centre = object->centre();
+
+    uint32_t target = current.parent_;
+    while(target != OctreeNode::NO_NODE) {
+        OctreeNode& candidate = node(target);
+        if(obj_diameter < candidate.strict_diameter() &&
+           kmAABB3ContainsPoint(&candidate.absolute_strict_bounds(), &centre)) {
+            break;
+        }
+        target = candidate.parent_;
+    }
+
+    if(target != OctreeNode::NO_NODE) {
+        insert_into_subtree(target, entry);
+    } else {
+        grow_and_insert(entry);
+    }
+
+    //Not until now, so that any nodes on the way back down weren't torn down and rebuilt
+    collapse(old_index);
 }
 
-void Octree::grow(const BoundableEntity *object) {
+void Octree::grow(const BoundableEntity *object, Renderable* renderable) {
     assert(object);
 
-    AABB obj_bounds = object->transformed_aabb();
+    if(locate(object)) {
+        //Already in the tree, so it can only have moved
+        relocate(object);
+        return;
+    }
+
     float obj_diameter = object->diameter();
 
     if(obj_diameter < kmEpsilon) {
@@ -72,19 +363,22 @@ void Octree::grow(const BoundableEntity *object) {
         return;
     }
 
-    if(!root_) {
+    grow_and_insert(OctreeNode::Entry{object, renderable});
+}
+
+void Octree::grow_and_insert(const OctreeNode::Entry& entry) {
+    const BoundableEntity* object = entry.object;
+    AABB obj_bounds = object->transformed_aabb();
+
+    if(!has_root()) {
         L_DEBUG("Creating root node");
         /*
          *  We don't have a root node yet, so create one centred around
          *  the object with strict bounds that encompass it.
          */
-        float node_size = obj_diameter;
+        float node_size = object->diameter();
 
-        root_.reset(new OctreeNode(
-            nullptr,
-            node_size,
-            object->centre()
-        ));
+        root_ = new_node(OctreeNode::NO_NODE, 0, node_size, object->centre());
 
         L_DEBUG(_u("Root node created with strict width of: {0}").format(node_size));
     }
@@ -110,7 +404,7 @@ void Octree::grow(const BoundableEntity *object) {
         new_centre.y += (obj_centre.y < root().centre().y) ? -half_current : half_current;
         new_centre.z += (obj_centre.z < root().centre().z) ? -half_current : half_current;
 
-        OctreeNode::ptr new_root(new OctreeNode(nullptr, root().strict_diameter() * 2, new_centre));
+        uint32_t new_root = new_node(OctreeNode::NO_NODE, 0, root().strict_diameter() * 2, new_centre);
 
 
         /*
@@ -149,15 +443,19 @@ void Octree::grow(const BoundableEntity *object) {
             }
         }
 
-        OctreeNode::ptr old_root = root_;
+        OctreeNode& old_root = root();
+        old_root.parent_ = new_root;
+        old_root.position_ = root_to_become_child;
+
+        OctreeNode& new_root_node = node(new_root);
+        new_root_node.children_[root_to_become_child] = root_;
+        new_root_node.child_mask_ |= (1 << root_to_become_child);
 
-        new_root->children_[root_to_become_child] = old_root;
-        old_root->parent_ = new_root.get();
         root_ = new_root;
     }
 
     //Now insert into the subtree
-    this->_register_object(&root().insert_into_subtree(object), object);
+    insert_into_subtree(root_, entry);
 }
 
 kmAABB3 OctreeNode::calculate_child_bounds(OctreePosition pos, float child_width) {
@@ -285,20 +583,6 @@ kmAABB3 OctreeNode::calculate_child_bounds(OctreePosition pos, float child_width
     return result;
 }
 
-OctreeNode& OctreeNode::create_child(OctreePosition pos) {
-    if(has_child(pos)) {
-        return child(pos);
-    }
-
-    kmAABB3 bounds = calculate_child_strict_bounds(pos);
-    kmVec3 centre;
-    kmAABB3Centre(&bounds, &centre);
-
-    children_[pos].reset(new OctreeNode(this, kmAABB3DiameterX(&bounds), centre));
-
-    return *children_[pos];
-}
-
 kmAABB3 OctreeNode::calculate_child_loose_bounds(OctreePosition pos) {
     return calculate_child_bounds(pos, this->strict_diameter());
 }
@@ -308,48 +592,41 @@ kmAABB3 OctreeNode::calculate_child_strict_bounds(OctreePosition pos) {
 }
 
 /**
- * @brief OctreeNode::insert_into_subtree
- * @param obj - The object to insert
- * @return The final OctreeNode that the object was inserted into
+ * @brief Octree::insert_into_subtree
+ * @param index - The node to start from
+ * @param entry - The object to insert, and what to return for it from objects_visible_from
  *
- * This method recursively searches down the tree to find the lowest
- * node that can fit the object. If the object doesn't fit inside any
- * nodes then an ObjectDoesNotFitError() is thrown.
+ * This method searches down the tree to find the lowest node that can fit the object,
+ * creating nodes as it goes, and adds the object to it.
  */
-OctreeNode& OctreeNode::insert_into_subtree(const BoundableEntity* obj) {
-    AABB obj_bounds = obj->transformed_aabb();
-    float obj_diameter = obj->diameter();
+void Octree::insert_into_subtree(uint32_t index, const OctreeNode::Entry& entry) {
+    float obj_diameter = entry.object->diameter();
+    kmVec3 centre = entry.object->centre();
 
-    if(obj_diameter < this->strict_diameter() / 2) {
+    while(obj_diameter < node(index).strict_diameter() / 2) {
         //Object will fit into child
-        kmVec3 centre = obj->centre();
+        OctreeNode& current = node(index);
 
-        L_DEBUG("Object will fit into child, traversing next level");
-        for(uint8_t i = 0; i < 8; ++i) {
-            kmAABB3 bounds = calculate_child_strict_bounds((OctreePosition)i);
+        /*
+         * Go by which side of the centre the object is on. Testing against each child's strict
+         * bounds can miss, rounding leaves slivers between them that belong to no child.
+         */
+        const kmVec3& middle = current.centre();
+        bool pos_x = centre.x >= middle.x;
+        bool pos_z = centre.z >= middle.z;
 
-            if(kmAABB3ContainsPoint(&bounds, &centre)) {
-                OctreeNode& child = create_child((OctreePosition) i);
-                return child.insert_into_subtree(obj);
-            }
+        OctreePosition i;
+        if(centre.y >= middle.y) {
+            i = (pos_z) ? ((pos_x) ? POSX_POSY_POSZ : NEGX_POSY_POSZ) : ((pos_x) ? POSX_POSY_NEGZ : NEGX_POSY_NEGZ);
+        } else {
+            i = (pos_z) ? ((pos_x) ? POSX_NEGY_POSZ : NEGX_NEGY_POSZ) : ((pos_x) ? POSX_NEGY_NEGZ : NEGX_NEGY_NEGZ);
         }
 
-        throw std::logic_error("Something went wrong while adding the object to the Octree");
-    } else {
-        L_DEBUG("Destination node for object found");
-
-        //Add to this node
-        this->add_object(obj);
-        return *this;
+        index = create_child(index, i);
     }
-}
-
-OctreeNode::OctreeNode(OctreeNode* parent, float strict_diameter, const kmVec3& centre):
-    parent_(parent),
-    centre_(centre) {
 
-    kmAABB3Initialize(&strict_bounds_, &centre_, strict_diameter, strict_diameter, strict_diameter);
-    kmAABB3Initialize(&loose_bounds_, &centre_, strict_diameter * 2, strict_diameter * 2, strict_diameter * 2);
+    //Add to this node
+    _place_object(index, entry);
 }
 
 }
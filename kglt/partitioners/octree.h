@@ -1,14 +1,13 @@
 #ifndef OCTREE_H
 #define OCTREE_H
 
-#include <set>
-#include <map>
+#include <algorithm>
 #include <stdexcept>
 #include <vector>
 #include <memory>
 #include <kazmath/kazmath.h>
 
-#include "../generic/managed.h"
+#include "../generic/small_vector.h"
 #include "../interfaces.h"
 #include "../types.h"
 
@@ -46,6 +45,7 @@ enum OctreePosition {
 class ChildNodeDoesNotExist :
     public std::logic_error {
 
+public:
     ChildNodeDoesNotExist():
         std::logic_error("Attempted to get a child node that doesn't exist") {}
 };
@@ -68,32 +68,30 @@ public:
 
 class Octree;
 
-class OctreeNode :
-    public Managed<OctreeNode> {
-
+/*
+ * Nodes live in a pool owned by the Octree and refer to each other by index, which child nodes
+ * exist is kept as a bit mask. The pool is allocated in blocks so nodes never move, references
+ * to them stay valid until they're removed from the tree.
+ */
+class OctreeNode {
 public:
-    OctreeNode(OctreeNode* parent, float strict_diameter, const kmVec3 &centre);
+    static const uint32_t NO_NODE = ~0u;
 
     const kmVec3& centre() const {
         return centre_;
     }
 
-    float width() const;
-    float loose_width() const;
-
-    uint8_t child_count() const { return children_.size(); }
-    uint32_t object_count() const;
+    uint8_t child_count() const;
+    uint32_t object_count() const { return objects_.size(); }
 
-    OctreeNode& child(OctreePosition pos) {
-        return *container::const_get(children_, pos);
-    }
+    OctreeNode& child(OctreePosition pos);
 
     bool has_child(OctreePosition pos) const {
-        return container::contains(children_, pos);
+        return (child_mask_ & (1 << pos)) != 0;
     }
     bool has_objects() const { return !objects_.empty(); }
 
-    bool is_root() const { return !parent_; }
+    bool is_root() const { return parent_ == NO_NODE; }
 
     const kmAABB3& absolute_loose_bounds() const { return loose_bounds_; }
     const kmAABB3& absolute_strict_bounds() const { return strict_bounds_; }
@@ -107,27 +105,31 @@ public:
         return kmAABB3DiameterX(&strict_bounds_);
     }
 
-    const std::set<const BoundableEntity*>& objects() const { return objects_; }
-private:
-    OctreeNode* parent_;
-    std::map<OctreePosition, std::shared_ptr<OctreeNode> > children_;
-    std::set<const BoundableEntity*> objects_;
+    //An object in the node, and the renderable it was added with (if any)
+    struct Entry {
+        const BoundableEntity* object;
+        Renderable* renderable;
+    };
 
-    AABB strict_bounds_;
-    AABB loose_bounds_;
-    Vec3 centre_;
+    typedef generic::SmallVector<Entry, 4> EntryList;
 
-    OctreeNode& create_child(OctreePosition pos);
+    const EntryList& objects() const { return objects_; }
 
-    OctreeNode& insert_into_subtree(const BoundableEntity *obj);
+private:
+    OctreeNode() = default;
 
-    void add_object(const BoundableEntity* obj) {
-        objects_.insert(obj);
-    }
+    Octree* tree_ = nullptr;
+    uint32_t parent_ = NO_NODE;
+    uint32_t children_[8];
+    uint8_t child_mask_ = 0;
+    uint8_t position_ = 0; //Which child of the parent this is
+    uint8_t rejected_by_ = 0; //The frustum plane which last found the node out of view
 
-    void remove_object(const BoundableEntity* obj) {
-        objects_.erase(obj);
-    }
+    EntryList objects_;
+
+    AABB strict_bounds_;
+    AABB loose_bounds_;
+    Vec3 centre_;
 
     kmAABB3 calculate_child_loose_bounds(OctreePosition pos);
     kmAABB3 calculate_child_strict_bounds(OctreePosition pos);
@@ -155,24 +157,34 @@ private:
  *   large, and then as child nodes empty shift in the direction of the fleet.
  * * If a node has no objects, and no children, it is removed. If the root node has no objects and only
  *   one child, then the child becomes the new root.
+ * * The tree finds objects through BoundableEntity::_spatial_slot(), so an object can only be in one
+ *   tree at a time.
  */
 
 class Octree {
 public:
     Octree();
 
+    Octree(const Octree&) = delete;
+    Octree& operator=(const Octree&) = delete;
+
     OctreeNode& root() {
-        if(!root_) {
+        if(root_ == OctreeNode::NO_NODE) {
             throw std::logic_error("Octree has not been initialized");
         }
-        return *root_;
+        return node(root_);
     }
 
-    uint32_t node_count() const;
+    uint32_t node_count() const { return node_count_; }
+    uint32_t object_count() const { return objects_.size(); }
 
-    bool has_root() const { return root_ != nullptr; }
+    bool has_root() const { return root_ != OctreeNode::NO_NODE; }
 
-    void grow(const BoundableEntity* object);
+    /*
+     * The renderable is optional, it's what objects_visible_from() hands back for the object so
+     * that the caller doesn't need to map from one to the other
+     */
+    void grow(const BoundableEntity* object, Renderable* renderable=nullptr);
     void shrink(const BoundableEntity* object);
     void relocate(const BoundableEntity* object);
 
@@ -180,22 +192,154 @@ public:
 
     std::vector<OctreeNode*> nodes_visible_from(const Frustum& frustum);
 
+    /*
+     * Appends the renderables of the objects in view to out, in a single walk of the tree.
+     * Nodes entirely within the frustum are taken whole without testing anything below them.
+     * In nodes which straddle the edge, each object's own bounds are tested if cull_objects is
+     * set, otherwise everything in them is taken. Below a node only the planes it straddles
+     * are tested, and each node remembers which plane last rejected it to try that one first.
+     */
+    void objects_visible_from(const Frustum& frustum, RenderableList& out, bool cull_objects=true);
+
+    /*
+     * Calls callback(object, renderable) for every object in the nodes the ray passes through
+     * within max_distance. max_distance is read as the walk goes, so the callback can shorten it
+     * (e.g. to the nearest hit so far) to skip the nodes further away.
+     */
+    template<typename Callback>
+    void visit_along_ray(const Ray& ray, const float& max_distance, const Callback& callback) const {
+        walk(
+            [&ray](const AABB& bounds, float& distance) { return ray.intersects(bounds, distance); },
+            max_distance, callback
+        );
+    }
+
+    /*
+     * Calls callback(object, renderable) for every object in the nodes within
+     * sqrt(max_distance_sq) of point, the callback can shrink the limit as it goes.
+     */
+    template<typename Callback>
+    void visit_near(const kmVec3& point, const float& max_distance_sq, const Callback& callback) const {
+        walk(
+            [&point](const AABB& bounds, float& distance) {
+                distance = bounds.distance_squared(point);
+                return true;
+            },
+            max_distance_sq, callback
+        );
+    }
+
+    /* Calls callback(object, renderable) for every object in the nodes overlapping box */
+    template<typename Callback>
+    void visit_overlapping(const AABB& box, const Callback& callback) const {
+        float limit = 0.0f;
+        walk(
+            [&box](const AABB& bounds, float& distance) {
+                distance = 0.0f;
+                return bool(kmAABB3IntersectsAABB(&bounds, &box));
+            },
+            limit, callback
+        );
+    }
+
 private:
-    OctreeNode::ptr root_;
-    uint32_t node_count_;
+    static const uint32_t NODES_PER_BLOCK = 256;
 
-    void _increment_node_count();
-    void _decrement_node_count();
+    //Where each object is, the object's spatial slot is its index in objects_
+    struct ObjectLocation {
+        const BoundableEntity* object;
+        uint32_t node;
+        uint32_t position; //Index in the node's objects
+    };
+
+    std::vector<std::unique_ptr<OctreeNode[]>> node_blocks_;
+    std::vector<uint32_t> free_nodes_;
+    std::vector<ObjectLocation> objects_;
+
+    uint32_t root_ = OctreeNode::NO_NODE;
+    uint32_t node_count_ = 0;
+
+    OctreeNode& node(uint32_t index) {
+        return node_blocks_[index / NODES_PER_BLOCK][index % NODES_PER_BLOCK];
+    }
 
-    void _register_object(OctreeNode* node, const BoundableEntity* obj) {
-        object_node_lookup_[obj] = node;
+    const OctreeNode& node(uint32_t index) const {
+        return node_blocks_[index / NODES_PER_BLOCK][index % NODES_PER_BLOCK];
     }
 
-    void _unregister_object(const BoundableEntity* obj) {
-        object_node_lookup_.erase(obj);
+    //A node waiting to be looked at, and how far away it was when it was found
+    struct Pending {
+        uint32_t node;
+        float distance;
+    };
+
+    /*
+     * Goes through the nodes whose loose bounds measure() accepts at a distance no greater than
+     * limit, calling callback for the objects in each
+     */
+    template<typename Measure, typename Callback>
+    void walk(const Measure& measure, const float& limit, const Callback& callback) const {
+        if(!has_root()) {
+            return;
+        }
+
+        generic::SmallVector<Pending, 64> stack;
+
+        Pending root = {root_, 0.0f};
+        if(!measure(node(root_).loose_bounds_, root.distance)) {
+            return;
+        }
+        stack.push_back(root);
+
+        while(!stack.empty()) {
+            Pending next = stack.back();
+            stack.pop_back();
+
+            //The limit may have come down since this was pushed
+            if(next.distance > limit) {
+                continue;
+            }
+
+            const OctreeNode& current = node(next.node);
+            for(const OctreeNode::Entry& entry: current.objects_) {
+                callback(entry.object, entry.renderable);
+            }
+
+            //Push the children furthest first, so the nearest are looked at next
+            uint32_t first = stack.size();
+            for(uint8_t i = 0; i < 8; ++i) {
+                if(!(current.child_mask_ & (1 << i))) {
+                    continue;
+                }
+
+                Pending child = {current.children_[i], 0.0f};
+                if(measure(node(child.node).loose_bounds_, child.distance) && child.distance <= limit) {
+                    stack.push_back(child);
+                }
+            }
+
+            std::sort(stack.begin() + first, stack.end(), [](const Pending& lhs, const Pending& rhs) {
+                return lhs.distance > rhs.distance;
+            });
+        }
     }
 
-    std::map<const BoundableEntity*, OctreeNode*> object_node_lookup_;
+    uint32_t new_node(uint32_t parent, uint8_t position, float strict_diameter, const kmVec3& centre);
+    void delete_node(uint32_t index);
+    uint32_t create_child(uint32_t parent, OctreePosition pos);
+
+    ObjectLocation* locate(const BoundableEntity* object);
+
+    void grow_and_insert(const OctreeNode::Entry& entry);
+    void insert_into_subtree(uint32_t index, const OctreeNode::Entry& entry);
+    void collapse(uint32_t index);
+
+    void _place_object(uint32_t node_index, const OctreeNode::Entry& entry);
+    OctreeNode::Entry _take_object(const ObjectLocation& location);
+    void _unregister_object(const BoundableEntity* obj);
+
+    void _add_all_objects(const OctreeNode& node, RenderableList& out);
+    void _add_visible_objects(OctreeNode& node, const Frustum& frustum, uint8_t plane_mask, RenderableList& out, bool cull_objects);
 
     friend class OctreeNode;
 };
@@ -1,10 +1,8 @@
 #include "octree_partitioner.h"
 
 #include "../stage.h"
-#include "../light.h"
-#include "../actor.h"
 #include "../camera.h"
-#include "../particles.h"
+#include "../batcher.h"
 
 /*
  * TODO:
@@ -15,105 +13,31 @@
 
 namespace kglt {
 
-void OctreePartitioner::event_actor_changed(ActorID ent) {
-    L_DEBUG("Actor changed, updating partitioner");
-    remove_actor(ent);
-    add_actor(ent);
-}
-
-void OctreePartitioner::add_particle_system(ParticleSystemID ps) {
-    auto system = stage()->particle_system(ps); //Get a handle on the particle system
-
-    BoundableEntity* ent = system.__object.get(); //Get the raw pointer as a BoundableEntity (bad?)
-    tree_.grow(ent);
-}
-
-void OctreePartitioner::remove_particle_system(ParticleSystemID ps) {
-    auto system = stage()->particle_system(ps);
-    BoundableEntity* ent = system.__object.get(); //Get the raw pointer as a BoundableEntity (bad?)
-    tree_.shrink(ent);
-}
-
-void OctreePartitioner::add_actor(ActorID obj) {
-    L_DEBUG("Adding actor to the partitioner");
-
-    auto ent = stage()->actor(obj);
-    for(uint16_t i = 0; i < ent->subactor_count(); ++i) {
-        //All subactors are boundable
-        BoundableEntity* boundable = &ent->subactor(i);
-        tree_.grow(boundable);
-
-        actor_to_registered_subactors_[obj].push_back(boundable);
-        boundable_to_renderable_[boundable] = ent->_subactors().at(i);
+void OctreePartitioner::geometry_visible_from(FrameResources& resources, CameraID camera_id, RenderableList& out) {
+    //If the tree has no root then there's nothing to add
+    if(!tree_.has_root()) {
+        return;
     }
 
-    //Connect the changed signal
-    actor_changed_connections_[obj] = ent->signal_mesh_changed().connect(std::bind(&OctreePartitioner::event_actor_changed, this, std::placeholders::_1));
+    //Lights aren't given a renderable in the tree, so they're left out
+    tree_.objects_visible_from(resources.camera(camera_id)->frustum(), out);
 }
 
-void OctreePartitioner::remove_actor(ActorID obj) {
-    L_DEBUG("Removing actor from the partitioner");
-
-    //Remove all boundable subactors that were linked to the actor
-    for(BoundableEntity* boundable: actor_to_registered_subactors_[obj]) {
-        tree_.shrink(boundable);
-        boundable_to_renderable_.erase(boundable);
-    }
-
-    //Erase the list of subactors linked to this actor
-    actor_to_registered_subactors_.erase(obj);
-
-    //Disconnect the changed signal
-    actor_changed_connections_[obj].disconnect();
-    actor_changed_connections_.erase(obj);
-}
+void OctreePartitioner::lights_visible_from(FrameResources& resources, CameraID camera_id, LightList& out) {
 
-void OctreePartitioner::add_light(LightID obj) {
-    //FIXME: THis is nasty and dangerous
-    auto light = stage()->light(obj);
-    BoundableEntity* boundable = light.__object.get();
-    assert(boundable);
-    tree_.grow(boundable);
-    boundable_to_light_[boundable] = obj;
 }
 
-void OctreePartitioner::remove_light(LightID obj) {
-    auto light = stage()->light(obj);
-    BoundableEntity* boundable = light.__object.get();
-    assert(boundable);
-    tree_.shrink(boundable);
-    boundable_to_light_.erase(boundable);
+//Lights are in the tree without a renderable, so these skip them
+void OctreePartitioner::visit_geometry_along_ray(const Ray& ray, const float& max_distance, const GeometryCallback& callback) {
+    tree_.visit_along_ray(ray, max_distance, forward_renderables(callback));
 }
 
-std::vector<RenderablePtr> OctreePartitioner::geometry_visible_from(CameraID camera_id) {
-    std::vector<RenderablePtr> results;
-
-    //If the tree has no root then we return nothing
-    if(!tree_.has_root()) {
-        return results;
-    }
-
-    /**
-     *  FIXME: A tree_->objects_visible_from(cam.frustum()); would be faster
-     */
-
-    //Go through the visible nodes
-    for(OctreeNode* node: tree_.nodes_visible_from(stage()->window().camera(camera_id)->frustum())) {
-        //Go through the objects
-        for(const BoundableEntity* obj: node->objects()) {
-            if(container::contains(boundable_to_renderable_, obj)) {
-                //Build a list of visible subactors
-                results.push_back(boundable_to_renderable_[obj]);
-            }
-        }
-    }
-
-    return results;
+void OctreePartitioner::visit_geometry_near(const Vec3& point, const float& max_distance_sq, const GeometryCallback& callback) {
+    tree_.visit_near(point, max_distance_sq, forward_renderables(callback));
 }
 
-std::vector<LightID> OctreePartitioner::lights_visible_from(CameraID camera_id) {
-    std::vector<LightID> lights;
-    return lights;
+void OctreePartitioner::visit_geometry_overlapping(const AABB& box, const GeometryCallback& callback) {
+    tree_.visit_overlapping(box, forward_renderables(callback));
 }
 
 }
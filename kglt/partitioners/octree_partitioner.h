@@ -1,45 +1,41 @@
 #ifndef OCTREE_PARTITIONER_H
 #define OCTREE_PARTITIONER_H
 
-#include "../partitioner.h"
+#include "spatial_partitioner.h"
 #include "octree.h"
 
-#include <kazbase/signals.h>
-
 namespace kglt {
 
-class Renderable;
-
-typedef std::shared_ptr<Renderable> RenderablePtr;
-
 class OctreePartitioner :
-    public Partitioner {
+    public SpatialPartitioner {
 
 public:
     OctreePartitioner(Stage& ss):
-        Partitioner(ss) {}
+        SpatialPartitioner(ss) {}
 
-    void add_actor(ActorID obj);
-    void remove_actor(ActorID obj);
+    void lights_visible_from(FrameResources& resources, CameraID camera_id, LightList& out);
+    void geometry_visible_from(FrameResources& resources, CameraID camera_id, RenderableList& out);
 
-    void add_light(LightID obj);
-    void remove_light(LightID obj);
+protected:
+    void insert_geometry(const BoundableEntity* boundable, Renderable* renderable) { tree_.grow(boundable, renderable); }
+    void update_geometry(const BoundableEntity* boundable) { tree_.relocate(boundable); }
+    void remove_geometry(const BoundableEntity* boundable) { tree_.shrink(boundable); }
 
-    void add_particle_system(ParticleSystemID ps);
-    void remove_particle_system(ParticleSystemID ps);
+    //Lights go in the same tree, without a renderable
+    void insert_light_bounds(const BoundableEntity* boundable) { tree_.grow(boundable); }
+    void update_light_bounds(const BoundableEntity* boundable) { tree_.relocate(boundable); }
+    void remove_light_bounds(const BoundableEntity* boundable) { tree_.shrink(boundable); }
 
-    std::vector<LightID> lights_visible_from(CameraID camera_id);
-    std::vector<RenderablePtr> geometry_visible_from(CameraID camera_id);
+    void visit_geometry_along_ray(const Ray& ray, const float& max_distance, const GeometryCallback& callback);
+    void visit_geometry_near(const Vec3& point, const float& max_distance_sq, const GeometryCallback& callback);
+    void visit_geometry_overlapping(const AABB& box, const GeometryCallback& callback);
 
-    void event_actor_changed(ActorID ent);
 private:
+    /*
+     * Relocation is cheap for things which are still inside the loose bounds of their node
+     * (which is most of them, most of the time) and only walks the tree for the rest.
+     */
     Octree tree_;
-
-    std::map<ActorID, std::vector<BoundableEntity*> > actor_to_registered_subactors_;
-
-    std::map<ActorID, sig::connection> actor_changed_connections_;
-    std::map<const BoundableEntity*, RenderablePtr> boundable_to_renderable_;
-    std::map<const BoundableEntity*, LightID> boundable_to_light_;
 };
 
 
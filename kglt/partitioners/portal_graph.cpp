@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "portal_graph.h"
+#include "../frustum.h"
+
+namespace kglt {
+
+namespace {
+
+const float EPSILON = 0.001f;
+
+float distance_to(const kmPlane& plane, const Vec3& point) {
+    return plane.a * point.x + plane.b * point.y + plane.c * point.z + plane.d;
+}
+
+bool normalize(kmPlane& plane) {
+    float length = std::sqrt(plane.a * plane.a + plane.b * plane.b + plane.c * plane.c);
+    if(length < 0.000001f) {
+        return false;
+    }
+
+    plane.a /= length;
+    plane.b /= length;
+    plane.c /= length;
+    plane.d /= length;
+    return true;
+}
+
+//The plane through the eye and an edge, facing inwards. False if the eye is in line with the edge
+bool plane_through(const Vec3& eye, const Vec3& a, const Vec3& b, const Vec3& inside, kmPlane& out) {
+    Vec3 u = a - eye;
+    Vec3 v = b - eye;
+
+    out.a = u.y * v.z - u.z * v.y;
+    out.b = u.z * v.x - u.x * v.z;
+    out.c = u.x * v.y - u.y * v.x;
+    out.d = -(out.a * eye.x + out.b * eye.y + out.c * eye.z);
+
+    if(!normalize(out)) {
+        return false;
+    }
+
+    if(distance_to(out, inside) < 0) {
+        out.a = -out.a;
+        out.b = -out.b;
+        out.c = -out.c;
+        out.d = -out.d;
+    }
+    return true;
+}
+
+//Sutherland-Hodgman, keeps the part of the polygon in front of the plane
+void clip(const std::vector<Vec3>& polygon, const kmPlane& plane, std::vector<Vec3>& out) {
+    out.clear();
+
+    for(uint32_t i = 0; i < polygon.size(); ++i) {
+        const Vec3& current = polygon[i];
+        const Vec3& next = polygon[(i + 1) % polygon.size()];
+
+        float d1 = distance_to(plane, current);
+        float d2 = distance_to(plane, next);
+
+        if(d1 >= 0) {
+            out.push_back(current);
+        }
+
+        if((d1 >= 0) != (d2 >= 0)) {
+            float t = d1 / (d1 - d2);
+            out.push_back(current + (next - current) * t);
+        }
+    }
+}
+
+}
+
+uint32_t PortalGraph::new_zone(const AABB& bounds) {
+    std::vector<kmPlane> planes = {
+        { 1, 0, 0, -bounds.min.x },
+        { -1, 0, 0, bounds.max.x },
+        { 0, 1, 0, -bounds.min.y },
+        { 0, -1, 0, bounds.max.y },
+        { 0, 0, 1, -bounds.min.z },
+        { 0, 0, -1, bounds.max.z }
+    };
+
+    return new_zone(planes);
+}
+
+uint32_t PortalGraph::new_zone(const std::vector<kmPlane>& planes) {
+    Zone zone;
+    for(kmPlane plane: planes) {
+        if(!normalize(plane)) {
+            throw std::logic_error("A zone's plane has no normal");
+        }
+        zone.planes.push_back(plane);
+    }
+
+    zones_.push_back(zone);
+    return zones_.size() - 1;
+}
+
+uint32_t PortalGraph::new_portal(uint32_t zone_a, uint32_t zone_b, const std::vector<Vec3>& polygon) {
+    if(zone_a >= zones_.size() || zone_b >= zones_.size() || zone_a == zone_b) {
+        throw std::logic_error("A portal must join two different zones");
+    }
+
+    if(polygon.size() < 3) {
+        throw std::logic_error("A portal needs at least three points");
+    }
+
+    Portal portal;
+    portal.zones[0] = zone_a;
+    portal.zones[1] = zone_b;
+    portal.polygon = polygon;
+
+    //Newell's method, which copes with the first few points being in line
+    Vec3 normal(0, 0, 0);
+    Vec3 centre(0, 0, 0);
+    for(uint32_t i = 0; i < polygon.size(); ++i) {
+        const Vec3& current = polygon[i];
+        const Vec3& next = polygon[(i + 1) % polygon.size()];
+
+        normal.x += (current.y - next.y) * (current.z + next.z);
+        normal.y += (current.z - next.z) * (current.x + next.x);
+        normal.z += (current.x - next.x) * (current.y + next.y);
+        centre = centre + current;
+    }
+    centre = centre * (1.0f / polygon.size());
+
+    portal.plane.a = normal.x;
+    portal.plane.b = normal.y;
+    portal.plane.c = normal.z;
+    portal.plane.d = -(normal.x * centre.x + normal.y * centre.y + normal.z * centre.z);
+
+    if(!normalize(portal.plane)) {
+        throw std::logic_error("A portal's polygon has no area");
+    }
+
+    portals_.push_back(portal);
+
+    uint32_t index = portals_.size() - 1;
+    zones_[zone_a].portals.push_back(index);
+    zones_[zone_b].portals.push_back(index);
+    return index;
+}
+
+int32_t PortalGraph::zone_at(const Vec3& point) const {
+    for(uint32_t i = 0; i < zones_.size(); ++i) {
+        bool inside = true;
+        for(const kmPlane& plane: zones_[i].planes) {
+            if(distance_to(plane, point) < -EPSILON) {
+                inside = false;
+                break;
+            }
+        }
+
+        if(inside) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+void PortalGraph::zones_overlapping(const AABB& box, std::vector<uint32_t>& out) const {
+    for(uint32_t i = 0; i < zones_.size(); ++i) {
+        /*
+         * Only the corner furthest along each plane's normal matters. This can let through boxes
+         * near the corners of zones which aren't box shaped, which only costs a little culling.
+         */
+        bool overlaps = true;
+        for(const kmPlane& plane: zones_[i].planes) {
+            Vec3 furthest(
+                (plane.a >= 0) ? box.max.x : box.min.x,
+                (plane.b >= 0) ? box.max.y : box.min.y,
+                (plane.c >= 0) ? box.max.z : box.min.z
+            );
+
+            if(distance_to(plane, furthest) < -EPSILON) {
+                overlaps = false;
+                break;
+            }
+        }
+
+        if(overlaps) {
+            out.push_back(i);
+        }
+    }
+}
+
+void PortalGraph::visible_zones(const Vec3& eye, const Frustum& frustum, std::vector<uint8_t>& out) const {
+    int32_t start = zone_at(eye);
+    if(start < 0) {
+        out.assign(zones_.size(), 1);
+        return;
+    }
+
+    out.assign(zones_.size(), 0);
+
+    /*
+     * The near plane is left out: a doorway the camera is stood in is closer than it, but is still
+     * seen through. The sides all meet at the eye, so the narrowed frustums can be built the same way.
+     */
+    std::vector<kmPlane> planes = {
+        frustum.plane(FRUSTUM_PLANE_LEFT),
+        frustum.plane(FRUSTUM_PLANE_RIGHT),
+        frustum.plane(FRUSTUM_PLANE_BOTTOM),
+        frustum.plane(FRUSTUM_PLANE_TOP)
+    };
+
+    kmPlane far = frustum.plane(FRUSTUM_PLANE_FAR);
+    normalize(far);
+
+    std::vector<uint32_t> path = { uint32_t(start) };
+    visit(start, eye, planes, far, path, out);
+}
+
+void PortalGraph::visit(uint32_t zone, const Vec3& eye, const std::vector<kmPlane>& planes, const kmPlane& far,
+                        std::vector<uint32_t>& path, std::vector<uint8_t>& out) const {
+
+    out[zone] = 1;
+
+    if(path.size() > MAX_PORTAL_DEPTH) {
+        return;
+    }
+
+    std::vector<Vec3> clipped, scratch;
+    for(uint32_t index: zones_[zone].portals) {
+        const Portal& portal = portals_[index];
+        uint32_t next = (portal.zones[0] == zone) ? portal.zones[1] : portal.zones[0];
+
+        //Going back into a zone on the way here can't show anything new
+        if(std::find(path.begin(), path.end(), next) != path.end()) {
+            continue;
+        }
+
+        if(std::fabs(distance_to(portal.plane, eye)) < EPSILON) {
+            //Stood in the portal, which is edge on, so it can't narrow (or be clipped by) the view
+            path.push_back(next);
+            visit(next, eye, planes, far, path, out);
+            path.pop_back();
+            continue;
+        }
+
+        clipped = portal.polygon;
+        for(const kmPlane& plane: planes) {
+            clip(clipped, plane, scratch);
+            std::swap(clipped, scratch);
+        }
+        clip(clipped, far, scratch);
+        std::swap(clipped, scratch);
+
+        if(clipped.size() < 3) {
+            continue;
+        }
+
+        Vec3 centre(0, 0, 0);
+        for(const Vec3& point: clipped) {
+            centre = centre + point;
+        }
+        centre = centre * (1.0f / clipped.size());
+
+        std::vector<kmPlane> narrowed;
+        for(uint32_t i = 0; i < clipped.size(); ++i) {
+            kmPlane plane;
+            if(plane_through(eye, clipped[i], clipped[(i + 1) % clipped.size()], centre, plane)) {
+                narrowed.push_back(plane);
+            }
+        }
+
+        path.push_back(next);
+        visit(next, eye, narrowed, far, path, out);
+        path.pop_back();
+    }
+}
+
+}
@@ -0,0 +1,73 @@
+#ifndef PORTAL_GRAPH_H
+#define PORTAL_GRAPH_H
+
+#include <cstdint>
+#include <vector>
+#include <kazmath/kazmath.h>
+
+#include "../generic/managed.h"
+#include "../types.h"
+
+namespace kglt {
+
+class Frustum;
+
+/*
+ * Hand authored zones (rooms, corridors) joined by portals (doorways, windows). Each zone is a
+ * convex volume, the space in front of all of its planes. Each portal is a convex polygon which
+ * can be seen through in both directions.
+ *
+ * Starting in the zone the eye is in, each portal in view narrows the frustum to the part of it
+ * that passes through the portal, and zones are only visible if one of those narrowed frustums
+ * reaches them. Everything is in world space.
+ */
+class PortalGraph:
+    public Managed<PortalGraph> {
+
+public:
+    //Stops portals which can see each other (e.g. facing mirrors of rooms) going on forever
+    static const uint32_t MAX_PORTAL_DEPTH = 32;
+
+    uint32_t new_zone(const AABB& bounds);
+    uint32_t new_zone(const std::vector<kmPlane>& planes);
+
+    /* Joins two zones, the polygon's points should be in order around its edge */
+    uint32_t new_portal(uint32_t zone_a, uint32_t zone_b, const std::vector<Vec3>& polygon);
+
+    uint32_t zone_count() const { return zones_.size(); }
+    uint32_t portal_count() const { return portals_.size(); }
+
+    /* The first zone containing point, -1 if it's in none of them */
+    int32_t zone_at(const Vec3& point) const;
+
+    /* Appends the zones the box reaches into, in order */
+    void zones_overlapping(const AABB& box, std::vector<uint32_t>& out) const;
+
+    /*
+     * Fills out with a flag per zone, set for those seen through the frustum from eye. If the eye
+     * isn't in any zone the portals can't narrow anything, so every zone is flagged.
+     */
+    void visible_zones(const Vec3& eye, const Frustum& frustum, std::vector<uint8_t>& out) const;
+
+private:
+    struct Zone {
+        std::vector<kmPlane> planes;
+        std::vector<uint32_t> portals;
+    };
+
+    struct Portal {
+        uint32_t zones[2];
+        std::vector<Vec3> polygon;
+        kmPlane plane;
+    };
+
+    std::vector<Zone> zones_;
+    std::vector<Portal> portals_;
+
+    void visit(uint32_t zone, const Vec3& eye, const std::vector<kmPlane>& planes, const kmPlane& far,
+               std::vector<uint32_t>& path, std::vector<uint8_t>& out) const;
+};
+
+}
+
+#endif // PORTAL_GRAPH_H
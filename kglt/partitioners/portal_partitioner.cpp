@@ -0,0 +1,178 @@
+#include <algorithm>
+
+#include "portal_partitioner.h"
+
+#include "../stage.h"
+#include "../light.h"
+#include "../actor.h"
+#include "../camera.h"
+#include "../batcher.h"
+#include "../mesh.h"
+#include "../particles.h"
+
+namespace kglt {
+
+void PortalPartitioner::add_actor(ActorID obj) {
+    auto ent = stage()->actor(obj);
+
+    MeshID mesh_id = ent->mesh_id();
+    if(mesh_id) {
+        auto mesh = stage()->mesh(mesh_id);
+        if(mesh->exists("PORTAL_GRAPH")) {
+            if(graph_) {
+                L_WARN("A second portal graph was added to the partitioner, it replaces the first");
+            }
+
+            graph_ = mesh->get<PortalGraph::ptr>("PORTAL_GRAPH");
+            graph_actor_ = obj;
+            visible_.clear();
+            place_everything();
+        }
+    }
+
+    SpatialPartitioner::add_actor(obj);
+}
+
+void PortalPartitioner::remove_actor(ActorID obj) {
+    SpatialPartitioner::remove_actor(obj);
+
+    if(graph_ && obj == graph_actor_) {
+        //Without the graph there's nothing to cull by, so everything is visible again
+        graph_.reset();
+        graph_actor_ = ActorID();
+        zones_.clear();
+        visible_.clear();
+    }
+}
+
+void PortalPartitioner::insert_geometry(const BoundableEntity* boundable, Renderable* renderable) {
+    geometry_.insert(boundable, renderable);
+    place(boundable);
+}
+
+void PortalPartitioner::update_geometry(const BoundableEntity* boundable) {
+    geometry_.update(boundable);
+    place(boundable);
+}
+
+void PortalPartitioner::remove_geometry(const BoundableEntity* boundable) {
+    geometry_.remove(boundable);
+    zones_.erase(boundable);
+}
+
+void PortalPartitioner::insert_light_bounds(const BoundableEntity* boundable) {
+    lights_.insert(boundable);
+    place(boundable);
+}
+
+void PortalPartitioner::update_light_bounds(const BoundableEntity* boundable) {
+    lights_.update(boundable);
+    place(boundable);
+}
+
+void PortalPartitioner::remove_light_bounds(const BoundableEntity* boundable) {
+    lights_.remove(boundable);
+    zones_.erase(boundable);
+}
+
+void PortalPartitioner::place(const BoundableEntity* boundable) {
+    if(!graph_) {
+        return;
+    }
+
+    std::vector<uint32_t>& zones = zones_[boundable];
+    zones.clear();
+    graph_->zones_overlapping(boundable->transformed_aabb(), zones);
+}
+
+void PortalPartitioner::place_everything() {
+    each_registered(std::bind(&PortalPartitioner::place, this, std::placeholders::_1));
+}
+
+namespace {
+
+bool same_matrix(const Mat4& lhs, const Mat4& rhs) {
+    return std::equal(lhs.mat, lhs.mat + 16, rhs.mat);
+}
+
+}
+
+const std::vector<uint8_t>& PortalPartitioner::find_visible_zones(CameraID camera_id, Camera& camera) {
+    static const std::vector<uint8_t> NO_ZONES;
+
+    if(!graph_) {
+        return NO_ZONES;
+    }
+
+    const Mat4& transform = camera.transform();
+    const Mat4& projection = camera.projection_matrix();
+
+    auto it = visible_.find(camera_id);
+    if(it != visible_.end() && same_matrix(it->second.transform, transform) && same_matrix(it->second.projection, projection)) {
+        return it->second.visible;
+    }
+
+    VisibleZones& zones = visible_[camera_id];
+    zones.transform = transform;
+    zones.projection = projection;
+
+    Vec3 eye(transform.mat[12], transform.mat[13], transform.mat[14]);
+    graph_->visible_zones(eye, camera.frustum(), zones.visible);
+
+    return zones.visible;
+}
+
+bool PortalPartitioner::potentially_visible(const BoundableEntity* boundable, const std::vector<uint8_t>& visible) const {
+    if(!graph_) {
+        return true;
+    }
+
+    auto it = zones_.find(boundable);
+    if(it == zones_.end() || it->second.empty()) {
+        return true;
+    }
+
+    for(uint32_t zone: it->second) {
+        if(zone < visible.size() && visible[zone]) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void PortalPartitioner::geometry_visible_from(FrameResources& resources, CameraID camera_id, RenderableList& out) {
+    Camera* camera = resources.camera(camera_id);
+    const std::vector<uint8_t>& visible = find_visible_zones(camera_id, *camera);
+
+    geometry_.visit_visible(camera->frustum(), [this, &visible, &out](const BoundableEntity* boundable, Renderable* renderable) {
+        if(renderable && potentially_visible(boundable, visible)) {
+            out.push_back(renderable);
+        }
+    });
+}
+
+void PortalPartitioner::lights_visible_from(FrameResources& resources, CameraID camera_id, LightList& out) {
+    Camera* camera = resources.camera(camera_id);
+    const std::vector<uint8_t>& visible = find_visible_zones(camera_id, *camera);
+
+    lights_.visit_visible(camera->frustum(), [this, &visible, &out](const BoundableEntity* boundable, Renderable*) {
+        if(potentially_visible(boundable, visible)) {
+            out.push_back(light_for(boundable));
+        }
+    });
+}
+
+void PortalPartitioner::visit_geometry_along_ray(const Ray& ray, const float& max_distance, const GeometryCallback& callback) {
+    geometry_.visit_along_ray(ray, max_distance, forward_renderables(callback));
+}
+
+void PortalPartitioner::visit_geometry_near(const Vec3& point, const float& max_distance_sq, const GeometryCallback& callback) {
+    geometry_.visit_near(point, max_distance_sq, forward_renderables(callback));
+}
+
+void PortalPartitioner::visit_geometry_overlapping(const AABB& box, const GeometryCallback& callback) {
+    geometry_.visit_overlapping(box, forward_renderables(callback));
+}
+
+}
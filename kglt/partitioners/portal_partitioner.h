@@ -0,0 +1,88 @@
+#ifndef PORTAL_PARTITIONER_H
+#define PORTAL_PARTITIONER_H
+
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "spatial_partitioner.h"
+#include "aabb_tree.h"
+#include "portal_graph.h"
+
+namespace kglt {
+
+/*
+ * For indoor scenes split by hand into zones and portals. When an actor is added whose mesh has
+ * a PortalGraph stashed on it as "PORTAL_GRAPH", that graph is used: only zones which can be seen
+ * through the portals from the camera are visible, and only actors, particle systems and lights
+ * in those zones are returned, after frustum culling. Anything outside every zone is only frustum
+ * culled. Until there's a graph it behaves as the BVHPartitioner does, which it's built the same
+ * way as.
+ *
+ * The graph is in world space, it doesn't move with the actor which brought it. Portals narrow
+ * the view towards the eye, so cameras should use a perspective projection.
+ */
+class PortalPartitioner :
+    public SpatialPartitioner {
+
+public:
+    PortalPartitioner(Stage& ss):
+        SpatialPartitioner(ss) {}
+
+    void add_actor(ActorID obj);
+    void remove_actor(ActorID obj);
+
+    void lights_visible_from(FrameResources& resources, CameraID camera_id, LightList& out);
+    void geometry_visible_from(FrameResources& resources, CameraID camera_id, RenderableList& out);
+
+    bool has_graph() const { return bool(graph_); }
+
+protected:
+    void insert_geometry(const BoundableEntity* boundable, Renderable* renderable);
+    void update_geometry(const BoundableEntity* boundable);
+    void remove_geometry(const BoundableEntity* boundable);
+
+    void insert_light_bounds(const BoundableEntity* boundable);
+    void update_light_bounds(const BoundableEntity* boundable);
+    void remove_light_bounds(const BoundableEntity* boundable);
+
+    void visit_geometry_along_ray(const Ray& ray, const float& max_distance, const GeometryCallback& callback);
+    void visit_geometry_near(const Vec3& point, const float& max_distance_sq, const GeometryCallback& callback);
+    void visit_geometry_overlapping(const AABB& box, const GeometryCallback& callback);
+
+private:
+    AABBTree geometry_;
+    AABBTree lights_;
+
+    PortalGraph::ptr graph_;
+    ActorID graph_actor_;
+
+    /*
+     * The zones each object is in. Objects which aren't in any (or all of them, before there's a
+     * graph) are never hidden by the portals, only by the frustum.
+     */
+    std::unordered_map<const BoundableEntity*, std::vector<uint32_t> > zones_;
+
+    /*
+     * A flag per zone for each camera, set if the camera can see it. The walk through the portals
+     * is shared by the geometry and light queries and only redone when the camera moves or changes
+     * projection, or the graph changes. Entries are kept between frames so that a camera which
+     * does move reuses its flags rather than allocating new ones.
+     */
+    struct VisibleZones {
+        Mat4 transform;
+        Mat4 projection;
+        std::vector<uint8_t> visible;
+    };
+
+    std::map<CameraID, VisibleZones> visible_;
+
+    void place(const BoundableEntity* boundable);
+    void place_everything();
+    const std::vector<uint8_t>& find_visible_zones(CameraID camera_id, Camera& camera);
+    bool potentially_visible(const BoundableEntity* boundable, const std::vector<uint8_t>& visible) const;
+};
+
+}
+
+#endif // PORTAL_PARTITIONER_H
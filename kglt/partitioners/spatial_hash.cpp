@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "spatial_hash.h"
+
+namespace kglt {
+
+constexpr float SpatialHash::DEFAULT_CELL_SIZE;
+
+SpatialHash::SpatialHash(float cell_size):
+    cell_size_(cell_size) {
+
+    if(cell_size <= 0.0f) {
+        throw std::logic_error("The cell size of a SpatialHash must be greater than zero");
+    }
+}
+
+int32_t SpatialHash::cell_coordinate(float value) const {
+    //Keep well clear of the ends of the range so that nothing overflows, this also catches infinity
+    const float limit = 1 << 30;
+
+    float cell = std::floor(value / cell_size_);
+    return int32_t(std::max(-limit, std::min(limit, cell)));
+}
+
+SpatialHash::CellRange SpatialHash::cell_range(const AABB& bounds) const {
+    CellRange range;
+    range.min_x = cell_coordinate(bounds.min.x);
+    range.min_y = cell_coordinate(bounds.min.y);
+    range.max_x = cell_coordinate(bounds.max.x);
+    range.max_y = cell_coordinate(bounds.max.y);
+    return range;
+}
+
+uint32_t SpatialHash::entry_of(const BoundableEntity* object) const {
+    uint32_t slot = object->_spatial_slot();
+    if(slot < entries_.size() && entries_[slot].object == object) {
+        return slot;
+    }
+    return NO_ENTRY;
+}
+
+uint32_t SpatialHash::next_stamp() {
+    if(++stamp_ == 0) {
+        //Wrapped around, clear out the old stamps so none of them match by accident
+        for(Entry& entry: entries_) {
+            entry.stamp = 0;
+        }
+        stamp_ = 1;
+    }
+    return stamp_;
+}
+
+void SpatialHash::add_to_cells(uint32_t index) {
+    Entry& entry = entries_[index];
+    entry.cells = cell_range(entry.bounds);
+    entry.large = entry.cells.cell_count() > MAX_CELLS_PER_OBJECT;
+
+    if(entry.large) {
+        large_entries_.push_back(index);
+        return;
+    }
+
+    for(int32_t x = entry.cells.min_x; x <= entry.cells.max_x; ++x) {
+        for(int32_t y = entry.cells.min_y; y <= entry.cells.max_y; ++y) {
+            cells_[cell_key(x, y)].push_back(index);
+        }
+    }
+}
+
+void SpatialHash::remove_from_cells(uint32_t index) {
+    Entry& entry = entries_[index];
+
+    if(entry.large) {
+        large_entries_.erase(std::find(large_entries_.begin(), large_entries_.end(), index));
+        return;
+    }
+
+    for(int32_t x = entry.cells.min_x; x <= entry.cells.max_x; ++x) {
+        for(int32_t y = entry.cells.min_y; y <= entry.cells.max_y; ++y) {
+            auto it = cells_.find(cell_key(x, y));
+            assert(it != cells_.end());
+
+            Cell& cell = it->second;
+            uint32_t i = std::find(cell.begin(), cell.end(), index) - cell.begin();
+            assert(i < cell.size());
+
+            //Only occupied cells are kept, so that queries over large areas can go through them
+            if(!cell.swap_remove(i)) {
+                cells_.erase(it);
+            }
+        }
+    }
+}
+
+void SpatialHash::insert(const BoundableEntity* object, Renderable* renderable) {
+    assert(object);
+
+    if(entry_of(object) != NO_ENTRY) {
+        throw std::logic_error("Tried to add an object which is already in the spatial hash");
+    }
+
+    uint32_t index;
+    if(free_entries_.empty()) {
+        index = entries_.size();
+        entries_.push_back(Entry());
+    } else {
+        index = free_entries_.back();
+        free_entries_.pop_back();
+    }
+
+    Entry& entry = entries_[index];
+    entry.object = object;
+    entry.renderable = renderable;
+    entry.bounds = object->transformed_aabb();
+    entry.stamp = 0;
+
+    add_to_cells(index);
+    object->_set_spatial_slot(index);
+}
+
+void SpatialHash::remove(const BoundableEntity* object) {
+    assert(object);
+
+    uint32_t index = entry_of(object);
+    if(index == NO_ENTRY) {
+        throw std::logic_error("Tried to remove an object that doesn't exist in the spatial hash");
+    }
+
+    remove_from_cells(index);
+    entries_[index] = Entry();
+    free_entries_.push_back(index);
+
+    object->_set_spatial_slot(~0u);
+}
+
+bool SpatialHash::update(const BoundableEntity* object) {
+    assert(object);
+
+    uint32_t index = entry_of(object);
+    if(index == NO_ENTRY) {
+        throw std::logic_error("Tried to update an object that doesn't exist in the spatial hash");
+    }
+
+    Entry& entry = entries_[index];
+    entry.bounds = object->transformed_aabb();
+
+    if(cell_range(entry.bounds) == entry.cells) {
+        return false;
+    }
+
+    remove_from_cells(index);
+    add_to_cells(index);
+    return true;
+}
+
+void SpatialHash::set_cell_size(float cell_size) {
+    if(cell_size <= 0.0f) {
+        throw std::logic_error("The cell size of a SpatialHash must be greater than zero");
+    }
+
+    cell_size_ = cell_size;
+
+    cells_.clear();
+    large_entries_.clear();
+
+    for(uint32_t i = 0; i < entries_.size(); ++i) {
+        if(entries_[i].object) {
+            add_to_cells(i);
+        }
+    }
+}
+
+void SpatialHash::objects_visible_from(const Frustum& frustum, RenderableList& out, bool cull_objects) {
+    //The frustum's extent on the XY plane
+    AABB area;
+    kmVec3Fill(&area.min, INFINITY, INFINITY, 0);
+    kmVec3Fill(&area.max, -INFINITY, -INFINITY, 0);
+
+    for(auto& corners: {frustum.near_corners(), frustum.far_corners()}) {
+        for(const kmVec3& corner: corners) {
+            area.min.x = std::min(area.min.x, corner.x);
+            area.min.y = std::min(area.min.y, corner.y);
+            area.max.x = std::max(area.max.x, corner.x);
+            area.max.y = std::max(area.max.y, corner.y);
+        }
+    }
+
+    visit_overlapping(area, [&](const BoundableEntity* object, Renderable* renderable) {
+        if(!renderable) {
+            return;
+        }
+
+        if(!cull_objects || frustum.intersects_aabb(object->transformed_aabb())) {
+            out.push_back(renderable);
+        }
+    });
+}
+
+}
@@ -0,0 +1,342 @@
+#ifndef SPATIAL_HASH_H
+#define SPATIAL_HASH_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+#include <kazmath/kazmath.h>
+
+#include "../generic/small_vector.h"
+#include "../interfaces.h"
+#include "../types.h"
+#include "../frustum.h"
+
+namespace kglt {
+
+/*
+ * A uniform grid over the XY plane for 2D scenes (sprites, tile maps, orthographic cameras), Z is
+ * ignored. Each object is listed in every cell its bounds overlap. Only cells which have something
+ * in them exist; they're found by hashing the cell's coordinates, so the world has no edges.
+ *
+ * * Adding, removing and moving an object touches only the cells it overlaps. A move which
+ *   doesn't change the cells costs nothing more than working them out.
+ * * Queries look in the cells overlapping the area they're interested in, or go through the
+ *   occupied cells if there are fewer of those.
+ * * Objects spanning more than MAX_CELLS_PER_OBJECT cells (e.g. a whole tile map) are kept to one
+ *   side and checked by every query instead.
+ *
+ * Cells should be a few times the size of a typical object. Objects are found through
+ * BoundableEntity::_spatial_slot(), so an object can only be in one spatial structure at a time.
+ */
+class SpatialHash {
+public:
+    static constexpr float DEFAULT_CELL_SIZE = 4.0f;
+    static const uint32_t MAX_CELLS_PER_OBJECT = 16;
+
+    SpatialHash(float cell_size=DEFAULT_CELL_SIZE);
+
+    SpatialHash(const SpatialHash&) = delete;
+    SpatialHash& operator=(const SpatialHash&) = delete;
+
+    void insert(const BoundableEntity* object, Renderable* renderable=nullptr);
+    void remove(const BoundableEntity* object);
+
+    /* Returns true if the object moved into different cells */
+    bool update(const BoundableEntity* object);
+
+    bool contains(const BoundableEntity* object) const { return entry_of(object) != NO_ENTRY; }
+
+    /* Changing the cell size rebuilds the grid */
+    void set_cell_size(float cell_size);
+    float cell_size() const { return cell_size_; }
+
+    uint32_t object_count() const { return entries_.size() - free_entries_.size(); }
+    uint32_t cell_count() const { return cells_.size(); }
+
+    /*
+     * Appends the renderables of the objects in view to out. The cells searched are those under the
+     * frustum's extent on the XY plane, each object found there is tested against the frustum if
+     * cull_objects is set.
+     */
+    void objects_visible_from(const Frustum& frustum, RenderableList& out, bool cull_objects=true);
+
+    /*
+     * Calls callback(object, renderable) once for each object whose bounds overlap box on the XY
+     * plane. The bounds are those the object had when it was last added or updated.
+     */
+    template<typename Callback>
+    void visit_overlapping(const AABB& box, const Callback& callback) {
+        uint32_t stamp = next_stamp();
+
+        auto visit = [&](uint32_t index) {
+            Entry& entry = entries_[index];
+            if(entry.stamp == stamp) {
+                return;
+            }
+            entry.stamp = stamp;
+
+            if(entry.bounds.min.x <= box.max.x && entry.bounds.max.x >= box.min.x &&
+               entry.bounds.min.y <= box.max.y && entry.bounds.max.y >= box.min.y) {
+                callback(entry.object, entry.renderable);
+            }
+        };
+
+        for(uint32_t index: large_entries_) {
+            visit(index);
+        }
+
+        CellRange range = cell_range(box);
+
+        if(range.cell_count() > cells_.size()) {
+            //Quicker to go through the cells there are than the ones there could be
+            for(auto& pair: cells_) {
+                if(range.contains(pair.first)) {
+                    for(uint32_t index: pair.second) {
+                        visit(index);
+                    }
+                }
+            }
+            return;
+        }
+
+        for(int32_t x = range.min_x; x <= range.max_x; ++x) {
+            for(int32_t y = range.min_y; y <= range.max_y; ++y) {
+                auto it = cells_.find(cell_key(x, y));
+                if(it == cells_.end()) {
+                    continue;
+                }
+
+                for(uint32_t index: it->second) {
+                    visit(index);
+                }
+            }
+        }
+    }
+
+    /*
+     * Calls callback(object, renderable) once for each object whose bounds the ray passes through
+     * within max_distance, walking the cells under the ray on the XY plane. max_distance is read
+     * as the walk goes, so the callback can shorten it to stop the walk early.
+     */
+    template<typename Callback>
+    void visit_along_ray(const Ray& ray, const float& max_distance, const Callback& callback) {
+        uint32_t stamp = next_stamp();
+
+        auto visit = [&](uint32_t index) {
+            Entry& entry = entries_[index];
+            if(entry.stamp == stamp) {
+                return;
+            }
+            entry.stamp = stamp;
+
+            float distance;
+            if(ray.intersects(entry.bounds, distance) && distance <= max_distance) {
+                callback(entry.object, entry.renderable);
+            }
+        };
+
+        for(uint32_t index: large_entries_) {
+            visit(index);
+        }
+
+        //Step from cell to cell along the ray (Amanatides & Woo), tracking how far along it each
+        //x and y boundary is crossed
+        int32_t x = cell_coordinate(ray.start.x);
+        int32_t y = cell_coordinate(ray.start.y);
+
+        const float never = std::numeric_limits<float>::infinity();
+
+        int32_t step_x = (ray.dir.x > 0) ? 1 : -1;
+        int32_t step_y = (ray.dir.y > 0) ? 1 : -1;
+        float next_x = (ray.dir.x == 0) ? never : ((x + (step_x > 0)) * cell_size_ - ray.start.x) / ray.dir.x;
+        float next_y = (ray.dir.y == 0) ? never : ((y + (step_y > 0)) * cell_size_ - ray.start.y) / ray.dir.y;
+        float delta_x = (ray.dir.x == 0) ? never : cell_size_ / std::abs(ray.dir.x);
+        float delta_y = (ray.dir.y == 0) ? never : cell_size_ / std::abs(ray.dir.y);
+
+        float entered_at = 0.0f;
+        uint64_t steps = 0;
+
+        while(entered_at <= max_distance) {
+            if(++steps > cells_.size()) {
+                //A long way through sparse cells, quicker to go through the cells there are
+                for(auto& pair: cells_) {
+                    for(uint32_t index: pair.second) {
+                        visit(index);
+                    }
+                }
+                return;
+            }
+
+            auto it = cells_.find(cell_key(x, y));
+            if(it != cells_.end()) {
+                for(uint32_t index: it->second) {
+                    visit(index);
+                }
+            }
+
+            if(next_x == never && next_y == never) {
+                break; //Straight along Z, this is the only cell
+            }
+
+            if(next_x < next_y) {
+                entered_at = next_x;
+                next_x += delta_x;
+                x += step_x;
+            } else {
+                entered_at = next_y;
+                next_y += delta_y;
+                y += step_y;
+            }
+        }
+    }
+
+    /*
+     * Calls callback(object, renderable) once for each object whose bounds are within
+     * sqrt(max_distance_sq) of point. Cells are searched in rings outwards from the point's cell
+     * until the next ring is beyond the limit, which the callback can shrink as it goes.
+     */
+    template<typename Callback>
+    void visit_near(const kmVec3& point, const float& max_distance_sq, const Callback& callback) {
+        uint32_t stamp = next_stamp();
+
+        auto visit = [&](uint32_t index) {
+            Entry& entry = entries_[index];
+            if(entry.stamp == stamp) {
+                return;
+            }
+            entry.stamp = stamp;
+
+            if(entry.bounds.distance_squared(point) <= max_distance_sq) {
+                callback(entry.object, entry.renderable);
+            }
+        };
+
+        auto visit_cell = [&](int32_t x, int32_t y) {
+            auto it = cells_.find(cell_key(x, y));
+            if(it != cells_.end()) {
+                for(uint32_t index: it->second) {
+                    visit(index);
+                }
+            }
+        };
+
+        for(uint32_t index: large_entries_) {
+            visit(index);
+        }
+
+        int32_t cx = cell_coordinate(point.x);
+        int32_t cy = cell_coordinate(point.y);
+        uint64_t searched = 0;
+
+        for(int32_t r = 0; ; ++r) {
+            //Everything in ring r is at least r - 1 cells away from the point
+            float gap = std::max(r - 1, 0) * cell_size_;
+            if(gap * gap > max_distance_sq) {
+                return;
+            }
+
+            uint64_t ring_size = (r == 0) ? 1 : 8 * uint64_t(r);
+            if(searched + ring_size > cells_.size()) {
+                //Quicker to go through the cells there are than the rings there could be
+                for(auto& pair: cells_) {
+                    for(uint32_t index: pair.second) {
+                        visit(index);
+                    }
+                }
+                return;
+            }
+            searched += ring_size;
+
+            if(r == 0) {
+                visit_cell(cx, cy);
+                continue;
+            }
+
+            for(int32_t x = cx - r; x <= cx + r; ++x) {
+                visit_cell(x, cy - r);
+                visit_cell(x, cy + r);
+            }
+
+            for(int32_t y = cy - r + 1; y <= cy + r - 1; ++y) {
+                visit_cell(cx - r, y);
+                visit_cell(cx + r, y);
+            }
+        }
+    }
+
+private:
+    static const uint32_t NO_ENTRY = ~0u;
+
+    struct CellRange {
+        int32_t min_x = 0;
+        int32_t min_y = 0;
+        int32_t max_x = -1;
+        int32_t max_y = -1;
+
+        uint64_t cell_count() const {
+            return uint64_t(int64_t(max_x) - min_x + 1) * uint64_t(int64_t(max_y) - min_y + 1);
+        }
+
+        bool contains(uint64_t key) const {
+            int32_t x = int32_t(key >> 32);
+            int32_t y = int32_t(key & 0xFFFFFFFF);
+            return x >= min_x && x <= max_x && y >= min_y && y <= max_y;
+        }
+
+        bool operator==(const CellRange& rhs) const {
+            return min_x == rhs.min_x && min_y == rhs.min_y && max_x == rhs.max_x && max_y == rhs.max_y;
+        }
+    };
+
+    struct Entry {
+        const BoundableEntity* object = nullptr; //Null if the entry is free
+        Renderable* renderable = nullptr;
+        AABB bounds;
+        CellRange cells;
+        bool large = false;
+        uint32_t stamp = 0;
+    };
+
+    //Sequential coordinates would otherwise bunch up in the buckets
+    struct CellHash {
+        std::size_t operator()(uint64_t key) const {
+            key ^= key >> 33;
+            key *= 0xff51afd7ed558ccdULL;
+            key ^= key >> 33;
+            return std::size_t(key);
+        }
+    };
+
+    typedef generic::SmallVector<uint32_t, 4> Cell;
+
+    float cell_size_;
+
+    std::unordered_map<uint64_t, Cell, CellHash> cells_;
+    std::vector<Entry> entries_;
+    std::vector<uint32_t> free_entries_;
+    std::vector<uint32_t> large_entries_;
+
+    //Each query marks the entries it has seen, so that objects in several cells are visited once
+    uint32_t stamp_ = 0;
+
+    static uint64_t cell_key(int32_t x, int32_t y) {
+        return (uint64_t(uint32_t(x)) << 32) | uint64_t(uint32_t(y));
+    }
+
+    int32_t cell_coordinate(float value) const;
+    CellRange cell_range(const AABB& bounds) const;
+
+    uint32_t entry_of(const BoundableEntity* object) const;
+    uint32_t next_stamp();
+
+    void add_to_cells(uint32_t index);
+    void remove_from_cells(uint32_t index);
+};
+
+}
+
+#endif // SPATIAL_HASH_H
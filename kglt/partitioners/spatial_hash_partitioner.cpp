@@ -0,0 +1,37 @@
+#include "spatial_hash_partitioner.h"
+
+#include "../stage.h"
+#include "../light.h"
+#include "../camera.h"
+#include "../batcher.h"
+
+namespace kglt {
+
+void SpatialHashPartitioner::geometry_visible_from(FrameResources& resources, CameraID camera_id, RenderableList& out) {
+    geometry_.objects_visible_from(resources.camera(camera_id)->frustum(), out);
+}
+
+void SpatialHashPartitioner::lights_visible_from(FrameResources& resources, CameraID camera_id, LightList& out) {
+    const Frustum& frustum = resources.camera(camera_id)->frustum();
+
+    //Lights are few and far between, so just test them all
+    for(auto& pair: registered_lights()) {
+        if(frustum.intersects_aabb(pair.second->transformed_aabb())) {
+            out.push_back(pair.first);
+        }
+    }
+}
+
+void SpatialHashPartitioner::visit_geometry_along_ray(const Ray& ray, const float& max_distance, const GeometryCallback& callback) {
+    geometry_.visit_along_ray(ray, max_distance, forward_renderables(callback));
+}
+
+void SpatialHashPartitioner::visit_geometry_near(const Vec3& point, const float& max_distance_sq, const GeometryCallback& callback) {
+    geometry_.visit_near(point, max_distance_sq, forward_renderables(callback));
+}
+
+void SpatialHashPartitioner::visit_geometry_overlapping(const AABB& box, const GeometryCallback& callback) {
+    geometry_.visit_overlapping(box, forward_renderables(callback));
+}
+
+}
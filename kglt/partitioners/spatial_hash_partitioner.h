@@ -0,0 +1,44 @@
+#ifndef SPATIAL_HASH_PARTITIONER_H
+#define SPATIAL_HASH_PARTITIONER_H
+
+#include "spatial_partitioner.h"
+#include "spatial_hash.h"
+
+namespace kglt {
+
+/*
+ * Keeps the stage's geometry in a 2D grid (see SpatialHash). Meant for sprite and tile based games drawn with orthographic cameras, where everything is on
+ * much the same Z and an octree would spend its time splitting space that isn't used.
+ */
+class SpatialHashPartitioner :
+    public SpatialPartitioner {
+
+public:
+    SpatialHashPartitioner(Stage& ss):
+        SpatialPartitioner(ss) {}
+
+    void lights_visible_from(FrameResources& resources, CameraID camera_id, LightList& out);
+    void geometry_visible_from(FrameResources& resources, CameraID camera_id, RenderableList& out);
+
+    /* The size of the grid cells in world units, they should be a few times a typical object */
+    void set_cell_size(float cell_size) {
+        geometry_.set_cell_size(cell_size);
+    }
+
+protected:
+    //Only moves into different cells change anything
+    void insert_geometry(const BoundableEntity* boundable, Renderable* renderable) { geometry_.insert(boundable, renderable); }
+    void update_geometry(const BoundableEntity* boundable) { geometry_.update(boundable); }
+    void remove_geometry(const BoundableEntity* boundable) { geometry_.remove(boundable); }
+
+    void visit_geometry_along_ray(const Ray& ray, const float& max_distance, const GeometryCallback& callback);
+    void visit_geometry_near(const Vec3& point, const float& max_distance_sq, const GeometryCallback& callback);
+    void visit_geometry_overlapping(const AABB& box, const GeometryCallback& callback);
+
+private:
+    SpatialHash geometry_;
+};
+
+}
+
+#endif // SPATIAL_HASH_PARTITIONER_H
@@ -0,0 +1,155 @@
+#include <algorithm>
+
+#include "spatial_partitioner.h"
+
+#include "../stage.h"
+#include "../light.h"
+#include "../actor.h"
+#include "../particles.h"
+
+namespace kglt {
+
+void SpatialPartitioner::event_actor_changed(ActorID ent) {
+    L_DEBUG("Actor changed, updating partitioner");
+    remove_actor(ent);
+    add_actor(ent);
+}
+
+void SpatialPartitioner::add_particle_system(ParticleSystemID ps) {
+    auto system = stage()->particle_system(ps);
+
+    BoundableEntity* ent = system.__object.get();
+    particle_system_to_boundable_[ps] = ent;
+    boundable_to_renderable_[ent] = system.__object;
+
+    insert_geometry(ent, system.__object.get());
+}
+
+void SpatialPartitioner::remove_particle_system(ParticleSystemID ps) {
+    auto it = particle_system_to_boundable_.find(ps);
+    if(it == particle_system_to_boundable_.end()) {
+        return;
+    }
+
+    remove_geometry(it->second);
+    boundable_to_renderable_.erase(it->second);
+    particle_system_to_boundable_.erase(it);
+}
+
+void SpatialPartitioner::add_actor(ActorID obj) {
+    L_DEBUG("Adding actor to the partitioner");
+
+    auto ent = stage()->actor(obj);
+    for(uint16_t i = 0; i < ent->subactor_count(); ++i) {
+        //All subactors are boundable
+        BoundableEntity* boundable = &ent->subactor(i);
+
+        actor_to_registered_subactors_[obj].push_back(boundable);
+        boundable_to_renderable_[boundable] = ent->_subactors().at(i);
+
+        insert_geometry(boundable, ent->_subactors().at(i).get());
+    }
+
+    //Connect the changed signal
+    actor_changed_connections_[obj] = ent->signal_mesh_changed().connect(std::bind(&SpatialPartitioner::event_actor_changed, this, std::placeholders::_1));
+}
+
+void SpatialPartitioner::remove_actor(ActorID obj) {
+    L_DEBUG("Removing actor from the partitioner");
+
+    for(BoundableEntity* boundable: actor_to_registered_subactors_[obj]) {
+        remove_geometry(boundable);
+        boundable_to_renderable_.erase(boundable);
+    }
+
+    actor_to_registered_subactors_.erase(obj);
+
+    actor_changed_connections_[obj].disconnect();
+    actor_changed_connections_.erase(obj);
+}
+
+void SpatialPartitioner::add_light(LightID obj) {
+    auto light = stage()->light(obj);
+    BoundableEntity* boundable = light.__object.get();
+    assert(boundable);
+
+    boundable_to_light_[boundable] = obj;
+    light_to_boundable_[obj] = boundable;
+
+    insert_light_bounds(boundable);
+}
+
+void SpatialPartitioner::remove_light(LightID obj) {
+    auto it = light_to_boundable_.find(obj);
+    if(it == light_to_boundable_.end()) {
+        return;
+    }
+
+    remove_light_bounds(it->second);
+    boundable_to_light_.erase(it->second);
+    light_to_boundable_.erase(it);
+}
+
+void SpatialPartitioner::each_registered(const std::function<void (const BoundableEntity*)>& callback) const {
+    for(auto& pair: actor_to_registered_subactors_) {
+        for(BoundableEntity* boundable: pair.second) {
+            callback(boundable);
+        }
+    }
+
+    for(auto& pair: particle_system_to_boundable_) {
+        callback(pair.second);
+    }
+
+    for(auto& pair: light_to_boundable_) {
+        callback(pair.second);
+    }
+}
+
+namespace {
+
+//Things can move more than once between updates, only update them once
+template<typename T>
+void sort_unique(std::vector<T>& ids) {
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+}
+
+}
+
+void SpatialPartitioner::update() {
+    //Anything removed since it moved won't be found in the lookups and is skipped
+
+    sort_unique(moved_actors_);
+    for(ActorID actor_id: moved_actors_) {
+        auto it = actor_to_registered_subactors_.find(actor_id);
+        if(it == actor_to_registered_subactors_.end()) {
+            continue;
+        }
+
+        for(BoundableEntity* boundable: it->second) {
+            update_geometry(boundable);
+        }
+    }
+    moved_actors_.clear();
+
+    sort_unique(moved_lights_);
+    for(LightID light_id: moved_lights_) {
+        auto it = light_to_boundable_.find(light_id);
+        if(it != light_to_boundable_.end()) {
+            update_light_bounds(it->second);
+        }
+    }
+    moved_lights_.clear();
+
+    sort_unique(moved_particle_systems_);
+    for(ParticleSystemID ps: moved_particle_systems_) {
+        auto it = particle_system_to_boundable_.find(ps);
+        if(it != particle_system_to_boundable_.end()) {
+            update_geometry(it->second);
+        }
+    }
+    moved_particle_systems_.clear();
+}
+
+}
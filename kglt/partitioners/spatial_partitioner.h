@@ -0,0 +1,103 @@
+#ifndef SPATIAL_PARTITIONER_H
+#define SPATIAL_PARTITIONER_H
+
+#include <functional>
+#include <map>
+#include <vector>
+
+#include "../partitioner.h"
+
+#include <kazbase/signals.h>
+
+namespace kglt {
+
+class Renderable;
+
+typedef std::shared_ptr<Renderable> RenderablePtr;
+
+/*
+ * The bookkeeping shared by partitioners which keep the stage's objects in a spatial structure.
+ * It registers the subactors of each actor, particle systems and lights, queues up whatever
+ * moves and hands each moved thing over once per update(), and re-adds actors whose mesh
+ * changes. Subclasses only insert, update and remove things in their structure, and visit it.
+ *
+ * Subactors and particle systems are geometry and are inserted with their renderable. Lights are
+ * inserted without one, and are ignored unless a subclass overrides the light hooks.
+ */
+class SpatialPartitioner :
+    public Partitioner {
+
+public:
+    SpatialPartitioner(Stage& ss):
+        Partitioner(ss) {}
+
+    void add_actor(ActorID obj);
+    void remove_actor(ActorID obj);
+
+    void add_light(LightID obj);
+    void remove_light(LightID obj);
+
+    void add_particle_system(ParticleSystemID ps);
+    void remove_particle_system(ParticleSystemID ps);
+
+    void actor_moved(ActorID obj) { moved_actors_.push_back(obj); }
+    void light_moved(LightID obj) { moved_lights_.push_back(obj); }
+    void particle_system_moved(ParticleSystemID ps) { moved_particle_systems_.push_back(ps); }
+
+    void update();
+
+    void event_actor_changed(ActorID ent);
+
+protected:
+    virtual void insert_geometry(const BoundableEntity* boundable, Renderable* renderable) = 0;
+    virtual void update_geometry(const BoundableEntity* boundable) = 0;
+    virtual void remove_geometry(const BoundableEntity* boundable) = 0;
+
+    virtual void insert_light_bounds(const BoundableEntity* boundable) {}
+    virtual void update_light_bounds(const BoundableEntity* boundable) {}
+    virtual void remove_light_bounds(const BoundableEntity* boundable) {}
+
+    LightID light_for(const BoundableEntity* boundable) const { return boundable_to_light_.at(boundable); }
+    const std::map<LightID, const BoundableEntity*>& registered_lights() const { return light_to_boundable_; }
+
+    /* Calls callback for everything which has been added, geometry and lights alike */
+    void each_registered(const std::function<void (const BoundableEntity*)>& callback) const;
+
+    /*
+     * Adapts a GeometryCallback for the visit_* walks of the spatial structures, skipping the
+     * lights, which are stored without a renderable.
+     */
+    struct RenderableForwarder {
+        const GeometryCallback& callback;
+
+        void operator()(const BoundableEntity*, Renderable* renderable) const {
+            if(renderable) {
+                callback(renderable);
+            }
+        }
+    };
+
+    static RenderableForwarder forward_renderables(const GeometryCallback& callback) {
+        return RenderableForwarder{callback};
+    }
+
+private:
+    //Things which have moved since the last update()
+    std::vector<ActorID> moved_actors_;
+    std::vector<LightID> moved_lights_;
+    std::vector<ParticleSystemID> moved_particle_systems_;
+
+    std::map<ActorID, std::vector<BoundableEntity*> > actor_to_registered_subactors_;
+    std::map<ActorID, sig::connection> actor_changed_connections_;
+
+    //Keeps the renderables alive for as long as the subclass's structure has pointers to them
+    std::map<const BoundableEntity*, RenderablePtr> boundable_to_renderable_;
+
+    std::map<const BoundableEntity*, LightID> boundable_to_light_;
+    std::map<LightID, const BoundableEntity*> light_to_boundable_;
+    std::map<ParticleSystemID, const BoundableEntity*> particle_system_to_boundable_;
+};
+
+}
+
+#endif // SPATIAL_PARTITIONER_H
@@ -80,7 +80,7 @@ SubMeshIndex rectangle(
         mesh->clear();
     }
 
-    uint16_t offset = mesh->shared_data().count();
+    uint32_t offset = mesh->shared_data().count();
 
     mesh->shared_data().move_to_end();
 
@@ -153,7 +153,7 @@ SubMeshIndex rectangle_outline(
         mesh->clear();
     }
 
-    uint16_t offset = mesh->shared_data().count();
+    uint32_t offset = mesh->shared_data().count();
 
     mesh->shared_data().position(x_offset + (-width / 2.0), y_offset + (-height / 2.0), z_offset);
     mesh->shared_data().diffuse(kglt::Colour::WHITE);
@@ -1,4 +1,5 @@
 #include "utils/glcompat.h"
+#include <algorithm>
 #include <unordered_map>
 
 #include "utils/gl_error.h"
@@ -59,7 +60,8 @@ void Pipeline::activate() {
 
 RenderSequence::RenderSequence(WindowBase &window):
     window_(window),
-    renderer_(new GenericRenderer(window)) {
+    renderer_(new GenericRenderer(window)),
+    frame_resources_(window) {
 
     //Set up the default render options
     render_options.wireframe_enabled = false;
@@ -180,17 +182,15 @@ void RenderSequence::run() {
     window_.console->set_stats_subactors_rendered(actors_rendered);
 }
 
-void RenderSequence::update_camera_constraint(CameraID cid) {
-    auto camera = window_.camera(cid);
-
-    if(camera->has_proxy()) {
+void RenderSequence::update_camera_constraint(Camera& camera) {
+    if(camera.has_proxy()) {
         //Update the associated camera
-        if(camera->proxy().is_constrained()) {
+        if(camera.proxy().is_constrained()) {
             //FIXME: THis might work for cameras but we need a more generic place
             //to do this for all objects before render
-            camera->proxy()._update_constraint();
+            camera.proxy()._update_constraint();
         }
-        camera->set_transform(camera->proxy().absolute_transformation());
+        camera.set_transform(camera.proxy().absolute_transformation());
     }
 }
 
@@ -199,9 +199,16 @@ void RenderSequence::run_pipeline(Pipeline::ptr pipeline_stage, int &actors_rend
         return;
     }
 
-    update_camera_constraint(pipeline_stage->camera_id());
+    CameraID camera_id = pipeline_stage->camera_id();
+    StageID stage_id = pipeline_stage->stage_id();
+
+    //Looked up once and held until the pipeline has been rendered, see FrameResources
+    frame_resources_.begin(stage_id);
+    Camera& camera = *frame_resources_.camera(camera_id);
 
-    Mat4 camera_projection = window_.camera(pipeline_stage->camera_id())->projection_matrix();
+    update_camera_constraint(camera);
+
+    Mat4 camera_projection = camera.projection_matrix();
 
     RenderTarget& target = window_; //FIXME: Should be window or texture
 
@@ -210,13 +217,14 @@ void RenderSequence::run_pipeline(Pipeline::ptr pipeline_stage, int &actors_rend
      *  time we hit a render target when processing the pipelines. We keep track of the targets that have been rendered each frame
      *  and this list is cleared at the start of run().
      */
-    if(targets_rendered_this_frame_.find(&target) == targets_rendered_this_frame_.end()) {
+    auto& targets = targets_rendered_this_frame_;
+    if(std::find(targets.begin(), targets.end(), &target) == targets.end()) {
         if(target.clear_every_frame_flags()) {
             Viewport view(kglt::VIEWPORT_TYPE_FULL, target.clear_every_frame_colour());
             view.clear(target, target.clear_every_frame_flags());
         }
 
-        targets_rendered_this_frame_.insert(&target);
+        targets.push_back(&target);
     }
 
     auto viewport = pipeline_stage->viewport();
@@ -230,20 +238,25 @@ void RenderSequence::run_pipeline(Pipeline::ptr pipeline_stage, int &actors_rend
 
     signal_pipeline_started_(*pipeline_stage);
 
-    CameraID camera_id = pipeline_stage->camera_id();
-    StageID stage_id = pipeline_stage->stage_id();
-
     if(pipeline_stage->ui_stage_id()) {        
         //This is a UI stage, so just render that
         auto ui_stage = window_.ui_stage(pipeline_stage->ui_stage_id());
         ui_stage->__resize(viewport.width_in_pixels(target), viewport.height_in_pixels(target));
         ui_stage->__render(camera_projection);
     } else {
-        auto stage = window_.stage(stage_id);
+        Stage& stage = frame_resources_.stage();
 
-        std::vector<RenderablePtr> buffers = stage->partitioner().geometry_visible_from(camera_id);
-        std::vector<LightID> lights = stage->partitioner().lights_visible_from(camera_id);
+        /*
+         * Everything built here only lasts for this pipeline, so it all comes from the
+         * frame arena and is gone by the end of the block
+         */
+        generic::LinearArena& arena = window_.frame_arena;
 
+        RenderableList buffers{generic::ArenaAllocator<Renderable*>(arena)};
+        LightList lights{generic::ArenaAllocator<LightID>(arena)};
+
+        stage.partitioner().geometry_visible_from(frame_resources_, camera_id, buffers);
+        stage.partitioner().lights_visible_from(frame_resources_, camera_id, lights);
 
         /*
          * Go through the visible objects, sort into queues and for
@@ -251,29 +264,33 @@ void RenderSequence::run_pipeline(Pipeline::ptr pipeline_stage, int &actors_rend
          * of material properties (uniforms) will be created with the child nodes
          * being the meshes
          */
-        typedef std::unordered_map<int32_t, std::vector<RootGroup::ptr> > QueueGroups;
-        static QueueGroups queues;
+        typedef generic::ArenaVector<generic::ArenaPtr<RootGroup>> PassGroups;
 
-        //Empty the queues
-        for(auto& queue: queues) {
-            for(auto& group: queue.second) {
-                group->clear();
-            }
-            queue.second.clear();
+        //One list of pass groups for each of RENDER_PRIORITIES, in the same order
+        generic::ArenaVector<PassGroups> queues{generic::ArenaAllocator<PassGroups>(arena)};
+        queues.reserve(RENDER_PRIORITIES.size());
+        for(uint32_t i = 0; i < RENDER_PRIORITIES.size(); ++i) {
+            queues.emplace_back(generic::ArenaAllocator<generic::ArenaPtr<RootGroup>>(arena));
         }
 
-        std::vector<LightID> lights_intersecting_actor;
+        LightList lights_intersecting_actor{generic::ArenaAllocator<LightID>(arena)};
+        lights_intersecting_actor.reserve(lights.size());
 
         //Go through the visible actors
-        for(RenderablePtr ent: buffers) {
+        for(Renderable* ent: buffers) {
             //Get the priority queue for this actor (e.g. RENDER_PRIORITY_BACKGROUND)
-            QueueGroups::mapped_type& priority_queue = queues[(uint32_t)ent->render_priority()];
+            auto priority = std::find(RENDER_PRIORITIES.begin(), RENDER_PRIORITIES.end(), ent->render_priority());
+            if(priority == RENDER_PRIORITIES.end()) {
+                continue;
+            }
+
+            PassGroups& priority_queue = queues[priority - RENDER_PRIORITIES.begin()];
 
-            auto mat = stage->material(ent->material_id());
+            Material* mat = frame_resources_.material(ent->material_id());
 
             lights_intersecting_actor.clear();
             for(auto lid: lights) {
-                auto light = stage->light(lid);
+                Light* light = frame_resources_.light(lid);
                 if(light->transformed_aabb().intersects(ent->transformed_aabb())) {
                     lights_intersecting_actor.push_back(lid);
                 }
@@ -282,16 +299,14 @@ void RenderSequence::run_pipeline(Pipeline::ptr pipeline_stage, int &actors_rend
             //Go through the actors material passes
             for(uint8_t pass = 0; pass < mat->pass_count(); ++pass) {
                 //Create a new render group if necessary
-                RootGroup::ptr group;
                 if(priority_queue.size() <= pass) {
-                    group = RootGroup::ptr(new RootGroup(window_, stage_id, camera_id));
-                    priority_queue.push_back(group);
-                } else {
-                    group = priority_queue[pass];
+                    priority_queue.push_back(generic::ArenaPtr<RootGroup>(
+                        arena.create<RootGroup>(window_, frame_resources_, arena, stage_id, camera_id)
+                    ));
                 }
 
                 //Insert the actor into the RenderGroup tree
-                group->insert(*ent, pass, lights_intersecting_actor);
+                priority_queue[pass]->insert(*ent, pass, lights_intersecting_actor);
             }
 
             actors_rendered++;
@@ -303,22 +318,23 @@ void RenderSequence::run_pipeline(Pipeline::ptr pipeline_stage, int &actors_rend
          * tree and calling bind()/unbind() at each level
          */
         renderer_->set_current_stage(stage_id);
-        for(RenderPriority priority: RENDER_PRIORITIES) {
-            QueueGroups::mapped_type& priority_queue = queues[priority];
-            for(RootGroup::ptr pass_group: priority_queue) {
-                std::function<void (Renderable&, MaterialPass&)> f = [=](Renderable& renderable, MaterialPass& pass) {
+        for(PassGroups& priority_queue: queues) {
+            for(auto& pass_group: priority_queue) {
+                RootGroup* group = pass_group.get();
+                pass_group->traverse([this, &camera, group](Renderable& renderable, MaterialPass& pass) {
                     renderer_->render(
                         renderable,
-                        pipeline_stage->camera_id(),
-                        pass_group->get_root().current_program()
+                        camera,
+                        group->current_program()
                     );
-                };
-                pass_group->traverse(f);
+                });
             }
         }
         renderer_->set_current_stage(StageID());
     }
 
+    frame_resources_.end();
+
 /*
     std::sort(buffers.begin(), buffers.end(), [](SubActor::ptr lhs, SubActor::ptr rhs) {
         return lhs->_parent().render_priority() < rhs->_parent().render_priority();
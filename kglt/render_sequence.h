@@ -12,6 +12,7 @@
 #include "viewport.h"
 #include "partitioner.h"
 #include "renderer.h"
+#include "batcher.h"
 
 namespace kglt {
 
@@ -110,27 +111,34 @@ public:
 
     void run();
 
+    /*
+     * Renders a single pipeline, run() calls this for each of them in priority order. Once the
+     * pipeline has been rendered before (so the frame arena and caches have grown to fit) this
+     * doesn't touch the heap for stages, see FrameResources.
+     */
+    void run_pipeline(Pipeline::ptr stage, int& actors_rendered);
+
     sig::signal<void (Pipeline&)>& signal_pipeline_started() { return signal_pipeline_started_; }
     sig::signal<void (Pipeline&)>& signal_pipeline_finished() { return signal_pipeline_finished_; }
 
     RenderOptions render_options;
 
-private:    
-    void run_pipeline(Pipeline::ptr stage, int& actors_rendered);
-
+private:
     WindowBase& window_;
     Renderer::ptr renderer_;
+    FrameResources frame_resources_;
 
     std::list<Pipeline::ptr> ordered_pipelines_;
 
     sig::signal<void (Pipeline&)> signal_pipeline_started_;
     sig::signal<void (Pipeline&)> signal_pipeline_finished_;
 
-    void update_camera_constraint(CameraID cid);
+    void update_camera_constraint(Camera& camera);
 
     friend class Pipeline;
 
-    std::set<RenderTarget*> targets_rendered_this_frame_;
+    //A vector rather than a set so that clearing it each frame keeps its storage
+    std::vector<RenderTarget*> targets_rendered_this_frame_;
 };
 
 }
@@ -16,7 +16,7 @@ namespace kglt {
  * FIXME: Stupid argument ordering
  */
 void GenericRenderer::set_auto_uniforms_on_shader(GPUProgram& program,
-    CameraID camera,
+    Camera& camera,
     Renderable &subactor) {
 
     //Calculate the modelview-projection matrix
@@ -24,8 +24,8 @@ void GenericRenderer::set_auto_uniforms_on_shader(GPUProgram& program,
     Mat4 modelview;
 
     const Mat4 model = subactor.final_transformation();
-    const Mat4& view = window().camera(camera)->view_matrix();
-    const Mat4& projection = window().camera(camera)->projection_matrix();
+    const Mat4& view = camera.view_matrix();
+    const Mat4& projection = camera.projection_matrix();
 
     kmMat4Multiply(&modelview, &view, &model);
     kmMat4Multiply(&modelview_projection, &projection, &modelview);
@@ -107,27 +107,48 @@ void GenericRenderer::set_auto_uniforms_on_shader(GPUProgram& program,
     }*/
 }
 
-template<typename EnabledMethod, typename OffsetMethod>
-void send_attribute(ShaderAvailableAttributes attr,
-                    const VertexData& data,
-                    EnabledMethod exists_on_data_predicate,
-                    OffsetMethod offset_func) {
+GLenum gl_type_for_attribute(VertexAttributeType type) {
+    switch(type) {
+        case VERTEX_ATTRIBUTE_TYPE_1F:
+        case VERTEX_ATTRIBUTE_TYPE_2F:
+        case VERTEX_ATTRIBUTE_TYPE_3F:
+        case VERTEX_ATTRIBUTE_TYPE_4F:
+            return GL_FLOAT;
+#ifdef GL_HALF_FLOAT
+        case VERTEX_ATTRIBUTE_TYPE_2H:
+        case VERTEX_ATTRIBUTE_TYPE_4H:
+            return GL_HALF_FLOAT;
+#endif
+        case VERTEX_ATTRIBUTE_TYPE_4UB_NORMALIZED:
+            return GL_UNSIGNED_BYTE;
+#ifdef GL_INT_2_10_10_10_REV
+        case VERTEX_ATTRIBUTE_TYPE_PACKED_NORMAL:
+            return GL_INT_2_10_10_10_REV;
+#endif
+    default:
+        throw NotImplementedError(__FILE__, __LINE__);
+    }
+}
 
+void send_attribute(ShaderAvailableAttributes attr, const VertexData& data, AttributeBitMask which) {
     int32_t loc = (int32_t) attr;
 
-    auto get_has_attribute = std::bind(exists_on_data_predicate, std::reference_wrapper<const VertexData>(data));
-
-    if(get_has_attribute()) {
-        auto get_offset = std::bind(offset_func, std::reference_wrapper<const VertexData>(data));
+    const VertexSpecification& spec = data.specification();
+    if(spec.has_attribute(which)) {
+        VertexAttributeType type = spec.attribute(which);
+        bool normalized = (
+            type == VERTEX_ATTRIBUTE_TYPE_4UB_NORMALIZED ||
+            type == VERTEX_ATTRIBUTE_TYPE_PACKED_NORMAL
+        );
 
         GLCheck(glEnableVertexAttribArray, loc);
         GLCheck(glVertexAttribPointer,
             loc,
-            SHADER_ATTRIBUTE_SIZES.find(attr)->second,
-            GL_FLOAT,
-            GL_FALSE,
+            vertex_attribute_component_count(type),
+            gl_type_for_attribute(type),
+            (normalized) ? GL_TRUE : GL_FALSE,
             data.stride(),
-            BUFFER_OFFSET(get_offset())
+            BUFFER_OFFSET(spec.offset(which))
         );
     } else {
         //L_WARN_ONCE(_u("Couldn't locate attribute on the mesh: {0}").format(attr));
@@ -136,18 +157,16 @@ void send_attribute(ShaderAvailableAttributes attr,
 
 void GenericRenderer::set_auto_attributes_on_shader(Renderable &buffer) {
     /*
-     *  Binding attributes generically is hard. So we have some template magic in the send_attribute
-     *  function above that takes the VertexData member functions we need to provide the attribute
-     *  and just makes the whole thing generic. Before this was 100s of lines of boilerplate. Thank god
-     *  for templates!
+     *  The vertex data describes its own layout, so the component count, type and offset of
+     *  each attribute all come from its VertexSpecification.
      */
-    send_attribute(SP_ATTR_VERTEX_POSITION, buffer.vertex_data(), &VertexData::has_positions, &VertexData::position_offset);
-    send_attribute(SP_ATTR_VERTEX_TEXCOORD0, buffer.vertex_data(), &VertexData::has_texcoord0, &VertexData::texcoord0_offset);
-    send_attribute(SP_ATTR_VERTEX_TEXCOORD1, buffer.vertex_data(), &VertexData::has_texcoord1, &VertexData::texcoord1_offset);
-    send_attribute(SP_ATTR_VERTEX_TEXCOORD2, buffer.vertex_data(), &VertexData::has_texcoord2, &VertexData::texcoord2_offset);
-    send_attribute(SP_ATTR_VERTEX_TEXCOORD3, buffer.vertex_data(), &VertexData::has_texcoord3, &VertexData::texcoord3_offset);
-    send_attribute(SP_ATTR_VERTEX_DIFFUSE, buffer.vertex_data(), &VertexData::has_diffuse, &VertexData::diffuse_offset);
-    send_attribute(SP_ATTR_VERTEX_NORMAL, buffer.vertex_data(), &VertexData::has_normals, &VertexData::normal_offset);
+    send_attribute(SP_ATTR_VERTEX_POSITION, buffer.vertex_data(), BM_POSITIONS);
+    send_attribute(SP_ATTR_VERTEX_TEXCOORD0, buffer.vertex_data(), BM_TEXCOORD_0);
+    send_attribute(SP_ATTR_VERTEX_TEXCOORD1, buffer.vertex_data(), BM_TEXCOORD_1);
+    send_attribute(SP_ATTR_VERTEX_TEXCOORD2, buffer.vertex_data(), BM_TEXCOORD_2);
+    send_attribute(SP_ATTR_VERTEX_TEXCOORD3, buffer.vertex_data(), BM_TEXCOORD_3);
+    send_attribute(SP_ATTR_VERTEX_DIFFUSE, buffer.vertex_data(), BM_DIFFUSE);
+    send_attribute(SP_ATTR_VERTEX_NORMAL, buffer.vertex_data(), BM_NORMALS);
 }
 
 void GenericRenderer::set_blending_mode(BlendType type) {
@@ -173,7 +192,7 @@ void GenericRenderer::set_blending_mode(BlendType type) {
     }
 }
 
-void GenericRenderer::render(Renderable& buffer, CameraID camera, GPUProgram* program) {
+void GenericRenderer::render(Renderable& buffer, Camera& camera, GPUProgram* program) {
 
     if(!program) {
         L_ERROR("No shader is bound, so nothing will be rendered");
@@ -195,25 +214,28 @@ void GenericRenderer::render(Renderable& buffer, CameraID camera, GPUProgram* pr
     set_auto_attributes_on_shader(buffer);
     set_auto_uniforms_on_shader(*program, camera, buffer);
 
+    //Large meshes need 32 bit indices, everything else uses 16 bit
+    GLenum index_type = (buffer.index_data().index_type() == INDEX_TYPE_32_BIT) ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+
     //Render the mesh, once for each iteration of the pass
     switch(buffer.arrangement()) {
         case MESH_ARRANGEMENT_POINTS:
-            GLCheck(glDrawElements, GL_POINTS, index_count, GL_UNSIGNED_SHORT, BUFFER_OFFSET(0));
+            GLCheck(glDrawElements, GL_POINTS, index_count, index_type, BUFFER_OFFSET(0));
         break;
         case MESH_ARRANGEMENT_LINES:
-            GLCheck(glDrawElements, GL_LINES, index_count, GL_UNSIGNED_SHORT, BUFFER_OFFSET(0));
+            GLCheck(glDrawElements, GL_LINES, index_count, index_type, BUFFER_OFFSET(0));
         break;
         case MESH_ARRANGEMENT_LINE_STRIP:
-            GLCheck(glDrawElements, GL_LINE_STRIP, index_count, GL_UNSIGNED_SHORT, BUFFER_OFFSET(0));
+            GLCheck(glDrawElements, GL_LINE_STRIP, index_count, index_type, BUFFER_OFFSET(0));
         break;
         case MESH_ARRANGEMENT_TRIANGLES:
-            GLCheck(glDrawElements, GL_TRIANGLES, index_count, GL_UNSIGNED_SHORT, BUFFER_OFFSET(0));
+            GLCheck(glDrawElements, GL_TRIANGLES, index_count, index_type, BUFFER_OFFSET(0));
         break;
         case MESH_ARRANGEMENT_TRIANGLE_STRIP:
-            GLCheck(glDrawElements, GL_TRIANGLE_STRIP, index_count, GL_UNSIGNED_SHORT, BUFFER_OFFSET(0));
+            GLCheck(glDrawElements, GL_TRIANGLE_STRIP, index_count, index_type, BUFFER_OFFSET(0));
         break;
         case MESH_ARRANGEMENT_TRIANGLE_FAN:
-            GLCheck(glDrawElements, GL_TRIANGLE_FAN, index_count, GL_UNSIGNED_SHORT, BUFFER_OFFSET(0));
+            GLCheck(glDrawElements, GL_TRIANGLE_FAN, index_count, index_type, BUFFER_OFFSET(0));
         break;
         default:
             throw NotImplementedError(__FILE__, __LINE__);
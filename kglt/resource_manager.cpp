@@ -2,8 +2,8 @@
 #include "resource_manager.h"
 #include "loader.h"
 #include "procedural/mesh.h"
+#include "utils/mesh_optimiser.h"
 
-#include "kazbase/datetime.h"
 
 
 /** FIXME
@@ -46,24 +46,16 @@ bool ResourceManagerImpl::init() {
 }
 
 void ResourceManagerImpl::update() {
-    static datetime::DateTime last_collection = datetime::now();
+    /*
+     * Collect a few candidates from each manager every frame rather than
+     * everything every few seconds, so collection never shows up as a spike.
+     */
+    const uint32_t budget = GC_CANDIDATES_PER_FRAME;
 
-    if(datetime::timedelta_in_seconds(datetime::now() - last_collection) >= 5) {
-        //Garbage collect all the things
-        L_DEBUG("Collecting meshes");
-        MeshManager::garbage_collect();
-
-        L_DEBUG("Collecting materials");
-        MaterialManager::garbage_collect();
-
-        L_DEBUG("Collecting textures");
-        TextureManager::garbage_collect();
-
-        L_DEBUG("Collecting sounds");
-        SoundManager::garbage_collect();
-
-        last_collection = datetime::now();
-    }
+    MeshManager::garbage_collect(budget);
+    MaterialManager::garbage_collect(budget);
+    TextureManager::garbage_collect(budget);
+    SoundManager::garbage_collect(budget);
 }
 
 ProtectedPtr<Mesh> ResourceManagerImpl::mesh(MeshID m) {
@@ -79,10 +71,22 @@ MeshID ResourceManagerImpl::new_mesh(bool garbage_collect) {
     return result;
 }
 
-MeshID ResourceManagerImpl::new_mesh_from_file(const unicode& path, bool garbage_collect) {
+namespace {
+
+bool should_optimise(const LoaderOptions& options) {
+    auto it = options.find("optimise");
+    return it == options.end() || kazbase::any_cast<bool>(it->second);
+}
+
+}
+
+MeshID ResourceManagerImpl::new_mesh_from_file(const unicode& path, bool garbage_collect, const LoaderOptions& options) {
     //Load the material
     kglt::MeshID mesh_id = new_mesh(garbage_collect);
-    window().loader_for(path.encode())->into(mesh(mesh_id));
+    window().loader_for(path.encode())->into(mesh(mesh_id), options);
+    if(should_optimise(options)) {
+        MeshOptimiser(window().jobs).optimise(*mesh(mesh_id).__object);
+    }
     MeshManager::mark_as_uncollected(mesh_id);
     return mesh_id;
 }
@@ -97,14 +101,18 @@ MeshID ResourceManagerImpl::new_mesh_from_tmx_file(const unicode& tmx_file, cons
     return mesh_id;
 }
 
-MeshID ResourceManagerImpl::new_mesh_from_heightmap(const unicode& image_file, float spacing, float min_height, float max_height, const HeightmapDiffuseGenerator &generator, bool garbage_collect) {
+MeshID ResourceManagerImpl::new_mesh_from_heightmap(const unicode& image_file, float spacing, float min_height, float max_height, const HeightmapDiffuseGenerator &generator, bool garbage_collect, const LoaderOptions& options) {
+    LoaderOptions heightmap_options = options;
+    heightmap_options["spacing"] = spacing;
+    heightmap_options["min_height"] = min_height;
+    heightmap_options["max_height"] = max_height;
+    heightmap_options["diffuse_func"] = generator;
+
     kglt::MeshID mesh_id = new_mesh(garbage_collect);
-    window().loader_for("heightmap_loader", image_file)->into(mesh(mesh_id), {
-        { "spacing", spacing},
-        { "min_height", min_height},
-        { "max_height", max_height},
-        { "diffuse_func", generator}
-    });
+    window().loader_for("heightmap_loader", image_file)->into(mesh(mesh_id), heightmap_options);
+    if(should_optimise(options)) {
+        MeshOptimiser(window().jobs).optimise(*mesh(mesh_id).__object);
+    }
     MeshManager::mark_as_uncollected(mesh_id);
     return mesh_id;
 }
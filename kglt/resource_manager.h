@@ -11,14 +11,15 @@
 #include "mesh.h"
 #include "material.h"
 #include "sound.h"
+#include "loader.h"
 
 namespace kglt {
 
 class ResourceManagerImpl;
 
-typedef generic::RefCountedTemplatedManager<ResourceManagerImpl, Mesh, MeshID> MeshManager;
+typedef generic::RefCountedSlotMapManager<ResourceManagerImpl, Mesh, MeshID> MeshManager;
 typedef generic::RefCountedTemplatedManager<ResourceManagerImpl, Material, MaterialID> MaterialManager;
-typedef generic::RefCountedTemplatedManager<ResourceManagerImpl, Texture, TextureID> TextureManager;
+typedef generic::RefCountedSlotMapManager<ResourceManagerImpl, Texture, TextureID> TextureManager;
 typedef generic::RefCountedTemplatedManager<ResourceManagerImpl, Sound, SoundID> SoundManager;
 
 class ResourceManager {
@@ -27,13 +28,17 @@ public:
 
     //Mesh functions
     virtual MeshID new_mesh(bool garbage_collect=true) = 0;
-    virtual MeshID new_mesh_from_file(const unicode& path, bool garbage_collect=true) = 0;
+    /*
+     * Meshes loaded from files (and heightmaps) are run through the MeshOptimiser, unless the
+     * options have "optimise" set to false. The other options are passed on to the loader.
+     */
+    virtual MeshID new_mesh_from_file(const unicode& path, bool garbage_collect=true, const LoaderOptions& options=LoaderOptions()) = 0;
     virtual MeshID new_mesh_from_tmx_file(const unicode& tmx_file, const unicode& layer_name, float tile_render_size=1.0, bool garbage_collect=true) = 0;
 
     virtual MeshID new_mesh_from_heightmap(
         const unicode& image_file, float spacing=1.0, float min_height=-64,
         float max_height=64.0, const HeightmapDiffuseGenerator& generator=HeightmapDiffuseGenerator(),
-        bool garbage_collect=true
+        bool garbage_collect=true, const LoaderOptions& options=LoaderOptions()
     ) = 0;
 
     virtual MeshID new_mesh_as_cube(float width, bool garbage_collect=true) = 0;
@@ -134,12 +139,12 @@ public:
     bool init() override;
 
     MeshID new_mesh(bool garbage_collect=true) override;
-    MeshID new_mesh_from_file(const unicode& path, bool garbage_collect=true) override;
+    MeshID new_mesh_from_file(const unicode& path, bool garbage_collect=true, const LoaderOptions& options=LoaderOptions()) override;
     MeshID new_mesh_from_tmx_file(const unicode& tmx_file, const unicode& layer_name, float tile_render_size=1.0, bool garbage_collect=true) override;
     MeshID new_mesh_from_heightmap(
         const unicode& image_file, float spacing=1.0, float min_height=-64,
         float max_height=64.0, const HeightmapDiffuseGenerator& generator=HeightmapDiffuseGenerator(),
-        bool garbage_collect=true
+        bool garbage_collect=true, const LoaderOptions& options=LoaderOptions()
     ) override;
     MeshID new_mesh_as_cube(float width, bool garbage_collect=true) override;
     MeshID new_mesh_as_box(float width, float height, float depth, bool garbage_collect=true) override;
@@ -222,6 +227,9 @@ public:
     TextureID default_texture_id() const;
 
 private:
+    /* How many GC candidates each manager examines in update() */
+    static const uint32_t GC_CANDIDATES_PER_FRAME = 16;
+
     WindowBase* window_;
 
     MaterialID default_material_id_;
@@ -15,6 +15,14 @@ class SceneNode:
     public Printable,
     public Nameable {
 
+public:
+    /*
+     * Nodes which return true are updated concurrently with each other on the job system
+     * (see StageManager::update). Their update must only touch their own state. Creating or
+     * reparenting nodes must go through Stage::defer, and throws otherwise; deleting them is
+     * deferred by the Stage itself.
+     */
+    virtual bool is_parallel_update_safe() const { return false; }
 };
 
 }
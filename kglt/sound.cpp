@@ -124,6 +124,8 @@ void Source::play_sound(SoundID sound, bool loop) {
     new_source->start();
 
     instances_.push_back(new_source);
+
+    on_sound_played();
 }
 
 void Source::update_source(float dt) {
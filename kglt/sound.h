@@ -104,11 +104,15 @@ public:
 
     void play_sound(SoundID sound, bool loop=false);
     int32_t playing_sound_count() const;
+    bool has_sound_instances() const { return !instances_.empty(); }
 
     void update_source(float dt);
 
     sig::signal<void ()>& signal_stream_finished() { return signal_stream_finished_; }
 
+protected:
+    virtual void on_sound_played() {}
+
 private:
     Stage* stage_;
     WindowBase* window_;
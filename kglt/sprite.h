@@ -27,6 +27,7 @@ public:
     bool init() override;
     void cleanup() override;
     void update(double dt);
+    bool wants_update() const override { return true; } //Keeps its actor attached every step
 
     Sprite(Stage* stage, SpriteID id);
 
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "stage.h"
 #include "window_base.h"
 #include "partitioner.h"
@@ -7,10 +9,15 @@
 #include "debug.h"
 #include "sprite.h"
 #include "particles.h"
+#include "mesh.h"
 
 #include "loader.h"
 #include "partitioners/null_partitioner.h"
 #include "partitioners/octree_partitioner.h"
+#include "partitioners/bvh_partitioner.h"
+#include "partitioners/spatial_hash_partitioner.h"
+#include "partitioners/bsp_partitioner.h"
+#include "partitioners/portal_partitioner.h"
 #include "procedural/geom_factory.h"
 #include "utils/ownable.h"
 
@@ -19,6 +26,8 @@ namespace kglt {
 Stage::Stage(WindowBase *parent, StageID id, AvailablePartitioner partitioner):
     generic::Identifiable<StageID>(id),
     window_(*parent),
+    transform_store_(TransformStore::create()),
+    active_objects_(ActiveObjectList::create()),
     ambient_light_(1.0, 1.0, 1.0, 1.0),
     geom_factory_(new GeomFactory(*this)) {
 
@@ -51,6 +60,8 @@ ActorID Stage::new_actor() {
 }
 
 ActorID Stage::new_actor(bool make_responsive, bool make_collidable) {
+    check_not_updating_in_parallel("create an actor");
+
     ActorID result = ActorManager::manager_new();
     actor(result)->set_parent(this);
 
@@ -72,6 +83,8 @@ ActorID Stage::new_actor(MeshID mid) {
 }
 
 ActorID Stage::new_actor(MeshID mid, bool make_responsive, bool make_collidable) {
+    check_not_updating_in_parallel("create an actor");
+
     ActorID result = ActorManager::manager_new();
     actor(result)->set_parent(this);
 
@@ -131,6 +144,11 @@ const ProtectedPtr<Actor> Stage::actor(ActorID e) const {
 }
 
 void Stage::delete_actor(ActorID e) {
+    if(updating_in_parallel_) {
+        defer(std::bind(&Stage::delete_actor, this, e));
+        return;
+    }
+
     signal_actor_destroyed_(e);
 
     actor(e)->destroy_children();
@@ -141,6 +159,8 @@ void Stage::delete_actor(ActorID e) {
 //=============== PARTICLES =================
 
 ParticleSystemID Stage::new_particle_system() {
+    check_not_updating_in_parallel("create a particle system");
+
     ParticleSystemID new_id = ParticleSystemManager::manager_new();
 
     signal_particle_system_created_(new_id);
@@ -180,6 +200,11 @@ bool Stage::has_particle_system(ParticleSystemID pid) const {
 }
 
 void Stage::delete_particle_system(ParticleSystemID pid) {
+    if(updating_in_parallel_) {
+        defer(std::bind(&Stage::delete_particle_system, this, pid));
+        return;
+    }
+
     signal_particle_system_destroyed_(pid);
 
     particle_system(pid)->destroy_children();
@@ -190,6 +215,8 @@ void Stage::delete_particle_system(ParticleSystemID pid) {
 //=============== SPRITES ===================
 
 SpriteID Stage::new_sprite() {
+    check_not_updating_in_parallel("create a sprite");
+
     SpriteID s = SpriteManager::manager_new();
     sprite(s)->set_parent(this);
     signal_sprite_created_(s);
@@ -220,7 +247,12 @@ bool Stage::has_sprite(SpriteID s) const {
     return SpriteManager::manager_contains(s);
 }
 
-void Stage::delete_sprite(SpriteID s) {   
+void Stage::delete_sprite(SpriteID s) {
+    if(updating_in_parallel_) {
+        defer(std::bind(&Stage::delete_sprite, this, s));
+        return;
+    }
+
     sprite(s)->apply_recursively_leaf_first(&ownable_tree_node_destroy, false);
     sprite(s)->detach();
     SpriteManager::manager_delete(s);
@@ -234,6 +266,8 @@ uint32_t Stage::sprite_count() const {
 
 
 LightID Stage::new_light(LightType type) {
+    check_not_updating_in_parallel("create a light");
+
     LightID lid = LightManager::manager_new();
     light(lid)->set_type(type);
     light(lid)->set_parent(this);
@@ -242,6 +276,8 @@ LightID Stage::new_light(LightType type) {
 }
 
 LightID Stage::new_light(Object &parent, LightType type) {
+    check_not_updating_in_parallel("create a light");
+
     LightID lid = LightManager::manager_new();
 
     {
@@ -260,6 +296,11 @@ ProtectedPtr<Light> Stage::light(LightID light_id) {
 }
 
 void Stage::delete_light(LightID light_id) {
+    if(updating_in_parallel_) {
+        defer(std::bind(&Stage::delete_light, this, light_id));
+        return;
+    }
+
     signal_light_destroyed_(light_id);
     light(light_id)->destroy_children();
     LightManager::manager_delete(light_id);
@@ -294,6 +335,18 @@ void Stage::set_partitioner(AvailablePartitioner partitioner) {
         case PARTITIONER_OCTREE:
             partitioner_ = Partitioner::ptr(new OctreePartitioner(*this));
         break;
+        case PARTITIONER_BVH:
+            partitioner_ = Partitioner::ptr(new BVHPartitioner(*this));
+        break;
+        case PARTITIONER_SPATIAL_HASH:
+            partitioner_ = Partitioner::ptr(new SpatialHashPartitioner(*this));
+        break;
+        case PARTITIONER_BSP:
+            partitioner_ = Partitioner::ptr(new BSPPartitioner(*this));
+        break;
+        case PARTITIONER_PORTAL:
+            partitioner_ = Partitioner::ptr(new PortalPartitioner(*this));
+        break;
         default: {
             throw std::logic_error("Invalid partitioner type specified");
         }
@@ -317,4 +370,159 @@ void Stage::update(double dt) {
 
 }
 
+void Stage::set_update_policy(UpdatePolicy policy, uint32_t hidden_interval) {
+    update_policy_ = policy;
+    hidden_update_interval_ = std::max<uint32_t>(hidden_interval, 1);
+    skipped_steps_ = 0;
+    skipped_time_ = 0.0;
+}
+
+bool Stage::_consume_update_step(double dt, double& step) {
+    if(update_policy_ == UPDATE_POLICY_ALWAYS || is_being_rendered()) {
+        //Catch up on anything left over from being hidden
+        step = dt + skipped_time_;
+        skipped_steps_ = 0;
+        skipped_time_ = 0.0;
+        return true;
+    }
+
+    if(update_policy_ == UPDATE_POLICY_WHEN_RENDERED) {
+        return false;
+    }
+
+    skipped_time_ += dt;
+    if(++skipped_steps_ < hidden_update_interval_) {
+        return false;
+    }
+
+    step = skipped_time_;
+    skipped_steps_ = 0;
+    skipped_time_ = 0.0;
+    return true;
+}
+
+/*
+ * Brings the ray into an object's own space. The direction isn't normalized again afterwards, so
+ * that distances along the local ray are the same as along the original.
+ */
+static bool to_local_space(const Ray& ray, const Mat4& transformation, float length, Ray& out) {
+    Mat4 inverse;
+    if(!kmMat4Inverse(&inverse, &transformation)) {
+        return false;
+    }
+
+    Vec3 start, end = ray.start + ray.dir;
+    kmVec3Transform(&start, &ray.start, &inverse);
+    kmVec3Transform(&end, &end, &inverse);
+
+    out = Ray(start, end - start, length);
+    return true;
+}
+
+std::shared_ptr<const TriangleBVH> Stage::triangle_bvh_of(Renderable* renderable) {
+    //Only subactors have triangles to test, they instance their actor's mesh
+    MeshID mesh_id = renderable->instanced_mesh_id();
+    if(!mesh_id) {
+        return std::shared_ptr<const TriangleBVH>();
+    }
+
+    return mesh(mesh_id)->submesh(renderable->instanced_submesh_id()).triangle_bvh();
+}
+
+bool Stage::raycast(const Ray& ray, RaycastHit& nearest, TriangleHit* triangle) {
+    raycast_candidates_.clear();
+    partitioner_->raycast_all(ray, raycast_candidates_);
+
+    bool found = false;
+    float best = ray.length;
+
+    for(const RaycastHit& candidate: raycast_candidates_) {
+        if(candidate.distance > best) {
+            break; //The rest are further away still
+        }
+
+        std::shared_ptr<const TriangleBVH> bvh = triangle_bvh_of(candidate.renderable);
+        Ray local = ray;
+        if(!bvh || !to_local_space(ray, candidate.renderable->final_transformation(), best, local)) {
+            continue;
+        }
+
+        TriangleHit hit;
+        if(bvh->raycast(local, hit)) {
+            found = true;
+            best = hit.distance;
+
+            nearest.renderable = candidate.renderable;
+            nearest.distance = hit.distance;
+            if(triangle) {
+                *triangle = hit;
+            }
+        }
+    }
+
+    return found;
+}
+
+bool Stage::line_of_sight(const Vec3& from, const Vec3& to) {
+    Vec3 dir = to - from;
+    float length = dir.length();
+    if(length == 0.0f) {
+        return true;
+    }
+
+    Ray ray(from, dir / length, length);
+
+    raycast_candidates_.clear();
+    partitioner_->raycast_all(ray, raycast_candidates_);
+
+    for(const RaycastHit& candidate: raycast_candidates_) {
+        std::shared_ptr<const TriangleBVH> bvh = triangle_bvh_of(candidate.renderable);
+        Ray local = ray;
+        if(!bvh || !to_local_space(ray, candidate.renderable->final_transformation(), length, local)) {
+            continue;
+        }
+
+        if(bvh->intersects(local)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void Stage::defer(std::function<void ()> command) {
+    if(!updating_in_parallel_) {
+        command();
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(deferred_mutex_);
+    deferred_commands_.push_back(command);
+}
+
+void Stage::check_not_updating_in_parallel(const std::string& what) const {
+    if(updating_in_parallel_) {
+        throw std::logic_error("Tried to " + what + " during a parallel update, use Stage::defer");
+    }
+}
+
+void Stage::_begin_parallel_update() {
+    updating_in_parallel_ = true;
+}
+
+void Stage::_end_parallel_update() {
+    updating_in_parallel_ = false;
+
+    std::vector<std::function<void ()>> commands;
+    {
+        std::lock_guard<std::mutex> lock(deferred_mutex_);
+        std::swap(commands, deferred_commands_);
+    }
+
+    //Queued in no particular order, but each node's own commands run in the order it issued them
+    for(auto& command: commands) {
+        command();
+    }
+}
+
 }
@@ -2,6 +2,7 @@
 #define STAGE_H
 
 #include <functional>
+#include <mutex>
 
 #include "generic/managed.h"
 #include "generic/manager.h"
@@ -10,22 +11,22 @@
 #include "procedural/geom_factory.h"
 
 #include "object.h"
+#include "partitioner.h"
+#include "transform_store.h"
 #include "types.h"
 #include "resource_manager.h"
 #include "window_base.h"
 
 namespace kglt {
 
-class Partitioner;
-
 class Debug;
 class Sprite;
 
-typedef generic::TemplatedManager<Stage, Actor, ActorID> ActorManager;
-typedef generic::TemplatedManager<Stage, Light, LightID> LightManager;
+typedef generic::SlotMapManager<Stage, Actor, ActorID> ActorManager;
+typedef generic::SlotMapManager<Stage, Light, LightID> LightManager;
 typedef generic::TemplatedManager<Stage, CameraProxy, CameraID> CameraProxyManager;
-typedef generic::TemplatedManager<Stage, Sprite, SpriteID> SpriteManager;
-typedef generic::TemplatedManager<Stage, ParticleSystem, ParticleSystemID> ParticleSystemManager;
+typedef generic::SlotMapManager<Stage, Sprite, SpriteID> SpriteManager;
+typedef generic::SlotMapManager<Stage, ParticleSystem, ParticleSystemID> ParticleSystemManager;
 
 class Stage:
     public Managed<Stage>,
@@ -95,6 +96,16 @@ public:
     kglt::Colour ambient_light() const { return ambient_light_; }
     void set_ambient_light(const kglt::Colour& c) { ambient_light_ = c; }
 
+    /* hidden_interval is the number of steps between updates under UPDATE_POLICY_REDUCED_WHEN_HIDDEN */
+    void set_update_policy(UpdatePolicy policy, uint32_t hidden_interval=10);
+    UpdatePolicy update_policy() const { return update_policy_; }
+
+    /*
+     * Called by the StageManager each step. Returns false if the stage should be skipped, otherwise
+     * sets step to the time to update by, which includes any steps that were skipped.
+     */
+    bool _consume_update_step(double dt, double& step);
+
     sig::signal<void (ActorID)>& signal_actor_created() { return signal_actor_created_; }
     sig::signal<void (ActorID)>& signal_actor_destroyed() { return signal_actor_destroyed_; }
 
@@ -119,6 +130,16 @@ public:
 
     Partitioner& partitioner() { return *partitioner_; }
 
+    /*
+     * Finds the nearest triangle of any actor's mesh that the ray hits. The partitioner finds
+     * the subactors whose bounds the ray passes through, nearest first, and their submeshes'
+     * triangle BVHs are searched until nothing nearer is possible. Returns false if nothing is hit.
+     */
+    bool raycast(const Ray& ray, RaycastHit& nearest, TriangleHit* triangle=nullptr);
+
+    /* Returns true if no actor's triangles are in the way between from and to */
+    bool line_of_sight(const Vec3& from, const Vec3& to);
+
     void ask_owner_for_destruction();
 
     /*
@@ -131,8 +152,8 @@ public:
         return window().new_mesh(garbage_collect);
     }
 
-    virtual MeshID new_mesh_from_file(const unicode& path, bool garbage_collect=true) override {
-        return window().new_mesh_from_file(path, garbage_collect);
+    virtual MeshID new_mesh_from_file(const unicode& path, bool garbage_collect=true, const LoaderOptions& options=LoaderOptions()) override {
+        return window().new_mesh_from_file(path, garbage_collect, options);
     }
 
     MeshID new_mesh_from_tmx_file(const unicode& tmx_file, const unicode& layer_name, float tile_render_size=1.0, bool garbage_collect=true) override {
@@ -141,8 +162,9 @@ public:
 
     MeshID new_mesh_from_heightmap(
         const unicode& image_file, float spacing=1.0, float min_height=-64,
-        float max_height=64.0, const HeightmapDiffuseGenerator& generator=HeightmapDiffuseGenerator(), bool garbage_collect=true) override {
-        return window().new_mesh_from_heightmap(image_file, spacing, min_height, max_height, generator, garbage_collect);
+        float max_height=64.0, const HeightmapDiffuseGenerator& generator=HeightmapDiffuseGenerator(), bool garbage_collect=true,
+        const LoaderOptions& options=LoaderOptions()) override {
+        return window().new_mesh_from_heightmap(image_file, spacing, min_height, max_height, generator, garbage_collect, options);
     }
 
     virtual MeshID new_mesh_as_cube(float width, bool garbage_collect=true) {
@@ -333,9 +355,42 @@ public:
     // RenderableStage
     void on_render_started() {}
     void on_render_stopped() {}
+
+    TransformStore::ptr transform_store() { return transform_store_; }
+    ActiveObjectList::ptr active_objects() { return active_objects_; }
+
+    /* Resolves the absolute transformations of every object in the stage */
+    void update_transforms() { transform_store_->update(); }
+
+    /* Runs the command now, or once the parallel update phase has finished if one is in progress */
+    void defer(std::function<void ()> command);
+
+    /*
+     * True while parallel-safe nodes are being updated on the job system. Deleting a node in the
+     * meantime is deferred automatically. Creating or reparenting one throws, as the caller would
+     * need the result straight away, so those must be wrapped in defer().
+     */
+    bool is_updating_in_parallel() const { return updating_in_parallel_; }
+
+    void _begin_parallel_update();
+    void _end_parallel_update();
 private:
     WindowBase& window_;
 
+    //Shared with the objects so it outlives whichever of them is destroyed last
+    TransformStore::ptr transform_store_;
+    ActiveObjectList::ptr active_objects_;
+
+    UpdatePolicy update_policy_ = UPDATE_POLICY_ALWAYS;
+    uint32_t hidden_update_interval_ = 10;
+    uint32_t skipped_steps_ = 0;
+    double skipped_time_ = 0.0;
+
+    bool updating_in_parallel_ = false;
+    void check_not_updating_in_parallel(const std::string& what) const;
+    std::mutex deferred_mutex_;
+    std::vector<std::function<void ()>> deferred_commands_;
+
     kglt::Colour ambient_light_;
 
     sig::signal<void (ActorID)> signal_actor_created_;
@@ -352,6 +407,10 @@ private:
 
     std::shared_ptr<Partitioner> partitioner_;
 
+    //Kept between raycasts so they don't allocate each time
+    RaycastHitList raycast_candidates_;
+    std::shared_ptr<const TriangleBVH> triangle_bvh_of(Renderable* renderable);
+
     void set_partitioner(AvailablePartitioner partitioner);
 
     std::shared_ptr<GeomFactory> geom_factory_;
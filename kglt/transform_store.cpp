@@ -0,0 +1,311 @@
+#include <algorithm>
+
+#include "transform_store.h"
+#include "object.h"
+
+namespace kglt {
+
+namespace {
+
+template<typename T>
+void permute(std::vector<T>& values, const std::vector<uint32_t>& order) {
+    std::vector<T> result;
+    result.reserve(values.size());
+    for(uint32_t slot: order) {
+        result.push_back(values[slot]);
+    }
+    values.swap(result);
+}
+
+}
+
+TransformStore::TransformStore():
+    order_dirty_(false) {
+
+}
+
+TransformHandle TransformStore::new_transform(Object* owner) {
+    TransformHandle handle;
+    if(!free_handles_.empty()) {
+        handle = free_handles_.back();
+        free_handles_.pop_back();
+    } else {
+        handle = slot_of_.size();
+        slot_of_.push_back(0);
+    }
+
+    slot_of_[handle] = handle_of_.size();
+
+    Mat4 identity;
+    kmMat4Identity(&identity);
+
+    handle_of_.push_back(handle);
+    parent_.push_back(INVALID_TRANSFORM);
+    owner_.push_back(owner);
+    relative_position_.push_back(Vec3());
+    relative_rotation_.push_back(Quaternion());
+    flags_.push_back(FLAG_DIRTY);
+    absolute_position_.push_back(Vec3());
+    absolute_rotation_.push_back(Quaternion());
+    absolute_transformation_.push_back(identity);
+    version_.push_back(0);
+    notified_version_.push_back(0);
+
+    return handle;
+}
+
+void TransformStore::move_slot(uint32_t from, uint32_t to) {
+    handle_of_[to] = handle_of_[from];
+    parent_[to] = parent_[from];
+    owner_[to] = owner_[from];
+    relative_position_[to] = relative_position_[from];
+    relative_rotation_[to] = relative_rotation_[from];
+    flags_[to] = flags_[from];
+    absolute_position_[to] = absolute_position_[from];
+    absolute_rotation_[to] = absolute_rotation_[from];
+    absolute_transformation_[to] = absolute_transformation_[from];
+    version_[to] = version_[from];
+    notified_version_[to] = notified_version_[from];
+
+    slot_of_[handle_of_[to]] = to;
+}
+
+void TransformStore::delete_transform(TransformHandle handle) {
+    uint32_t slot = slot_of_[handle];
+    uint32_t last = handle_of_.size() - 1;
+
+    if(slot != last) {
+        //Fill the hole with the last slot. That can't have had any children (they'd come after
+        //it) but it might now come before its parent
+        move_slot(last, slot);
+
+        TransformHandle parent = parent_[slot];
+        if(parent != INVALID_TRANSFORM && slot_of_[parent] > slot) {
+            order_dirty_ = true;
+        }
+    }
+
+    handle_of_.pop_back();
+    parent_.pop_back();
+    owner_.pop_back();
+    relative_position_.pop_back();
+    relative_rotation_.pop_back();
+    flags_.pop_back();
+    absolute_position_.pop_back();
+    absolute_rotation_.pop_back();
+    absolute_transformation_.pop_back();
+    version_.pop_back();
+    notified_version_.pop_back();
+
+    free_handles_.push_back(handle);
+}
+
+void TransformStore::set_parent(TransformHandle handle, TransformHandle parent) {
+    uint32_t slot = slot_of_[handle];
+    parent_[slot] = parent;
+
+    if(parent != INVALID_TRANSFORM && slot_of_[parent] > slot) {
+        order_dirty_ = true;
+    }
+}
+
+void TransformStore::set_relative_position(TransformHandle handle, const Vec3& position) {
+    uint32_t slot = slot_of_[handle];
+    relative_position_[slot] = position;
+}
+
+void TransformStore::set_relative_rotation(TransformHandle handle, const Quaternion& rotation) {
+    uint32_t slot = slot_of_[handle];
+    relative_rotation_[slot] = rotation;
+}
+
+void TransformStore::set_position_locked(TransformHandle handle, bool value) {
+    uint32_t slot = slot_of_[handle];
+    if(value) {
+        flags_[slot] |= FLAG_POSITION_LOCKED;
+    } else {
+        flags_[slot] &= ~FLAG_POSITION_LOCKED;
+    }
+}
+
+void TransformStore::set_rotation_locked(TransformHandle handle, bool value) {
+    uint32_t slot = slot_of_[handle];
+    if(value) {
+        flags_[slot] |= FLAG_ROTATION_LOCKED;
+    } else {
+        flags_[slot] &= ~FLAG_ROTATION_LOCKED;
+    }
+}
+
+const Vec3& TransformStore::absolute_position(TransformHandle handle) const {
+    uint32_t slot = slot_of_[handle];
+    resolve(slot);
+    return absolute_position_[slot];
+}
+
+const Quaternion& TransformStore::absolute_rotation(TransformHandle handle) const {
+    uint32_t slot = slot_of_[handle];
+    resolve(slot);
+    return absolute_rotation_[slot];
+}
+
+const Mat4& TransformStore::absolute_transformation(TransformHandle handle) const {
+    uint32_t slot = slot_of_[handle];
+    resolve(slot);
+    return absolute_transformation_[slot];
+}
+
+uint64_t TransformStore::version(TransformHandle handle) const {
+    uint32_t slot = slot_of_[handle];
+    resolve(slot);
+    return version_[slot];
+}
+
+void TransformStore::resolve(uint32_t slot) const {
+    if(!(flags_[slot] & FLAG_DIRTY)) {
+        return;
+    }
+
+    TransformHandle parent = parent_[slot];
+    if(parent == INVALID_TRANSFORM) {
+        calculate(slot, Vec3(), Quaternion());
+    } else {
+        uint32_t parent_slot = slot_of_[parent];
+        resolve(parent_slot);
+        calculate(slot, absolute_position_[parent_slot], absolute_rotation_[parent_slot]);
+    }
+}
+
+void TransformStore::calculate(uint32_t slot, const Vec3& parent_position, const Quaternion& parent_rotation) const {
+    Vec3 orig_pos = absolute_position_[slot];
+    Quaternion orig_rot = absolute_rotation_[slot];
+
+    uint8_t flags = flags_[slot];
+
+    if(!(flags & FLAG_POSITION_LOCKED)) {
+        absolute_position_[slot] = parent_position + relative_position_[slot];
+    }
+
+    if(!(flags & FLAG_ROTATION_LOCKED)) {
+        absolute_rotation_[slot] = relative_rotation_[slot] * parent_rotation;
+        absolute_rotation_[slot].normalize();
+    }
+
+    flags_[slot] = flags & ~FLAG_DIRTY;
+
+    if(version_[slot] && orig_pos == absolute_position_[slot] && orig_rot == absolute_rotation_[slot]) {
+        return;
+    }
+
+    //Rotation then translation, without the cost of a full matrix multiply
+    Mat4& transform = absolute_transformation_[slot];
+    kmMat4RotationQuaternion(&transform, &absolute_rotation_[slot]);
+    transform.mat[12] = absolute_position_[slot].x;
+    transform.mat[13] = absolute_position_[slot].y;
+    transform.mat[14] = absolute_position_[slot].z;
+
+    ++version_[slot];
+}
+
+void TransformStore::sort_by_depth() {
+    uint32_t count = handle_of_.size();
+
+    const uint32_t UNKNOWN = ~0u;
+    std::vector<uint32_t> depth(count, UNKNOWN);
+    std::vector<uint32_t> chain;
+
+    uint32_t max_depth = 0;
+    for(uint32_t i = 0; i < count; ++i) {
+        //Walk up until we hit something with a known depth, then fill in on the way back
+        uint32_t slot = i;
+        while(depth[slot] == UNKNOWN) {
+            chain.push_back(slot);
+            TransformHandle parent = parent_[slot];
+            if(parent == INVALID_TRANSFORM) {
+                break;
+            }
+            slot = slot_of_[parent];
+        }
+
+        uint32_t current = (depth[slot] == UNKNOWN) ? 0 : depth[slot] + 1;
+        while(!chain.empty()) {
+            if(depth[chain.back()] == UNKNOWN) {
+                depth[chain.back()] = current++;
+            }
+            chain.pop_back();
+        }
+
+        max_depth = std::max(max_depth, depth[i]);
+    }
+
+    //Counting sort, stable so siblings stay in the same relative order
+    std::vector<uint32_t> offsets(max_depth + 2, 0);
+    for(uint32_t d: depth) {
+        ++offsets[d + 1];
+    }
+
+    for(uint32_t i = 1; i < offsets.size(); ++i) {
+        offsets[i] += offsets[i - 1];
+    }
+
+    std::vector<uint32_t> order(count);
+    for(uint32_t i = 0; i < count; ++i) {
+        order[offsets[depth[i]]++] = i;
+    }
+
+    permute(handle_of_, order);
+    permute(parent_, order);
+    permute(owner_, order);
+    permute(relative_position_, order);
+    permute(relative_rotation_, order);
+    permute(flags_, order);
+    permute(absolute_position_, order);
+    permute(absolute_rotation_, order);
+    permute(absolute_transformation_, order);
+    permute(version_, order);
+    permute(notified_version_, order);
+
+    for(uint32_t i = 0; i < count; ++i) {
+        slot_of_[handle_of_[i]] = i;
+    }
+
+    order_dirty_ = false;
+}
+
+void TransformStore::update() {
+    if(order_dirty_) {
+        sort_by_depth();
+    }
+
+    uint32_t count = handle_of_.size();
+
+    //Parents always come first, so by the time we reach a slot its parent is up to date
+    for(uint32_t i = 0; i < count; ++i) {
+        if(!(flags_[i] & FLAG_DIRTY)) {
+            continue;
+        }
+
+        TransformHandle parent = parent_[i];
+        if(parent == INVALID_TRANSFORM) {
+            calculate(i, Vec3(), Quaternion());
+        } else {
+            uint32_t parent_slot = slot_of_[parent];
+            calculate(i, absolute_position_[parent_slot], absolute_rotation_[parent_slot]);
+        }
+    }
+
+    //Notify separately, the callbacks are free to move things around
+    changed_.clear();
+    for(uint32_t i = 0; i < count; ++i) {
+        if(version_[i] != notified_version_[i]) {
+            notified_version_[i] = version_[i];
+            changed_.push_back(owner_[i]);
+        }
+    }
+
+    for(Object* object: changed_) {
+        object->transformation_changed();
+    }
+}
+
+}
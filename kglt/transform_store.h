@@ -0,0 +1,107 @@
+#ifndef TRANSFORM_STORE_H
+#define TRANSFORM_STORE_H
+
+#include <cstdint>
+#include <vector>
+#include <memory>
+
+#include "generic/managed.h"
+#include "types.h"
+
+namespace kglt {
+
+class Object;
+
+typedef uint32_t TransformHandle;
+const TransformHandle INVALID_TRANSFORM = ~0u;
+
+/*
+ *  Holds the transformations of all the objects in a Stage as parallel arrays, so that
+ *  propagating them down the hierarchy is a linear sweep rather than a walk of the scene tree.
+ *
+ *  Handles are stable, but the slots they refer to are not. Slots are kept ordered so that
+ *  parents always come before their children; when reparenting or deletion breaks that the
+ *  arrays are re-sorted by depth before the next sweep.
+ *
+ *  Absolute transformations are resolved lazily when read, and all at once by update(). The
+ *  setters don't mark anything dirty; that's up to the owner (see Object::mark_transform_dirty)
+ *  which knows the hierarchy and can stop at branches which are already dirty.
+ */
+class TransformStore:
+    public Managed<TransformStore> {
+
+public:
+    TransformStore();
+
+    TransformHandle new_transform(Object* owner);
+    void delete_transform(TransformHandle handle);
+
+    void set_parent(TransformHandle handle, TransformHandle parent);
+    TransformHandle parent(TransformHandle handle) const { return parent_[slot_of_[handle]]; }
+
+    const Vec3& relative_position(TransformHandle handle) const { return relative_position_[slot_of_[handle]]; }
+    const Quaternion& relative_rotation(TransformHandle handle) const { return relative_rotation_[slot_of_[handle]]; }
+
+    void set_relative_position(TransformHandle handle, const Vec3& position);
+    void set_relative_rotation(TransformHandle handle, const Quaternion& rotation);
+
+    const Vec3& absolute_position(TransformHandle handle) const;
+    const Quaternion& absolute_rotation(TransformHandle handle) const;
+    const Mat4& absolute_transformation(TransformHandle handle) const;
+    uint64_t version(TransformHandle handle) const;
+
+    void set_position_locked(TransformHandle handle, bool value);
+    void set_rotation_locked(TransformHandle handle, bool value);
+    bool position_locked(TransformHandle handle) const { return flags_[slot_of_[handle]] & FLAG_POSITION_LOCKED; }
+    bool rotation_locked(TransformHandle handle) const { return flags_[slot_of_[handle]] & FLAG_ROTATION_LOCKED; }
+
+    bool is_dirty(TransformHandle handle) const { return flags_[slot_of_[handle]] & FLAG_DIRTY; }
+    void mark_dirty(TransformHandle handle) { flags_[slot_of_[handle]] |= FLAG_DIRTY; }
+
+    /*
+     * Resolves every dirty transformation in a single pass, parents first, then tells
+     * the owners of any which changed since the last update.
+     */
+    void update();
+
+    uint32_t size() const { return handle_of_.size(); }
+
+private:
+    enum Flags {
+        FLAG_DIRTY = 1,
+        FLAG_POSITION_LOCKED = 2,
+        FLAG_ROTATION_LOCKED = 4
+    };
+
+    std::vector<uint32_t> slot_of_; //Indexed by handle
+    std::vector<TransformHandle> free_handles_;
+
+    //Everything below is indexed by slot
+    std::vector<TransformHandle> handle_of_;
+    std::vector<TransformHandle> parent_;
+    std::vector<Object*> owner_;
+
+    std::vector<Vec3> relative_position_;
+    std::vector<Quaternion> relative_rotation_;
+
+    mutable std::vector<uint8_t> flags_;
+    mutable std::vector<Vec3> absolute_position_;
+    mutable std::vector<Quaternion> absolute_rotation_;
+    mutable std::vector<Mat4> absolute_transformation_;
+    mutable std::vector<uint64_t> version_;
+    std::vector<uint64_t> notified_version_;
+
+    //The owners to notify at the end of update(), kept so that it doesn't allocate each frame
+    std::vector<Object*> changed_;
+
+    bool order_dirty_;
+
+    void resolve(uint32_t slot) const;
+    void calculate(uint32_t slot, const Vec3& parent_position, const Quaternion& parent_rotation) const;
+    void sort_by_depth();
+    void move_slot(uint32_t from, uint32_t to);
+};
+
+}
+
+#endif // TRANSFORM_STORE_H
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <kazbase/random.h>
 #include "types.h"
 
@@ -30,11 +31,15 @@ kglt::Vec3 operator/(float lhs, const kglt::Vec3& rhs) {
 }
 
 Vec3 Vec3::random_deviant(const Degrees& angle, const Vec3 up) const {
+    return deviant(angle, random_gen::random_float(0, 1), up);
+}
+
+Vec3 Vec3::deviant(const Degrees& angle, float turn, const Vec3 up) const {
     //Lovingly adapted from ogre
     Vec3 new_up = (up == Vec3()) ? perpendicular() : up;
 
     Quaternion q;
-    kmQuaternionRotationAxisAngle(&q, this, random_gen::random_float(0, 1) * (PI * 2.0));
+    kmQuaternionRotationAxisAngle(&q, this, turn * (PI * 2.0));
     kmQuaternionMultiplyVec3(&new_up, &q, &new_up);
     kmQuaternionRotationAxisAngle(&q, &new_up, Radians(angle).value_);
 
@@ -56,6 +61,43 @@ Vec3 Vec3::perpendicular() const {
     return perp.normalized();
 }
 
+bool Ray::intersects(const AABB& box, float& distance) const {
+    //Slab test, narrowing down the part of the ray inside the box one axis at a time
+    float enter = 0.0f;
+    float leave = length;
+
+    for(int axis = 0; axis < 3; ++axis) {
+        float s = (&start.x)[axis];
+        float d = (&dir.x)[axis];
+        float lo = (&box.min.x)[axis];
+        float hi = (&box.max.x)[axis];
+
+        if(d == 0.0f) {
+            //Parallel to the slab, so either always between its planes or never
+            if(s < lo || s > hi) {
+                return false;
+            }
+            continue;
+        }
+
+        float t1 = (lo - s) / d;
+        float t2 = (hi - s) / d;
+        if(t1 > t2) {
+            std::swap(t1, t2);
+        }
+
+        enter = std::max(enter, t1);
+        leave = std::min(leave, t2);
+
+        if(enter > leave) {
+            return false;
+        }
+    }
+
+    distance = enter;
+    return true;
+}
+
 kglt::Vec3 operator-(const kglt::Vec3& vec) {
     return kglt::Vec3(-vec.x, -vec.y, -vec.z);
 }
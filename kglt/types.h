@@ -1,7 +1,9 @@
 #ifndef TYPES_H_INCLUDED
 #define TYPES_H_INCLUDED
 
+#include <algorithm>
 #include <iostream>
+#include <limits>
 #include <memory>
 
 #include <lua.hpp>
@@ -24,6 +26,7 @@
 #include "generic/auto_weakptr.h"
 #include "generic/unique_id.h"
 #include "generic/manager_lookup_ptr.h"
+#include "generic/linear_arena.h"
 #include "kazbase/unicode.h"
 
 namespace kglt {
@@ -368,6 +371,9 @@ struct Vec3 : public kmVec3 {
 
     Vec3 perpendicular() const;
     Vec3 random_deviant(const Degrees& angle, const Vec3 up=Vec3()) const;
+
+    /* As random_deviant, but turned about this vector by the given fraction of a full turn */
+    Vec3 deviant(const Degrees& angle, float turn, const Vec3 up=Vec3()) const;
 };
 
 
@@ -392,6 +398,32 @@ struct AABB : public kmAABB3 {
     bool intersects(const AABB& other) const {
         return kmAABB3IntersectsAABB(this, &other);
     }
+
+    /* The squared distance from point to the nearest part of the box, zero if it's inside */
+    float distance_squared(const kmVec3& point) const {
+        float dx = std::max(std::max(min.x - point.x, 0.0f), point.x - max.x);
+        float dy = std::max(std::max(min.y - point.y, 0.0f), point.y - max.y);
+        float dz = std::max(std::max(min.z - point.z, 0.0f), point.z - max.z);
+        return dx * dx + dy * dy + dz * dz;
+    }
+};
+
+/* A ray from start along dir (which should be normalized) for length units, or forever */
+struct Ray {
+    Ray(const Vec3& start, const Vec3& dir, float length=std::numeric_limits<float>::infinity()):
+        start(start),
+        dir(dir),
+        length(length) {}
+
+    Vec3 start;
+    Vec3 dir;
+    float length;
+
+    /*
+     * Returns true if the ray hits the box within its length, and sets distance to how far along
+     * the ray it enters the box (zero if it starts inside)
+     */
+    bool intersects(const AABB& box, float& distance) const;
 };
 
 std::ostream& operator<<(std::ostream& stream, const Vec2& vec);
@@ -464,7 +496,17 @@ enum VertexAttribute {
 
 enum AvailablePartitioner {
     PARTITIONER_NULL,
-    PARTITIONER_OCTREE
+    PARTITIONER_OCTREE,
+    PARTITIONER_BVH,
+    PARTITIONER_SPATIAL_HASH, ///< A 2D grid on the XY plane, for sprites and tile maps
+    PARTITIONER_BSP, ///< Culls by a loaded BSP level's potentially visible sets
+    PARTITIONER_PORTAL ///< Culls by hand authored zones and the portals between them
+};
+
+enum UpdatePolicy {
+    UPDATE_POLICY_ALWAYS,
+    UPDATE_POLICY_WHEN_RENDERED, ///< Frozen while no pipeline is rendering the stage
+    UPDATE_POLICY_REDUCED_WHEN_HIDDEN ///< Updated every few steps (with the time since the last) while hidden
 };
 
 enum LightType {
@@ -566,6 +608,8 @@ typedef UniqueID<14> ParticleSystemID;
 
 const StageID DefaultStageID = StageID();
 
+typedef generic::ArenaVector<LightID> LightList;
+
 const std::string DEFAULT_MATERIAL_SCHEME = "default";
 
 typedef uint16_t SubMeshIndex;
@@ -27,7 +27,7 @@ void end_of_frame_check();
 
 template<typename Res, typename Func, typename... Args>
 struct Checker {
-    static Res run(const std::string& function_name, Func&& func, Args&&... args) {
+    static Res run(const char* function_name, Func&& func, Args&&... args) {
         Res result = func(std::forward<Args>(args)...);
         if(USE_GL_GET_ERROR) {
             check_and_log_error(function_name);
@@ -38,7 +38,7 @@ struct Checker {
 
 template<typename Func, typename... Args>
 struct Checker<void, Func, Args...> {
-    static void run(const std::string& function_name, Func&& func, Args&&... args) {
+    static void run(const char* function_name, Func&& func, Args&&... args) {
         func(std::forward<Args>(args)...);
         if(USE_GL_GET_ERROR) {
             check_and_log_error(function_name);
@@ -48,7 +48,7 @@ struct Checker<void, Func, Args...> {
 
 template<typename Func>
 struct Checker<void, Func> {
-    static void run(const std::string& function_name, Func&& func) {
+    static void run(const char* function_name, Func&& func) {
         func();
         if(USE_GL_GET_ERROR) {
             check_and_log_error(function_name);
@@ -58,8 +58,12 @@ struct Checker<void, Func> {
 
 }
 
+/*
+ * The function name is only turned into a string if there's an error to report, GL calls are made
+ * every frame and shouldn't allocate
+ */
 template<typename Res=void, typename Func, typename... Args>
-Res _GLCheck(const std::string& function_name, Func&& func, Args&&... args) {
+Res _GLCheck(const char* function_name, Func&& func, Args&&... args) {
     GLThreadCheck::check();
     return GLChecker::Checker<Res, Func, Args...>::run(function_name, std::forward<Func>(func), std::forward<Args>(args)...);
 }
@@ -0,0 +1,427 @@
+#include <deque>
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+#include <limits>
+
+#include <kazbase/logging.h>
+#include <kazbase/unicode.h>
+
+#include "mesh_optimiser.h"
+#include "../mesh.h"
+#include "../job_system.h"
+
+namespace kglt {
+
+namespace {
+
+struct VertexBytesHash {
+    const uint8_t* data;
+    uint32_t stride;
+
+    std::size_t operator()(uint32_t vertex) const {
+        //FNV-1a over the packed vertex
+        const uint8_t* bytes = data + (vertex * stride);
+        uint64_t hash = 14695981039346656037ULL;
+        for(uint32_t i = 0; i < stride; ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+};
+
+struct VertexBytesEqual {
+    const uint8_t* data;
+    uint32_t stride;
+
+    bool operator()(uint32_t lhs, uint32_t rhs) const {
+        return std::memcmp(data + (lhs * stride), data + (rhs * stride), stride) == 0;
+    }
+};
+
+/* Everything one worker needs to optimise one vertex buffer and the index buffers which use it */
+struct OptimisationTask {
+    VertexData* vertex_data = nullptr;
+    std::vector<SubMeshIndex> submeshes;
+    std::vector<std::vector<uint32_t>> indices;
+    std::vector<bool> is_triangle_list;
+
+    //Results
+    std::vector<uint32_t> new_to_old;
+    uint32_t triangle_count = 0;
+    float misses_before = 0;
+    float misses_after = 0;
+};
+
+std::vector<uint32_t> weld_vertices(const VertexData& data, std::vector<uint32_t>& old_to_new) {
+    VertexBytesHash hasher{data._raw_data(), data.stride()};
+    VertexBytesEqual equal{data._raw_data(), data.stride()};
+
+    std::unordered_map<uint32_t, uint32_t, VertexBytesHash, VertexBytesEqual> unique(data.count(), hasher, equal);
+    std::vector<uint32_t> new_to_old;
+
+    old_to_new.resize(data.count());
+    for(uint32_t i = 0; i < data.count(); ++i) {
+        auto it = unique.find(i);
+        if(it == unique.end()) {
+            it = unique.insert(std::make_pair(i, (uint32_t) new_to_old.size())).first;
+            new_to_old.push_back(i);
+        }
+        old_to_new[i] = it->second;
+    }
+
+    return new_to_old;
+}
+
+std::vector<uint32_t> reorder_for_overdraw(
+    const std::vector<uint32_t>& indices,
+    const std::vector<uint32_t>& cluster_starts,
+    const std::vector<kglt::Vec3>& positions) {
+
+    uint32_t triangle_count = indices.size() / 3;
+
+    kglt::Vec3 mesh_centre;
+    for(auto& p: positions) {
+        mesh_centre += p;
+    }
+    if(!positions.empty()) {
+        mesh_centre /= float(positions.size());
+    }
+
+    struct Cluster {
+        uint32_t start;
+        uint32_t end;
+        float sort_value;
+    };
+
+    std::vector<Cluster> clusters;
+    for(uint32_t i = 0; i < cluster_starts.size(); ++i) {
+        Cluster c;
+        c.start = cluster_starts[i];
+        c.end = (i + 1 < cluster_starts.size()) ? cluster_starts[i + 1] : triangle_count;
+
+        kglt::Vec3 centre, normal;
+        float total_area = 0;
+        for(uint32_t t = c.start; t < c.end; ++t) {
+            const kglt::Vec3& v1 = positions[indices[t * 3]];
+            const kglt::Vec3& v2 = positions[indices[t * 3 + 1]];
+            const kglt::Vec3& v3 = positions[indices[t * 3 + 2]];
+
+            kglt::Vec3 face_normal = (v2 - v1).cross(v3 - v1);
+            float area = face_normal.length();
+
+            centre += (v1 + v2 + v3) * (area / 3.0f);
+            normal += face_normal;
+            total_area += area;
+        }
+
+        if(total_area > 0) {
+            centre /= total_area;
+        }
+
+        //Clusters facing away from the centre of the mesh are likely to occlude the others, so draw them first
+        c.sort_value = (normal.length() > 0) ? (centre - mesh_centre).dot(normal.normalized()) : 0.0f;
+        clusters.push_back(c);
+    }
+
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& lhs, const Cluster& rhs) {
+        return lhs.sort_value > rhs.sort_value;
+    });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for(auto& c: clusters) {
+        result.insert(result.end(), indices.begin() + c.start * 3, indices.begin() + c.end * 3);
+    }
+    return result;
+}
+
+void run_task(OptimisationTask& task, uint32_t cache_size, float overdraw_threshold) {
+    const VertexData& data = *task.vertex_data;
+
+    std::vector<uint32_t> old_to_new;
+    std::vector<uint32_t> welded = weld_vertices(data, old_to_new);
+
+    std::vector<kglt::Vec3> positions;
+    positions.reserve(welded.size());
+    for(uint32_t old: welded) {
+        positions.push_back(data.position_at(old));
+    }
+
+    for(uint32_t i = 0; i < task.indices.size(); ++i) {
+        auto& indices = task.indices[i];
+
+        for(auto& idx: indices) {
+            idx = old_to_new.at(idx);
+        }
+
+        if(!task.is_triangle_list[i] || indices.size() % 3 != 0) {
+            continue;
+        }
+
+        float triangles = float(indices.size() / 3);
+        task.triangle_count += indices.size() / 3;
+        task.misses_before += calculate_acmr(indices, cache_size) * triangles;
+
+        std::vector<uint32_t> cluster_starts;
+        std::vector<uint32_t> optimised = tipsify(indices, welded.size(), cache_size, &cluster_starts);
+        float optimised_acmr = calculate_acmr(optimised, cache_size);
+
+        std::vector<uint32_t> sorted = reorder_for_overdraw(optimised, cluster_starts, positions);
+        float sorted_acmr = calculate_acmr(sorted, cache_size);
+
+        if(sorted_acmr <= optimised_acmr * overdraw_threshold) {
+            indices.swap(sorted);
+            task.misses_after += sorted_acmr * triangles;
+        } else {
+            indices.swap(optimised);
+            task.misses_after += optimised_acmr * triangles;
+        }
+    }
+
+    //Finally, number the vertices in the order they are first used so fetching is linear
+    const uint32_t UNUSED = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> fetch_remap(welded.size(), UNUSED);
+    uint32_t next = 0;
+    for(auto& indices: task.indices) {
+        for(auto& idx: indices) {
+            if(fetch_remap[idx] == UNUSED) {
+                fetch_remap[idx] = next++;
+            }
+            idx = fetch_remap[idx];
+        }
+    }
+
+    //Keep unreferenced vertices at the end, something might still be using them
+    for(auto& idx: fetch_remap) {
+        if(idx == UNUSED) {
+            idx = next++;
+        }
+    }
+
+    task.new_to_old.resize(welded.size());
+    for(uint32_t i = 0; i < welded.size(); ++i) {
+        task.new_to_old[fetch_remap[i]] = welded[i];
+    }
+}
+
+}
+
+float calculate_acmr(const std::vector<uint32_t>& indices, uint32_t cache_size) {
+    if(indices.size() < 3) {
+        return 0.0;
+    }
+
+    std::deque<uint32_t> cache;
+    uint32_t misses = 0;
+
+    for(uint32_t idx: indices) {
+        if(std::find(cache.begin(), cache.end(), idx) == cache.end()) {
+            ++misses;
+            cache.push_back(idx);
+            if(cache.size() > cache_size) {
+                cache.pop_front();
+            }
+        }
+    }
+
+    return float(misses) / float(indices.size() / 3);
+}
+
+/*
+ * Tipsify: Sander, Nehab and Barczak - "Fast Triangle Reordering for Vertex Locality
+ * and Reduced Overdraw". Fans around vertices which are still in the cache, falling
+ * back to recently used (then any) vertices with live triangles. Each time we have to
+ * fall back we record the start of a new cluster for the overdraw pass.
+ */
+std::vector<uint32_t> tipsify(
+    const std::vector<uint32_t>& indices, uint32_t vertex_count, uint32_t cache_size,
+    std::vector<uint32_t>* cluster_starts) {
+
+    uint32_t triangle_count = indices.size() / 3;
+
+    //Build the vertex -> triangle adjacency
+    std::vector<uint32_t> live(vertex_count, 0);
+    for(uint32_t idx: indices) {
+        live[idx]++;
+    }
+
+    std::vector<uint32_t> offsets(vertex_count + 1, 0);
+    for(uint32_t i = 0; i < vertex_count; ++i) {
+        offsets[i + 1] = offsets[i] + live[i];
+    }
+
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for(uint32_t i = 0; i < indices.size(); ++i) {
+        adjacency[fill[indices[i]]++] = i / 3;
+    }
+
+    std::vector<uint32_t> cache_time(vertex_count, 0);
+    std::vector<bool> emitted(triangle_count, false);
+    std::vector<uint32_t> dead_end;
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+
+    const int64_t NONE = -1;
+    int64_t fanning = (vertex_count) ? 0 : NONE;
+    uint32_t time_stamp = cache_size + 1;
+    uint32_t cursor = 1;
+
+    if(cluster_starts) {
+        cluster_starts->push_back(0);
+    }
+
+    std::vector<uint32_t> candidates;
+    while(fanning != NONE) {
+        candidates.clear();
+
+        for(uint32_t a = offsets[fanning]; a < offsets[fanning + 1]; ++a) {
+            uint32_t t = adjacency[a];
+            if(emitted[t]) {
+                continue;
+            }
+
+            for(uint32_t c = 0; c < 3; ++c) {
+                uint32_t v = indices[t * 3 + c];
+                result.push_back(v);
+                dead_end.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+
+                if(time_stamp - cache_time[v] > cache_size) {
+                    cache_time[v] = time_stamp++;
+                }
+            }
+            emitted[t] = true;
+        }
+
+        //Pick the candidate which will still be in the cache and has the most live triangles
+        int64_t best = NONE;
+        int64_t best_priority = -1;
+        for(uint32_t v: candidates) {
+            if(!live[v]) {
+                continue;
+            }
+
+            int64_t priority = 0;
+            if(time_stamp - cache_time[v] + 2 * live[v] <= cache_size) {
+                priority = time_stamp - cache_time[v];
+            }
+
+            if(priority > best_priority) {
+                best_priority = priority;
+                best = v;
+            }
+        }
+
+        if(best == NONE) {
+            //Dead end, try the most recently used vertices, then just scan for the next one
+            while(!dead_end.empty() && best == NONE) {
+                uint32_t d = dead_end.back();
+                dead_end.pop_back();
+                if(live[d]) {
+                    best = d;
+                }
+            }
+
+            while(best == NONE && cursor < vertex_count) {
+                if(live[cursor]) {
+                    best = cursor;
+                }
+                ++cursor;
+            }
+
+            uint32_t emitted_count = result.size() / 3;
+            if(best != NONE && cluster_starts && emitted_count < triangle_count && emitted_count > cluster_starts->back()) {
+                cluster_starts->push_back(result.size() / 3);
+            }
+        }
+
+        fanning = best;
+    }
+
+    return result;
+}
+
+MeshOptimiser::MeshOptimiser(JobSystem& jobs, uint32_t cache_size, float overdraw_threshold):
+    jobs_(jobs),
+    cache_size_(cache_size),
+    overdraw_threshold_(overdraw_threshold) {
+
+}
+
+MeshOptimisationReport MeshOptimiser::optimise(Mesh& mesh) {
+    std::vector<OptimisationTask> tasks;
+
+    //One task for the shared data (and every submesh that uses it), one per submesh with its own data
+    OptimisationTask shared;
+    shared.vertex_data = &mesh.shared_data();
+
+    for(SubMeshIndex smi: mesh.submesh_ids()) {
+        SubMesh& sm = mesh.submesh(smi);
+
+        OptimisationTask single;
+        OptimisationTask& task = (sm.uses_shared_vertices()) ? shared : single;
+        task.vertex_data = &sm.vertex_data();
+        task.submeshes.push_back(smi);
+        task.indices.push_back(sm.index_data().all());
+        task.is_triangle_list.push_back(sm.arrangement() == MESH_ARRANGEMENT_TRIANGLES);
+
+        if(!sm.uses_shared_vertices() && sm.vertex_data().count()) {
+            tasks.push_back(single);
+        }
+    }
+
+    //Only touch the shared data if a submesh uses it, otherwise we can't know what references it
+    if(mesh.shared_data().count() && !shared.submeshes.empty()) {
+        tasks.push_back(shared);
+    }
+
+    //Tasks vary a lot in size, so hand them out one at a time
+    jobs_.parallel_for(0, tasks.size(), [&](uint32_t begin, uint32_t end) {
+        for(uint32_t i = begin; i < end; ++i) {
+            run_task(tasks[i], cache_size_, overdraw_threshold_);
+        }
+    }, 1);
+
+    //Now apply the results, this must happen on this thread as it fires the update signals
+    MeshOptimisationReport report;
+    uint32_t triangles = 0;
+    float misses_before = 0, misses_after = 0;
+
+    for(auto& task: tasks) {
+        VertexData& data = *task.vertex_data;
+
+        report.vertices_before += data.count();
+        report.vertices_after += task.new_to_old.size();
+        triangles += task.triangle_count;
+        misses_before += task.misses_before;
+        misses_after += task.misses_after;
+
+        data.remap(task.new_to_old);
+        data.done();
+
+        for(uint32_t i = 0; i < task.submeshes.size(); ++i) {
+            IndexData& index_data = mesh.submesh(task.submeshes[i]).index_data();
+            index_data.clear();
+            index_data.reserve(task.indices[i].size());
+            index_data.index(task.indices[i].data(), task.indices[i].size());
+            index_data.done();
+        }
+    }
+
+    if(triangles) {
+        report.acmr_before = misses_before / float(triangles);
+        report.acmr_after = misses_after / float(triangles);
+    }
+
+    L_DEBUG(_u("Optimised mesh: {0} -> {1} vertices, ACMR {2} -> {3}").format(
+        report.vertices_before, report.vertices_after, report.acmr_before, report.acmr_after
+    ));
+
+    return report;
+}
+
+}
@@ -0,0 +1,56 @@
+#ifndef MESH_OPTIMISER_H
+#define MESH_OPTIMISER_H
+
+#include <cstdint>
+#include <vector>
+
+namespace kglt {
+
+class Mesh;
+class VertexData;
+class JobSystem;
+
+struct MeshOptimisationReport {
+    uint32_t vertices_before = 0;
+    uint32_t vertices_after = 0;
+
+    float acmr_before = 0.0; ///< Average cache miss ratio (misses per triangle) before optimising
+    float acmr_after = 0.0;
+};
+
+/*
+ *  Post-load optimisation of mesh geometry. This:
+ *
+ *  1. Welds vertices which are identical
+ *  2. Reorders triangles for the post-transform vertex cache (Tipsify)
+ *  3. Reorders the resulting triangle clusters to reduce overdraw, as long as
+ *     that doesn't hurt the cache efficiency by more than overdraw_threshold
+ *  4. Reorders vertices into the order they are first used for fetch locality
+ *
+ *  The shared data and each submesh with its own vertices are processed as separate tasks,
+ *  spread over the window's job system. The results are applied to the mesh on the calling
+ *  thread.
+ */
+class MeshOptimiser {
+public:
+    MeshOptimiser(JobSystem& jobs, uint32_t cache_size=16, float overdraw_threshold=1.05);
+
+    MeshOptimisationReport optimise(Mesh& mesh);
+
+private:
+    JobSystem& jobs_;
+    uint32_t cache_size_;
+    float overdraw_threshold_;
+};
+
+/* Returns the average number of vertex cache misses per triangle using a FIFO cache */
+float calculate_acmr(const std::vector<uint32_t>& indices, uint32_t cache_size=16);
+
+std::vector<uint32_t> tipsify(
+    const std::vector<uint32_t>& indices, uint32_t vertex_count, uint32_t cache_size,
+    std::vector<uint32_t>* cluster_starts=nullptr
+);
+
+}
+
+#endif // MESH_OPTIMISER_H
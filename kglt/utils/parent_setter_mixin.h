@@ -1,6 +1,8 @@
 #ifndef PARENT_SETTER_MIXIN_H
 #define PARENT_SETTER_MIXIN_H
 
+#include <stdexcept>
+
 #include "../types.h"
 
 namespace kglt {
@@ -14,26 +16,32 @@ public:
         T(stage) {}
 
     void set_parent(ActorID actor) {
+        check_can_reparent();
         T::set_parent(T::stage()->actor(actor).__object.get());
     }
 
     void set_parent(LightID light) {
+        check_can_reparent();
         T::set_parent(T::stage()->light(light));
     }
 
     void set_parent(CameraID camera) {
+        check_can_reparent();
         T::set_parent(T::stage()->camera(camera).__object.get());
     }
 
     void set_parent(SpriteID sprite) {
+        check_can_reparent();
         T::set_parent(T::stage()->sprite(sprite).__object.get());
     }
 
     void set_parent(BackgroundID background) {
+        check_can_reparent();
         T::set_parent(T::stage()->background(background).__object.get());
     }
 
     void set_parent(ParticleSystemID particles) {
+        check_can_reparent();
         T::set_parent(T::stage()->particle_system(particles).__object.get());
     }
 
@@ -41,6 +49,13 @@ protected:
     using T::set_parent;
 
     friend class Stage;
+
+private:
+    void check_can_reparent() {
+        if(T::stage()->is_updating_in_parallel()) {
+            throw std::logic_error("Tried to reparent a node during a parallel update, use Stage::defer");
+        }
+    }
 };
 
 }
@@ -0,0 +1,389 @@
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+#include "triangle_bvh.h"
+#include "../generic/small_vector.h"
+
+namespace kglt {
+
+namespace {
+
+const uint32_t BIN_COUNT = 16;
+const uint32_t NO_PARENT = ~0u;
+
+//Leaves can be bigger than MAX_LEAF_TRIANGLES if splitting them wouldn't pay off, but not by much
+const uint32_t MAX_SAH_LEAF_TRIANGLES = 16;
+
+struct BuildTriangle {
+    AABB bounds;
+    kmVec3 centroid;
+};
+
+struct BuildTask {
+    uint32_t right_of; //The node this is the second child of, NO_PARENT otherwise
+    uint32_t begin;
+    uint32_t end;
+};
+
+struct Bin {
+    AABB bounds;
+    uint32_t count;
+};
+
+inline float component(const kmVec3& v, uint32_t axis) {
+    return (&v.x)[axis];
+}
+
+inline kmVec3 sub(const kmVec3& lhs, const kmVec3& rhs) {
+    kmVec3 result = {lhs.x - rhs.x, lhs.y - rhs.y, lhs.z - rhs.z};
+    return result;
+}
+
+inline kmVec3 cross(const kmVec3& lhs, const kmVec3& rhs) {
+    kmVec3 result = {
+        lhs.y * rhs.z - lhs.z * rhs.y,
+        lhs.z * rhs.x - lhs.x * rhs.z,
+        lhs.x * rhs.y - lhs.y * rhs.x
+    };
+    return result;
+}
+
+inline float dot(const kmVec3& lhs, const kmVec3& rhs) {
+    return lhs.x * rhs.x + lhs.y * rhs.y + lhs.z * rhs.z;
+}
+
+AABB empty_bounds() {
+    const float inf = std::numeric_limits<float>::infinity();
+
+    AABB result;
+    kmVec3Fill(&result.min, inf, inf, inf);
+    kmVec3Fill(&result.max, -inf, -inf, -inf);
+    return result;
+}
+
+void expand(AABB& box, const kmVec3& point) {
+    box.min.x = std::min(box.min.x, point.x);
+    box.min.y = std::min(box.min.y, point.y);
+    box.min.z = std::min(box.min.z, point.z);
+    box.max.x = std::max(box.max.x, point.x);
+    box.max.y = std::max(box.max.y, point.y);
+    box.max.z = std::max(box.max.z, point.z);
+}
+
+void merge(AABB& box, const AABB& other) {
+    expand(box, other.min);
+    expand(box, other.max);
+}
+
+//Half the surface area, which is all the heuristic needs
+float half_area(const AABB& box) {
+    if(box.min.x > box.max.x) {
+        return 0.0f;
+    }
+
+    float dx = box.max.x - box.min.x;
+    float dy = box.max.y - box.min.y;
+    float dz = box.max.z - box.min.z;
+    return dx * dy + dy * dz + dz * dx;
+}
+
+/*
+ * Returns where to split the triangles in order[begin, end), after reordering them so that the
+ * first part goes left, or end if they're better off as a leaf
+ */
+uint32_t split(const std::vector<BuildTriangle>& info, std::vector<uint32_t>& order,
+               uint32_t begin, uint32_t end, const AABB& bounds, const AABB& centroid_bounds, uint16_t& axis) {
+
+    uint32_t count = end - begin;
+
+    kmVec3 extent = sub(centroid_bounds.max, centroid_bounds.min);
+    axis = (extent.x > extent.y && extent.x > extent.z) ? 0 : (extent.y > extent.z) ? 1 : 2;
+
+    float low = component(centroid_bounds.min, axis);
+    float width = component(extent, axis);
+
+    if(width <= 0.0f) {
+        //The centroids are all in the same place, so there's nothing to choose between them
+        return (count <= MAX_SAH_LEAF_TRIANGLES) ? end : begin + count / 2;
+    }
+
+    float scale = BIN_COUNT / width;
+    auto bin_of = [&](uint32_t triangle) {
+        uint32_t bin = uint32_t((component(info[triangle].centroid, axis) - low) * scale);
+        return std::min(bin, BIN_COUNT - 1);
+    };
+
+    Bin bins[BIN_COUNT];
+    for(Bin& bin: bins) {
+        bin.bounds = empty_bounds();
+        bin.count = 0;
+    }
+
+    for(uint32_t i = begin; i < end; ++i) {
+        Bin& bin = bins[bin_of(order[i])];
+        merge(bin.bounds, info[order[i]].bounds);
+        ++bin.count;
+    }
+
+    //Sweep from the right to find the cost of everything after each split, then from the left
+    float right_cost[BIN_COUNT];
+    AABB right_bounds = empty_bounds();
+    uint32_t right_count = 0;
+    for(uint32_t i = BIN_COUNT - 1; i > 0; --i) {
+        merge(right_bounds, bins[i].bounds);
+        right_count += bins[i].count;
+        right_cost[i] = right_count * half_area(right_bounds);
+    }
+
+    float best_cost = std::numeric_limits<float>::infinity();
+    uint32_t best_bin = 0;
+
+    AABB left_bounds = empty_bounds();
+    uint32_t left_count = 0;
+    for(uint32_t i = 0; i < BIN_COUNT - 1; ++i) {
+        merge(left_bounds, bins[i].bounds);
+        left_count += bins[i].count;
+
+        float cost = left_count * half_area(left_bounds) + right_cost[i + 1];
+        if(cost < best_cost) {
+            best_cost = cost;
+            best_bin = i;
+        }
+    }
+
+    //A node costs about as much to visit as a triangle costs to test
+    float leaf_cost = count * half_area(bounds);
+    float split_cost = half_area(bounds) + best_cost;
+
+    if(split_cost >= leaf_cost && count <= MAX_SAH_LEAF_TRIANGLES) {
+        return end;
+    }
+
+    uint32_t mid = std::partition(order.begin() + begin, order.begin() + end, [&](uint32_t triangle) {
+        return bin_of(triangle) <= best_bin;
+    }) - order.begin();
+
+    if(mid == begin || mid == end) {
+        //Everything landed on one side, fall back to splitting at the median
+        mid = begin + count / 2;
+        std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end, [&](uint32_t lhs, uint32_t rhs) {
+            return component(info[lhs].centroid, axis) < component(info[rhs].centroid, axis);
+        });
+    }
+
+    return mid;
+}
+
+}
+
+void TriangleBVH::clear() {
+    nodes_.clear();
+    triangles_.clear();
+    triangle_ids_.clear();
+}
+
+void TriangleBVH::build(const std::vector<kmVec3>& corners) {
+    clear();
+
+    uint32_t count = corners.size() / 3;
+    if(!count) {
+        return;
+    }
+
+    std::vector<BuildTriangle> info(count);
+    std::vector<uint32_t> order(count);
+
+    for(uint32_t i = 0; i < count; ++i) {
+        BuildTriangle& triangle = info[i];
+        triangle.bounds = empty_bounds();
+        expand(triangle.bounds, corners[i * 3]);
+        expand(triangle.bounds, corners[i * 3 + 1]);
+        expand(triangle.bounds, corners[i * 3 + 2]);
+        kmAABB3Centre(&triangle.bounds, &triangle.centroid);
+
+        order[i] = i;
+    }
+
+    //A binary tree with at least one triangle per leaf can't have more nodes than this
+    nodes_.reserve(count * 2 - 1);
+
+    std::vector<BuildTask> tasks;
+    tasks.push_back(BuildTask{NO_PARENT, 0, count});
+
+    while(!tasks.empty()) {
+        BuildTask task = tasks.back();
+        tasks.pop_back();
+
+        uint32_t index = nodes_.size();
+        nodes_.push_back(Node());
+
+        //First children are always built straight after their parent, so only second children need linking
+        if(task.right_of != NO_PARENT) {
+            nodes_[task.right_of].offset = index;
+        }
+
+        AABB bounds = empty_bounds();
+        AABB centroid_bounds = empty_bounds();
+        for(uint32_t i = task.begin; i < task.end; ++i) {
+            merge(bounds, info[order[i]].bounds);
+            expand(centroid_bounds, info[order[i]].centroid);
+        }
+
+        Node& node = nodes_[index];
+        node.min = bounds.min;
+        node.max = bounds.max;
+        node.axis = 0;
+
+        uint32_t mid = task.end;
+        if(task.end - task.begin > MAX_LEAF_TRIANGLES) {
+            mid = split(info, order, task.begin, task.end, bounds, centroid_bounds, node.axis);
+        }
+
+        if(mid == task.end) {
+            node.offset = task.begin;
+            node.count = task.end - task.begin;
+            continue;
+        }
+
+        node.offset = 0;
+        node.count = 0;
+
+        //The second child goes on first, so that the first is built next
+        tasks.push_back(BuildTask{index, mid, task.end});
+        tasks.push_back(BuildTask{NO_PARENT, task.begin, mid});
+    }
+
+    triangles_.resize(count);
+    triangle_ids_.resize(count);
+
+    for(uint32_t i = 0; i < count; ++i) {
+        const kmVec3* triangle = &corners[order[i] * 3];
+
+        triangles_[i].corner = triangle[0];
+        triangles_[i].edge1 = sub(triangle[1], triangle[0]);
+        triangles_[i].edge2 = sub(triangle[2], triangle[0]);
+        triangle_ids_[i] = order[i];
+    }
+}
+
+AABB TriangleBVH::bounds() const {
+    AABB result;
+    if(!nodes_.empty()) {
+        result.min = nodes_[0].min;
+        result.max = nodes_[0].max;
+    }
+    return result;
+}
+
+bool TriangleBVH::raycast(const Ray& ray, TriangleHit& nearest) const {
+    return trace<false>(ray, &nearest);
+}
+
+bool TriangleBVH::intersects(const Ray& ray) const {
+    return trace<true>(ray, nullptr);
+}
+
+template<bool AnyHit>
+bool TriangleBVH::trace(const Ray& ray, TriangleHit* nearest) const {
+    if(nodes_.empty()) {
+        return false;
+    }
+
+    //Large rather than infinite for axis aligned rays, so that a start on a slab's plane gives 0 rather than NaN
+    const float huge = 1e30f;
+    kmVec3 inverse_dir = {
+        (ray.dir.x != 0.0f) ? 1.0f / ray.dir.x : huge,
+        (ray.dir.y != 0.0f) ? 1.0f / ray.dir.y : huge,
+        (ray.dir.z != 0.0f) ? 1.0f / ray.dir.z : huge
+    };
+
+    float best = ray.length;
+    bool found = false;
+
+    generic::SmallVector<uint32_t, 64> stack;
+    stack.push_back(0);
+
+    while(!stack.empty()) {
+        uint32_t index = stack.back();
+        stack.pop_back();
+
+        const Node& node = nodes_[index];
+
+        //Slab test against the node, clipped to what's left of the ray
+        float enter = 0.0f;
+        float leave = best;
+        for(uint32_t axis = 0; axis < 3; ++axis) {
+            float start = component(ray.start, axis);
+            float inverse = component(inverse_dir, axis);
+            float t1 = (component(node.min, axis) - start) * inverse;
+            float t2 = (component(node.max, axis) - start) * inverse;
+
+            enter = std::max(enter, std::min(t1, t2));
+            leave = std::min(leave, std::max(t1, t2));
+        }
+
+        if(enter > leave) {
+            continue;
+        }
+
+        if(node.count) {
+            for(uint32_t i = node.offset; i < node.offset + node.count; ++i) {
+                //Moller-Trumbore
+                const Triangle& triangle = triangles_[i];
+
+                kmVec3 p = cross(ray.dir, triangle.edge2);
+                float det = dot(triangle.edge1, p);
+                if(det == 0.0f) {
+                    continue; //Parallel to the triangle
+                }
+
+                float inverse_det = 1.0f / det;
+                kmVec3 offset = sub(ray.start, triangle.corner);
+
+                float u = dot(offset, p) * inverse_det;
+                if(u < 0.0f || u > 1.0f) {
+                    continue;
+                }
+
+                kmVec3 q = cross(offset, triangle.edge1);
+                float v = dot(ray.dir, q) * inverse_det;
+                if(v < 0.0f || u + v > 1.0f) {
+                    continue;
+                }
+
+                float t = dot(triangle.edge2, q) * inverse_det;
+                if(t < 0.0f || t > best) {
+                    continue;
+                }
+
+                if(AnyHit) {
+                    return true;
+                }
+
+                found = true;
+                best = t;
+
+                nearest->triangle = triangle_ids_[i];
+                nearest->distance = t;
+                nearest->u = u;
+                nearest->v = v;
+            }
+            continue;
+        }
+
+        //Look at the child on the near side first, hits there cut short the search of the other
+        uint32_t first = index + 1;
+        uint32_t second = node.offset;
+        if(component(ray.dir, node.axis) < 0.0f) {
+            std::swap(first, second);
+        }
+
+        stack.push_back(second);
+        stack.push_back(first);
+    }
+
+    return found;
+}
+
+}
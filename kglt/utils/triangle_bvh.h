@@ -0,0 +1,76 @@
+#ifndef TRIANGLE_BVH_H
+#define TRIANGLE_BVH_H
+
+#include <cstdint>
+#include <vector>
+#include <kazmath/vec3.h>
+
+#include "../types.h"
+
+namespace kglt {
+
+struct TriangleHit {
+    uint32_t triangle; ///< Which triangle, in the order they were given to build()
+    float distance; ///< How far along the ray, in units of the ray's direction
+    float u, v; ///< Barycentric coordinates of the hit within the triangle
+};
+
+/*
+ *  A static bounding volume hierarchy over a set of triangles, for exact ray tests against a
+ *  mesh (picking, line of sight) once something coarser has found the mesh.
+ *
+ *  The tree is built top down, splitting by the surface area heuristic over binned centroids,
+ *  and stored flattened in depth first order: each node is 32 bytes, its first child directly
+ *  follows it and only the second child's index is stored. The triangles are copied into leaf
+ *  order as a corner and two edges, which is what the intersection test wants.
+ *
+ *  Triangles are two sided. A BVH doesn't watch what it was built from, see
+ *  SubMesh::triangle_bvh() for one that's kept up to date.
+ */
+class TriangleBVH {
+public:
+    static const uint32_t MAX_LEAF_TRIANGLES = 4;
+
+    /* Builds from a list of triangle corners, three per triangle. Anything already built is discarded */
+    void build(const std::vector<kmVec3>& corners);
+    void clear();
+
+    /* Finds the nearest triangle the ray hits within its length */
+    bool raycast(const Ray& ray, TriangleHit& nearest) const;
+
+    /* Returns true if the ray hits any triangle within its length, stopping at the first one found */
+    bool intersects(const Ray& ray) const;
+
+    bool empty() const { return triangles_.empty(); }
+    uint32_t triangle_count() const { return triangles_.size(); }
+    uint32_t node_count() const { return nodes_.size(); }
+
+    /* The bounds of every triangle, empty bounds at the origin if there aren't any */
+    AABB bounds() const;
+
+private:
+    struct Node {
+        kmVec3 min;
+        kmVec3 max;
+        uint32_t offset; //First triangle for leaves, the second child for everything else
+        uint16_t count; //Triangles in a leaf, zero for everything else
+        uint16_t axis; //The axis the children were split along
+    };
+
+    struct Triangle {
+        kmVec3 corner;
+        kmVec3 edge1;
+        kmVec3 edge2;
+    };
+
+    std::vector<Node> nodes_;
+    std::vector<Triangle> triangles_;
+    std::vector<uint32_t> triangle_ids_; //The original index of each triangle in triangles_
+
+    template<bool AnyHit>
+    bool trace(const Ray& ray, TriangleHit* nearest) const;
+};
+
+}
+
+#endif // TRIANGLE_BVH_H
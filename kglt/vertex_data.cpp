@@ -1,73 +1,478 @@
 #include "utils/glcompat.h"
 
 #include <stdexcept>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <limits>
 #include "vertex_data.h"
 #include "window_base.h"
 #include "utils/gl_thread_check.h"
 
 namespace kglt {
 
-void VertexData::check_or_add_attribute(AttributeBitMask attr) {
-    if(data_.size() > 1 && ((enabled_bitmask_ & attr) != attr)) {
+namespace {
+
+uint16_t float_to_half(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(float));
+
+    uint16_t sign = (bits >> 16) & 0x8000;
+    int32_t exponent = int32_t((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    if(exponent <= 0) {
+        //Too small for a normalized half, flush to signed zero
+        return sign;
+    } else if(exponent >= 31) {
+        //Too big (or inf/nan), clamp to infinity
+        return sign | 0x7C00;
+    }
+
+    //Round to nearest
+    uint16_t result = sign | (exponent << 10) | (mantissa >> 13);
+    if(mantissa & 0x1000) {
+        ++result;
+    }
+    return result;
+}
+
+float half_to_float(uint16_t value) {
+    uint32_t sign = uint32_t(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1F;
+    uint32_t mantissa = value & 0x3FF;
+
+    uint32_t bits;
+    if(exponent == 0) {
+        //We never write denormals, so treat them as zero
+        bits = sign;
+    } else if(exponent == 31) {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    } else {
+        bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    }
+
+    float result;
+    std::memcpy(&result, &bits, sizeof(float));
+    return result;
+}
+
+int32_t pack_snorm10(float value) {
+    value = std::max(-1.0f, std::min(1.0f, value));
+    return int32_t(std::round(value * 511.0f)) & 0x3FF;
+}
+
+float unpack_snorm10(uint32_t value) {
+    int32_t v = int32_t(value & 0x3FF);
+    if(v & 0x200) {
+        v -= 0x400; //Sign extend
+    }
+    return std::max(-1.0f, float(v) / 511.0f);
+}
+
+void encode_attribute(uint8_t* out, VertexAttributeType type, const float* values) {
+    switch(type) {
+    case VERTEX_ATTRIBUTE_TYPE_1F:
+    case VERTEX_ATTRIBUTE_TYPE_2F:
+    case VERTEX_ATTRIBUTE_TYPE_3F:
+    case VERTEX_ATTRIBUTE_TYPE_4F:
+        std::memcpy(out, values, vertex_attribute_size(type));
+    break;
+    case VERTEX_ATTRIBUTE_TYPE_2H:
+    case VERTEX_ATTRIBUTE_TYPE_4H: {
+        uint16_t* halves = (uint16_t*) out;
+        for(uint8_t i = 0; i < vertex_attribute_component_count(type); ++i) {
+            halves[i] = float_to_half(values[i]);
+        }
+    }
+    break;
+    case VERTEX_ATTRIBUTE_TYPE_4UB_NORMALIZED:
+        for(uint8_t i = 0; i < 4; ++i) {
+            out[i] = uint8_t(std::round(std::max(0.0f, std::min(1.0f, values[i])) * 255.0f));
+        }
+    break;
+    case VERTEX_ATTRIBUTE_TYPE_PACKED_NORMAL: {
+        uint32_t packed = pack_snorm10(values[0]) | (pack_snorm10(values[1]) << 10) | (pack_snorm10(values[2]) << 20);
+        std::memcpy(out, &packed, sizeof(uint32_t));
+    }
+    break;
+    default:
+        throw std::logic_error("Tried to write an empty vertex attribute");
+    }
+}
+
+void decode_attribute(const uint8_t* in, VertexAttributeType type, float* values) {
+    switch(type) {
+    case VERTEX_ATTRIBUTE_TYPE_1F:
+    case VERTEX_ATTRIBUTE_TYPE_2F:
+    case VERTEX_ATTRIBUTE_TYPE_3F:
+    case VERTEX_ATTRIBUTE_TYPE_4F:
+        std::memcpy(values, in, vertex_attribute_size(type));
+    break;
+    case VERTEX_ATTRIBUTE_TYPE_2H:
+    case VERTEX_ATTRIBUTE_TYPE_4H: {
+        const uint16_t* halves = (const uint16_t*) in;
+        for(uint8_t i = 0; i < vertex_attribute_component_count(type); ++i) {
+            values[i] = half_to_float(halves[i]);
+        }
+    }
+    break;
+    case VERTEX_ATTRIBUTE_TYPE_4UB_NORMALIZED:
+        for(uint8_t i = 0; i < 4; ++i) {
+            values[i] = float(in[i]) / 255.0f;
+        }
+    break;
+    case VERTEX_ATTRIBUTE_TYPE_PACKED_NORMAL: {
+        uint32_t packed;
+        std::memcpy(&packed, in, sizeof(uint32_t));
+        values[0] = unpack_snorm10(packed);
+        values[1] = unpack_snorm10(packed >> 10);
+        values[2] = unpack_snorm10(packed >> 20);
+    }
+    break;
+    default:
+        break;
+    }
+}
+
+VertexAttributeType float_type_for_dimensions(uint8_t count) {
+    switch(count) {
+        case 1: return VERTEX_ATTRIBUTE_TYPE_1F;
+        case 2: return VERTEX_ATTRIBUTE_TYPE_2F;
+        case 3: return VERTEX_ATTRIBUTE_TYPE_3F;
+        case 4: return VERTEX_ATTRIBUTE_TYPE_4F;
+    default:
+        throw std::out_of_range("Texture coordinates can only have up to 4 parts");
+    }
+}
+
+AttributeBitMask texcoord_bit(uint8_t which) {
+    switch(which) {
+        case 0: return BM_TEXCOORD_0;
+        case 1: return BM_TEXCOORD_1;
+        case 2: return BM_TEXCOORD_2;
+        case 3: return BM_TEXCOORD_3;
+        case 4: return BM_TEXCOORD_4;
+    default:
+        throw std::out_of_range("Invalid tex coordinate index");
+    }
+}
+
+const AttributeBitMask ALL_ATTRIBUTES[] = {
+    BM_POSITIONS, BM_NORMALS,
+    BM_TEXCOORD_0, BM_TEXCOORD_1, BM_TEXCOORD_2, BM_TEXCOORD_3, BM_TEXCOORD_4,
+    BM_DIFFUSE, BM_SPECULAR
+};
+
+}
+
+uint32_t vertex_attribute_size(VertexAttributeType type) {
+    switch(type) {
+        case VERTEX_ATTRIBUTE_TYPE_EMPTY: return 0;
+        case VERTEX_ATTRIBUTE_TYPE_1F: return sizeof(float);
+        case VERTEX_ATTRIBUTE_TYPE_2F: return sizeof(float) * 2;
+        case VERTEX_ATTRIBUTE_TYPE_3F: return sizeof(float) * 3;
+        case VERTEX_ATTRIBUTE_TYPE_4F: return sizeof(float) * 4;
+        case VERTEX_ATTRIBUTE_TYPE_2H: return sizeof(uint16_t) * 2;
+        case VERTEX_ATTRIBUTE_TYPE_4H: return sizeof(uint16_t) * 4;
+        case VERTEX_ATTRIBUTE_TYPE_4UB_NORMALIZED: return sizeof(uint8_t) * 4;
+        case VERTEX_ATTRIBUTE_TYPE_PACKED_NORMAL: return sizeof(uint32_t);
+    default:
+        throw std::logic_error("Unknown vertex attribute type");
+    }
+}
+
+uint8_t vertex_attribute_component_count(VertexAttributeType type) {
+    switch(type) {
+        case VERTEX_ATTRIBUTE_TYPE_EMPTY: return 0;
+        case VERTEX_ATTRIBUTE_TYPE_1F: return 1;
+        case VERTEX_ATTRIBUTE_TYPE_2F:
+        case VERTEX_ATTRIBUTE_TYPE_2H: return 2;
+        case VERTEX_ATTRIBUTE_TYPE_3F: return 3;
+        case VERTEX_ATTRIBUTE_TYPE_4F:
+        case VERTEX_ATTRIBUTE_TYPE_4H:
+        case VERTEX_ATTRIBUTE_TYPE_4UB_NORMALIZED:
+        case VERTEX_ATTRIBUTE_TYPE_PACKED_NORMAL: return 4;
+    default:
+        throw std::logic_error("Unknown vertex attribute type");
+    }
+}
+
+bool VertexSpecification::operator==(const VertexSpecification& other) const {
+    for(uint8_t i = 0; i < MAX_TEXCOORDS; ++i) {
+        if(texcoord_attributes[i] != other.texcoord_attributes[i]) {
+            return false;
+        }
+    }
+
+    return position_attribute == other.position_attribute &&
+           normal_attribute == other.normal_attribute &&
+           diffuse_attribute == other.diffuse_attribute &&
+           specular_attribute == other.specular_attribute;
+}
+
+VertexAttributeType VertexSpecification::attribute(AttributeBitMask attr) const {
+    switch(attr) {
+        case BM_POSITIONS: return position_attribute;
+        case BM_NORMALS: return normal_attribute;
+        case BM_TEXCOORD_0: return texcoord_attributes[0];
+        case BM_TEXCOORD_1: return texcoord_attributes[1];
+        case BM_TEXCOORD_2: return texcoord_attributes[2];
+        case BM_TEXCOORD_3: return texcoord_attributes[3];
+        case BM_TEXCOORD_4: return texcoord_attributes[4];
+        case BM_DIFFUSE: return diffuse_attribute;
+        case BM_SPECULAR: return specular_attribute;
+    default:
+        throw std::logic_error("Unknown vertex attribute");
+    }
+}
+
+void VertexSpecification::set_attribute(AttributeBitMask attr, VertexAttributeType type) {
+    switch(attr) {
+        case BM_POSITIONS: position_attribute = type; break;
+        case BM_NORMALS: normal_attribute = type; break;
+        case BM_TEXCOORD_0: texcoord_attributes[0] = type; break;
+        case BM_TEXCOORD_1: texcoord_attributes[1] = type; break;
+        case BM_TEXCOORD_2: texcoord_attributes[2] = type; break;
+        case BM_TEXCOORD_3: texcoord_attributes[3] = type; break;
+        case BM_TEXCOORD_4: texcoord_attributes[4] = type; break;
+        case BM_DIFFUSE: diffuse_attribute = type; break;
+        case BM_SPECULAR: specular_attribute = type; break;
+    default:
+        throw std::logic_error("Unknown vertex attribute");
+    }
+}
+
+uint32_t VertexSpecification::stride() const {
+    uint32_t total = vertex_attribute_size(position_attribute) + vertex_attribute_size(normal_attribute);
+    for(uint8_t i = 0; i < MAX_TEXCOORDS; ++i) {
+        total += vertex_attribute_size(texcoord_attributes[i]);
+    }
+    total += vertex_attribute_size(diffuse_attribute) + vertex_attribute_size(specular_attribute);
+    return total;
+}
+
+uint32_t VertexSpecification::offset(AttributeBitMask attr) const {
+    if(!has_attribute(attr)) {
+        throw std::logic_error("Requested the offset of an attribute which isn't in the vertex specification");
+    }
+
+    uint32_t offset = 0;
+    if(attr == BM_POSITIONS) return offset;
+    offset += vertex_attribute_size(position_attribute);
+
+    if(attr == BM_NORMALS) return offset;
+    offset += vertex_attribute_size(normal_attribute);
+
+    for(uint8_t i = 0; i < MAX_TEXCOORDS; ++i) {
+        if(attr == texcoord_bit(i)) return offset;
+        offset += vertex_attribute_size(texcoord_attributes[i]);
+    }
+
+    if(attr == BM_DIFFUSE) return offset;
+    offset += vertex_attribute_size(diffuse_attribute);
+
+    //Must be BM_SPECULAR
+    return offset;
+}
+
+void VertexData::check_or_add_attribute(AttributeBitMask attr, VertexAttributeType default_type) {
+    if((enabled_bitmask_ & attr) == attr) {
+        return;
+    }
+
+    if(vertex_count_ > 1) {
         throw std::logic_error("Attempted to add an attribute that didn't exist on the first vertex");
     }
 
-    enabled_bitmask_ |= attr;
+    VertexSpecification new_spec = specification_;
+    new_spec.set_attribute(attr, default_type);
+    apply_specification(new_spec);
 }
 
 VertexData::VertexData():
     enabled_bitmask_(0),
+    stride_(0),
+    vertex_count_(0),
     cursor_position_(0) {
 
     //Default to u,v for all tex coords
-    for(uint8_t i = 0; i < 8; ++i) {
+    for(uint8_t i = 0; i < MAX_TEXCOORDS; ++i) {
         set_texture_coordinate_dimensions(i, 2);
     }
 }
 
+VertexData::VertexData(const VertexSpecification& specification):
+    VertexData() {
+
+    set_specification(specification);
+}
+
 void VertexData::set_texture_coordinate_dimensions(uint8_t coord_index, uint8_t count) {
-    if(coord_index >= 8) {
-        throw std::out_of_range("coord_index must be less than 8");
+    if(coord_index >= MAX_TEXCOORDS) {
+        throw std::out_of_range("coord_index must be less than MAX_TEXCOORDS");
     }
 
-    if(count >= 4) {
+    if(count == 0 || count > 4) {
         throw std::out_of_range("Texture coordinates can only have up to 4 parts");
     }
 
     tex_coord_dimensions_[coord_index] = count;
+
+    //If the texcoord is already stored as floats, switch to the new dimensions
+    VertexAttributeType current = specification_.texcoord_attributes[coord_index];
+    if(current >= VERTEX_ATTRIBUTE_TYPE_1F && current <= VERTEX_ATTRIBUTE_TYPE_4F) {
+        VertexSpecification new_spec = specification_;
+        new_spec.texcoord_attributes[coord_index] = float_type_for_dimensions(count);
+        apply_specification(new_spec);
+    }
 }
 
-void VertexData::clear() {
-    data_.clear();
-    cursor_position_ = 0;    
+uint8_t VertexData::texcoord_size(uint8_t which) const {
+    if(which >= MAX_TEXCOORDS) {
+        throw std::out_of_range("Invalid tex coordinate index");
+    }
+
+    VertexAttributeType type = specification_.texcoord_attributes[which];
+    if(type == VERTEX_ATTRIBUTE_TYPE_EMPTY) {
+        return tex_coord_dimensions_[which];
+    }
+    return vertex_attribute_component_count(type);
+}
+
+void VertexData::set_specification(const VertexSpecification& specification) {
+    declared_specification_ = specification;
+    apply_specification(specification);
+}
+
+void VertexData::apply_specification(const VertexSpecification& specification) {
+    if(specification == specification_) {
+        return;
+    }
+
+    uint32_t new_stride = specification.stride();
+
+    if(vertex_count_) {
+        //Convert the existing vertices to the new layout
+        std::vector<uint8_t> new_data(vertex_count_ * new_stride, 0);
+
+        for(AttributeBitMask attr: ALL_ATTRIBUTES) {
+            if(!specification_.has_attribute(attr) || !specification.has_attribute(attr)) {
+                continue;
+            }
+
+            uint32_t old_offset = specification_.offset(attr);
+            uint32_t new_offset = specification.offset(attr);
+
+            for(uint32_t i = 0; i < vertex_count_; ++i) {
+                float values[4] = {0, 0, 0, 0};
+                decode_attribute(&data_[i * stride_ + old_offset], specification_.attribute(attr), values);
+                encode_attribute(&new_data[i * new_stride + new_offset], specification.attribute(attr), values);
+            }
+        }
+
+        data_.swap(new_data);
+    }
+
+    //The layout changed, so the whole buffer needs uploading again
+    dirty_ranges_.mark_all();
+
+    specification_ = specification;
+    stride_ = new_stride;
+
     enabled_bitmask_ = 0;
+    for(AttributeBitMask attr: ALL_ATTRIBUTES) {
+        if(specification_.has_attribute(attr)) {
+            enabled_bitmask_ |= attr;
+        }
+    }
 }
 
-kglt::Vec3 VertexData::position() const {
-    if(cursor_position_ > (int32_t) data_.size()) {
+void VertexData::write_attribute(AttributeBitMask attr, VertexAttributeType default_type, const float* values, uint8_t count) {
+    check_or_add_attribute(attr, default_type);
+
+    if(cursor_position_ >= (int32_t) vertex_count_) {
         throw std::out_of_range("Cursor moved out of range");
     }
 
-    const Vertex& vert = data_.at(cursor_position_);
-    return vert.position;
+    VertexAttributeType type = specification_.attribute(attr);
+
+    float padded[4] = {0, 0, 0, 0};
+    if(attr == BM_DIFFUSE || attr == BM_SPECULAR) {
+        padded[3] = 1.0f;
+    }
+
+    //Packed types always store all the components, so keep anything that wasn't
+    //passed in rather than zeroing it
+    uint8_t components = vertex_attribute_component_count(type);
+    if(count < components) {
+        decode_attribute(&data_[cursor_position_ * stride_ + specification_.offset(attr)], type, padded);
+    }
+
+    for(uint8_t i = 0; i < std::min(count, components); ++i) {
+        padded[i] = values[i];
+    }
+
+    encode_attribute(&data_[cursor_position_ * stride_ + specification_.offset(attr)], type, padded);
+    dirty_ranges_.mark(cursor_position_);
 }
 
-void VertexData::position(float x, float y, float z) {
-    check_or_add_attribute(BM_POSITIONS);
+kmVec4 VertexData::read_attribute(uint32_t idx, AttributeBitMask attr) const {
+    if(idx >= vertex_count_) {
+        throw std::out_of_range("Tried to read a vertex outside the range of the data");
+    }
 
-    if(cursor_position_ == (int32_t) data_.size()) {
-        data_.push_back(Vertex());
+    float values[4] = {0, 0, 0, 0};
+    if(specification_.has_attribute(attr)) {
+        decode_attribute(&data_[idx * stride_ + specification_.offset(attr)], specification_.attribute(attr), values);
     }
 
-    if(cursor_position_ > (int32_t) data_.size()) {
-        throw std::out_of_range("Cursor moved out of range");
+    kmVec4 result;
+    kmVec4Fill(&result, values[0], values[1], values[2], values[3]);
+    return result;
+}
+
+void VertexData::remap(const std::vector<uint32_t>& old_indices) {
+    std::vector<uint8_t> new_data(old_indices.size() * stride_);
+
+    for(uint32_t i = 0; i < old_indices.size(); ++i) {
+        if(old_indices[i] >= vertex_count_) {
+            throw std::out_of_range("Tried to remap a vertex outside the range of the data");
+        }
+
+        std::memcpy(&new_data[i * stride_], &data_[old_indices[i] * stride_], stride_);
     }
 
-    Vertex& vert = data_.at(cursor_position_);
+    data_.swap(new_data);
+    vertex_count_ = old_indices.size();
+    cursor_position_ = 0;
+    dirty_ranges_.mark_all();
+}
+
+void VertexData::clear() {
+    data_.clear();
+    vertex_count_ = 0;
+    cursor_position_ = 0;
+
+    //Drop any attributes which were added on the fly, but keep the declared format
+    apply_specification(declared_specification_);
+}
 
-    vert.position.x = x;
-    vert.position.y = y;
-    vert.position.z = z;
+kglt::Vec3 VertexData::position() const {
+    kmVec4 pos = read_attribute(cursor_position_, BM_POSITIONS);
+    return kglt::Vec3(pos.x, pos.y, pos.z);
+}
+
+void VertexData::position(float x, float y, float z) {
+    check_or_add_attribute(BM_POSITIONS, VERTEX_ATTRIBUTE_TYPE_3F);
+
+    if(cursor_position_ == (int32_t) vertex_count_) {
+        data_.resize(data_.size() + stride_, 0);
+        ++vertex_count_;
+    }
+
+    const float values[] = { x, y, z };
+    write_attribute(BM_POSITIONS, VERTEX_ATTRIBUTE_TYPE_3F, values, 3);
 }
 
 void VertexData::position(float x, float y) {
@@ -82,95 +487,60 @@ void VertexData::position(const kmVec3& pos) {
     position(pos.x, pos.y, pos.z);
 }
 
+kmVec3 VertexData::position_at(uint32_t idx) const {
+    kmVec4 pos = read_attribute(idx, BM_POSITIONS);
+    return kglt::Vec3(pos.x, pos.y, pos.z);
+}
 
 kglt::Vec3 VertexData::normal() const {
-    if(cursor_position_ > (int32_t) data_.size()) {
-        throw std::out_of_range("Cursor moved out of range");
-    }
-
-    const Vertex& vert = data_.at(cursor_position_);
-    return vert.normal;
+    kmVec4 n = read_attribute(cursor_position_, BM_NORMALS);
+    return kglt::Vec3(n.x, n.y, n.z);
 }
 
 void VertexData::normal(float x, float y, float z) {
-    check_or_add_attribute(BM_NORMALS);
-
-    Vertex& vert = data_.at(cursor_position_);
-    vert.normal.x = x;
-    vert.normal.y = y;
-    vert.normal.z = z;
+    const float values[] = { x, y, z };
+    write_attribute(BM_NORMALS, VERTEX_ATTRIBUTE_TYPE_3F, values, 3);
 }
 
 void VertexData::normal(const kmVec3& n) {
     normal(n.x, n.y, n.z);
 }
 
-void VertexData::check_texcoord(uint8_t which) {
-    switch(which) {
-    case 0:
-        check_or_add_attribute(BM_TEXCOORD_0);
-    break;
-    case 1:
-        check_or_add_attribute(BM_TEXCOORD_1);
-    break;
-    case 2:
-        check_or_add_attribute(BM_TEXCOORD_2);
-    break;
-    case 3:
-        check_or_add_attribute(BM_TEXCOORD_3);
-    break;
-    case 4:
-        check_or_add_attribute(BM_TEXCOORD_4);
-    break;
-    default:
-        assert(0 && "Not implemented");
-    }
+kmVec3 VertexData::normal_at(uint32_t idx) const {
+    kmVec4 n = read_attribute(idx, BM_NORMALS);
+    return kglt::Vec3(n.x, n.y, n.z);
 }
 
 void VertexData::tex_coordX(uint8_t which, float u) {
-    check_texcoord(which);
-
-    //FIXME: throw an exception
-    assert(tex_coord_dimensions_[which] >= 1);
-
-    Vertex& vert = data_.at(cursor_position_);
-    vert.tex_coords[which].x = u;
+    const float values[] = { u };
+    write_attribute(texcoord_bit(which), float_type_for_dimensions(tex_coord_dimensions_[which]), values, 1);
 }
 
 void VertexData::tex_coordX(uint8_t which, float u, float v) {
-    check_texcoord(which);
-
-    //FIXME: throw an exception
-    assert(tex_coord_dimensions_[which] >= 2);
+    if(texcoord_size(which) < 2) {
+        throw std::logic_error("Tried to write 2 texture coordinate components to a smaller attribute");
+    }
 
-    Vertex& vert = data_.at(cursor_position_);
-    vert.tex_coords[which].x = u;
-    vert.tex_coords[which].y = v;
+    const float values[] = { u, v };
+    write_attribute(texcoord_bit(which), float_type_for_dimensions(tex_coord_dimensions_[which]), values, 2);
 }
 
 void VertexData::tex_coordX(uint8_t which, float u, float v, float w) {
-    check_texcoord(which);
-
-    //FIXME: throw an exception
-    assert(tex_coord_dimensions_[which] >= 3);
+    if(texcoord_size(which) < 3) {
+        throw std::logic_error("Tried to write 3 texture coordinate components to a smaller attribute");
+    }
 
-    Vertex& vert = data_.at(cursor_position_);
-    vert.tex_coords[which].x = u;
-    vert.tex_coords[which].y = v;
-    vert.tex_coords[which].z = w;
+    const float values[] = { u, v, w };
+    write_attribute(texcoord_bit(which), float_type_for_dimensions(tex_coord_dimensions_[which]), values, 3);
 }
 
 void VertexData::tex_coordX(uint8_t which, float u, float v, float w, float x) {
-    check_texcoord(which);
-
-    //FIXME: throw an exception
-    assert(tex_coord_dimensions_[which] >= 4);
+    if(texcoord_size(which) < 4) {
+        throw std::logic_error("Tried to write 4 texture coordinate components to a smaller attribute");
+    }
 
-    Vertex& vert = data_.at(cursor_position_);
-    vert.tex_coords[which].x = u;
-    vert.tex_coords[which].y = v;
-    vert.tex_coords[which].z = w;
-    vert.tex_coords[which].w = x;
+    const float values[] = { u, v, w, x };
+    write_attribute(texcoord_bit(which), float_type_for_dimensions(tex_coord_dimensions_[which]), values, 4);
 }
 
 void VertexData::tex_coord0(float u) {
@@ -237,45 +607,178 @@ void VertexData::tex_coord3(float u, float v, float w, float x) {
     tex_coordX(3, u, v, w, x);
 }
 
-void VertexData::diffuse(float r, float g, float b, float a) {
-    check_or_add_attribute(BM_DIFFUSE);
+void VertexData::tex_coord4(float u) {
+    tex_coordX(4, u);
+}
 
-    Vertex& vert = data_.at(cursor_position_);
-    vert.diffuse.r = r;
-    vert.diffuse.g = g;
-    vert.diffuse.b = b;
-    vert.diffuse.a = a;
+void VertexData::tex_coord4(float u, float v) {
+    tex_coordX(4, u, v);
+}
+
+void VertexData::tex_coord4(float u, float v, float w) {
+    tex_coordX(4, u, v, w);
+}
+
+void VertexData::tex_coord4(float u, float v, float w, float x) {
+    tex_coordX(4, u, v, w, x);
+}
+
+void VertexData::diffuse(float r, float g, float b, float a) {
+    const float values[] = { r, g, b, a };
+    write_attribute(BM_DIFFUSE, VERTEX_ATTRIBUTE_TYPE_4F, values, 4);
 }
 
 void VertexData::diffuse(const Colour& colour) {
     diffuse(colour.r, colour.g, colour.b, colour.a);
 }
 
+void VertexData::specular(float r, float g, float b, float a) {
+    const float values[] = { r, g, b, a };
+    write_attribute(BM_SPECULAR, VERTEX_ATTRIBUTE_TYPE_4F, values, 4);
+}
+
+void VertexData::specular(const Colour& colour) {
+    specular(colour.r, colour.g, colour.b, colour.a);
+}
+
+void VertexData::reserve(uint32_t vertex_count) {
+    data_.reserve(vertex_count * stride_);
+}
+
+void VertexData::resize(uint32_t vertex_count) {
+    if(vertex_count > vertex_count_) {
+        grow_to(vertex_count);
+        return;
+    }
+
+    data_.resize(vertex_count * stride_);
+    vertex_count_ = vertex_count;
+    cursor_position_ = std::min(cursor_position_, (int32_t) vertex_count_);
+}
+
+void VertexData::grow_to(uint32_t vertex_count) {
+    if(vertex_count <= vertex_count_) {
+        return;
+    }
+
+    data_.resize(vertex_count * stride_, 0);
+    dirty_ranges_.mark(vertex_count_, vertex_count - vertex_count_);
+    vertex_count_ = vertex_count;
+}
+
+void VertexData::write_attribute_stream(
+    AttributeBitMask attr, VertexAttributeType default_type, uint32_t first,
+    const uint8_t* values, uint8_t components, uint32_t count, uint32_t source_stride) {
+
+    if(!count) {
+        return;
+    }
+
+    if(first > vertex_count_) {
+        throw std::out_of_range("Tried to write vertices past the end of the data");
+    }
+
+    if(!specification_.has_attribute(attr)) {
+        VertexSpecification new_spec = specification_;
+        new_spec.set_attribute(attr, default_type);
+        apply_specification(new_spec);
+    }
+
+    grow_to(first + count);
+
+    VertexAttributeType type = specification_.attribute(attr);
+    uint8_t* out = &data_[first * stride_ + specification_.offset(attr)];
+
+    bool is_float = type >= VERTEX_ATTRIBUTE_TYPE_1F && type <= VERTEX_ATTRIBUTE_TYPE_4F;
+    if(is_float && vertex_attribute_component_count(type) == components) {
+        //Same format as the source, so this is just a strided copy
+        uint32_t size = components * sizeof(float);
+        for(uint32_t i = 0; i < count; ++i, out += stride_, values += source_stride) {
+            std::memcpy(out, values, size);
+        }
+    } else {
+        uint8_t to_copy = std::min(components, vertex_attribute_component_count(type));
+        for(uint32_t i = 0; i < count; ++i, out += stride_, values += source_stride) {
+            float padded[4] = {0, 0, 0, 0};
+            if(attr == BM_DIFFUSE || attr == BM_SPECULAR) {
+                padded[3] = 1.0f;
+            }
+
+            std::memcpy(padded, values, to_copy * sizeof(float));
+            encode_attribute(out, type, padded);
+        }
+    }
+
+    dirty_ranges_.mark(first, count);
+}
+
+void VertexData::write_positions(uint32_t first, const kmVec3* values, uint32_t count, uint32_t source_stride) {
+    write_attribute_stream(BM_POSITIONS, VERTEX_ATTRIBUTE_TYPE_3F, first, (const uint8_t*) values, 3, count, source_stride);
+}
+
+void VertexData::write_normals(uint32_t first, const kmVec3* values, uint32_t count, uint32_t source_stride) {
+    write_attribute_stream(BM_NORMALS, VERTEX_ATTRIBUTE_TYPE_3F, first, (const uint8_t*) values, 3, count, source_stride);
+}
+
+void VertexData::write_diffuse(uint32_t first, const Colour* values, uint32_t count, uint32_t source_stride) {
+    write_attribute_stream(BM_DIFFUSE, VERTEX_ATTRIBUTE_TYPE_4F, first, (const uint8_t*) values, 4, count, source_stride);
+}
+
+void VertexData::write_specular(uint32_t first, const Colour* values, uint32_t count, uint32_t source_stride) {
+    write_attribute_stream(BM_SPECULAR, VERTEX_ATTRIBUTE_TYPE_4F, first, (const uint8_t*) values, 4, count, source_stride);
+}
+
+void VertexData::write_tex_coords(uint8_t which, uint32_t first, const float* values, uint32_t count, uint32_t source_stride) {
+    uint8_t components = texcoord_size(which);
+    if(!source_stride) {
+        source_stride = components * sizeof(float);
+    }
+
+    write_attribute_stream(
+        texcoord_bit(which), float_type_for_dimensions(tex_coord_dimensions_[which]),
+        first, (const uint8_t*) values, components, count, source_stride
+    );
+}
+
+void VertexData::write_interleaved(uint32_t first, const uint8_t* vertices, uint32_t count) {
+    if(!count) {
+        return;
+    }
+
+    if(first > vertex_count_) {
+        throw std::out_of_range("Tried to write vertices past the end of the data");
+    }
+
+    grow_to(first + count);
+    std::memcpy(&data_[first * stride_], vertices, count * stride_);
+    dirty_ranges_.mark(first, count);
+}
+
 void VertexData::move_to_start() {
     move_to(0);
 }
 
 void VertexData::move_to_end() {
-    move_to(data_.size());
+    move_to(vertex_count_);
 }
 
-void VertexData::move_by(int16_t amount) {
+void VertexData::move_by(int32_t amount) {
     cursor_position_ += amount;
 }
 
-void VertexData::move_to(uint16_t index) {
-    if(index > data_.size()) {
+void VertexData::move_to(uint32_t index) {
+    if(index > vertex_count_) {
         throw std::out_of_range("Tried to move outside the range of the data");
     }
 
     cursor_position_ = index;
 }
 
-uint16_t VertexData::move_next() {
+uint32_t VertexData::move_next() {
     cursor_position_++;
 
-    //cursor_position_ == data_.size() is allowed (see position())
-    if(cursor_position_ > (int32_t) data_.size()) {
+    //cursor_position_ == vertex_count_ is allowed (see position())
+    if(cursor_position_ > (int32_t) vertex_count_) {
         throw std::out_of_range("Cursor moved out of range");
     }
 
@@ -290,7 +793,8 @@ void VertexData::done() {
     signal_update_complete_();
 }
 
-IndexData::IndexData() {
+IndexData::IndexData():
+    index_type_(INDEX_TYPE_16_BIT) {
 
 }
 
@@ -298,7 +802,102 @@ void IndexData::reset() {
     clear();
 }
 
+void IndexData::clear() {
+    if(index_type_ != INDEX_TYPE_16_BIT) {
+        dirty_ranges_.mark_all();
+    }
+
+    short_indices_.clear();
+    int_indices_.clear();
+    index_type_ = INDEX_TYPE_16_BIT;
+}
+
+void IndexData::reserve(uint32_t size) {
+    if(index_type_ == INDEX_TYPE_16_BIT) {
+        short_indices_.reserve(size);
+    } else {
+        int_indices_.reserve(size);
+    }
+}
+
+void IndexData::widen() {
+    int_indices_.assign(short_indices_.begin(), short_indices_.end());
+    short_indices_.clear();
+    short_indices_.shrink_to_fit();
+    index_type_ = INDEX_TYPE_32_BIT;
+    dirty_ranges_.mark_all();
+}
+
+void IndexData::index(uint32_t idx) {
+    if(index_type_ == INDEX_TYPE_16_BIT) {
+        if(idx <= std::numeric_limits<uint16_t>::max()) {
+            dirty_ranges_.mark(short_indices_.size());
+            short_indices_.push_back(idx);
+            return;
+        }
+
+        widen();
+    }
+
+    dirty_ranges_.mark(int_indices_.size());
+    int_indices_.push_back(idx);
+}
+
+void IndexData::index(const uint32_t* indices, uint32_t count) {
+    if(!count) {
+        return;
+    }
+
+    if(index_type_ == INDEX_TYPE_16_BIT) {
+        uint32_t highest = *std::max_element(indices, indices + count);
+        if(highest <= std::numeric_limits<uint16_t>::max()) {
+            dirty_ranges_.mark(short_indices_.size(), count);
+            short_indices_.insert(short_indices_.end(), indices, indices + count);
+            return;
+        }
+
+        widen();
+    }
+
+    dirty_ranges_.mark(int_indices_.size(), count);
+    int_indices_.insert(int_indices_.end(), indices, indices + count);
+}
+
+uint32_t IndexData::at(const uint32_t i) const {
+    return (index_type_ == INDEX_TYPE_16_BIT) ? short_indices_.at(i) : int_indices_.at(i);
+}
+
+uint32_t IndexData::count() const {
+    return (index_type_ == INDEX_TYPE_16_BIT) ? short_indices_.size() : int_indices_.size();
+}
+
+std::vector<uint32_t> IndexData::all() const {
+    if(index_type_ == INDEX_TYPE_16_BIT) {
+        return std::vector<uint32_t>(short_indices_.begin(), short_indices_.end());
+    }
+    return int_indices_;
+}
+
+void* IndexData::_raw_data() {
+    if(index_type_ == INDEX_TYPE_16_BIT) {
+        return &short_indices_[0];
+    }
+    return &int_indices_[0];
+}
+
 void IndexData::done() {
+    if(index_type_ == INDEX_TYPE_32_BIT) {
+        //If the indices were rewritten and now fit in 16 bits, narrow them again
+        uint32_t highest = int_indices_.empty() ? 0 : *std::max_element(int_indices_.begin(), int_indices_.end());
+        if(highest <= std::numeric_limits<uint16_t>::max()) {
+            short_indices_.assign(int_indices_.begin(), int_indices_.end());
+            int_indices_.clear();
+            int_indices_.shrink_to_fit();
+            index_type_ = INDEX_TYPE_16_BIT;
+            dirty_ranges_.mark_all();
+        }
+    }
+
     signal_update_complete_();
 }
 
@@ -29,37 +29,51 @@ enum AttributeBitMask {
     BM_SPECULAR = 256
 };
 
+enum VertexAttributeType {
+    VERTEX_ATTRIBUTE_TYPE_EMPTY = 0,
+    VERTEX_ATTRIBUTE_TYPE_1F,
+    VERTEX_ATTRIBUTE_TYPE_2F,
+    VERTEX_ATTRIBUTE_TYPE_3F,
+    VERTEX_ATTRIBUTE_TYPE_4F,
+    VERTEX_ATTRIBUTE_TYPE_2H, ///< Two half floats
+    VERTEX_ATTRIBUTE_TYPE_4H, ///< Four half floats
+    VERTEX_ATTRIBUTE_TYPE_4UB_NORMALIZED, ///< Four unsigned bytes, mapped to 0.0 - 1.0 (e.g. colours)
+    VERTEX_ATTRIBUTE_TYPE_PACKED_NORMAL ///< Signed 10-10-10-2, mapped to -1.0 - 1.0 (e.g. normals)
+};
+
+uint32_t vertex_attribute_size(VertexAttributeType type);
+uint8_t vertex_attribute_component_count(VertexAttributeType type);
+
+const uint8_t MAX_TEXCOORDS = 5;
+
 /*
- *  FIXME:
- *  The BufferObject maintained by VertexData includes all attributes, even if some of them
- *  haven't been used - this is ridiculously inefficient. Also the values returned from the *_offset
- *  methods are fixed and don't vary according to the attributes being used. What should happen
- *  is the buffer object should only include the attributes in use, and the offset methods should
- *  throw an exception if they are called on a VertexData instance that doesn't have the associated
- *  attribute in use. Similarly, texture coordinates should only take up the correct size in the
- *  buffer object and not always the full 4 floats.
+ *  Describes which attributes a VertexData stores and how each of them is stored. Attributes
+ *  are tightly packed in the order position, normal, texcoords, diffuse, specular and attributes
+ *  which are EMPTY take up no space at all.
  */
+struct VertexSpecification {
+    VertexAttributeType position_attribute = VERTEX_ATTRIBUTE_TYPE_EMPTY;
+    VertexAttributeType normal_attribute = VERTEX_ATTRIBUTE_TYPE_EMPTY;
+    VertexAttributeType texcoord_attributes[MAX_TEXCOORDS] = {
+        VERTEX_ATTRIBUTE_TYPE_EMPTY, VERTEX_ATTRIBUTE_TYPE_EMPTY,
+        VERTEX_ATTRIBUTE_TYPE_EMPTY, VERTEX_ATTRIBUTE_TYPE_EMPTY,
+        VERTEX_ATTRIBUTE_TYPE_EMPTY
+    };
+    VertexAttributeType diffuse_attribute = VERTEX_ATTRIBUTE_TYPE_EMPTY;
+    VertexAttributeType specular_attribute = VERTEX_ATTRIBUTE_TYPE_EMPTY;
 
-struct Vertex {
-    kmVec3 position;
-    kmVec3 normal;
-    kmVec4 tex_coords[8];
-    Colour diffuse;
-    Colour specular;
-
-    bool operator==(const Vertex& other) const {
-        for(uint8_t i = 0; i < 8; ++i) {
-
-            if(!kmVec4AreEqual(&this->tex_coords[i], &other.tex_coords[i])) {
-                return false;
-            }
-        }
-
-        return kmVec3AreEqual(&this->position, &other.position) &&
-               kmVec3AreEqual(&this->normal, &other.normal) &&
-                this->diffuse == other.diffuse &&
-                this->specular == other.specular;
-    }
+    bool operator==(const VertexSpecification& other) const;
+    bool operator!=(const VertexSpecification& other) const { return !(*this == other); }
+
+    VertexAttributeType attribute(AttributeBitMask attr) const;
+    void set_attribute(AttributeBitMask attr, VertexAttributeType type);
+
+    bool has_attribute(AttributeBitMask attr) const { return attribute(attr) != VERTEX_ATTRIBUTE_TYPE_EMPTY; }
+
+    uint32_t stride() const;
+
+    /* Throws a logic_error if the attribute isn't part of the specification */
+    uint32_t offset(AttributeBitMask attr) const;
 };
 
 class VertexData :
@@ -67,16 +81,25 @@ class VertexData :
 
 public:
     VertexData();
+    VertexData(const VertexSpecification& specification);
 
     void reset();
     void set_texture_coordinate_dimensions(uint8_t coord_index, uint8_t count);
 
+    /*
+     * Declares the storage format of the vertex attributes. Any existing vertices are
+     * converted to the new format. Attributes which aren't declared are added (as floats)
+     * when they are first written to the first vertex.
+     */
+    void set_specification(const VertexSpecification& specification);
+    const VertexSpecification& specification() const { return specification_; }
+
     void clear();
     void move_to_start();
-    void move_by(int16_t amount);
-    void move_to(uint16_t index);
+    void move_by(int32_t amount);
+    void move_to(uint32_t index);
     void move_to_end();
-    uint16_t move_next();
+    uint32_t move_next();
 
     void done();
 
@@ -86,17 +109,13 @@ public:
     void position(const kmVec3& pos);
     void position(const kmVec2& pos);
 
-    kmVec3 position_at(uint16_t idx) {
-        return data_.at(idx).position;
-    }
+    kmVec3 position_at(uint32_t idx) const;
 
     kglt::Vec3 normal() const;
     void normal(float x, float y, float z);
     void normal(const kmVec3& n);
 
-    kmVec3 normal_at(uint16_t idx) {
-        return data_.at(idx).normal;
-    }
+    kmVec3 normal_at(uint32_t idx) const;
 
     void tex_coord0(float u);
     void tex_coord0(float u, float v);
@@ -134,6 +153,26 @@ public:
     void specular(float r, float g, float b, float a);
     void specular(const Colour& colour);
 
+    void reserve(uint32_t vertex_count);
+    void resize(uint32_t vertex_count);
+
+    /*
+     * Bulk writes. These write count values starting at vertex first, reading the next value every
+     * source_stride bytes so they can be pointed straight at a member of an array of structs. The
+     * data grows if the write runs past the last vertex. Missing attributes are added and the
+     * existing vertices converted, so declare the format up front with set_specification().
+     */
+    void write_positions(uint32_t first, const kmVec3* values, uint32_t count, uint32_t source_stride=sizeof(kmVec3));
+    void write_normals(uint32_t first, const kmVec3* values, uint32_t count, uint32_t source_stride=sizeof(kmVec3));
+    void write_diffuse(uint32_t first, const Colour* values, uint32_t count, uint32_t source_stride=sizeof(Colour));
+    void write_specular(uint32_t first, const Colour* values, uint32_t count, uint32_t source_stride=sizeof(Colour));
+
+    /* Each value is texcoord_size(which) floats. A source_stride of 0 means they are tightly packed */
+    void write_tex_coords(uint8_t which, uint32_t first, const float* values, uint32_t count, uint32_t source_stride=0);
+
+    /* Copies whole vertices which are already laid out as specification() describes */
+    void write_interleaved(uint32_t first, const uint8_t* vertices, uint32_t count);
+
     bool has_positions() const { return enabled_bitmask_ & BM_POSITIONS; }
     bool has_normals() const { return enabled_bitmask_ & BM_NORMALS; }
     bool has_texcoord0() const { return enabled_bitmask_ & BM_TEXCOORD_0; }
@@ -144,112 +183,112 @@ public:
     bool has_diffuse() const { return enabled_bitmask_ & BM_DIFFUSE; }
     bool has_specular() const { return enabled_bitmask_ & BM_SPECULAR; }
 
-    uint16_t count() const { return data_.size(); }
+    uint32_t count() const { return vertex_count_; }
 
     bool operator==(const VertexData& other) const {
-        return this->data_ == other.data_;
+        return this->specification_ == other.specification_ && this->data_ == other.data_;
     }
 
     bool operator!=(const VertexData& other) const {
         return !(*this == other);
     }
 
-    uint32_t stride() const { return sizeof(Vertex); }
-
-    uint32_t position_offset() const {
-        Vertex vert;
-        return uint64_t(&vert.position) - uint64_t(&vert);
-    }
-
-    uint32_t normal_offset() const {
-        Vertex vert;
-        return uint64_t(&vert.normal) - uint64_t(&vert);
-    }
-
-    uint32_t texcoord0_offset() const {
-        Vertex vert;
-        return uint64_t(&vert.tex_coords[0]) - uint64_t(&vert);
-    }
-
-    uint32_t texcoord1_offset() const {
-        Vertex vert;
-        return uint64_t(&vert.tex_coords[1]) - uint64_t(&vert);
-    }
-
-    uint32_t texcoord2_offset() const {
-        Vertex vert;
-        return uint64_t(&vert.tex_coords[2]) - uint64_t(&vert);
-    }
+    uint32_t stride() const { return stride_; }
 
-    uint32_t texcoord3_offset() const {
-        Vertex vert;
-        return uint64_t(&vert.tex_coords[3]) - uint64_t(&vert);
-    }
-
-    uint32_t texcoord4_offset() const {
-        Vertex vert;
-        return uint64_t(&vert.tex_coords[4]) - uint64_t(&vert);
-    }
+    uint32_t position_offset() const { return specification_.offset(BM_POSITIONS); }
+    uint32_t normal_offset() const { return specification_.offset(BM_NORMALS); }
+    uint32_t texcoord0_offset() const { return specification_.offset(BM_TEXCOORD_0); }
+    uint32_t texcoord1_offset() const { return specification_.offset(BM_TEXCOORD_1); }
+    uint32_t texcoord2_offset() const { return specification_.offset(BM_TEXCOORD_2); }
+    uint32_t texcoord3_offset() const { return specification_.offset(BM_TEXCOORD_3); }
+    uint32_t texcoord4_offset() const { return specification_.offset(BM_TEXCOORD_4); }
+    uint32_t diffuse_offset() const { return specification_.offset(BM_DIFFUSE); }
+    uint32_t specular_offset() const { return specification_.offset(BM_SPECULAR); }
 
-    uint32_t diffuse_offset() const {
-        Vertex vert;
-        return uint64_t(&vert.diffuse) - uint64_t(&vert);
-    }
+    uint8_t texcoord_size(uint8_t which) const;
 
-    uint32_t specular_offset() const {
-        Vertex vert;
-        return uint64_t(&vert.specular) - uint64_t(&vert);
-    }
+    sig::signal<void ()>& signal_update_complete() { return signal_update_complete_; }
 
-    uint8_t texcoord_size(uint8_t which) const {
-        if(which >= 8) {
-            throw std::out_of_range("Invalid tex coordinate index");
-        }
-        return tex_coord_dimensions_[which];
-    }
+    /* The vertices modified since the data was last uploaded, cleared by whoever uploads it */
+    const DirtyRanges& dirty_ranges() const { return dirty_ranges_; }
+    void mark_clean() { dirty_ranges_.clear(); }
 
-    sig::signal<void ()>& signal_update_complete() { return signal_update_complete_; }
+    /*
+     * Rebuilds the vertices so that vertex i is the old vertex at old_indices[i]. Vertices
+     * can be dropped or duplicated. Any indices referencing this data must be updated by the caller.
+     */
+    void remap(const std::vector<uint32_t>& old_indices);
 
-    Vertex* _raw_data() { return &data_[0]; }
+    uint8_t* _raw_data() { return &data_[0]; }
+    const uint8_t* _raw_data() const { return &data_[0]; }
 
     bool empty() const { return data_.empty(); }
 
 private:
     int32_t enabled_bitmask_;
-    uint8_t tex_coord_dimensions_[8];
+    uint8_t tex_coord_dimensions_[MAX_TEXCOORDS];
+
+    VertexSpecification declared_specification_;
+    VertexSpecification specification_;
+    uint32_t stride_;
 
-    std::vector<Vertex> data_;
+    std::vector<uint8_t> data_;
+    uint32_t vertex_count_;
     int32_t cursor_position_;
 
-    void check_or_add_attribute(AttributeBitMask attr);
+    void check_or_add_attribute(AttributeBitMask attr, VertexAttributeType default_type);
+    void apply_specification(const VertexSpecification& specification);
+
+    void write_attribute(AttributeBitMask attr, VertexAttributeType default_type, const float* values, uint8_t count);
+    void write_attribute_stream(
+        AttributeBitMask attr, VertexAttributeType default_type, uint32_t first,
+        const uint8_t* values, uint8_t components, uint32_t count, uint32_t source_stride
+    );
+    void grow_to(uint32_t vertex_count);
+    kmVec4 read_attribute(uint32_t idx, AttributeBitMask attr) const;
 
     void tex_coordX(uint8_t which, float u);
     void tex_coordX(uint8_t which, float u, float v);
     void tex_coordX(uint8_t which, float u, float v, float w);
     void tex_coordX(uint8_t which, float x, float y, float z, float w);
-    void check_texcoord(uint8_t which);
+
+    DirtyRanges dirty_ranges_;
 
     sig::signal<void ()> signal_update_complete_;
 };
 
 
+enum IndexType {
+    INDEX_TYPE_16_BIT,
+    INDEX_TYPE_32_BIT
+};
+
+/*
+ *  Indices are stored as 16 bit values until an index is added which doesn't fit, at which
+ *  point the whole buffer is widened to 32 bit. done() narrows the buffer back down if
+ *  everything fits in 16 bits again, so the GPU always gets the smallest type possible.
+ */
 class IndexData {
 public:
     IndexData();
 
     void reset();
-    void clear() { indices_.clear(); }
-    void reserve(uint16_t size) { indices_.reserve(size); }
-    void index(uint16_t idx) { indices_.push_back(idx); }
+    void clear();
+    void reserve(uint32_t size);
+    void index(uint32_t idx);
+    void index(const uint32_t* indices, uint32_t count);
     void done();
-    uint16_t at(const uint16_t i) { return indices_.at(i); }
+    uint32_t at(const uint32_t i) const;
+
+    uint32_t count() const;
 
-    uint16_t count() const { return indices_.size(); }
+    std::vector<uint32_t> all() const;
 
-    const std::vector<uint16_t>& all() const { return indices_; }
+    IndexType index_type() const { return index_type_; }
+    uint32_t index_size() const { return (index_type_ == INDEX_TYPE_16_BIT) ? sizeof(uint16_t) : sizeof(uint32_t); }
 
     bool operator==(const IndexData& other) const {
-        return this->indices_ == other.indices_;
+        return this->all() == other.all();
     }
 
     bool operator!=(const IndexData& other) const {
@@ -258,9 +297,18 @@ public:
 
     sig::signal<void ()>& signal_update_complete() { return signal_update_complete_; }
 
-    uint16_t* _raw_data() { return &indices_[0]; }
+    const DirtyRanges& dirty_ranges() const { return dirty_ranges_; }
+    void mark_clean() { dirty_ranges_.clear(); }
+
+    void* _raw_data();
 private:
-    std::vector<uint16_t> indices_;
+    IndexType index_type_;
+    std::vector<uint16_t> short_indices_;
+    std::vector<uint32_t> int_indices_;
+
+    DirtyRanges dirty_ranges_;
+
+    void widen();
 
     sig::signal<void ()> signal_update_complete_;
 };
@@ -15,11 +15,13 @@
 #include "loaders/tiled_loader.h"
 #include "loaders/particle_script.h"
 #include "loaders/heightmap_loader.h"
+#include "loaders/q2bsp_loader.h"
 
 #include "sound.h"
 #include "camera.h"
 #include "lua/console.h"
 #include "watcher.h"
+#include "job_system.h"
 #include "message_bar.h"
 #include "render_sequence.h"
 #include "stage.h"
@@ -50,7 +52,8 @@ WindowBase::WindowBase():
     frame_time_in_milliseconds_(0),
     total_time_(0),
     render_sequence_(new RenderSequence(*this)),
-    routes_(new ScreenManager(*this)) {
+    routes_(new ScreenManager(*this)),
+    job_system_(new JobSystem()) {
 
     ktiGenTimers(1, &fixed_timer_);
     ktiBindTimer(fixed_timer_);
@@ -65,6 +68,7 @@ WindowBase::WindowBase():
 
 WindowBase::~WindowBase() {
     //FIXME: Make WindowBase Managed<> and put this in cleanup()
+    job_system_.reset(); //Runs any outstanding jobs before the things they use go away
     loading_.reset();
     message_bar_.reset();
     console_.reset();
@@ -149,6 +153,7 @@ bool WindowBase::_init(int width, int height, int bpp, bool fullscreen) {
         register_loader(std::make_shared<kglt::loaders::OBJLoaderType>());
         register_loader(std::make_shared<kglt::loaders::TiledLoaderType>());
         register_loader(std::make_shared<kglt::loaders::HeightmapLoaderType>());
+        register_loader(std::make_shared<kglt::loaders::Q2BSPLoaderType>());
 
         L_INFO("Initializing OpenAL");
         Sound::init_openal();
@@ -261,6 +266,9 @@ bool WindowBase::run_frame() {
 
     signal_frame_finished_();
 
+    //Nothing from this frame is still using the arena by now
+    frame_arena_.reset();
+
     if(!is_running_) {
         signal_shutdown_();
 
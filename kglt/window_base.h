@@ -9,6 +9,7 @@
 #include "generic/property.h"
 #include "generic/manager.h"
 #include "generic/data_carrier.h"
+#include "generic/linear_arena.h"
 
 #include "resource_locator.h"
 
@@ -45,6 +46,7 @@ class RenderSequence;
 class SceneImpl;
 class Watcher;
 class VirtualGamepad;
+class JobSystem;
 
 typedef std::function<void (double)> WindowUpdateCallback;
 typedef std::shared_ptr<Loader> LoaderPtr;
@@ -259,6 +261,11 @@ private:
 
     std::shared_ptr<ScreenManager> routes_;
 
+    std::shared_ptr<JobSystem> job_system_;
+
+    //Transient render data, only for use on the render thread. Reset when the frame finishes
+    generic::LinearArena frame_arena_;
+
 public:
 
     //Read only properties
@@ -277,6 +284,8 @@ public:
     };
 
     Property<WindowBase, IdleTaskManager> idle = { this, &WindowBase::idle_ };
+    Property<WindowBase, JobSystem> jobs = { this, &WindowBase::job_system_ };
+    Property<WindowBase, generic::LinearArena> frame_arena = { this, &WindowBase::frame_arena_ };
     Property<WindowBase, generic::DataCarrier> data = { this, &WindowBase::data_carrier_ };
     Property<WindowBase, ResourceLocator> resource_locator = { this, &WindowBase::resource_locator_ };
 
@@ -0,0 +1,171 @@
+/*
+ * Times the spatial partitioning structures against a large number of moving objects. This
+ * doesn't open a window, it works on the structures directly so that nothing else is measured.
+ *
+ * Usage: partitioner_benchmark [object_count] [frame_count]
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "kglt/partitioners/octree.h"
+#include "kglt/partitioners/aabb_tree.h"
+#include "kglt/frustum.h"
+
+using namespace kglt;
+
+/*
+ * The structures hand back Renderables from their visibility queries, so the objects have to
+ * be Renderables to be counted. Nothing here is ever drawn.
+ */
+class MovingObject:
+    public Renderable {
+
+public:
+    MovingObject(const Vec3& position, const Vec3& velocity, float size):
+        position_(position),
+        velocity_(velocity),
+        size_(size) {}
+
+    void step(float dt, float world_size) {
+        position_ += velocity_ * dt;
+
+        //Bounce off the edges of the world so that the density stays the same
+        for(float* axis: {&position_.x, &position_.y, &position_.z}) {
+            if(*axis < -world_size || *axis > world_size) {
+                velocity_ = velocity_ * -1.0f;
+                break;
+            }
+        }
+    }
+
+    const AABB aabb() const {
+        AABB result;
+        kmAABB3Initialize(&result, nullptr, size_, size_, size_);
+        return result;
+    }
+
+    const AABB transformed_aabb() const {
+        AABB result;
+        kmAABB3Initialize(&result, &position_, size_, size_, size_);
+        return result;
+    }
+
+    const Vec3 centre() const { return position_; }
+
+    const VertexData& vertex_data() const { throw std::logic_error("Not drawable"); }
+    const IndexData& index_data() const { throw std::logic_error("Not drawable"); }
+    const MeshArrangement arrangement() const { return MESH_ARRANGEMENT_TRIANGLES; }
+
+    void _update_vertex_array_object() {}
+    void _bind_vertex_array_object() {}
+
+    RenderPriority render_priority() const { return RENDER_PRIORITY_MAIN; }
+    Mat4 final_transformation() const { return Mat4(); }
+
+    const MaterialID material_id() const { return MaterialID(); }
+    const bool is_visible() const { return true; }
+
+    MeshID instanced_mesh_id() const { return MeshID(); }
+    SubMeshIndex instanced_submesh_id() const { return 0; }
+
+private:
+    Vec3 position_;
+    Vec3 velocity_;
+    float size_;
+};
+
+typedef std::chrono::high_resolution_clock Clock;
+
+double milliseconds_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void add(Octree& tree, MovingObject& object) { tree.grow(&object, &object); }
+void add(AABBTree& tree, MovingObject& object) { tree.insert(&object, &object); }
+
+void move(Octree& tree, MovingObject& object) { tree.relocate(&object); }
+void move(AABBTree& tree, MovingObject& object) { tree.update(&object); }
+
+/* The objects are taken by value so that each structure starts from the same positions */
+template<typename Tree>
+void run(const std::string& name, std::vector<MovingObject> objects, uint32_t frame_count, float world_size, const Frustum& frustum) {
+    const float dt = 1.0f / 60.0f;
+
+    Tree tree;
+
+    auto start = Clock::now();
+    for(auto& object: objects) {
+        add(tree, object);
+    }
+    std::cout << name << " insertion: " << milliseconds_since(start) << "ms" << std::endl;
+
+    RenderableList visible;
+
+    double update_time = 0.0;
+    double query_time = 0.0;
+    std::size_t visible_count = 0;
+
+    for(uint32_t frame = 0; frame < frame_count; ++frame) {
+        for(auto& object: objects) {
+            object.step(dt, world_size);
+        }
+
+        start = Clock::now();
+        for(auto& object: objects) {
+            move(tree, object);
+        }
+        update_time += milliseconds_since(start);
+
+        visible.clear();
+        start = Clock::now();
+        tree.objects_visible_from(frustum, visible);
+        query_time += milliseconds_since(start);
+
+        visible_count += visible.size();
+    }
+
+    std::cout << name << " update: " << update_time / frame_count << "ms per frame" << std::endl;
+    std::cout << name << " visibility: " << query_time / frame_count << "ms per frame (";
+    std::cout << visible_count / frame_count << " objects visible)" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    const uint32_t object_count = (argc > 1) ? std::atoi(argv[1]) : 10000;
+    const uint32_t frame_count = (argc > 2) ? std::atoi(argv[2]) : 300;
+    const float world_size = 1000.0f;
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> position(-world_size, world_size);
+    std::uniform_real_distribution<float> velocity(-20.0f, 20.0f);
+    std::uniform_real_distribution<float> size(1.0f, 10.0f);
+
+    std::vector<MovingObject> objects;
+    objects.reserve(object_count);
+    for(uint32_t i = 0; i < object_count; ++i) {
+        objects.push_back(MovingObject(
+            Vec3(position(rng), position(rng), position(rng)),
+            Vec3(velocity(rng), velocity(rng), velocity(rng)),
+            size(rng)
+        ));
+    }
+
+    //A camera in the middle of the world looking down -Z
+    kmMat4 projection;
+    kmMat4PerspectiveProjection(&projection, 45.0, 16.0 / 9.0, 1.0, world_size);
+
+    Frustum frustum;
+    frustum.build(&projection);
+
+    std::cout << "Objects: " << object_count << ", frames: " << frame_count << std::endl;
+
+    run<Octree>("Octree", objects, frame_count, world_size, frustum);
+    run<AABBTree>("AABB tree", objects, frame_count, world_size, frustum);
+
+    return 0;
+}
@@ -0,0 +1,88 @@
+/*
+ * Walks around a Quake 2 level, culled by its potentially visible sets. W and S move, A and D turn.
+ *
+ * Usage: q2bsp_sample [level.bsp]
+ */
+
+#include "kglt/kglt.h"
+#include "kglt/shortcuts.h"
+#include "kglt/loaders/q2bsp_loader.h"
+
+using namespace kglt;
+
+class GameScreen : public kglt::Screen<GameScreen> {
+public:
+    GameScreen(WindowBase& window, const unicode& level):
+        kglt::Screen<GameScreen>(window),
+        level_(level) {}
+
+    void do_load() {
+        stage_id_ = window->new_stage(PARTITIONER_BSP);
+        camera_id_ = window->new_camera();
+        window->render(stage_id_, camera_id_).with_clear();
+
+        auto stage = window->stage(stage_id_);
+        stage->host_camera(camera_id_);
+        stage->set_ambient_light(kglt::Colour(0.02, 0.02, 0.02, 1.0));
+
+        window->camera(camera_id_)->set_perspective_projection(
+            45.0,
+            float(window->width()) / float(window->height()),
+            1.0,
+            5000.0
+        );
+
+        MeshID level = stage->new_mesh_from_file(level_);
+        stage->new_actor_with_mesh(level);
+
+        auto mesh = stage->mesh(level);
+        loaders::add_lights_to_stage(stage, mesh->get<std::vector<loaders::ActorProperties> >("BSP_ACTORS"));
+        stage->camera(camera_id_)->move_to(mesh->get<Vec3>("BSP_PLAYER_START"));
+
+        window->keyboard->key_while_pressed_connect(SDL_SCANCODE_W, [&](SDL_Keysym key, double dt) {
+            window->stage(stage_id_)->camera(camera_id_)->move_forward(300.0 * dt);
+        });
+        window->keyboard->key_while_pressed_connect(SDL_SCANCODE_S, [&](SDL_Keysym key, double dt) {
+            window->stage(stage_id_)->camera(camera_id_)->move_forward(-300.0 * dt);
+        });
+        window->keyboard->key_while_pressed_connect(SDL_SCANCODE_A, [&](SDL_Keysym key, double dt) {
+            window->stage(stage_id_)->camera(camera_id_)->rotate_y(kglt::Degrees(90.0 * dt));
+        });
+        window->keyboard->key_while_pressed_connect(SDL_SCANCODE_D, [&](SDL_Keysym key, double dt) {
+            window->stage(stage_id_)->camera(camera_id_)->rotate_y(kglt::Degrees(-90.0 * dt));
+        });
+    }
+
+private:
+    unicode level_;
+
+    StageID stage_id_;
+    CameraID camera_id_;
+};
+
+class Q2Sample: public kglt::Application {
+
+public:
+    Q2Sample(const unicode& level):
+        Application("Quake 2 Renderer"),
+        level_(level) {
+
+        window->set_logging_level(kglt::LOG_LEVEL_DEBUG);
+    }
+
+private:
+    unicode level_;
+
+    bool do_init() {
+        register_screen("/", [this](WindowBase& window) {
+            return GameScreen::create(window, level_);
+        });
+        return true;
+    }
+};
+
+
+int main(int argc, char* argv[]) {
+    Q2Sample app((argc > 1) ? unicode(argv[1]) : unicode("sample_data/sample.bsp"));
+    return app.run();
+}
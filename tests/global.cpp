@@ -1,3 +1,21 @@
+#include <cstdlib>
+#include <new>
+
 #include "global.h"
 
 kglt::Window::ptr window;
+
+std::atomic<uint64_t> heap_allocation_count(0);
+
+void* operator new(std::size_t size) {
+    ++heap_allocation_count;
+
+    if(void* mem = std::malloc(size ? size : 1)) {
+        return mem;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* mem) noexcept {
+    std::free(mem);
+}
@@ -1,13 +1,19 @@
 #ifndef GLOBAL_H
 #define GLOBAL_H
 
+#include <algorithm>
+#include <atomic>
 #include "kglt/window.h"
 
 extern kglt::Window::ptr window;
 
+//Bumped by every call to the global operator new, see global.cpp
+extern std::atomic<uint64_t> heap_allocation_count;
+
 #include <kaztest/kaztest.h>
 #include <kazbase/logging.h>
 #include "kglt/window_base.h"
+#include "kglt/interfaces.h"
 
 class KGLTTestCase : public TestCase {
 public:
@@ -23,5 +29,80 @@ public:
     }
 };
 
+/* Something with bounds which can be moved around by hand, for testing the spatial structures */
+class BoundableObject :
+    public kglt::BoundableEntity {
+
+public:
+    BoundableObject(float size):
+        BoundableObject(size, size, size) {}
+
+    BoundableObject(float width, float height, float depth) {
+        kmVec3Zero(&centre_);
+        kmAABB3Initialize(&absolute_bounds_, nullptr, width, height, depth);
+    }
+
+    void set_bounds(float width, float height, float depth) {
+        kmAABB3Initialize(&absolute_bounds_,
+            &centre_,
+            width,
+            height,
+            depth
+        );
+    }
+
+    void set_centre(const kmVec3& centre) {
+        //Reinitialize the AABB with the same dimensions but a different
+        //central point.
+        kmVec3Assign(&centre_, &centre);
+        kmAABB3Initialize(&absolute_bounds_,
+            &centre_,
+            kmAABB3DiameterX(&absolute_bounds_),
+            kmAABB3DiameterY(&absolute_bounds_),
+            kmAABB3DiameterZ(&absolute_bounds_)
+        );
+    }
+
+    const kglt::AABB transformed_aabb() const {
+        return absolute_bounds_;
+    }
+
+    const kglt::AABB aabb() const {
+        kglt::AABB local;
+        kmAABB3Initialize(
+            &local,
+            nullptr,
+            kmAABB3DiameterX(&absolute_bounds_),
+            kmAABB3DiameterY(&absolute_bounds_),
+            kmAABB3DiameterZ(&absolute_bounds_)
+        );
+        return local;
+    }
+
+    const kglt::Vec3 centre() const {
+        return centre_;
+    }
+
+private:
+    kglt::AABB absolute_bounds_;
+    kglt::Vec3 centre_;
+};
+
+/* A cube of the given size around centre */
+inline kglt::AABB box(const kglt::Vec3& centre, float size) {
+    kglt::AABB result;
+    kmAABB3Initialize(&result, &centre, size, size, size);
+    return result;
+}
+
+inline kglt::Mat4 translation(const kglt::Vec3& position) {
+    kglt::Mat4 result;
+    kmMat4Translation(&result, position.x, position.y, position.z);
+    return result;
+}
+
+inline bool contains(const kglt::RenderableList& list, kglt::Renderable* renderable) {
+    return std::find(list.begin(), list.end(), renderable) != list.end();
+}
 
 #endif // GLOBAL_H
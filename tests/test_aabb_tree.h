@@ -0,0 +1,105 @@
+#ifndef TEST_AABB_TREE_H
+#define TEST_AABB_TREE_H
+
+#include <kaztest/kaztest.h>
+
+#include "kglt/kglt.h"
+#include "global.h"
+
+#include "kglt/partitioners/aabb_tree.h"
+
+class AABBTreeTest : public KGLTTestCase {
+public:
+    void test_insertion_and_removal() {
+        kglt::AABBTree tree;
+
+        std::vector<std::shared_ptr<BoundableObject>> objects;
+        for(uint32_t i = 0; i < 10; ++i) {
+            objects.push_back(std::make_shared<BoundableObject>(1));
+            objects.back()->set_centre(kglt::Vec3(i * 3, 0, 0));
+            tree.insert(objects.back().get());
+        }
+
+        assert_equal(10, tree.object_count());
+        assert_equal(19, tree.node_count()); //Every object is a leaf, plus a parent for each pair
+
+        for(auto& obj: objects) {
+            assert_true(tree.contains(obj.get()));
+        }
+
+        assert_raises(std::logic_error, std::bind(&kglt::AABBTree::insert, &tree, objects[0].get(), nullptr));
+
+        for(auto& obj: objects) {
+            tree.remove(obj.get());
+            assert_false(tree.contains(obj.get()));
+        }
+
+        assert_equal(0, tree.object_count());
+        assert_equal(0, tree.node_count());
+    }
+
+    void test_ordered_insertion_stays_balanced() {
+        kglt::AABBTree tree;
+
+        std::vector<std::shared_ptr<BoundableObject>> objects;
+        for(uint32_t i = 0; i < 256; ++i) {
+            objects.push_back(std::make_shared<BoundableObject>(1));
+            objects.back()->set_centre(kglt::Vec3(i * 2, 0, 0));
+            tree.insert(objects.back().get());
+        }
+
+        //A perfectly balanced tree would be 8 high, a list would be 255
+        assert_true(tree.height() <= 12);
+    }
+
+    void test_moving_objects() {
+        kglt::AABBTree tree(0.5);
+
+        BoundableObject obj(2);
+        tree.insert(&obj);
+
+        //The leaf extends half the object's size beyond it on each side
+        assert_close(-2.0, tree.fat_bounds(&obj).min.x, 0.0001);
+        assert_close(2.0, tree.fat_bounds(&obj).max.x, 0.0001);
+
+        obj.set_centre(kglt::Vec3(0.5, 0, 0));
+        assert_false(tree.update(&obj));
+
+        obj.set_centre(kglt::Vec3(10, 0, 0));
+        assert_true(tree.update(&obj));
+
+        kglt::AABB bounds = obj.transformed_aabb();
+        assert_true(kmAABB3ContainsAABB(&tree.fat_bounds(&obj), &bounds) == KM_CONTAINS_ALL);
+    }
+
+    void test_visible_from() {
+        kmMat4 projection;
+        kmMat4OrthographicProjection(&projection, -10.0, 10.0, -10.0, 10.0, 1.0, 100.0);
+
+        kglt::Frustum frustum;
+        frustum.build(&projection);
+
+        kglt::AABBTree tree;
+
+        std::vector<std::shared_ptr<BoundableObject>> objects;
+        for(int32_t i = -20; i <= 20; ++i) {
+            objects.push_back(std::make_shared<BoundableObject>(1));
+            objects.back()->set_centre(kglt::Vec3(i * 2, 0, -50));
+            tree.insert(objects.back().get());
+        }
+
+        std::set<const kglt::BoundableEntity*> visible;
+        tree.visit_visible(frustum, [&visible](const kglt::BoundableEntity* obj, kglt::Renderable*) {
+            visible.insert(obj);
+        });
+
+        //Those with their centres from -10 to 10, the ones at the edges are half inside
+        assert_equal(11, visible.size());
+        for(auto& obj: objects) {
+            bool inside = std::abs(obj->centre().x) <= 10.5;
+            assert_equal(inside, visible.count(obj.get()) == 1);
+        }
+    }
+};
+
+#endif // TEST_AABB_TREE_H
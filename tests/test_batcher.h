@@ -15,7 +15,8 @@ public:
     void set_up() {
         KGLTTestCase::set_up();
 
-        root_group_.reset(new RootGroup(*window, StageID(), CameraID()));
+        resources_.reset(new FrameResources(*window));
+        root_group_.reset(new RootGroup(*window, *resources_, arena_, StageID(), CameraID()));
     }
 
     void test_group_creation() {
@@ -28,7 +29,152 @@ public:
         assert_false(root_group_->get<TextureGroup>(TextureGroupData(0, TextureID())).exists<TextureGroup>(TextureGroupData(1, TextureID(2))));
     }    
 
+    void test_frame_cache_looks_up_once() {
+        generic::FrameCache<TextureID, int> cache;
+
+        int lookups = 0;
+        auto lookup = [&](TextureID id) -> std::shared_ptr<int> {
+            ++lookups;
+            return std::make_shared<int>(id.value());
+        };
+
+        //Enough to make the table grow
+        for(uint32_t i = 1; i <= 200; ++i) {
+            assert_equal((int) i, *cache.get(TextureID(i), lookup));
+        }
+        for(uint32_t i = 1; i <= 200; ++i) {
+            assert_equal((int) i, *cache.get(TextureID(i), lookup));
+        }
+        assert_equal(200, lookups);
+
+        cache.clear();
+        assert_equal(0, cache.size());
+        cache.get(TextureID(1), lookup);
+        assert_equal(201, lookups);
+    }
+
+    void test_frame_resources_hold_materials() {
+        StageID stage_id = window->new_stage();
+        MaterialID mat_id = window->new_material(false);
+
+        resources_->begin(stage_id);
+        Material* mat = resources_->material(mat_id);
+        assert_true(mat == window->material(mat_id).__object.get());
+        assert_true(mat == resources_->material(mat_id));
+
+        //Deleting mid-frame mustn't free it from under the renderer
+        window->delete_material(mat_id);
+        window->MaterialManager::garbage_collect();
+        assert_true(window->has_material(mat_id));
+
+        resources_->end();
+        window->MaterialManager::garbage_collect();
+        assert_false(window->has_material(mat_id));
+
+        window->delete_stage(stage_id);
+    }
+
+    /*
+     * The render group tree on its own, with blocks small enough that the arena has to grow on
+     * the first frame and must then be reused. Whole pipelines are covered below.
+     */
+    void test_steady_state_group_building_does_not_allocate() {
+        StageID stage_id = window->new_stage();
+        auto stage = window->stage(stage_id);
+        ActorID actor_id = stage->new_actor_with_mesh(window->new_mesh_as_cube(1.0));
+
+        Renderable* renderable = &stage->actor(actor_id)->subactor(0);
+        MaterialPass* pass = &window->material(window->default_material_id())->pass(0);
+
+        //Small blocks so that the first frame overflows and the arena has to grow
+        generic::LinearArena arena(1024);
+
+        auto run_frame = [&]() -> uint32_t {
+            uint32_t visited = 0;
+            {
+                RootGroup root(*window, *resources_, arena, stage_id, CameraID());
+                for(uint32_t i = 0; i < 100; ++i) {
+                    root.get_or_create<InstancedMeshGroup>(MeshGroupData(MeshID(i % 10 + 1), 0)).add(renderable, pass);
+                }
+                root.traverse([&visited](Renderable&, MaterialPass&) { ++visited; });
+            }
+            arena.reset();
+            return visited;
+        };
+
+        assert_equal(100, run_frame());
+        uint32_t blocks = arena.block_allocations();
+        assert_true(blocks > 1);
+
+        uint64_t before = heap_allocation_count;
+        uint32_t visited = run_frame();
+        uint64_t after = heap_allocation_count;
+
+        assert_equal(100, visited);
+        assert_equal(before, after);
+        assert_equal(blocks, arena.block_allocations());
+
+        window->delete_stage(stage_id);
+    }
+
+    /*
+     * Once a pipeline has been rendered, rendering it again mustn't touch the heap: everything
+     * built for it comes from the frame arena, and the camera, stage, materials and lights are
+     * held by the frame resources rather than through a ProtectedPtr.
+     */
+    void test_steady_state_pipeline_does_not_allocate() {
+        for(AvailablePartitioner partitioner: {PARTITIONER_NULL, PARTITIONER_OCTREE}) {
+            StageID stage_id = window->new_stage(partitioner);
+            CameraID camera_id = window->new_camera();
+            window->camera(camera_id)->set_perspective_projection(45.0, 1.0);
+
+            {
+                auto stage = window->stage(stage_id);
+                MeshID mesh_id = stage->new_mesh_as_cube(1.0);
+
+                for(int32_t i = 0; i < 10; ++i) {
+                    ActorID actor_id = stage->new_actor_with_mesh(mesh_id);
+                    stage->actor(actor_id)->move_to(i - 5, 0, -10);
+                }
+
+                LightID light_id = stage->new_light();
+                stage->light(light_id)->move_to(0, 0, -10);
+
+                stage->update_transforms();
+                stage->partitioner().update();
+            }
+
+            //A sequence of its own, so that only this pipeline is rendered
+            auto sequence = RenderSequence::create(*window);
+            PipelineID pipeline_id = sequence->new_pipeline(stage_id, camera_id);
+            Pipeline::ptr pipeline = sequence->pipeline(pipeline_id);
+            generic::LinearArena& arena = window->frame_arena;
+
+            int rendered = 0;
+            sequence->run_pipeline(pipeline, rendered);
+            arena.reset();
+
+            int first_frame = rendered;
+            assert_true(first_frame >= 10);
+
+            uint64_t before = heap_allocation_count;
+            sequence->run_pipeline(pipeline, rendered);
+            uint64_t after = heap_allocation_count;
+            arena.reset();
+
+            assert_equal(first_frame * 2, rendered);
+            assert_equal(before, after);
+
+            pipeline.reset();
+            sequence->delete_pipeline(pipeline_id);
+            window->delete_camera(camera_id);
+            window->delete_stage(stage_id);
+        }
+    }
+
 private:
+    generic::LinearArena arena_;
+    std::unique_ptr<FrameResources> resources_;
     kglt::RootGroup::ptr root_group_;
 };
 
@@ -0,0 +1,174 @@
+#ifndef TEST_BSP_PARTITIONER_H
+#define TEST_BSP_PARTITIONER_H
+
+#include <kaztest/kaztest.h>
+
+#include "kglt/kglt.h"
+#include "global.h"
+
+#include "kglt/partitioners/bsp_tree.h"
+#include "kglt/partitioners/bsp_partitioner.h"
+
+class BSPPartitionerTest : public KGLTTestCase {
+public:
+    void test_finding_leaves_and_clusters() {
+        kglt::BSPTree::ptr tree = two_rooms();
+
+        assert_equal(0, tree->leaf_at(kglt::Vec3(5, 0, 0)));
+        assert_equal(1, tree->leaf_at(kglt::Vec3(-5, 0, 0)));
+        assert_equal(0, tree->cluster_at(kglt::Vec3(5, 0, 0)));
+        assert_equal(1, tree->cluster_at(kglt::Vec3(-5, 0, 0)));
+
+        //Straddling the wall between them
+        std::vector<int32_t> clusters;
+        tree->clusters_overlapping(box(kglt::Vec3(0, 0, 0), 2), clusters);
+        assert_equal(2, clusters.size());
+        assert_equal(0, clusters[0]);
+        assert_equal(1, clusters[1]);
+
+        clusters.clear();
+        tree->clusters_overlapping(box(kglt::Vec3(-5, 0, 0), 2), clusters);
+        assert_equal(1, clusters.size());
+        assert_equal(1, clusters[0]);
+    }
+
+    void test_visible_sets_are_decompressed() {
+        kglt::BSPTree tree;
+        for(int32_t i = 0; i < 24; ++i) {
+            tree.add_leaf(i);
+        }
+
+        //Cluster 0 sees itself and cluster 23, with the two bytes between them run length encoded
+        std::vector<uint8_t> data = { 0x01, 0x00, 0x01, 0x80 };
+        std::vector<uint32_t> offsets(24, 0);
+        tree.set_visibility(24, offsets, data);
+
+        std::vector<uint8_t> visible;
+        tree.visible_clusters(0, visible);
+
+        assert_equal(3, visible.size());
+        for(int32_t i = 0; i < 24; ++i) {
+            assert_equal(i == 0 || i == 23, kglt::BSPTree::is_visible(visible, i));
+        }
+
+        //From outside the level everything is visible
+        tree.visible_clusters(-1, visible);
+        for(int32_t i = 0; i < 24; ++i) {
+            assert_true(kglt::BSPTree::is_visible(visible, i));
+        }
+    }
+
+    void test_only_visible_clusters_are_returned() {
+        auto stage_id = window->new_stage(kglt::PARTITIONER_BSP);
+        auto stage = window->stage(stage_id);
+
+        auto camera_id = window->new_camera();
+        window->camera(camera_id)->set_orthographic_projection(-10, 10, -10, 10, 1, 10);
+
+        //A level with a room either side of x = 0, which can't see each other
+        kglt::MeshID level_id = stage->new_mesh();
+        auto level = stage->mesh(level_id);
+
+        kglt::SubMeshIndex right = level->new_submesh_as_rectangle(window->default_material_id(), 1, 1, kglt::Vec3(5, 0, -5));
+        kglt::SubMeshIndex left = level->new_submesh_as_rectangle(window->default_material_id(), 1, 1, kglt::Vec3(-5, 0, -5));
+
+        kglt::SubMeshClusters submesh_clusters;
+        submesh_clusters[right] = { 0 };
+        submesh_clusters[left] = { 1 };
+
+        level->stash(two_rooms(), "BSP_TREE");
+        level->stash(submesh_clusters, "BSP_SUBMESH_CLUSTERS");
+
+        kglt::ActorID level_actor = stage->new_actor_with_mesh(level_id);
+
+        kglt::MeshID cube = stage->new_mesh_as_cube(1);
+        kglt::ActorID in_view = stage->new_actor_with_mesh(cube);
+        kglt::ActorID behind_wall = stage->new_actor_with_mesh(cube);
+        stage->actor(in_view)->move_to(5, 5, -5);
+        stage->actor(behind_wall)->move_to(-5, 5, -5);
+
+        stage->update_transforms();
+        stage->partitioner().update();
+
+        assert_true(((kglt::BSPPartitioner&) stage->partitioner()).has_level());
+
+        //The camera is at the origin, on the front side of the wall
+        kglt::RenderableList visible;
+        stage->partitioner().geometry_visible_from(camera_id, visible);
+
+        assert_equal(2, visible.size());
+        assert_true(contains(visible, renderable(stage, level_actor, right)));
+        assert_true(contains(visible, stage->actor(in_view)->_subactors().at(0).get()));
+
+        //Walking through into the other room
+        window->camera(camera_id)->set_transform(translation(kglt::Vec3(-1, 0, 0)));
+
+        visible.clear();
+        stage->partitioner().geometry_visible_from(camera_id, visible);
+
+        assert_equal(2, visible.size());
+        assert_true(contains(visible, renderable(stage, level_actor, left)));
+        assert_true(contains(visible, stage->actor(behind_wall)->_subactors().at(0).get()));
+
+        //Removing the level takes its visibility data with it
+        stage->delete_actor(level_actor);
+        stage->partitioner().update();
+        assert_false(((kglt::BSPPartitioner&) stage->partitioner()).has_level());
+
+        visible.clear();
+        stage->partitioner().geometry_visible_from(camera_id, visible);
+        assert_true(contains(visible, stage->actor(in_view)->_subactors().at(0).get()));
+
+        window->delete_camera(camera_id);
+        window->delete_stage(stage_id);
+    }
+
+    void test_loading_a_quake2_level() {
+        kglt::MeshID mesh_id = window->new_mesh_from_file("sample_data/sample.bsp");
+        auto mesh = window->mesh(mesh_id);
+
+        assert_true(mesh->exists("BSP_TREE"));
+        assert_true(mesh->exists("BSP_SUBMESH_CLUSTERS"));
+
+        auto tree = mesh->get<kglt::BSPTree::ptr>("BSP_TREE");
+        assert_true(tree->has_visibility());
+        assert_equal(1231, tree->cluster_count());
+
+        auto clusters = mesh->get<kglt::SubMeshClusters>("BSP_SUBMESH_CLUSTERS");
+        assert_equal(mesh->submesh_ids().size(), clusters.size());
+
+        //Quake 2 is Z-up, the start is at (-128, 208, 168) in the file
+        kglt::Vec3 start = mesh->get<kglt::Vec3>("BSP_PLAYER_START");
+        assert_close(-128, start.x, 0.001);
+        assert_close(168, start.y, 0.001);
+        assert_close(-208, start.z, 0.001);
+
+        assert_true(tree->cluster_at(start) >= 0);
+    }
+
+private:
+    //Split by the plane x = 0, cluster 0 in front and 1 behind, neither can see the other
+    kglt::BSPTree::ptr two_rooms() {
+        kglt::BSPTree::ptr tree = kglt::BSPTree::create();
+        tree->add_plane(kglt::Vec3(1, 0, 0), 0);
+        tree->add_node(0, -1, -2);
+        tree->add_leaf(0);
+        tree->add_leaf(1);
+
+        std::vector<uint8_t> data = { 0x01, 0x02 };
+        std::vector<uint32_t> offsets = { 0, 1 };
+        tree->set_visibility(2, offsets, data);
+        return tree;
+    }
+
+    kglt::Renderable* renderable(kglt::StagePtr stage, kglt::ActorID actor, kglt::SubMeshIndex submesh) {
+        for(auto& subactor: stage->actor(actor)->_subactors()) {
+            if(subactor->submesh_id() == submesh) {
+                return subactor.get();
+            }
+        }
+        return nullptr;
+    }
+};
+
+#endif // TEST_BSP_PARTITIONER_H
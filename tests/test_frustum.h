@@ -1,6 +1,8 @@
 #ifndef TEST_FRUSTUM_H
 #define TEST_FRUSTUM_H
 
+#include <chrono>
+#include <random>
 #include <kaztest/kaztest.h>
 
 #include "kglt/kglt.h"
@@ -76,6 +78,115 @@ public:
         assert_close(2.0, frustum.far_height(), 0.0001);
         assert_close(9.0, frustum.depth(), 0.0001);
     }
+
+    void test_plane_masks_and_coherency() {
+        Frustum frustum = perspective();
+
+        //Entirely inside, so the box's children don't need testing against anything
+        uint8_t mask = FRUSTUM_ALL_PLANES;
+        uint8_t first_plane = 0;
+        assert_equal(FRUSTUM_CONTAINS_ALL, frustum.classify_aabb(box(Vec3(0, 0, -10), 1), mask, first_plane));
+        assert_equal(0, mask);
+
+        //Across the right hand side, only that plane needs testing below it
+        mask = FRUSTUM_ALL_PLANES;
+        assert_equal(FRUSTUM_CONTAINS_PARTIAL, frustum.classify_aabb(box(Vec3(6, 0, -10), 2), mask, first_plane));
+        assert_equal(1 << FRUSTUM_PLANE_RIGHT, mask);
+
+        //Off to the left, the left plane is remembered for next time
+        mask = FRUSTUM_ALL_PLANES;
+        assert_equal(FRUSTUM_CONTAINS_NONE, frustum.classify_aabb(box(Vec3(-50, 0, -10), 1), mask, first_plane));
+        assert_equal(FRUSTUM_PLANE_LEFT, first_plane);
+
+        //Planes which aren't in the mask aren't tested
+        mask = FRUSTUM_ALL_PLANES & ~(1 << FRUSTUM_PLANE_LEFT);
+        first_plane = 0;
+        assert_equal(FRUSTUM_CONTAINS_ALL, frustum.classify_aabb(box(Vec3(-50, 0, -10), 1), mask, first_plane));
+    }
+
+    void test_batched_classification_matches_scalar() {
+        Frustum frustum = perspective();
+
+        //Not a multiple of four or eight, so there are spare lanes at the end
+        std::vector<kmAABB3> boxes = random_boxes(1003);
+        std::vector<FrustumClassification> results(boxes.size());
+
+        uint8_t masks[] = {
+            FRUSTUM_ALL_PLANES,
+            (1 << FRUSTUM_PLANE_LEFT) | (1 << FRUSTUM_PLANE_FAR),
+            0
+        };
+
+        for(uint8_t plane_mask: masks) {
+            frustum.classify_aabbs(&boxes[0], boxes.size(), &results[0], plane_mask);
+
+            for(uint32_t i = 0; i < boxes.size(); ++i) {
+                uint8_t mask = plane_mask;
+                uint8_t first_plane = 0;
+                assert_equal(frustum.classify_aabb(boxes[i], mask, first_plane), results[i]);
+            }
+        }
+    }
+
+    void test_batched_classification_throughput() {
+        const uint32_t ROUNDS = 50;
+
+        Frustum frustum = perspective();
+        std::vector<kmAABB3> boxes = random_boxes(10000);
+        std::vector<FrustumClassification> results(boxes.size());
+
+        uint32_t scalar_visible = 0;
+        auto start = std::chrono::steady_clock::now();
+        for(uint32_t round = 0; round < ROUNDS; ++round) {
+            for(const kmAABB3& box: boxes) {
+                scalar_visible += (frustum.classify_aabb(box) != FRUSTUM_CONTAINS_NONE);
+            }
+        }
+        auto scalar_time = std::chrono::steady_clock::now() - start;
+
+        uint32_t batched_visible = 0;
+        start = std::chrono::steady_clock::now();
+        for(uint32_t round = 0; round < ROUNDS; ++round) {
+            frustum.classify_aabbs(&boxes[0], boxes.size(), &results[0]);
+            for(FrustumClassification result: results) {
+                batched_visible += (result != FRUSTUM_CONTAINS_NONE);
+            }
+        }
+        auto batched_time = std::chrono::steady_clock::now() - start;
+
+        assert_equal(scalar_visible, batched_visible);
+
+        //Timings vary too much from machine to machine to assert on, they're reported instead
+        double scalar_ms = std::chrono::duration<double, std::milli>(scalar_time).count();
+        double batched_ms = std::chrono::duration<double, std::milli>(batched_time).count();
+        L_INFO(_u("Classified {0} boxes: scalar {1}ms, batched {2}ms").format(
+            boxes.size() * ROUNDS, scalar_ms, batched_ms
+        ));
+    }
+
+private:
+    //Looking down -z from the origin
+    Frustum perspective() {
+        kmMat4 projection;
+        kmMat4PerspectiveProjection(&projection, 60.0, 1.0, 1.0, 100.0);
+
+        Frustum frustum;
+        frustum.build(&projection);
+        return frustum;
+    }
+
+    std::vector<kmAABB3> random_boxes(uint32_t count) {
+        std::mt19937 generator(1234);
+        std::uniform_real_distribution<float> position(-120.0f, 120.0f);
+        std::uniform_real_distribution<float> size(0.1f, 20.0f);
+
+        std::vector<kmAABB3> boxes;
+        for(uint32_t i = 0; i < count; ++i) {
+            Vec3 centre(position(generator), position(generator), position(generator));
+            boxes.push_back(box(centre, size(generator)));
+        }
+        return boxes;
+    }
 };
 
 #endif // TEST_FRUSTUM_H
@@ -0,0 +1,105 @@
+#ifndef TEST_JOB_SYSTEM_H
+#define TEST_JOB_SYSTEM_H
+
+#include <atomic>
+#include <stdexcept>
+#include <kaztest/kaztest.h>
+
+#include "kglt/job_system.h"
+
+namespace {
+
+using namespace kglt;
+
+class JobSystemTest : public TestCase {
+public:
+    void test_dependencies_run_first() {
+        JobSystem jobs(3);
+
+        std::atomic<int> counter(0);
+        int first = -1, second = -1, third = -1;
+
+        JobHandle a = jobs.schedule([&]() { first = counter++; });
+        JobHandle b = jobs.schedule([&]() { second = counter++; }, {a});
+        JobHandle c = jobs.schedule([&]() { third = counter++; }, {a, b});
+
+        jobs.wait(c);
+
+        assert_true(c->is_finished());
+        assert_equal(0, first);
+        assert_equal(1, second);
+        assert_equal(2, third);
+    }
+
+    void test_parallel_for_covers_the_range() {
+        JobSystem jobs(3);
+
+        std::vector<int> hits(10000, 0);
+        jobs.parallel_for(0, hits.size(), [&](uint32_t begin, uint32_t end) {
+            for(uint32_t i = begin; i < end; ++i) {
+                hits[i]++;
+            }
+        }, 64);
+
+        for(int hit: hits) {
+            assert_equal(1, hit);
+        }
+    }
+
+    void test_works_without_workers() {
+        JobSystem jobs(0);
+
+        std::atomic<int> counter(0);
+
+        //Nested jobs, the waiting thread has to run everything itself
+        JobHandle outer = jobs.schedule([&]() {
+            JobHandle inner = jobs.schedule([&]() { counter++; });
+            jobs.wait(inner);
+            counter++;
+        });
+
+        jobs.wait(outer);
+        assert_equal(2, counter.load());
+    }
+
+    void test_queued_jobs_run_before_destruction() {
+        std::atomic<int> counter(0);
+
+        {
+            JobSystem jobs(2);
+
+            JobHandle first;
+            for(int i = 0; i < 100; ++i) {
+                JobHandle job = jobs.schedule([&]() { counter++; });
+                if(!first) {
+                    first = job;
+                }
+            }
+
+            //Released as their dependencies finish, possibly while shutting down
+            for(int i = 0; i < 10; ++i) {
+                jobs.schedule([&]() { counter++; }, {first});
+            }
+        }
+
+        assert_equal(110, counter.load());
+
+        {
+            JobSystem jobs(0);
+            jobs.schedule([&]() { counter++; });
+        }
+
+        assert_equal(111, counter.load());
+    }
+
+    void test_exceptions_are_rethrown_from_wait() {
+        JobSystem jobs(2);
+
+        JobHandle job = jobs.schedule([]() { throw std::runtime_error("boom"); });
+        assert_raises(std::runtime_error, std::bind(static_cast<void (JobSystem::*)(JobHandle)>(&JobSystem::wait), &jobs, job));
+    }
+};
+
+}
+
+#endif // TEST_JOB_SYSTEM_H
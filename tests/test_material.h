@@ -44,6 +44,44 @@ public:
         assert_true(pass.is_reflective());
         assert_true(mat->has_reflective_pass());
     }
+
+    void test_garbage_collection_is_incremental() {
+        const uint32_t COUNT = 6;
+        const uint32_t BUDGET = 2;
+
+        window->MaterialManager::garbage_collect();
+        uint32_t before = window->material_count();
+
+        //Whatever survived is still in use and sits in the queue ahead of the new materials
+        uint32_t survivors = window->MaterialManager::gc_candidate_count();
+
+        for(uint32_t i = 0; i < COUNT; ++i) {
+            //Accessing it marks it as claimed, so it can go as soon as it's let go of
+            window->material(window->new_material());
+        }
+        assert_equal(before + COUNT, window->material_count());
+
+        assert_equal(0, window->MaterialManager::garbage_collect(survivors));
+
+        //Each call deletes exactly its budget until the queue runs dry
+        for(uint32_t remaining = COUNT; remaining > 0; remaining -= BUDGET) {
+            assert_equal(BUDGET, window->MaterialManager::garbage_collect(BUDGET));
+            assert_equal(before + remaining - BUDGET, window->material_count());
+        }
+
+        assert_equal(0, window->MaterialManager::garbage_collect(BUDGET));
+        assert_equal(before, window->material_count());
+
+        //Held resources stay candidates until they're released
+        kglt::MaterialID held = window->new_material();
+        {
+            auto mat = window->material(held);
+            window->MaterialManager::garbage_collect();
+            assert_true(window->has_material(held));
+        }
+        window->MaterialManager::garbage_collect();
+        assert_false(window->has_material(held));
+    }
 };
 
 #endif // TEST_MATERIAL_H
@@ -5,6 +5,7 @@
 #include <kaztest/kaztest.h>
 
 #include "kglt/kglt.h"
+#include "kglt/utils/mesh_optimiser.h"
 #include "global.h"
 
 class MeshTest : public KGLTTestCase {
@@ -187,6 +188,44 @@ public:
         assert_equal(kglt::MaterialID(1), actor->subactor(0).material_id());
     }
 
+    void test_optimiser_welds_duplicate_vertices() {
+        auto stage = window->stage(stage_id_);
+        auto mesh = stage->mesh(stage->new_mesh());
+
+        //Unindexed quad, the diagonal vertices are duplicated
+        float corners[6][2] = { {-1, -1}, {1, -1}, {1, 1}, {-1, -1}, {1, 1}, {-1, 1} };
+
+        kglt::VertexData& data = mesh->shared_data();
+        kglt::SubMesh& submesh = mesh->submesh(mesh->new_submesh(kglt::MaterialID()));
+        for(uint32_t i = 0; i < 6; ++i) {
+            data.position(corners[i][0], corners[i][1], 0);
+            data.move_next();
+            submesh.index_data().index(i);
+        }
+        data.done();
+        submesh.index_data().done();
+
+        kglt::MeshOptimisationReport report = kglt::MeshOptimiser(window->jobs).optimise(*mesh.__object);
+
+        assert_equal((uint32_t) 6, report.vertices_before);
+        assert_equal((uint32_t) 4, report.vertices_after);
+        assert_equal((uint32_t) 4, data.count());
+        assert_equal((uint32_t) 6, submesh.index_data().count());
+        assert_true(report.acmr_after <= report.acmr_before);
+
+        //Both triangles share the diagonal, so each must still reference it
+        kmVec3 expected;
+        kmVec3Fill(&expected, 1, 1, 0);
+        for(uint32_t tri = 0; tri < 2; ++tri) {
+            bool found = false;
+            for(uint32_t i = 0; i < 3; ++i) {
+                kmVec3 pos = data.position_at(submesh.index_data().at((tri * 3) + i));
+                found = found || kmVec3AreEqual(&expected, &pos);
+            }
+            assert_true(found);
+        }
+    }
+
     void test_scene_methods() {
         auto stage = window->stage(stage_id_);
 
@@ -56,6 +56,21 @@ public:
         //Shouldn't throw
         kglt::MeshID mid = window->new_mesh_from_file("cube.obj");
     }
+
+    void test_optimisation_can_be_turned_off() {
+        unicode path = os::path::join(os::path::dir_name(__FILE__), "test-data");
+        window->resource_locator->add_search_path(path);
+
+        //Each quad is loaded as a fan of five vertices, the optimiser welds the repeated one
+        kglt::MeshID optimised = window->new_mesh_from_file("cube.obj");
+        kglt::MeshID unoptimised = window->new_mesh_from_file("cube.obj", true, {{"optimise", false}});
+
+        auto& optimised_data = window->mesh(optimised)->submesh(window->mesh(optimised)->submesh_ids()[0]).vertex_data();
+        auto& unoptimised_data = window->mesh(unoptimised)->submesh(window->mesh(unoptimised)->submesh_ids()[0]).vertex_data();
+
+        assert_equal(30, unoptimised_data.count());
+        assert_equal(24, optimised_data.count());
+    }
 };
 
 #endif // TEST_OBJ_LOADER_H
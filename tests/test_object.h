@@ -92,7 +92,181 @@ public:
         assert_equal(kglt::Vec3(10, 0, 0), actor2->relative_position());
     }
 
+    void test_absolute_transformation_is_cached() {
+        kglt::ActorID act = window->stage(stage_id_)->new_actor();
+        auto actor = window->stage(stage_id_)->actor(act);
+
+        kglt::ActorID act2 = window->stage(stage_id_)->new_actor();
+        auto actor2 = window->stage(stage_id_)->actor(act2);
+        actor2->set_parent(act);
+        actor2->set_relative_position(0, 1, 0);
+
+        uint64_t version = actor2->transform_version();
+
+        //Nothing changed, so nothing should be recalculated
+        actor2->absolute_transformation();
+        assert_equal(version, actor2->transform_version());
+
+        //Moving the parent must invalidate the child
+        actor->move_to(5, 0, 0);
+        assert_true(actor2->transform_version() != version);
+
+        kglt::Mat4 transform = actor2->absolute_transformation();
+        assert_close(5.0, transform.mat[12], 0.00001);
+        assert_close(1.0, transform.mat[13], 0.00001);
+    }
+
+    void test_transforms_are_resolved_after_reparenting() {
+        auto stage = window->stage(stage_id_);
+
+        kglt::ActorID child = stage->new_actor();
+        kglt::ActorID middle = stage->new_actor();
+        kglt::ActorID root = stage->new_actor();
+
+        //Parents created after their children, so the store must reorder itself
+        stage->actor(middle)->set_parent(root);
+        stage->actor(child)->set_parent(middle);
+
+        stage->actor(root)->move_to(1, 0, 0);
+        stage->actor(middle)->set_relative_position(0, 2, 0);
+        stage->actor(child)->set_relative_position(0, 0, 3);
+
+        stage->update_transforms();
+
+        kglt::Vec3 pos = stage->actor(child)->absolute_position();
+        assert_close(1.0, pos.x, 0.00001);
+        assert_close(2.0, pos.y, 0.00001);
+        assert_close(3.0, pos.z, 0.00001);
+
+        //Destroying the middle of the chain mustn't leave the child resolving against it
+        stage->actor(child)->set_parent(root);
+        stage->delete_actor(middle);
+        stage->update_transforms();
+
+        pos = stage->actor(child)->absolute_position();
+        assert_close(1.0, pos.x, 0.00001);
+        assert_close(0.0, pos.y, 0.00001);
+        assert_close(3.0, pos.z, 0.00001);
+    }
+
+    void test_deletion_is_deferred_during_parallel_update() {
+        auto stage = window->stage(stage_id_);
+
+        kglt::ActorID act = stage->new_actor();
+        assert_true(stage->actor(act)->is_parallel_update_safe());
+
+        stage->_begin_parallel_update();
+        stage->actor(act)->ask_owner_for_destruction();
+        assert_true(stage->has_actor(act));
+        stage->_end_parallel_update();
+
+        assert_false(stage->has_actor(act));
+
+        //Outside of the update phase nothing is held back
+        act = stage->new_actor();
+        stage->actor(act)->ask_owner_for_destruction();
+        assert_false(stage->has_actor(act));
+    }
+
+    void test_structural_changes_during_parallel_update() {
+        auto stage = window->stage(stage_id_);
+
+        kglt::ActorID parent = stage->new_actor();
+        kglt::ActorID child = stage->new_actor();
+        kglt::ActorID doomed = stage->new_actor();
+        uint32_t before = stage->actor_count();
+
+        kglt::ActorID spawned;
+
+        stage->_begin_parallel_update();
+        window->jobs->parallel_for(0, 2, [&](uint32_t begin, uint32_t end) {
+            for(uint32_t i = begin; i < end; ++i) {
+                if(i == 0) {
+                    //Spawning and reparenting have to be deferred...
+                    stage->defer([&]() {
+                        spawned = stage->new_actor_with_parent(parent);
+                        stage->actor(child)->set_parent(parent);
+                    });
+                } else {
+                    //...deleting another node is deferred for us
+                    stage->delete_actor(doomed);
+                }
+            }
+        }, 1);
+
+        assert_true(stage->has_actor(doomed));
+        assert_equal(before, stage->actor_count());
+
+        //Doing them straight away isn't allowed
+        assert_raises(std::logic_error, std::bind(&ObjectTest::spawn_actor, this));
+        assert_raises(std::logic_error, std::bind(&ObjectTest::reparent_actor, this, child, parent));
+        stage->_end_parallel_update();
+
+        assert_false(stage->has_actor(doomed));
+        assert_true(stage->has_actor(spawned));
+        assert_true(stage->actor(spawned)->parent() == stage->actor(parent).__object.get());
+        assert_true(stage->actor(child)->parent() == stage->actor(parent).__object.get());
+    }
+
+    void test_only_active_objects_are_updated() {
+        auto stage = window->stage(stage_id_);
+
+        kglt::ActorID act = stage->new_actor();
+        assert_true(stage->actor(act)->is_update_active());
+
+        //Nothing to do, so it drops out after its first update
+        window->StageManager::update(1.0 / 60.0);
+        assert_false(stage->actor(act)->is_update_active());
+
+        stage->actor(act)->constrain_to(kglt::Vec3(-1, -1, -1), kglt::Vec3(1, 1, 1));
+        assert_true(stage->actor(act)->is_update_active());
+
+        stage->actor(act)->move_to(5, 0, 0);
+        window->StageManager::update(1.0 / 60.0);
+        assert_close(1.0, stage->actor(act)->absolute_position().x, 0.00001);
+        assert_true(stage->actor(act)->is_update_active());
+
+        stage->actor(act)->disable_constraint();
+        window->StageManager::update(1.0 / 60.0);
+        assert_false(stage->actor(act)->is_update_active());
+    }
+
+    void test_hidden_stages_follow_their_update_policy() {
+        auto stage = window->stage(stage_id_);
+        assert_false(stage->is_being_rendered());
+
+        //A constrained actor shows whether the stage was updated
+        kglt::ActorID act = stage->new_actor();
+        stage->actor(act)->constrain_to(kglt::Vec3(-1, -1, -1), kglt::Vec3(1, 1, 1));
+
+        stage->set_update_policy(kglt::UPDATE_POLICY_WHEN_RENDERED);
+        stage->actor(act)->move_to(5, 0, 0);
+        window->StageManager::update(1.0 / 60.0);
+        assert_close(5.0, stage->actor(act)->absolute_position().x, 0.00001);
+
+        stage->set_update_policy(kglt::UPDATE_POLICY_REDUCED_WHEN_HIDDEN, 2);
+        window->StageManager::update(1.0 / 60.0);
+        assert_close(5.0, stage->actor(act)->absolute_position().x, 0.00001);
+        window->StageManager::update(1.0 / 60.0);
+        assert_close(1.0, stage->actor(act)->absolute_position().x, 0.00001);
+
+        double step = 0.0;
+        stage->set_update_policy(kglt::UPDATE_POLICY_REDUCED_WHEN_HIDDEN, 3);
+        assert_false(stage->_consume_update_step(0.25, step));
+        assert_false(stage->_consume_update_step(0.25, step));
+        assert_true(stage->_consume_update_step(0.25, step));
+        assert_close(0.75, step, 0.00001);
+    }
+
 private:
+    void spawn_actor() {
+        window->stage(stage_id_)->new_actor();
+    }
+
+    void reparent_actor(kglt::ActorID child, kglt::ActorID parent) {
+        window->stage(stage_id_)->actor(child)->set_parent(parent);
+    }
+
     CameraID camera_id_;
     StageID stage_id_;
 };
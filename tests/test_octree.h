@@ -14,7 +14,7 @@ public:
     void test_moving_objects() {
         kglt::Octree tree;
 
-        Object obj(10, 10, 10);
+        BoundableObject obj(10, 10, 10);
         obj.set_centre(kglt::Vec3(0, 0, 0));
 
         tree.grow(&obj); //Insert the obj
@@ -24,7 +24,66 @@ public:
         assert_equal(10, tree.root().strict_diameter());
         assert_equal(20, tree.root().loose_diameter());
 
-        //CONTINUE: write tests for relocate
+        //Small moves stay within the loose bounds, so nothing changes
+        obj.set_centre(kglt::Vec3(3, 0, 0));
+        tree.relocate(&obj);
+        assert_true(tree.find(&obj).is_root());
+
+        //Moving outside of the tree grows it
+        obj.set_centre(kglt::Vec3(30, 0, 0));
+        tree.relocate(&obj);
+
+        kglt::AABB bounds = obj.transformed_aabb();
+        assert_true(kmAABB3ContainsAABB(&tree.root().absolute_strict_bounds(), &bounds) == KM_CONTAINS_ALL);
+        assert_true(kmAABB3ContainsAABB(&tree.find(&obj).absolute_loose_bounds(), &bounds) == KM_CONTAINS_ALL);
+
+        //Small objects go down the tree, and back up and over when they leave their node
+        BoundableObject small(1, 1, 1);
+        small.set_centre(kglt::Vec3(30, 0, 0));
+        tree.grow(&small);
+
+        kglt::OctreeNode* first = &tree.find(&small);
+        assert_true(!first->is_root());
+
+        small.set_centre(kglt::Vec3(0, 0, 0));
+        tree.relocate(&small);
+
+        bounds = small.transformed_aabb();
+        assert_true(&tree.find(&small) != first);
+        assert_true(!tree.find(&small).is_root());
+        assert_true(kmAABB3ContainsAABB(&tree.find(&small).absolute_loose_bounds(), &bounds) == KM_CONTAINS_ALL);
+    }
+
+    void test_empty_nodes_are_collapsed() {
+        kglt::Octree tree;
+
+        BoundableObject big(10, 10, 10);
+        tree.grow(&big);
+
+        //Enough small objects to spill out of the node's inline storage
+        std::vector<std::shared_ptr<BoundableObject>> small;
+        for(uint32_t i = 0; i < 10; ++i) {
+            small.push_back(std::make_shared<BoundableObject>(1, 1, 1));
+            small.back()->set_centre(kglt::Vec3(-4, -4, -4));
+            tree.grow(small.back().get());
+        }
+
+        kglt::OctreeNode& leaf = tree.find(small[0].get());
+        assert_equal(10, leaf.object_count());
+        assert_true(tree.node_count() > 1);
+
+        for(auto& obj: small) {
+            tree.shrink(obj.get());
+        }
+
+        //Only the root, which still holds the big object, is left
+        assert_equal(1, tree.node_count());
+        assert_true(tree.find(&big).is_root());
+        assert_equal(0, tree.root().child_count());
+
+        tree.shrink(&big);
+        assert_false(tree.has_root());
+        assert_equal(0, tree.node_count());
     }
 
     void test_insertion() {
@@ -32,7 +91,7 @@ public:
         kglt::Octree tree;
 
         //Create an object 5 units high, centred a 10, 10, 10
-        Object obj(2, 5, 2);
+        BoundableObject obj(2, 5, 2);
         obj.set_centre(kglt::Vec3(10, 10, 10));
 
         tree.grow(&obj);
@@ -46,7 +105,7 @@ public:
         kmVec3 obj_centre = obj.centre();
         assert_true(kmVec3AreEqual(&root_centre, &obj_centre));
 
-        Object obj2(3, 3, 3); //Add a smaller object
+        BoundableObject obj2(3, 3, 3); //Add a smaller object
         obj2.set_centre(kglt::Vec3(10, 10, 17));
 
         tree.grow(&obj2);
@@ -96,61 +155,6 @@ public:
          */
 
     }
-private:
-    class Object :
-        public kglt::BoundableEntity {
-
-    public:
-        Object(float width, float height, float depth) {
-            kmVec3Zero(&centre_);
-            kmAABB3Initialize(&absolute_bounds_, nullptr, width, height, depth);
-        }
-
-        void set_bounds(float width, float height, float depth) {
-            kmAABB3Initialize(&absolute_bounds_,
-                &centre_,
-                width,
-                height,
-                depth
-            );
-        }
-
-        void set_centre(const kmVec3& centre) {
-            //Reinitialize the AABB with the same dimensions but a different
-            //central point.
-            kmVec3Assign(&centre_, &centre);
-            kmAABB3Initialize(&absolute_bounds_,
-                &centre_,
-                kmAABB3DiameterX(&absolute_bounds_),
-                kmAABB3DiameterY(&absolute_bounds_),
-                kmAABB3DiameterZ(&absolute_bounds_)
-            );
-        }
-
-        const kglt::AABB transformed_aabb() const {
-            return absolute_bounds_;
-        }
-
-        const kglt::AABB aabb() const {
-            kglt::AABB local;
-            kmAABB3Initialize(
-                &local,
-                nullptr,
-                kmAABB3DiameterX(&absolute_bounds_),
-                kmAABB3DiameterY(&absolute_bounds_),
-                kmAABB3DiameterZ(&absolute_bounds_)
-            );
-            return local;
-        }
-
-        const kglt::Vec3 centre() const {
-            return centre_;
-        }
-    private:
-        kglt::AABB absolute_bounds_;
-        kglt::Vec3 centre_;
-
-    };
 };
 
 
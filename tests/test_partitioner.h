@@ -0,0 +1,155 @@
+#ifndef TEST_PARTITIONER_H
+#define TEST_PARTITIONER_H
+
+#include <kaztest/kaztest.h>
+
+#include "kglt/kglt.h"
+#include "global.h"
+
+#include "kglt/partitioner.h"
+
+class PartitionerQueryTest : public KGLTTestCase {
+public:
+    void test_null_partitioner_queries() {
+        check_queries(kglt::PARTITIONER_NULL);
+    }
+
+    void test_octree_partitioner_queries() {
+        check_queries(kglt::PARTITIONER_OCTREE);
+    }
+
+    void test_bvh_partitioner_queries() {
+        check_queries(kglt::PARTITIONER_BVH);
+    }
+
+    void test_spatial_hash_partitioner_queries() {
+        check_queries(kglt::PARTITIONER_SPATIAL_HASH);
+    }
+
+    void test_null_partitioner_visibility() {
+        check_visibility(kglt::PARTITIONER_NULL);
+    }
+
+    void test_octree_partitioner_visibility() {
+        check_visibility(kglt::PARTITIONER_OCTREE);
+    }
+
+    void test_bvh_partitioner_visibility() {
+        check_visibility(kglt::PARTITIONER_BVH);
+    }
+
+    void test_spatial_hash_partitioner_visibility() {
+        check_visibility(kglt::PARTITIONER_SPATIAL_HASH);
+    }
+
+    void test_bsp_partitioner_visibility() {
+        //Without a level there are no clusters to hide anything
+        check_visibility(kglt::PARTITIONER_BSP);
+    }
+
+    void test_portal_partitioner_visibility() {
+        //Without a portal graph there are no zones to hide anything
+        check_visibility(kglt::PARTITIONER_PORTAL);
+    }
+
+private:
+    //Every partitioner should give the same answers, however it gets to them
+    void check_queries(kglt::AvailablePartitioner type) {
+        auto stage_id = window->new_stage(type);
+        auto stage = window->stage(stage_id);
+
+        kglt::MeshID mesh_id = stage->new_mesh_as_cube(1);
+
+        kglt::ActorID first = stage->new_actor_with_mesh(mesh_id);
+        kglt::ActorID second = stage->new_actor_with_mesh(mesh_id);
+        kglt::ActorID third = stage->new_actor_with_mesh(mesh_id);
+        kglt::ActorID above = stage->new_actor_with_mesh(mesh_id);
+
+        stage->actor(first)->move_to(0, 0, -5);
+        stage->actor(second)->move_to(5, 0, -5);
+        stage->actor(third)->move_to(10, 0, -5);
+        stage->actor(above)->move_to(0, 20, -5);
+
+        stage->update_transforms();
+        stage->partitioner().update();
+
+        auto renderable = [&stage](kglt::ActorID actor) -> kglt::Renderable* {
+            return stage->actor(actor)->_subactors().at(0).get();
+        };
+
+        kglt::Partitioner& partitioner = stage->partitioner();
+        kglt::Ray ray(kglt::Vec3(-10, 0, -5), kglt::Vec3(1, 0, 0));
+
+        kglt::RaycastHit hit;
+        assert_true(partitioner.raycast(ray, hit));
+        assert_true(hit.renderable == renderable(first));
+        assert_close(9.5, hit.distance, 0.0001);
+
+        kglt::RaycastHitList hits;
+        partitioner.raycast_all(ray, hits);
+        assert_equal(3, hits.size());
+        assert_true(hits[0].renderable == renderable(first));
+        assert_true(hits[1].renderable == renderable(second));
+        assert_true(hits[2].renderable == renderable(third));
+
+        //Stops short of the first one
+        assert_false(partitioner.raycast(kglt::Ray(kglt::Vec3(-10, 0, -5), kglt::Vec3(1, 0, 0), 9.0), hit));
+
+        kglt::AABB box;
+        kglt::Vec3 box_centre(5, 0, -5);
+        kmAABB3Initialize(&box, &box_centre, 2, 2, 2);
+
+        kglt::RenderableList found;
+        partitioner.geometry_overlapping(box, found);
+        assert_equal(1, found.size());
+        assert_true(found[0] == renderable(second));
+
+        //The edges of first and above are 9.5 away
+        found.clear();
+        partitioner.geometry_within(kglt::Vec3(0, 10, -5), 10.0, found);
+        assert_equal(2, found.size());
+
+        found.clear();
+        partitioner.nearest_geometry(kglt::Vec3(9, 0, -5), 2, found);
+        assert_equal(2, found.size());
+        assert_true(found[0] == renderable(third));
+        assert_true(found[1] == renderable(second));
+
+        window->delete_stage(stage_id);
+    }
+
+    //Whatever a partitioner does to cull, it must not lose anything the camera can see
+    void check_visibility(kglt::AvailablePartitioner type) {
+        auto stage_id = window->new_stage(type);
+        auto stage = window->stage(stage_id);
+
+        auto camera_id = window->new_camera();
+        window->camera(camera_id)->set_orthographic_projection(-10, 10, -10, 10, 1, 10);
+
+        kglt::MeshID mesh_id = stage->new_mesh_as_cube(1);
+
+        kglt::ActorID inside = stage->new_actor_with_mesh(mesh_id);
+        kglt::ActorID edge = stage->new_actor_with_mesh(mesh_id);
+        kglt::ActorID outside = stage->new_actor_with_mesh(mesh_id);
+
+        stage->actor(inside)->move_to(0, 0, -5);
+        stage->actor(edge)->move_to(10, 0, -5);
+        stage->actor(outside)->move_to(100, 0, -5);
+
+        stage->update_transforms();
+        stage->partitioner().update();
+
+        kglt::RenderableList visible;
+        stage->partitioner().geometry_visible_from(camera_id, visible);
+
+        assert_equal(2, visible.size());
+        assert_true(contains(visible, stage->actor(inside)->_subactors().at(0).get()));
+        assert_true(contains(visible, stage->actor(edge)->_subactors().at(0).get()));
+        assert_false(contains(visible, stage->actor(outside)->_subactors().at(0).get()));
+
+        window->delete_camera(camera_id);
+        window->delete_stage(stage_id);
+    }
+};
+
+#endif // TEST_PARTITIONER_H
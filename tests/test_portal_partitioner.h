@@ -0,0 +1,260 @@
+#ifndef TEST_PORTAL_PARTITIONER_H
+#define TEST_PORTAL_PARTITIONER_H
+
+#include <cmath>
+#include <kaztest/kaztest.h>
+
+#include "kglt/kglt.h"
+#include "global.h"
+
+#include "kglt/frustum.h"
+#include "kglt/partitioners/portal_graph.h"
+#include "kglt/partitioners/portal_partitioner.h"
+
+class PortalPartitionerTest : public KGLTTestCase {
+public:
+    void test_finding_zones() {
+        kglt::PortalGraph::ptr graph = rooms_in_a_row(2, 10);
+
+        assert_equal(2, graph->zone_count());
+        assert_equal(1, graph->portal_count());
+
+        assert_equal(0, graph->zone_at(kglt::Vec3(0, 0, -5)));
+        assert_equal(1, graph->zone_at(kglt::Vec3(0, 0, -15)));
+        assert_equal(-1, graph->zone_at(kglt::Vec3(0, 0, 5)));
+
+        //Straddling the wall between them
+        std::vector<uint32_t> zones;
+        graph->zones_overlapping(box(kglt::Vec3(0, 0, -10), 2), zones);
+        assert_equal(2, zones.size());
+        assert_equal(0, zones[0]);
+        assert_equal(1, zones[1]);
+
+        zones.clear();
+        graph->zones_overlapping(box(kglt::Vec3(0, 0, -15), 2), zones);
+        assert_equal(1, zones.size());
+        assert_equal(1, zones[0]);
+
+        assert_raises(std::logic_error, std::bind(&PortalPartitionerTest::join_a_room_to_itself, this));
+    }
+
+    void test_open_walls_agree_with_brute_force() {
+        //Portals the size of the walls hide nothing the frustum doesn't
+        check_against_brute_force(10);
+    }
+
+    void test_doorways_agree_with_brute_force() {
+        check_against_brute_force(2);
+    }
+
+    void test_rooms_behind_walls_are_hidden() {
+        kglt::PortalGraph::ptr graph = rooms_in_a_row(3, 2);
+        std::vector<uint8_t> visible;
+
+        //Looking straight through the doorways
+        graph->visible_zones(kglt::Vec3(0, 0, -1), frustum(kglt::Vec3(0, 0, -1), 0), visible);
+        assert_true(visible[0] && visible[1] && visible[2]);
+
+        //From the side of the room the doorway is too narrow to see past the next room
+        graph->visible_zones(kglt::Vec3(4, 0, -1), frustum(kglt::Vec3(4, 0, -1), 0), visible);
+        assert_true(visible[0] && visible[1]);
+        assert_false(visible[2]);
+
+        //Facing away from the doorway
+        graph->visible_zones(kglt::Vec3(0, 0, -5), frustum(kglt::Vec3(0, 0, -5), 180), visible);
+        assert_true(visible[0]);
+        assert_false(visible[1] || visible[2]);
+
+        //Stood in a doorway, looking into the room beyond
+        graph->visible_zones(kglt::Vec3(0, 0, -10), frustum(kglt::Vec3(0, 0, -10), 0), visible);
+        assert_true(visible[1]);
+
+        //Outside every zone there's nothing to narrow the frustum by
+        graph->visible_zones(kglt::Vec3(0, 0, 5), frustum(kglt::Vec3(0, 0, 5), 180), visible);
+        assert_true(visible[0] && visible[1] && visible[2]);
+    }
+
+    void test_only_actors_in_visible_zones_are_returned() {
+        auto stage_id = window->new_stage(kglt::PARTITIONER_PORTAL);
+        auto stage = window->stage(stage_id);
+
+        auto camera_id = window->new_camera();
+        window->camera(camera_id)->set_perspective_projection(90, 1, 0.1, 100);
+        window->camera(camera_id)->set_transform(translation(kglt::Vec3(0, 0, -1)));
+
+        //Two rooms with a doorway between them over to the right
+        kglt::PortalGraph::ptr graph = kglt::PortalGraph::create();
+        graph->new_zone(bounds(kglt::Vec3(-5, -5, -10), kglt::Vec3(5, 5, 0)));
+        graph->new_zone(bounds(kglt::Vec3(-5, -5, -20), kglt::Vec3(5, 5, -10)));
+        graph->new_portal(0, 1, {
+            kglt::Vec3(3, -1, -10), kglt::Vec3(5, -1, -10), kglt::Vec3(5, 1, -10), kglt::Vec3(3, 1, -10)
+        });
+
+        kglt::MeshID zones_id = stage->new_mesh();
+        stage->mesh(zones_id)->stash(graph, "PORTAL_GRAPH");
+        kglt::ActorID zones_actor = stage->new_actor_with_mesh(zones_id);
+
+        kglt::MeshID cube = stage->new_mesh_as_cube(1);
+        kglt::ActorID near_room = stage->new_actor_with_mesh(cube);
+        kglt::ActorID far_room = stage->new_actor_with_mesh(cube);
+        stage->actor(near_room)->move_to(0, 0, -5);
+        stage->actor(far_room)->move_to(4, 0, -15);
+
+        stage->update_transforms();
+        stage->partitioner().update();
+
+        assert_true(((kglt::PortalPartitioner&) stage->partitioner()).has_graph());
+
+        kglt::RenderableList visible;
+        stage->partitioner().geometry_visible_from(camera_id, visible);
+        assert_equal(1, visible.size());
+        assert_true(contains(visible, stage->actor(near_room)->_subactors().at(0).get()));
+
+        //Moving over so the far room can be seen through the doorway
+        window->camera(camera_id)->set_transform(translation(kglt::Vec3(4, 0, -1)));
+
+        visible.clear();
+        stage->partitioner().geometry_visible_from(camera_id, visible);
+        assert_equal(2, visible.size());
+        assert_true(contains(visible, stage->actor(far_room)->_subactors().at(0).get()));
+
+        //Removing the zones takes the portals with them, so the far room is seen from anywhere
+        window->camera(camera_id)->set_transform(translation(kglt::Vec3(0, 0, -1)));
+        stage->delete_actor(zones_actor);
+        stage->partitioner().update();
+        assert_false(((kglt::PortalPartitioner&) stage->partitioner()).has_graph());
+
+        visible.clear();
+        stage->partitioner().geometry_visible_from(camera_id, visible);
+        assert_true(contains(visible, stage->actor(far_room)->_subactors().at(0).get()));
+
+        window->delete_camera(camera_id);
+        window->delete_stage(stage_id);
+    }
+
+private:
+    /*
+     * Rooms 10 units across, one after another going down -z, with a square doorway of the given
+     * size in the middle of each wall between them.
+     */
+    kglt::PortalGraph::ptr rooms_in_a_row(uint32_t count, float doorway) {
+        kglt::PortalGraph::ptr graph = kglt::PortalGraph::create();
+        for(uint32_t i = 0; i < count; ++i) {
+            float front = -10.0f * i;
+            graph->new_zone(bounds(kglt::Vec3(-5, -5, front - 10), kglt::Vec3(5, 5, front)));
+        }
+
+        float half = doorway / 2;
+        for(uint32_t i = 0; i + 1 < count; ++i) {
+            float wall = -10.0f * (i + 1);
+            graph->new_portal(i, i + 1, {
+                kglt::Vec3(-half, -half, wall), kglt::Vec3(half, -half, wall),
+                kglt::Vec3(half, half, wall), kglt::Vec3(-half, half, wall)
+            });
+        }
+        return graph;
+    }
+
+    /*
+     * Brute force: a room is seen if any of a grid of points in it is in the frustum, and the line
+     * to it from the eye goes through a doorway in each wall on the way. Anything seen this way
+     * must be found through the portals, and anything found through the portals must at least
+     * touch the frustum.
+     */
+    void check_against_brute_force(float doorway) {
+        const uint32_t ROOMS = 4;
+        kglt::PortalGraph::ptr graph = rooms_in_a_row(ROOMS, doorway);
+
+        float xs[] = { -4, 0, 4 };
+        float zs[] = { -1, -5, -9 };
+        std::vector<uint8_t> visible;
+
+        for(float x: xs) {
+            for(float z: zs) {
+                for(float yaw = -60; yaw <= 60; yaw += 15) {
+                    kglt::Vec3 eye(x, 1, z);
+                    kglt::Frustum view = frustum(eye, yaw);
+                    graph->visible_zones(eye, view, visible);
+
+                    for(uint32_t room = 0; room < ROOMS; ++room) {
+                        kglt::AABB room_bounds = bounds(
+                            kglt::Vec3(-5, -5, -10.0f * (room + 1)), kglt::Vec3(5, 5, -10.0f * room)
+                        );
+
+                        if(seen_by_brute_force(eye, view, room, doorway)) {
+                            assert_true(visible[room]);
+                        }
+
+                        if(visible[room]) {
+                            assert_true(view.intersects_aabb(room_bounds));
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    bool seen_by_brute_force(const kglt::Vec3& eye, const kglt::Frustum& view, uint32_t room, float doorway) {
+        for(int i = 0; i <= 10; ++i) {
+            for(int j = 0; j <= 10; ++j) {
+                for(int k = 0; k <= 10; ++k) {
+                    kglt::Vec3 point(-5 + i, -5 + j, -10.0f * room - k);
+                    if(!view.contains_point(point)) {
+                        continue;
+                    }
+
+                    bool through_doorways = true;
+                    for(uint32_t wall = 1; wall <= room; ++wall) {
+                        float t = (-10.0f * wall - eye.z) / (point.z - eye.z);
+                        float x = eye.x + (point.x - eye.x) * t;
+                        float y = eye.y + (point.y - eye.y) * t;
+                        if(std::fabs(x) > doorway / 2 || std::fabs(y) > doorway / 2) {
+                            through_doorways = false;
+                            break;
+                        }
+                    }
+
+                    if(through_doorways) {
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    //A 60 degree perspective frustum at eye, turned about y (0 looks down -z)
+    kglt::Frustum frustum(const kglt::Vec3& eye, float yaw) {
+        float radians = yaw * kmPI / 180.0f;
+
+        kglt::Mat4 transform = translation(eye);
+        transform.mat[0] = std::cos(radians);
+        transform.mat[2] = -std::sin(radians);
+        transform.mat[8] = std::sin(radians);
+        transform.mat[10] = std::cos(radians);
+
+        kglt::Mat4 view, projection, mvp;
+        kmMat4Inverse(&view, &transform);
+        kmMat4PerspectiveProjection(&projection, 60, 1, 0.1, 100);
+        kmMat4Multiply(&mvp, &projection, &view);
+
+        kglt::Frustum result;
+        result.build(&mvp);
+        return result;
+    }
+
+    void join_a_room_to_itself() {
+        kglt::PortalGraph graph;
+        uint32_t room = graph.new_zone(bounds(kglt::Vec3(0, 0, 0), kglt::Vec3(1, 1, 1)));
+        graph.new_portal(room, room, { kglt::Vec3(0, 0, 0), kglt::Vec3(1, 0, 0), kglt::Vec3(1, 1, 0) });
+    }
+
+    kglt::AABB bounds(const kglt::Vec3& min, const kglt::Vec3& max) {
+        kglt::AABB result;
+        result.min = min;
+        result.max = max;
+        return result;
+    }
+};
+
+#endif // TEST_PORTAL_PARTITIONER_H
@@ -0,0 +1,76 @@
+#ifndef TEST_SLOT_MAP_H
+#define TEST_SLOT_MAP_H
+
+#include <kaztest/kaztest.h>
+
+#include "kglt/generic/unique_id.h"
+#include "kglt/generic/slot_map.h"
+
+namespace {
+
+typedef UniqueID<999> ThingID;
+
+struct Thing {
+    Thing(int value): value(value) {}
+    int value;
+};
+
+class SlotMapTest : public TestCase {
+public:
+    typedef kglt::generic::SlotMap<ThingID, Thing> ThingMap;
+
+    ThingID add(ThingMap& map, int value) {
+        ThingID id = map.new_id();
+        map.insert(std::make_pair(id, std::make_shared<Thing>(value)));
+        return id;
+    }
+
+    void test_lookup_and_iteration() {
+        ThingMap map;
+        ThingID a = add(map, 1);
+        ThingID b = add(map, 2);
+        ThingID c = add(map, 3);
+
+        assert_equal(3, map.size());
+        assert_equal(2, map[b]->value);
+
+        //Removing from the front moves the last one into the gap
+        map.erase(a);
+        assert_true(map.find(a) == map.end());
+        assert_equal(2, map[b]->value);
+        assert_equal(3, map[c]->value);
+
+        int total = 0;
+        for(auto& pair: map) {
+            total += pair.second->value;
+        }
+        assert_equal(5, total);
+    }
+
+    void test_stale_ids_are_detected() {
+        ThingMap map;
+        ThingID a = add(map, 1);
+        map.erase(a);
+
+        //Reuses the slot, but not the ID
+        ThingID b = add(map, 2);
+        assert_true(a != b);
+        assert_true(map.find(a) == map.end());
+        assert_equal(0, map.erase(a));
+        assert_equal(2, map[b]->value);
+    }
+
+    void test_reserved_ids_are_not_found() {
+        ThingMap map;
+        ThingID id = map.new_id();
+        assert_true(bool(id));
+        assert_true(map.find(id) == map.end());
+
+        map.release_id(id);
+        assert_raises(std::logic_error, std::bind(&ThingMap::insert, &map, std::make_pair(id, std::make_shared<Thing>(1))));
+    }
+};
+
+}
+
+#endif // TEST_SLOT_MAP_H
@@ -0,0 +1,81 @@
+#ifndef TEST_SPATIAL_HASH_H
+#define TEST_SPATIAL_HASH_H
+
+#include <kaztest/kaztest.h>
+
+#include "kglt/kglt.h"
+#include "global.h"
+
+#include "kglt/partitioners/spatial_hash.h"
+
+class SpatialHashTest : public KGLTTestCase {
+public:
+    void test_objects_are_listed_in_the_cells_they_overlap() {
+        kglt::SpatialHash hash(4.0);
+
+        //Straddles the corner of four cells
+        BoundableObject obj(2);
+        obj.set_centre(kglt::Vec3(4, 4, 0));
+        hash.insert(&obj);
+
+        assert_equal(1, hash.object_count());
+        assert_equal(4, hash.cell_count());
+
+        //Found from any of them, but only once
+        uint32_t found = 0;
+        hash.visit_overlapping(box(kglt::Vec3(4, 4, 0), 8), [&found](const kglt::BoundableEntity*, kglt::Renderable*) {
+            ++found;
+        });
+        assert_equal(1, found);
+
+        hash.remove(&obj);
+        assert_equal(0, hash.object_count());
+        assert_equal(0, hash.cell_count());
+    }
+
+    void test_moving_objects() {
+        kglt::SpatialHash hash(4.0);
+
+        BoundableObject obj(1);
+        obj.set_centre(kglt::Vec3(1, 1, 0));
+        hash.insert(&obj);
+
+        //Within the same cell, nothing changes
+        obj.set_centre(kglt::Vec3(2, 2, 0));
+        assert_false(hash.update(&obj));
+
+        obj.set_centre(kglt::Vec3(50, -50, 0));
+        assert_true(hash.update(&obj));
+        assert_equal(1, hash.cell_count());
+
+        uint32_t found = 0;
+        auto count = [&found](const kglt::BoundableEntity*, kglt::Renderable*) { ++found; };
+
+        hash.visit_overlapping(box(kglt::Vec3(2, 2, 0), 4), count);
+        assert_equal(0, found);
+
+        hash.visit_overlapping(box(kglt::Vec3(50, -50, 0), 4), count);
+        assert_equal(1, found);
+    }
+
+    void test_large_objects_are_found_everywhere_they_overlap() {
+        kglt::SpatialHash hash(1.0);
+
+        //Far more cells than are worth listing it in
+        BoundableObject map(100);
+        hash.insert(&map);
+        assert_equal(0, hash.cell_count());
+
+        uint32_t found = 0;
+        auto count = [&found](const kglt::BoundableEntity*, kglt::Renderable*) { ++found; };
+
+        hash.visit_overlapping(box(kglt::Vec3(40, 40, 0), 1), count);
+        assert_equal(1, found);
+
+        //Beyond its edge
+        hash.visit_overlapping(box(kglt::Vec3(60, 60, 0), 1), count);
+        assert_equal(1, found);
+    }
+};
+
+#endif // TEST_SPATIAL_HASH_H
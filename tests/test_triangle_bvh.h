@@ -0,0 +1,127 @@
+#ifndef TEST_TRIANGLE_BVH_H
+#define TEST_TRIANGLE_BVH_H
+
+#include <kaztest/kaztest.h>
+
+#include "kglt/kglt.h"
+#include "global.h"
+
+#include "kglt/utils/triangle_bvh.h"
+
+class TriangleBVHTest : public KGLTTestCase {
+public:
+    void test_raycast_finds_the_nearest_triangle() {
+        std::vector<kmVec3> corners;
+
+        //A row of upright triangles facing along x, further away as they go
+        for(int i = 0; i < 20; ++i) {
+            add_triangle(corners, float(i));
+        }
+
+        kglt::TriangleBVH bvh;
+        bvh.build(corners);
+
+        assert_equal(20, bvh.triangle_count());
+        assert_true(bvh.node_count() > 1);
+
+        kglt::TriangleHit hit;
+        assert_true(bvh.raycast(kglt::Ray(kglt::Vec3(-1.5, 0, 0), kglt::Vec3(1, 0, 0)), hit));
+        assert_equal(0, hit.triangle);
+        assert_close(1.5, hit.distance, 0.0001);
+
+        //From the other end
+        assert_true(bvh.raycast(kglt::Ray(kglt::Vec3(25, 0, 0), kglt::Vec3(-1, 0, 0)), hit));
+        assert_equal(19, hit.triangle);
+        assert_close(6, hit.distance, 0.0001);
+
+        //Starting between two of them
+        assert_true(bvh.raycast(kglt::Ray(kglt::Vec3(7.5, 0, 0), kglt::Vec3(1, 0, 0)), hit));
+        assert_equal(8, hit.triangle);
+        assert_close(0.5, hit.distance, 0.0001);
+    }
+
+    void test_misses() {
+        std::vector<kmVec3> corners;
+        add_triangle(corners, 0);
+
+        kglt::TriangleBVH bvh;
+        bvh.build(corners);
+
+        kglt::TriangleHit hit;
+
+        //Passes above it
+        assert_false(bvh.raycast(kglt::Ray(kglt::Vec3(-1, 5, 0), kglt::Vec3(1, 0, 0)), hit));
+
+        //Stops short of it
+        assert_false(bvh.raycast(kglt::Ray(kglt::Vec3(-1, 0, 0), kglt::Vec3(1, 0, 0), 0.5), hit));
+        assert_false(bvh.intersects(kglt::Ray(kglt::Vec3(-1, 0, 0), kglt::Vec3(1, 0, 0), 0.5)));
+        assert_true(bvh.intersects(kglt::Ray(kglt::Vec3(-1, 0, 0), kglt::Vec3(1, 0, 0), 1.5)));
+
+        //Points away from it
+        assert_false(bvh.raycast(kglt::Ray(kglt::Vec3(-1, 0, 0), kglt::Vec3(-1, 0, 0)), hit));
+
+        bvh.clear();
+        assert_true(bvh.empty());
+        assert_false(bvh.intersects(kglt::Ray(kglt::Vec3(-1, 0, 0), kglt::Vec3(1, 0, 0))));
+    }
+
+    void test_stage_raycast() {
+        auto stage_id = window->new_stage(kglt::PARTITIONER_OCTREE);
+        auto stage = window->stage(stage_id);
+
+        kglt::MeshID mesh_id = stage->new_mesh_as_cube(1);
+
+        kglt::ActorID near = stage->new_actor_with_mesh(mesh_id);
+        kglt::ActorID far = stage->new_actor_with_mesh(mesh_id);
+
+        stage->actor(near)->move_to(0, 0, -5);
+        stage->actor(far)->move_to(5, 0, -5);
+
+        stage->update_transforms();
+        stage->partitioner().update();
+
+        kglt::RaycastHit hit;
+        assert_true(stage->raycast(kglt::Ray(kglt::Vec3(-10, 0, -5), kglt::Vec3(1, 0, 0)), hit));
+        assert_true(hit.renderable == stage->actor(near)->_subactors().at(0).get());
+        assert_close(9.5, hit.distance, 0.0001);
+
+        //Hits the far side of the further cube from beyond it
+        assert_true(stage->raycast(kglt::Ray(kglt::Vec3(20, 0, -5), kglt::Vec3(-1, 0, 0)), hit));
+        assert_true(hit.renderable == stage->actor(far)->_subactors().at(0).get());
+        assert_close(14.5, hit.distance, 0.0001);
+
+        assert_false(stage->raycast(kglt::Ray(kglt::Vec3(-10, 5, -5), kglt::Vec3(1, 0, 0)), hit));
+
+        assert_false(stage->line_of_sight(kglt::Vec3(-10, 0, -5), kglt::Vec3(10, 0, -5)));
+        assert_true(stage->line_of_sight(kglt::Vec3(-10, 0, -5), kglt::Vec3(-1, 0, -5)));
+        assert_true(stage->line_of_sight(kglt::Vec3(-10, 5, -5), kglt::Vec3(10, 5, -5)));
+
+        window->delete_stage(stage_id);
+    }
+
+    void test_submesh_bvh_snapshots_outlive_changes() {
+        kglt::MeshID mesh_id = window->new_mesh_as_cube(1);
+        auto mesh = window->mesh(mesh_id);
+        kglt::SubMesh& sm = mesh->submesh(mesh->submesh_ids()[0]);
+
+        std::shared_ptr<const kglt::TriangleBVH> before = sm.triangle_bvh();
+        assert_false(before->empty());
+        assert_true(before == sm.triangle_bvh());
+
+        //Finishing an update drops the cached one, but the snapshot we have is still usable
+        sm.index_data().done();
+
+        std::shared_ptr<const kglt::TriangleBVH> after = sm.triangle_bvh();
+        assert_true(before != after);
+        assert_true(before->intersects(kglt::Ray(kglt::Vec3(-10, 0, 0), kglt::Vec3(1, 0, 0))));
+    }
+
+private:
+    void add_triangle(std::vector<kmVec3>& corners, float x) {
+        corners.push_back(kglt::Vec3(x, -1, -1));
+        corners.push_back(kglt::Vec3(x, 1, -1));
+        corners.push_back(kglt::Vec3(x, 0, 1));
+    }
+};
+
+#endif // TEST_TRIANGLE_BVH_H
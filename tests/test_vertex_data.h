@@ -11,8 +11,212 @@ public:
     void test_offsets() {
         kglt::VertexData::ptr data = kglt::VertexData::create();
 
+        data->position(0, 0, 0);
+        data->normal(0, 0, 1);
+        data->move_next();
+
         assert_equal(0, (int32_t) data->position_offset());
         assert_equal(sizeof(float) * 3, data->normal_offset());
+        assert_equal(sizeof(float) * 6, data->stride());
+    }
+
+    void test_only_enabled_attributes_are_stored() {
+        kglt::VertexData::ptr data = kglt::VertexData::create();
+
+        data->position(1, 2);
+        data->tex_coord0(0.5, 0.5);
+        data->move_next();
+
+        assert_equal(sizeof(float) * 5, data->stride());
+        assert_equal(sizeof(float) * 3, data->texcoord0_offset());
+        assert_false(data->has_normals());
+        assert_raises(std::logic_error, std::bind(&kglt::VertexData::normal_offset, data.get()));
+    }
+
+    void test_packed_specification() {
+        kglt::VertexSpecification spec;
+        spec.position_attribute = kglt::VERTEX_ATTRIBUTE_TYPE_3F;
+        spec.normal_attribute = kglt::VERTEX_ATTRIBUTE_TYPE_PACKED_NORMAL;
+        spec.texcoord_attributes[0] = kglt::VERTEX_ATTRIBUTE_TYPE_2H;
+        spec.diffuse_attribute = kglt::VERTEX_ATTRIBUTE_TYPE_4UB_NORMALIZED;
+
+        kglt::VertexData::ptr data = kglt::VertexData::create(spec);
+
+        assert_equal((uint32_t) 24, data->stride());
+        assert_equal((uint32_t) 12, data->normal_offset());
+        assert_equal((uint32_t) 16, data->texcoord0_offset());
+        assert_equal((uint32_t) 20, data->diffuse_offset());
+
+        data->position(1, 2, 3);
+        data->normal(0, -1, 0);
+        data->tex_coord0(0.25, 0.75);
+        data->diffuse(kglt::Colour::WHITE);
+        data->move_next();
+
+        assert_equal((uint16_t) 1, data->count());
+        assert_close(2.0f, data->position_at(0).y, 0.0001f);
+        assert_close(-1.0f, data->normal_at(0).y, 0.01f);
+        assert_close(0.0f, data->normal_at(0).x, 0.01f);
+    }
+
+    void test_every_texcoord_has_an_attribute() {
+        kglt::VertexSpecification spec;
+        spec.position_attribute = kglt::VERTEX_ATTRIBUTE_TYPE_3F;
+        for(uint8_t i = 0; i < kglt::MAX_TEXCOORDS; ++i) {
+            spec.texcoord_attributes[i] = kglt::VERTEX_ATTRIBUTE_TYPE_2F;
+        }
+        spec.diffuse_attribute = kglt::VERTEX_ATTRIBUTE_TYPE_4F;
+
+        kglt::VertexData::ptr data = kglt::VertexData::create(spec);
+
+        assert_true(data->has_texcoord4());
+        assert_equal(sizeof(float) * 11, data->texcoord4_offset());
+        assert_equal(sizeof(float) * 13, data->diffuse_offset());
+        assert_equal(sizeof(float) * 17, data->stride());
+    }
+
+    void test_attributes_are_repacked_on_first_vertex() {
+        kglt::VertexData::ptr data = kglt::VertexData::create();
+
+        data->position(1, 2, 3);
+        data->diffuse(kglt::Colour::WHITE);
+        data->normal(0, 0, 1);
+        data->move_next();
+
+        assert_close(3.0f, data->position_at(0).z, 0.0001f);
+        assert_close(1.0f, data->normal_at(0).z, 0.0001f);
+
+        data->position(4, 5, 6);
+        assert_raises(std::logic_error, std::bind(
+            static_cast<void (kglt::VertexData::*)(float, float, float, float)>(&kglt::VertexData::specular),
+            data.get(), 1, 1, 1, 1
+        ));
+    }
+
+    void test_modified_vertices_are_tracked() {
+        kglt::VertexData::ptr data = kglt::VertexData::create();
+
+        for(uint32_t i = 0; i < 10; ++i) {
+            data->position(i, 0, 0);
+            data->move_next();
+        }
+        data->done();
+
+        //Nothing has been uploaded yet
+        assert_true(data->dirty_ranges().all());
+        data->mark_clean();
+        assert_true(data->dirty_ranges().empty());
+
+        data->move_to(2);
+        data->position(0, 1, 0);
+        data->move_to(3);
+        data->position(0, 1, 0);
+        data->move_to(7);
+        data->position(0, 1, 0);
+
+        auto ranges = data->dirty_ranges().ranges();
+        assert_false(data->dirty_ranges().all());
+        assert_equal((uint32_t) 2, ranges.size());
+        assert_equal((uint32_t) 2, ranges[0].first);
+        assert_equal((uint32_t) 2, ranges[0].count);
+        assert_equal((uint32_t) 7, ranges[1].first);
+        assert_equal((uint32_t) 1, ranges[1].count);
+
+        //Filling the gap coalesces everything into one range
+        data->move_to(4);
+        for(uint32_t i = 4; i < 7; ++i) {
+            data->position(0, 1, 0);
+            data->move_next();
+        }
+
+        ranges = data->dirty_ranges().ranges();
+        assert_equal((uint32_t) 1, ranges.size());
+        assert_equal((uint32_t) 2, ranges[0].first);
+        assert_equal((uint32_t) 6, ranges[0].count);
+    }
+
+    void test_bulk_writes() {
+        struct Point {
+            kglt::Vec3 position;
+            float ttl;
+            kglt::Colour colour;
+        };
+
+        std::vector<Point> points(3);
+        for(uint32_t i = 0; i < 3; ++i) {
+            points[i].position = kglt::Vec3(i, i * 2, i * 3);
+            points[i].colour = kglt::Colour(0, 0, 1, 1);
+        }
+
+        kglt::VertexSpecification spec;
+        spec.position_attribute = kglt::VERTEX_ATTRIBUTE_TYPE_3F;
+        spec.diffuse_attribute = kglt::VERTEX_ATTRIBUTE_TYPE_4UB_NORMALIZED;
+
+        kglt::VertexData::ptr data = kglt::VertexData::create(spec);
+        data->write_positions(0, &points[0].position, 3, sizeof(Point));
+        data->write_diffuse(0, &points[0].colour, 3, sizeof(Point));
+
+        assert_equal((uint32_t) 3, data->count());
+        assert_close(4.0f, data->position_at(2).y, 0.0001f);
+        assert_close(6.0f, data->position_at(2).z, 0.0001f);
+
+        //Texture coordinates weren't declared, so they get added
+        const float uvs[] = { 0, 0, 1, 0, 1, 1, 0, 1 };
+        data->write_tex_coords(0, 1, uvs, 4);
+
+        assert_true(data->has_texcoord0());
+        assert_equal((uint32_t) 5, data->count());
+        assert_close(1.0f, data->position_at(1).x, 0.0001f);
+
+        const uint32_t indices[] = { 0, 1, 2, 70000 };
+        kglt::IndexData index_data;
+        index_data.index(indices, 3);
+        assert_equal(kglt::INDEX_TYPE_16_BIT, index_data.index_type());
+        index_data.index(indices, 4);
+        assert_equal(kglt::INDEX_TYPE_32_BIT, index_data.index_type());
+        assert_equal((uint32_t) 7, index_data.count());
+        assert_equal((uint32_t) 70000, index_data.at(6));
+    }
+};
+
+class IndexDataTest : public KGLTTestCase {
+public:
+    void test_narrowest_index_type() {
+        kglt::IndexData data;
+        data.index(0);
+        data.index(65535);
+        data.done();
+
+        assert_equal(kglt::INDEX_TYPE_16_BIT, data.index_type());
+        assert_equal((uint32_t) sizeof(uint16_t), data.index_size());
+
+        data.index(70000);
+        data.done();
+
+        assert_equal(kglt::INDEX_TYPE_32_BIT, data.index_type());
+        assert_equal((uint32_t) 3, data.count());
+        assert_equal((uint32_t) 65535, data.at(1));
+        assert_equal((uint32_t) 70000, data.at(2));
+
+        data.clear();
+        data.index(1);
+        data.done();
+
+        assert_equal(kglt::INDEX_TYPE_16_BIT, data.index_type());
+    }
+
+    void test_dirty_ranges_are_bounded() {
+        kglt::DirtyRanges ranges;
+        ranges.clear();
+
+        //Every other element, so nothing is adjacent
+        for(uint32_t i = 0; i < kglt::DirtyRanges::MAX_RANGES * 4; i += 2) {
+            ranges.mark(i);
+        }
+
+        assert_equal(kglt::DirtyRanges::MAX_RANGES, ranges.ranges().size());
+        assert_equal((uint32_t) 0, ranges.ranges().front().first);
+        assert_equal(kglt::DirtyRanges::MAX_RANGES * 4 - 1, ranges.ranges().back().end());
     }
 };
 